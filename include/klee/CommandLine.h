@@ -27,10 +27,14 @@ extern llvm::cl::opt<bool> UseFastCexSolver;
 
 extern llvm::cl::opt<bool> UseCexCache;
 
+extern llvm::cl::opt<bool> UseIntervalSolver;
+
 extern llvm::cl::opt<bool> UseCache;
 
 extern llvm::cl::opt<bool> UseIndependentSolver; 
 
+extern llvm::cl::opt<unsigned> IndependentSolverThreads;
+
 extern llvm::cl::opt<bool> DebugValidateSolver;
   
 extern llvm::cl::opt<int> MinQueryTimeToLog;
@@ -46,8 +50,10 @@ enum QueryLoggingSolverType
 {
     ALL_PC,       ///< Log all queries (un-optimised) in .pc (KQuery) format
     ALL_SMTLIB,   ///< Log all queries (un-optimised)  .smt2 (SMT-LIBv2) format
+    ALL_BINARY,   ///< Log all queries (un-optimised) in the binary format
     SOLVER_PC,    ///< Log queries passed to solver (optimised) in .pc (KQuery) format
-    SOLVER_SMTLIB ///< Log queries passed to solver (optimised) in .smt2 (SMT-LIBv2) format
+    SOLVER_SMTLIB, ///< Log queries passed to solver (optimised) in .smt2 (SMT-LIBv2) format
+    SOLVER_BINARY ///< Log queries passed to solver (optimised) in the binary format
 };
 
 /* Using cl::list<> instead of cl::bits<> results in quite a bit of ugliness when it comes to checking
@@ -13,6 +13,7 @@
 
 #ifndef KLEE_COMMON_H
 #define KLEE_COMMON_H
+#include "klee/CommandLine.h"
 #include "klee/Solver.h"
 #include <string>
 
@@ -21,12 +22,33 @@ namespace klee {
     const char SOLVER_QUERIES_SMT2_FILE_NAME[]="solver-queries.smt2";
     const char ALL_QUERIES_PC_FILE_NAME[]="all-queries.pc";
     const char SOLVER_QUERIES_PC_FILE_NAME[]="solver-queries.pc";
+    const char ALL_QUERIES_BINARY_FILE_NAME[]="all-queries.kqlog";
+    const char SOLVER_QUERIES_BINARY_FILE_NAME[]="solver-queries.kqlog";
+
+    /// The choice of solvers making up a chain. By default these are
+    /// taken from the command line options, so that callers building
+    /// chains of other configurations need not change those options.
+    struct SolverChainOptions {
+      CoreSolverType coreSolver;
+      bool cexCache, cache, interval, independent;
+      /// Worker threads of the independent solver.
+      unsigned independentThreads;
+      /// Whether to log queries as --use-query-log asks. A second chain
+      /// logging to the same files would clobber the first one's logs.
+      bool logQueries;
+
+      SolverChainOptions();
+    };
 
     Solver *constructSolverChain(Solver *coreSolver,
                                  std::string querySMT2LogPath,
                                  std::string baseSolverQuerySMT2LogPath,
                                  std::string queryPCLogPath,
-                                 std::string baseSolverQueryPCLogPath);
+                                 std::string baseSolverQueryPCLogPath,
+                                 std::string queryBinaryLogPath,
+                                 std::string baseSolverQueryBinaryLogPath,
+                                 const SolverChainOptions &options =
+                                     SolverChainOptions());
 }
 
 
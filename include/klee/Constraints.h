@@ -12,6 +12,8 @@
 
 #include "klee/Expr.h"
 
+#include <map>
+
 // FIXME: Currently we use ConstraintManager for two things: to pass
 // sets of constraints around, and to optimize constraints. We should
 // move the first usage into a separate data structure
@@ -19,21 +21,81 @@
 namespace klee {
 
 class ExprVisitor;
-  
+
+/// ArrayPartition - A union-find over the arrays read by a set of
+/// constraints. Two arrays share a class iff some chain of constraints
+/// (transitively) reads both of them. A partition is shared between the
+/// constraint managers of forked states and copied on first write.
+class ArrayPartition {
+public:
+  unsigned refCount;
+
+  ArrayPartition() : refCount(0) {}
+  ArrayPartition(const ArrayPartition &ap)
+    : refCount(0), parent(ap.parent), rank(ap.rank) {}
+
+  /// Returns the representative of the class containing \a array. Arrays
+  /// which were never added are their own representative.
+  const Array *find(const Array *array) const;
+
+  /// Merges the classes of \a a and \a b.
+  void unite(const Array *a, const Array *b);
+
+private:
+  // Union by rank keeps the trees logarithmic, which lets find() stay
+  // const (no path compression) so it can be used from queries.
+  std::map<const Array*, const Array*> parent;
+  std::map<const Array*, unsigned> rank;
+
+  ArrayPartition &operator=(const ArrayPartition &);
+};
+
+/// EqualityIndex - The substitutions ConstraintManager::simplifyExpr makes
+/// for a set of constraints: the right side of each equality with a
+/// constant by that constant, and every other constraint by true. Kept up
+/// to date as constraints are added and rewritten rather than rebuilt for
+/// every query, and shared between forked states until first written.
+class EqualityIndex {
+public:
+  unsigned refCount;
+
+  EqualityIndex() : refCount(0) {}
+  EqualityIndex(const EqualityIndex &ei)
+    : refCount(0), equalities(ei.equalities), uses(ei.uses) {}
+
+  void add(ref<Expr> constraint);
+  void remove(ref<Expr> constraint);
+
+  const std::map< ref<Expr>, ref<Expr> > &getEqualities() const {
+    return equalities;
+  }
+
+private:
+  std::map< ref<Expr>, ref<Expr> > equalities;
+  // The number of constraints giving each key of equalities. If several
+  // do, the first one added determines the substitution.
+  std::map< ref<Expr>, unsigned > uses;
+
+  EqualityIndex &operator=(const EqualityIndex &);
+};
+
 class ConstraintManager {
 public:
   typedef std::vector< ref<Expr> > constraints_ty;
   typedef constraints_ty::iterator iterator;
   typedef constraints_ty::const_iterator const_iterator;
 
-  ConstraintManager() {}
+  ConstraintManager() : tracksPartition(true) {}
 
   // create from constraints with no optimization
   explicit
   ConstraintManager(const std::vector< ref<Expr> > &_constraints) :
-    constraints(_constraints) {}
+    constraints(_constraints), tracksPartition(false) {}
 
-  ConstraintManager(const ConstraintManager &cs) : constraints(cs.constraints) {}
+  ConstraintManager(const ConstraintManager &cs)
+    : constraints(cs.constraints), representatives(cs.representatives),
+      partition(cs.partition), equalities(cs.equalities),
+      tracksPartition(cs.tracksPartition) {}
 
   typedef std::vector< ref<Expr> >::const_iterator constraint_iterator;
 
@@ -69,11 +131,49 @@ public:
 	  return constraints;
   }
 
+  /// Returns true iff the array partition of this constraint set is
+  /// maintained, i.e. every constraint was added through addConstraint.
+  bool hasArrayPartition() const {
+    return tracksPartition;
+  }
+
+  /// Collects, in order, the constraints whose arrays are in the same
+  /// partition class as one of \a arrays. This is a superset of the
+  /// constraints the independent solver would keep for those arrays.
+  /// Requires hasArrayPartition().
+  void getDependentConstraints(const std::vector<const Array*> &arrays,
+                               std::vector< ref<Expr> > &result) const;
+
+  /// Splits the constraints, preserving their relative order, into one
+  /// group per partition class. Constraints which read no arrays are
+  /// dropped. Requires hasArrayPartition().
+  void getPartitionClasses(std::vector< std::vector< ref<Expr> > > &result)
+    const;
+
+  /// Appends to \a result the arrays a constraint depends on, in the
+  /// sense of the independent solver (reads of unmodified constant arrays
+  /// are ignored).
+  static void findDependentArrays(ref<Expr> e,
+                                  std::vector<const Array*> &result);
+
 private:
   std::vector< ref<Expr> > constraints;
 
-  // returns true iff the constraints were modified
-  bool rewriteConstraints(ExprVisitor &visitor);
+  // One entry per constraint: an array read by it (or null if it reads
+  // none), used to look up the constraint's partition class.
+  std::vector<const Array*> representatives;
+  ref<ArrayPartition> partition;
+  // Maintained along with the partition; null until the first constraint.
+  ref<EqualityIndex> equalities;
+  bool tracksPartition;
+
+  void pushConstraint(ref<Expr> e);
+
+  // returns true iff the constraints were modified. If \a arrays is given,
+  // only the constraints in the same partition class as one of them are
+  // visited.
+  bool rewriteConstraints(ExprVisitor &visitor,
+                          const std::vector<const Array*> *arrays = 0);
 
   void addConstraintInternal(ref<Expr> e);
 };
@@ -32,7 +32,7 @@
 namespace klee {
 class Array;
 class CallPathNode;
-struct Cell;
+class Cell;
 struct KFunction;
 struct KInstruction;
 class MemoryObject;
@@ -69,6 +69,33 @@ struct StackFrame {
   ~StackFrame();
 };
 
+/// @brief The states forked at one branch, which may be merged again where
+/// the two sides of the branch join
+struct MergeGroup {
+  unsigned refCount;
+
+  /// @brief Creation order of the group, to keep merging deterministic
+  uint64_t id;
+
+  MergeGroup();
+};
+
+/// @brief A join point that a state is still to reach before it can be
+/// merged with the other states of its group
+struct PendingMerge {
+  /// @brief First instruction after the PHI nodes of the join block
+  llvm::Instruction *point;
+
+  /// @brief Stack depth of the frame the branch was executed in
+  unsigned depth;
+
+  ref<MergeGroup> group;
+
+  PendingMerge(llvm::Instruction *_point, unsigned _depth,
+               const ref<MergeGroup> &_group)
+      : point(_point), depth(_depth), group(_group) {}
+};
+
 /// @brief ExecutionState representing a path under exploration
 class ExecutionState {
 public:
@@ -127,6 +154,31 @@ public:
   /// taken to reach/create this state
   TreeOStream symPathOS;
 
+  /// @brief The successor taken at each fork or branch of this state, kept
+  /// only while writing or resuming checkpoints
+  std::vector<unsigned> branchDecisions;
+
+  /// @brief The range of checkpointed states being resumed which descend
+  /// from this state; empty once the state is explored as usual
+  unsigned resumeBegin, resumeEnd;
+
+  /// @brief The instruction count when the state was last selected for
+  /// execution; the least recently selected states are swapped out first
+  uint64_t lastSelected;
+
+  /// @brief Offset of the branch decisions of the state in the executor's
+  /// swap file while the state is swapped out, or -1
+  long swapOffset;
+
+  /// @brief The instruction count before which the state may not be
+  /// swapped out again, so that it runs for at least as long as replaying
+  /// it took
+  uint64_t swapHoldUntil;
+
+  /// @brief Whether the state has called an external function. Replaying
+  /// its path would call it again, so such a state is never swapped out
+  bool madeExternalCalls;
+
   /// @brief Counts how many instructions were executed since the last new
   /// instruction was covered.
   unsigned instsSinceCovNew;
@@ -154,10 +206,28 @@ public:
   /// @brief Set of used array names for this state.  Used to avoid collisions.
   std::set<std::string> arrayNames;
 
+  /// @brief Join points of the branches this state forked at and has not
+  /// passed yet, innermost last
+  std::vector<PendingMerge> pendingMerges;
+
   std::string getFnAlias(std::string fn);
   void addFnAlias(std::string old_fn, std::string new_fn);
   void removeFnAlias(std::string fn);
 
+  /// @brief Drop the memory, constraints, symbolics and stack of the state
+  /// but for its top frame, keeping only what identifies it to the searcher
+  /// and process tree
+  void releaseExecution();
+
+  /// @brief Take the memory, constraints, stack and symbolics of
+  /// \a initial, to execute again from where it is
+  void restartExecution(const ExecutionState &initial);
+
+  /// @brief Approximate number of heap bytes that terminating this state
+  /// would free: its unshared object states, constraints, stack and
+  /// interpolation tree shadow data
+  size_t getExclusiveBytes() const;
+
 private:
   ExecutionState() : ptreeNode(0), txTreeNode(0) {}
 
@@ -190,7 +260,10 @@ public:
     constraints.addConstraint(e);
   }
 
-  bool merge(const ExecutionState &b);
+  /// @brief Merge \a b into this state, joining differing locals and
+  /// memory with if-then-else expressions. Gives up if more than
+  /// \a maxSelects values would need joining (0 for no limit).
+  bool merge(const ExecutionState &b, unsigned maxSelects = 0);
   void dumpStack(llvm::raw_ostream &out) const;
   void debugSubsumption(uint64_t level);
   void debugSubsumptionOff();
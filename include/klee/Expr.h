@@ -35,6 +35,7 @@ class Array;
 class ArrayCache;
 class ConstantExpr;
 class ObjectState;
+class UpdateNode;
 
 template<class T> class ref;
 
@@ -89,7 +90,9 @@ Todo: Shouldn't bool \c Xor just be written as not equal?
 
 class Expr {
 public:
-  static unsigned count;
+  /// Expressions created less those destroyed by the calling thread. Kept
+  /// per thread, as solver and writer threads build expressions too.
+  static __thread unsigned count;
   static const unsigned MAGIC_HASH_CONSTANT = 39;
 
   /// The type of an expression is simply its width, in bits. 
@@ -173,10 +176,19 @@ public:
 
 protected:  
   unsigned hashValue;
+
+private:
+  /// The number of expressions in the hash-consing table (see intern()).
+  static unsigned internedCount;
+  static void unintern(Expr *e);
   
 public:
   Expr() : refCount(0) { Expr::count++; }
-  virtual ~Expr() { Expr::count--; } 
+  virtual ~Expr() {
+    Expr::count--;
+    if (internedCount)
+      unintern(this);
+  }
 
   virtual Kind getKind() const = 0;
   virtual Width getWidth() const = 0;
@@ -249,6 +261,16 @@ public:
   struct CreateArg;
   static ref<Expr> createFromKind(Kind k, std::vector<CreateArg> args);
 
+  /// intern - Return the canonical expression structurally equal to \a e,
+  /// making \a e canonical if there is none yet. Canonical expressions leave
+  /// the table when they are destroyed. The table is not thread-safe: once
+  /// anything is interned, every expression destroyed looks it up, so no
+  /// other thread may destroy expressions while it is in use.
+  static ref<Expr> intern(const ref<Expr> &e);
+
+  /// getInternedCount - The number of canonical expressions alive.
+  static unsigned getInternedCount() { return internedCount; }
+
   static bool isValidKidWidth(unsigned kid, Width w) { return true; }
   static bool needsResultType() { return false; }
 
@@ -448,6 +470,26 @@ public:
 };
 
 
+/// Class indexing the updates at constant indices in a segment of an update
+/// sequence, from the update it is attached to down to the most recent
+/// update at a non-constant index.
+class UpdateSnapshot {
+public:
+  typedef std::vector<std::pair<uint64_t, const UpdateNode*> > entries_ty;
+
+  /// the most recent update at each constant index in the segment, sorted
+  /// by index
+  entries_ty entries;
+
+  /// the update below the segment, which has a non-constant index, or null
+  /// if the segment reaches the start of the sequence
+  const UpdateNode *tail;
+
+  UpdateSnapshot() : tail(0) {}
+
+  const UpdateNode *lookup(uint64_t index) const;
+};
+
 /// Class representing a byte update of an array.
 class UpdateNode {
   friend class UpdateList;  
@@ -463,6 +505,18 @@ public:
 private:
   /// size of this update sequence, including this update
   unsigned size;
+
+  /// Every so often an update with a constant index is given a snapshot, so
+  /// that reads at constant indices need not walk the whole sequence. The
+  /// distance between snapshots grows with their size, which keeps the
+  /// cost of building them linear in the length of the sequence.
+  static const unsigned SnapshotInterval = 32;
+
+  UpdateSnapshot *snapshot;
+
+  /// the closest update below this one which has a snapshot or a
+  /// non-constant index, or null
+  const UpdateNode *snapshotBase;
   
 public:
   UpdateNode(const UpdateNode *_next, 
@@ -471,14 +525,27 @@ public:
 
   unsigned getSize() const { return size; }
 
+  /// getSnapshot - The snapshot of the sequence ending at this update, or
+  /// null if it does not have one.
+  const UpdateSnapshot *getSnapshot() const { return snapshot; }
+
+  /// findConstantWrite - Find the most recent update at or below this one
+  /// which writes the constant index \a index, looking only past updates at
+  /// other constant indices. Returns null if there is none, with \a barrier
+  /// set to the update at a non-constant index which was reached, or null if
+  /// the search reached the start of the sequence.
+  const UpdateNode *findConstantWrite(uint64_t index,
+                                      const UpdateNode *&barrier) const;
+
   int compare(const UpdateNode &b) const;  
   unsigned hash() const { return hashValue; }
 
 private:
-  UpdateNode() : refCount(0) {}
+  UpdateNode() : refCount(0), snapshot(0), snapshotBase(0) {}
   ~UpdateNode();
 
   unsigned computeHash();
+  void buildSnapshot();
 };
 
 class Array {
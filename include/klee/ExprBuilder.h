@@ -86,6 +86,13 @@ namespace klee {
   ///
   /// Base - The base builder to use when constructing expressions.
   ExprBuilder *createSimplifyingExprBuilder(ExprBuilder *Base);
+
+  /// createHashConsingExprBuilder - Create an expression builder which
+  /// returns the same node for structurally equal expressions, so that they
+  /// compare equal by pointer and are stored once (see Expr::intern).
+  ///
+  /// Base - The base builder to use when constructing expressions.
+  ExprBuilder *createHashConsingExprBuilder(ExprBuilder *Base);
 }
 
 #endif
@@ -80,6 +80,11 @@ public:
                                     std::vector< std::vector<unsigned char> > 
                                       &values,
                                     bool &hasSolution) = 0;
+
+  /// getUnsatCore - Set \a core to the constraints used to decide the last
+  /// query which was decided. Returns false if the solver does not keep
+  /// track of them.
+  virtual bool getUnsatCore(std::vector< ref<Expr> > &core) { return false; }
 };
 
 /// StagedSolver - Adapter class for staging an incomplete solver with
@@ -89,6 +94,12 @@ class StagedSolverImpl : public SolverImpl {
 private:
   IncompleteSolver *primary;
   Solver *secondary;
+  /// The unsatisfiability core of the last query decided by the primary
+  /// solver, if it provides one.
+  std::vector< ref<Expr> > primaryCore;
+  bool usePrimaryCore;
+
+  void setPrimaryDecided();
   
 public:
   StagedSolverImpl(IncompleteSolver *_primary, Solver *_secondary);
@@ -104,9 +115,7 @@ public:
   SolverRunStatus getOperationStatusCode();
   char *getConstraintLog(const Query&);
   void setCoreSolverTimeout(double timeout);
-  std::vector<ref<Expr> > &getUnsatCore() {
-    return secondary->impl->getUnsatCore();
-  }
+  std::vector<ref<Expr> > &getUnsatCore();
 };
 
 }
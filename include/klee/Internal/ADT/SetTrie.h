@@ -0,0 +1,208 @@
+//===-- SetTrie.h -----------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_SETTRIE_H
+#define KLEE_SETTRIE_H
+
+#include <cassert>
+#include <functional>
+#include <map>
+#include <utility>
+
+namespace klee {
+
+  /// SetTrie - Maps sets to values, and finds stored subsets and supersets
+  /// of a given set. This is the unlimited branching tree of Hoffmann and
+  /// Koehler ("A New Method to Index and Query Sets", IJCAI 1999), as is
+  /// MapOfSets, but entries can also be removed and searches can be bounded.
+  ///
+  /// Sets are passed as ranges which must be sorted by, and free of
+  /// duplicates under, \a Compare. Searches take the maximum number of trie
+  /// nodes they may visit (0 for no limit) and report no match once it is
+  /// exceeded, so that the cost of a miss does not grow with the trie.
+  template<class K, class V, class Compare = std::less<K> >
+  class SetTrie {
+  public:
+    class Node {
+      friend class SetTrie<K, V, Compare>;
+
+      typedef std::map<K, Node*, Compare> children_ty;
+
+      Node *parent;
+      K key;
+      bool isEndOfSet;
+      children_ty children;
+
+      Node(Node *_parent, const K &_key)
+        : parent(_parent), key(_key), isEndOfSet(false), value() {}
+
+    public:
+      V value;
+    };
+
+  private:
+    typedef typename Node::children_ty children_ty;
+
+    Node root;
+    unsigned numNodes, numEntries;
+
+    // FIXME: Make =delete when we switch to C++11
+    SetTrie(const SetTrie &);
+    SetTrie &operator=(const SetTrie &);
+
+    static void destroy(Node *n) {
+      for (typename children_ty::iterator it = n->children.begin(),
+             ie = n->children.end(); it != ie; ++it) {
+        destroy(it->second);
+        delete it->second;
+      }
+      n->children.clear();
+    }
+
+    template<class Iterator, class Predicate>
+    static Node *findSubset(Node *n, Iterator begin, Iterator end,
+                            const Predicate &p, unsigned &visits) {
+      if (!visits)
+        return 0;
+      --visits;
+      if (n->isEndOfSet && p(n->value))
+        return n;
+      if (n->children.empty())
+        return 0;
+      for (Iterator it = begin; it != end && visits;) {
+        typename children_ty::iterator kit = n->children.find(*it);
+        ++it;
+        if (kit != n->children.end())
+          if (Node *res = findSubset(kit->second, it, end, p, visits))
+            return res;
+      }
+      return 0;
+    }
+
+    template<class Iterator, class Predicate>
+    static Node *findSuperset(Node *n, Iterator begin, Iterator end,
+                              const Predicate &p, unsigned &visits) {
+      if (!visits)
+        return 0;
+      --visits;
+      if (begin == end) {
+        if (n->isEndOfSet && p(n->value))
+          return n;
+        for (typename children_ty::iterator it = n->children.begin(),
+               ie = n->children.end(); it != ie && visits; ++it)
+          if (Node *res = findSuperset(it->second, begin, end, p, visits))
+            return res;
+        return 0;
+      }
+
+      // Children ordered after the next wanted element cannot lead to it.
+      Compare less;
+      for (typename children_ty::iterator it = n->children.begin(),
+             ie = n->children.end();
+           it != ie && visits && !less(*begin, it->first); ++it) {
+        Iterator next = begin;
+        if (!less(it->first, *begin))
+          ++next;
+        if (Node *res = findSuperset(it->second, next, end, p, visits))
+          return res;
+      }
+      return 0;
+    }
+
+  public:
+    SetTrie() : root(0, K()), numNodes(1), numEntries(0) {}
+    ~SetTrie() { destroy(&root); }
+
+    /// size - The number of sets stored.
+    unsigned size() const { return numEntries; }
+
+    /// nodeCount - The number of trie nodes, including the root.
+    unsigned nodeCount() const { return numNodes; }
+
+    void clear() {
+      destroy(&root);
+      root.isEndOfSet = false;
+      root.value = V();
+      numNodes = 1;
+      numEntries = 0;
+    }
+
+    /// insert - Add the set [begin, end) unless already present. Returns its
+    /// node, which stays valid until it is erased, and whether it was added.
+    template<class Iterator>
+    std::pair<Node*, bool> insert(Iterator begin, Iterator end,
+                                  const V &value) {
+      Node *n = &root;
+      for (Iterator it = begin; it != end; ++it) {
+        std::pair<typename children_ty::iterator, bool> res =
+          n->children.insert(std::make_pair(*it, (Node*) 0));
+        if (res.second) {
+          res.first->second = new Node(n, *it);
+          ++numNodes;
+        }
+        n = res.first->second;
+      }
+      if (n->isEndOfSet)
+        return std::make_pair(n, false);
+      n->isEndOfSet = true;
+      n->value = value;
+      ++numEntries;
+      return std::make_pair(n, true);
+    }
+
+    template<class Iterator>
+    Node *lookup(Iterator begin, Iterator end) {
+      Node *n = &root;
+      for (Iterator it = begin; it != end; ++it) {
+        typename children_ty::iterator kit = n->children.find(*it);
+        if (kit == n->children.end())
+          return 0;
+        n = kit->second;
+      }
+      return n->isEndOfSet ? n : 0;
+    }
+
+    /// erase - Remove the set stored at \a n, and any nodes which no longer
+    /// lead to a stored set.
+    void erase(Node *n) {
+      assert(n->isEndOfSet && "erasing a set which is not stored");
+      n->isEndOfSet = false;
+      n->value = V();
+      --numEntries;
+      while (n != &root && !n->isEndOfSet && n->children.empty()) {
+        Node *parent = n->parent;
+        parent->children.erase(n->key);
+        delete n;
+        --numNodes;
+        n = parent;
+      }
+    }
+
+    /// findSubset - Find a stored subset of [begin, end) whose value
+    /// satisfies \a p, visiting at most \a maxVisits nodes.
+    template<class Iterator, class Predicate>
+    Node *findSubset(Iterator begin, Iterator end, const Predicate &p,
+                     unsigned maxVisits = 0) {
+      unsigned visits = maxVisits ? maxVisits : ~0U;
+      return findSubset(&root, begin, end, p, visits);
+    }
+
+    /// findSuperset - Find a stored superset of [begin, end) whose value
+    /// satisfies \a p, visiting at most \a maxVisits nodes.
+    template<class Iterator, class Predicate>
+    Node *findSuperset(Iterator begin, Iterator end, const Predicate &p,
+                       unsigned maxVisits = 0) {
+      unsigned visits = maxVisits ? maxVisits : ~0U;
+      return findSuperset(&root, begin, end, p, visits);
+    }
+  };
+
+}
+
+#endif
@@ -15,8 +15,65 @@
 namespace klee {
   class MemoryObject;
 
-  struct Cell {
-    ref<Expr> value;
+  /// Cell - A register or constant table entry.
+  ///
+  /// Constants of up to 64 bits are held inline, so that the interpreter can
+  /// compute on them without allocating a ConstantExpr; getValue() conses up
+  /// the expression only when a client asks for one.
+  class Cell {
+    /// The value as an expression. For an immediate this is only a cache,
+    /// filled in by getValue().
+    mutable ref<Expr> expr;
+    uint64_t immediate;
+    /// The width of the immediate, or Expr::InvalidWidth if the value is
+    /// held in expr alone.
+    Expr::Width immediateWidth;
+
+  public:
+    Cell() : immediate(0), immediateWidth(Expr::InvalidWidth) {}
+
+    /// isConstant - Whether the value is held inline.
+    bool isConstant() const {
+      return immediateWidth != Expr::InvalidWidth;
+    }
+
+    /// getConstant - The inline value, zero-extended to 64 bits.
+    uint64_t getConstant() const {
+      assert(isConstant() && "cell does not hold a constant");
+      return immediate;
+    }
+
+    /// getWidth - The width of the inline value.
+    Expr::Width getWidth() const {
+      assert(isConstant() && "cell does not hold a constant");
+      return immediateWidth;
+    }
+
+    ref<Expr> getValue() const {
+      if (isConstant() && expr.isNull())
+        expr = ConstantExpr::create(immediate, immediateWidth);
+      return expr;
+    }
+
+    void setValue(const ref<Expr> &value) {
+      expr = value;
+      ConstantExpr *ce = dyn_cast_or_null<ConstantExpr>(value.get());
+      if (ce && ce->getWidth() <= Expr::Int64) {
+        immediate = ce->getZExtValue();
+        immediateWidth = ce->getWidth();
+      } else {
+        immediateWidth = Expr::InvalidWidth;
+      }
+    }
+
+    /// setConstant - Hold \a value, truncated to \a width bits, inline.
+    void setConstant(uint64_t value, Expr::Width width) {
+      assert(width != Expr::InvalidWidth && width <= Expr::Int64 &&
+             "invalid width for an inline constant");
+      expr = 0;
+      immediate = width == Expr::Int64 ? value : value & ((1ULL << width) - 1);
+      immediateWidth = width;
+    }
   };
 }
 
@@ -31,7 +31,7 @@ namespace llvm {
 }
 
 namespace klee {
-  struct Cell;
+  class Cell;
   class Executor;
   class Expr;
   class InterpreterHandler;
@@ -50,6 +50,11 @@ namespace klee {
 
     std::map<llvm::BasicBlock*, unsigned> basicBlockEntry;
 
+    /// For blocks ending in a conditional branch whose two sides join again
+    /// after only a few instructions, the first non-PHI instruction of the
+    /// join block. Filled in by KModule::computeMergePoints.
+    std::map<llvm::BasicBlock*, llvm::Instruction*> mergePoints;
+
     /// Whether instructions in this function should count as
     /// "coverable" for statistics and search heuristics.
     bool trackCoverage;
@@ -127,6 +132,11 @@ namespace klee {
     void prepare(const Interpreter::ModuleOptions &opts, 
                  InterpreterHandler *ihandler);
 
+    /// Find where the sides of each conditional branch join again (its
+    /// immediate post-dominator), for branches where no side loops back to
+    /// the branch and at most \a maxRegionSize instructions lie in between.
+    void computeMergePoints(unsigned maxRegionSize);
+
     /// Return an id for the given constant, creating a new one if necessary.
     unsigned getConstantID(llvm::Constant *c, KInstruction* ki);
   };
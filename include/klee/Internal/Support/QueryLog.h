@@ -11,10 +11,15 @@
 #define KLEE_OPT_LOGGINGSOLVER_H
 
 #include "klee/Expr.h"
+#include "klee/util/ExprHashMap.h"
 
+#include <map>
+#include <string>
 #include <vector>
 
 namespace klee {
+  class ArrayCache;
+  class ExprBuilder;
   struct Query;
 
   class QueryLogEntry {
@@ -57,7 +62,84 @@ namespace klee {
       }
     }
   };
-  
+
+  /// QueryLogWriter - Encodes queries in the binary query log format.
+  ///
+  /// A log is a header followed by records. Expressions, update nodes and
+  /// arrays are defined by a record the first time they are used and are
+  /// afterwards referred to by number, so that subexpressions shared within
+  /// and across queries are written once. Integers are written as LEB128
+  /// varints.
+  ///
+  /// The definitions are kept alive by the writer; once there are more than
+  /// a given number of them, the writer and reader both forget them.
+  class QueryLogWriter {
+    ExprHashMap<unsigned> exprIds;
+    std::map<const UpdateNode*, unsigned> updateIds;
+    std::map<const Array*, unsigned> arrayIds;
+    unsigned maxDefinitions;
+
+    // FIXME: Make =delete when we switch to C++11
+    QueryLogWriter(const QueryLogWriter &);
+    QueryLogWriter &operator=(const QueryLogWriter &);
+
+    unsigned writeExpr(std::string &out, const ref<Expr> &e);
+    unsigned writeUpdates(std::string &out, const UpdateNode *head);
+    unsigned writeArray(std::string &out, const Array *array);
+
+  public:
+    explicit QueryLogWriter(unsigned _maxDefinitions = 1 << 20)
+      : maxDefinitions(_maxDefinitions) {}
+
+    /// writeHeader - Append the header which starts every log.
+    static void writeHeader(std::string &out);
+
+    /// write - Append the record of a query and its result, preceded by the
+    /// definitions it needs.
+    void write(std::string &out, const QueryLogEntry &entry,
+               const QueryLogResult &result);
+  };
+
+  /// QueryLogReader - Decodes a binary query log written by QueryLogWriter.
+  class QueryLogReader {
+    const unsigned char *pos, *end;
+    ExprBuilder *builder;
+    ArrayCache &arrayCache;
+    std::vector< ref<Expr> > exprs;
+    // The update lists are rootless; they only hold the nodes alive.
+    std::vector<UpdateList> updates;
+    std::vector<const Array*> arrays;
+    std::string error;
+
+    // FIXME: Make =delete when we switch to C++11
+    QueryLogReader(const QueryLogReader &);
+    QueryLogReader &operator=(const QueryLogReader &);
+
+    bool readVarint(uint64_t &value);
+    bool readExprId(ref<Expr> &e);
+    bool readArrayId(const Array *&array);
+    bool readExpr();
+    bool readUpdate();
+    bool readArray();
+    bool fail(const char *message);
+
+  public:
+    /// The arrays are created in \a _arrayCache, and the expressions with
+    /// \a _builder.
+    QueryLogReader(const char *begin, const char *_end, ExprBuilder *_builder,
+                   ArrayCache &_arrayCache);
+
+    /// isQueryLog - Whether the data starts with a binary query log header.
+    static bool isQueryLog(const char *begin, const char *end);
+
+    /// read - Read the next query and its logged result. Returns false at
+    /// the end of the log, or if it is malformed (see getError()).
+    bool read(QueryLogEntry &entry, QueryLogResult &result);
+
+    /// getError - A description of the first malformation found, or the
+    /// empty string.
+    const std::string &getError() const { return error; }
+  };
 }
 
 #endif
@@ -0,0 +1,109 @@
+//===-- Thread.h ------------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_UTIL_THREAD_H
+#define KLEE_UTIL_THREAD_H
+
+#include <pthread.h>
+
+#include <deque>
+#include <vector>
+
+namespace klee {
+  class Mutex {
+    pthread_mutex_t mutex;
+
+    friend class Condition;
+
+    // FIXME: Make =delete when we switch to C++11
+    Mutex(const Mutex &);
+    Mutex &operator=(const Mutex &);
+
+  public:
+    Mutex();
+    ~Mutex();
+
+    void lock();
+    void unlock();
+  };
+
+  /// MutexLock - Holds a mutex for the lifetime of the object.
+  class MutexLock {
+    Mutex &mutex;
+
+    MutexLock(const MutexLock &);
+    MutexLock &operator=(const MutexLock &);
+
+  public:
+    explicit MutexLock(Mutex &_mutex) : mutex(_mutex) { mutex.lock(); }
+    ~MutexLock() { mutex.unlock(); }
+  };
+
+  class Condition {
+    pthread_cond_t cond;
+
+    Condition(const Condition &);
+    Condition &operator=(const Condition &);
+
+  public:
+    Condition();
+    ~Condition();
+
+    /// wait - Atomically release \a mutex (which must be held) and block
+    /// until signalled; \a mutex is held again on return.
+    void wait(Mutex &mutex);
+    void signal();
+    void broadcast();
+  };
+
+  /// WorkerPool - A fixed set of threads running tasks from a shared queue.
+  ///
+  /// Tasks are run in the order they were enqueued, although several may be
+  /// running at the same time. Each task is told the index of the worker
+  /// thread running it, so that clients can keep per-thread state.
+  class WorkerPool {
+  public:
+    class Task {
+    public:
+      virtual ~Task() {}
+      virtual void run(unsigned worker) = 0;
+    };
+
+  private:
+    std::vector<pthread_t> threads;
+    std::deque<Task*> queue;
+    unsigned pending;
+    bool shuttingDown;
+    Mutex mutex;
+    Condition workAvailable, workDone;
+
+    WorkerPool(const WorkerPool &);
+    WorkerPool &operator=(const WorkerPool &);
+
+    static void *threadMain(void *arg);
+    void workerLoop(unsigned worker);
+
+  public:
+    explicit WorkerPool(unsigned numThreads);
+    /// Waits for all enqueued tasks and joins the worker threads.
+    ~WorkerPool();
+
+    unsigned size() const { return threads.size(); }
+
+    /// enqueue - Schedule \a task to run on some worker. The pool does not
+    /// take ownership of the task.
+    void enqueue(Task *task);
+
+    /// wait - Block until at most \a maxPending of the tasks enqueued so far
+    /// are still queued or running; by default, until all have finished.
+    void wait(unsigned maxPending = 0);
+  };
+}
+
+#endif
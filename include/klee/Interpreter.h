@@ -26,6 +26,7 @@ class raw_fd_ostream;
 namespace klee {
 class ExecutionState;
 class Interpreter;
+class TestCaseSnapshot;
 class TreeStreamWriter;
 
 class InterpreterHandler {
@@ -59,9 +60,17 @@ public:
   virtual void incExitTerminationTest() = 0;
   virtual void assignSubsumptionStats(std::string currentStats) = 0;
 
+  /// Called for each state which reaches the frontier depth, instead of
+  /// exploring it further. \see Interpreter::setFrontierDepth
+  virtual void processFrontierState(const ExecutionState &state) = 0;
+
   virtual void processTestCase(const ExecutionState &state,
                                const char *err, 
                                const char *suffix) = 0;
+
+  /// Called once exploration is over, before the final statistics are
+  /// written, to finish any test cases still being generated.
+  virtual void waitForTestCases() = 0;
 };
 
 class Interpreter {
@@ -140,6 +149,10 @@ public:
   // a user specified path. use null to reset.
   virtual void setReplayPath(const std::vector<bool> *path) = 0;
 
+  // like setReplayPath, but explore as usual once the decisions of the
+  // path have been used up.
+  virtual void setReplayPathPrefix(const std::vector<bool> *path) = 0;
+
   // supply a set of symbolic bindings that will be used as "seeds"
   // for the search. use null to reset.
   virtual void useSeeds(const std::vector<struct KTest *> *seeds) = 0;
@@ -155,6 +168,23 @@ public:
 
   virtual void setInhibitForking(bool value) = 0;
 
+  // hand states which have branched this many times to the handler's
+  // processFrontierState instead of exploring them. 0 to disable.
+  virtual void setFrontierDepth(unsigned depth) = 0;
+
+  // record the branch decisions of each state, so that the live states can
+  // be written to the "checkpoint" output file: every interval seconds (0
+  // for never), on requestCheckpoint, and when execution is halted.
+  virtual void setCheckpointing(double interval) = 0;
+
+  // write a checkpoint before the next instruction. only sets a flag, so it
+  // can be called from a signal handler.
+  virtual void requestCheckpoint() = 0;
+
+  // resume the states of a checkpoint written by an earlier run on the same
+  // module, instead of exploring from the start. call after setModule.
+  virtual void setResumeCheckpoint(const std::string &file) = 0;
+
   /*** State accessor methods ***/
 
   virtual unsigned getPathStreamID(const ExecutionState &state) = 0;
@@ -173,6 +203,30 @@ public:
 
   virtual void getCoveredLines(const ExecutionState &state,
                                std::map<const std::string*, std::set<unsigned> > &res) = 0;
+
+  /// Capture what is needed to solve for and log a test case of \a state
+  /// in an object that shares nothing with the interpreter, so that the
+  /// work can be done on another thread. Returns null when the configured
+  /// solver cannot be used concurrently; the caller owns the result.
+  virtual TestCaseSnapshot *
+  createTestCaseSnapshot(const ExecutionState &state) = 0;
+};
+
+/// TestCaseSnapshot - A detached copy of the constraints and symbolic
+/// objects of a state. Its methods mirror the corresponding Interpreter
+/// state accessors and may be called from any one thread at a time.
+class TestCaseSnapshot {
+public:
+  virtual ~TestCaseSnapshot() {}
+
+  virtual void getConstraintLog(std::string &res,
+                                Interpreter::LogType logFormat =
+                                    Interpreter::STP) = 0;
+
+  virtual bool getSymbolicSolution(std::vector<
+                                   std::pair<std::string,
+                                   std::vector<unsigned char> > >
+                                   &res) = 0;
 };
 
 } // End klee namespace
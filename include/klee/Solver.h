@@ -305,12 +305,25 @@ namespace klee {
   /// \param s - The underlying solver to use.
   Solver *createFastCexSolver(Solver *s);
 
+  /// createIntervalSolver - Create a solver which tries to decide queries by
+  /// evaluating them over the intervals and known bits implied by the
+  /// constraints, before passing them on to the underlying solver.
+  ///
+  /// \param s - The underlying solver to use.
+  Solver *createIntervalSolver(Solver *s);
+
   /// createIndependentSolver - Create a solver which will eliminate any
   /// unnecessary constraints before propogating the query to the underlying
   /// solver.
   ///
   /// \param s - The underlying solver to use.
-  Solver *createIndependentSolver(Solver *s);
+  /// \param workerSolvers - If not empty, the independent factors of
+  /// getInitialValues queries are solved in parallel on one worker thread
+  /// per solver given. Each must be a separate chain, which is only ever
+  /// used by one thread at a time; the independent solver takes ownership.
+  Solver *createIndependentSolver(Solver *s,
+                                  const std::vector<Solver*> &workerSolvers =
+                                      std::vector<Solver*>());
   
   /// createPCLoggingSolver - Create a solver which will forward all queries
   /// after writing them to the given path in .pc format.
@@ -322,6 +335,11 @@ namespace klee {
   Solver *createSMTLIBLoggingSolver(Solver *s, std::string path,
                                     int minQueryTimeToLog);
 
+  /// createBinaryLoggingSolver - Create a solver which will forward all
+  /// queries after writing them, with their results, to the given path in
+  /// the binary query log format.
+  Solver *createBinaryLoggingSolver(Solver *s, std::string path);
+
 
   /// createDummySolver - Create a dummy solver implementation which always
   /// fails.
@@ -12,6 +12,8 @@
 
 #include "Statistic.h"
 
+#include <pthread.h>
+
 #include <vector>
 #include <string>
 #include <string.h>
@@ -46,10 +48,32 @@ namespace klee {
     StatisticRecord *contextStats;
     unsigned index;
 
+    /// The counters of the registered worker threads, and those of the
+    /// worker threads which have left.
+    std::vector<uint64_t*> threadStats;
+    uint64_t *retiredThreadStats;
+    bool threadsUsed;
+    mutable pthread_mutex_t threadStatsLock;
+    static __thread uint64_t *currentThreadStats;
+
+    uint64_t getValueWithThreads(const Statistic &s) const;
+
   public:
     StatisticManager();
     ~StatisticManager();
 
+    /// prepareWorkerThreads - Make reads include the counts of worker
+    /// threads. Must be called by the thread creating them, before they
+    /// start, so that no thread sees the switch happen.
+    void prepareWorkerThreads();
+
+    /// enterWorkerThread - Count the statistics incremented by the calling
+    /// thread apart from the main thread's until leaveWorkerThread, so that
+    /// worker threads need no locking. Their counts are included in the
+    /// values read, but are not attributed to instructions or states.
+    void enterWorkerThread();
+    void leaveWorkerThread();
+
     void useIndexedStats(unsigned totalIndices);
 
     StatisticRecord *getContext();
@@ -76,6 +100,10 @@ namespace klee {
   inline void StatisticManager::incrementStatistic(Statistic &s, 
                                                    uint64_t addend) {
     if (enabled) {
+      if (currentThreadStats) {
+        currentThreadStats[s.id] += addend;
+        return;
+      }
       globalStats[s.id] += addend;
       if (indexedStats) {
         indexedStats[index*stats.size() + s.id] += addend;
@@ -130,6 +158,8 @@ namespace klee {
   }
 
   inline uint64_t StatisticManager::getValue(const Statistic &s) const {
+    if (threadsUsed)
+      return getValueWithThreads(s);
     return globalStats[s.id];
   }
 
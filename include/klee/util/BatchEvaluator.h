@@ -0,0 +1,105 @@
+//===-- BatchEvaluator.h ----------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_UTIL_BATCHEVALUATOR_H
+#define KLEE_UTIL_BATCHEVALUATOR_H
+
+#include "klee/Expr.h"
+
+#include <map>
+#include <stdint.h>
+#include <vector>
+
+namespace klee {
+  class Assignment;
+
+  /// BatchEvaluator - Checks a set of constraints against many assignments
+  /// at once.
+  ///
+  /// The constraints are compiled once into a flat tape of instructions,
+  /// one per distinct subexpression, which is then run over blocks of
+  /// assignments with one column of values per instruction. The result
+  /// agrees with Assignment::satisfies; assignments which cannot be judged
+  /// on the tape (division by zero, reads of free values) are handed to it.
+  ///
+  /// The expressions need not be constraints: evaluate() computes the value
+  /// of one of them under each assignment.
+  ///
+  /// Only expressions of at most 64 bits are supported; check isSupported()
+  /// before use.
+  class BatchEvaluator {
+  public:
+    /// The number of assignments evaluated together.
+    static const unsigned BlockSize = 64;
+
+  private:
+    struct Instruction {
+      Expr::Kind kind;
+      Expr::Width width;
+      unsigned ops[3];
+      // Extract: bit offset; Concat: width of the low part; Constant: value;
+      // Read: index into reads.
+      uint64_t aux;
+    };
+
+    struct Read {
+      unsigned array; // index into arrays
+      // (index, value) tape slots of the updates, most recent first
+      std::vector< std::pair<unsigned, unsigned> > updates;
+    };
+
+    struct ArrayInfo {
+      const Array *array;
+      std::vector<uint64_t> constantValues;
+    };
+
+    std::vector< ref<Expr> > constraints;
+    std::vector<Instruction> tape;
+    std::vector<unsigned> roots;
+    std::vector<Read> reads;
+    std::vector<ArrayInfo> arrays;
+    std::map<const Expr*, unsigned> slots;
+    std::map<const Array*, unsigned> arrayIndex;
+    // column of BlockSize values per instruction
+    std::vector<uint64_t> values;
+    bool supported;
+
+    unsigned compile(const ref<Expr> &e);
+    unsigned compileRead(const ReadExpr *re);
+
+    /// Run the tape over \a n assignments, setting bit i of \a unknown if
+    /// the values under assignment i must be found individually.
+    void evaluateBlock(Assignment *const *assignments, unsigned n,
+                       uint64_t &unknown);
+
+  public:
+    template<class InputIterator>
+    BatchEvaluator(InputIterator begin, InputIterator end) : supported(true) {
+      for (; begin != end && supported; ++begin) {
+        constraints.push_back(*begin);
+        roots.push_back(compile(*begin));
+      }
+    }
+
+    bool isSupported() const { return supported; }
+
+    /// findFirstSatisfying - Return the index of the first assignment which
+    /// satisfies every constraint, or the number of assignments if none do.
+    unsigned findFirstSatisfying(const std::vector<Assignment*> &assignments);
+
+    /// evaluate - Compute the value of expression \a index (in the order
+    /// given to the constructor) under each assignment. \a known[i] is
+    /// cleared if the value under assignment i could not be computed on the
+    /// tape, in which case it must be found with Assignment::evaluate.
+    void evaluate(unsigned index, const std::vector<Assignment*> &assignments,
+                  std::vector<uint64_t> &results, std::vector<bool> &known);
+  };
+}
+
+#endif
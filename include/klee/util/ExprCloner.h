@@ -0,0 +1,61 @@
+//===-- ExprCloner.h --------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_EXPRCLONER_H
+#define KLEE_EXPRCLONER_H
+
+#include "klee/Expr.h"
+
+#include <map>
+#include <set>
+
+namespace klee {
+  class ArrayCache;
+
+  /// Orders arrays by name, size, widths and constant values, so that the
+  /// copy of a constant array can be found from any array with the same
+  /// contents, even one allocated where a freed original used to be.
+  struct ArrayContentLT {
+    bool operator()(const Array *a, const Array *b) const;
+  };
+
+  /// The copies of constant arrays made by cloners, keyed by their contents.
+  typedef std::set<const Array*, ArrayContentLT> ArrayCopySet;
+
+  /// ExprCloner - Copies expressions into a new DAG which shares no
+  /// reference counted nodes with the original, so that the copy can be used
+  /// by another thread while the original remains in use. Sharing within the
+  /// copied expressions is preserved.
+  ///
+  /// Symbolic arrays are immutable and are shared with the original; constant
+  /// arrays hold reference counted values and are copied into the given
+  /// ArrayCache, which must outlive the copies.
+  class ExprCloner {
+    ArrayCache &arrayCache;
+    std::map<const Expr*, ref<Expr> > exprs;
+    std::map<const UpdateNode*, UpdateList> updates;
+    ArrayCopySet ownArrays;
+    ArrayCopySet &arrays;
+
+  public:
+    explicit ExprCloner(ArrayCache &_arrayCache)
+      : arrayCache(_arrayCache), arrays(ownArrays) {}
+
+    /// Record the copies of constant arrays in \a _arrays, so that cloners
+    /// sharing it and \a _arrayCache copy each array only once.
+    ExprCloner(ArrayCache &_arrayCache, ArrayCopySet &_arrays)
+      : arrayCache(_arrayCache), arrays(_arrays) {}
+
+    const Array *clone(const Array *array);
+    UpdateList clone(const UpdateList &ul);
+    ref<Expr> clone(const ref<Expr> &e);
+  };
+}
+
+#endif
@@ -36,7 +36,14 @@ public:
   ValueType binaryAnd(ValueType &);
   ValueType binaryOr(ValueType &);
   ValueType binaryXor(ValueType &);
+  ValueType binaryNot(unsigned width);
   ValueType concat(ValueType &, unsigned width);
+  ValueType extract(uint64_t lowBit, uint64_t maxBit);
+  ValueType zext(unsigned width);
+  ValueType sext(unsigned srcWidth, unsigned width);
+  ValueType shl(ValueType &, unsigned width);
+  ValueType lshr(ValueType &, unsigned width);
+  ValueType ashr(ValueType &, unsigned width);
   ValueType add(ValueType &, unsigned width);
   ValueType sub(ValueType &, unsigned width);
   ValueType mul(ValueType &, unsigned width);
@@ -59,7 +66,16 @@ protected:
   /// array (which may be constant), for the given range of indices.
   virtual T getInitialReadRange(const Array &os, T index) = 0;
 
+  /// getCachedRange - Return true and set \a res if the range of \a e is
+  /// known without evaluating it.
+  virtual bool getCachedRange(const ref<Expr> &e, T &res) { return false; }
+
+  /// refineRange - Called with the evaluated range of \a e, return a
+  /// (possibly smaller) range to use for it instead.
+  virtual T refineRange(const ref<Expr> &e, const T &res) { return res; }
+
   T evalRead(const UpdateList &ul, T index);
+  T evaluateKind(const ref<Expr> &e);
 
 public:
   ExprRangeEvaluator() {}
@@ -91,6 +107,14 @@ T ExprRangeEvaluator<T>::evalRead(const UpdateList &ul,
 
 template<class T>
 T ExprRangeEvaluator<T>::evaluate(const ref<Expr> &e) {
+  T res;
+  if (getCachedRange(e, res))
+    return res;
+  return refineRange(e, evaluateKind(e));
+}
+
+template<class T>
+T ExprRangeEvaluator<T>::evaluateKind(const ref<Expr> &e) {
   switch (e->getKind()) {
   case Expr::Constant:
     return T(cast<ConstantExpr>(e));
@@ -125,10 +149,25 @@ T ExprRangeEvaluator<T>::evaluate(const ref<Expr> &e) {
     const Expr *ep = e.get();
     T res(0);
     for (unsigned i=0; i<ep->getNumKids(); i++)
-      res = res.concat(evaluate(ep->getKid(i)),8);
+      res = res.concat(evaluate(ep->getKid(i)), ep->getKid(i)->getWidth());
     return res;
   }
 
+  case Expr::Extract: {
+    const ExtractExpr *ee = cast<ExtractExpr>(e);
+    return evaluate(ee->expr).extract(ee->offset, ee->offset + ee->width);
+  }
+
+  case Expr::ZExt: {
+    const CastExpr *ce = cast<CastExpr>(e);
+    return evaluate(ce->src).zext(ce->width);
+  }
+
+  case Expr::SExt: {
+    const CastExpr *ce = cast<CastExpr>(e);
+    return evaluate(ce->src).sext(ce->src->getWidth(), ce->width);
+  }
+
     // Arithmetic
 
   case Expr::Add: {
@@ -169,6 +208,10 @@ T ExprRangeEvaluator<T>::evaluate(const ref<Expr> &e) {
 
     // Binary
 
+  case Expr::Not: {
+    const NotExpr *ne = cast<NotExpr>(e);
+    return evaluate(ne->expr).binaryNot(ne->getWidth());
+  }
   case Expr::And: {
     const BinaryExpr *be = cast<BinaryExpr>(e);
     return evaluate(be->left).binaryAnd(evaluate(be->right));
@@ -182,22 +225,19 @@ T ExprRangeEvaluator<T>::evaluate(const ref<Expr> &e) {
     return evaluate(be->left).binaryXor(evaluate(be->right));
   }
   case Expr::Shl: {
-    //    BinaryExpr *be = cast<BinaryExpr>(e);
-    //    unsigned width = be->left->getWidth();
-    //    return evaluate(be->left).shl(evaluate(be->right), width);
-    break;
+    const BinaryExpr *be = cast<BinaryExpr>(e);
+    unsigned width = be->left->getWidth();
+    return evaluate(be->left).shl(evaluate(be->right), width);
   }
   case Expr::LShr: {
-    //    BinaryExpr *be = cast<BinaryExpr>(e);
-    //    unsigned width = be->left->getWidth();
-    //    return evaluate(be->left).lshr(evaluate(be->right), width);
-    break;
+    const BinaryExpr *be = cast<BinaryExpr>(e);
+    unsigned width = be->left->getWidth();
+    return evaluate(be->left).lshr(evaluate(be->right), width);
   }
   case Expr::AShr: {
-    //    BinaryExpr *be = cast<BinaryExpr>(e);
-    //    unsigned width = be->left->getWidth();
-    //    return evaluate(be->left).ashr(evaluate(be->right), width);
-    break;
+    const BinaryExpr *be = cast<BinaryExpr>(e);
+    unsigned width = be->left->getWidth();
+    return evaluate(be->left).ashr(evaluate(be->right), width);
   }
 
     // Comparison
@@ -26,6 +26,13 @@ UseCexCache("use-cex-cache",
             llvm::cl::init(true),
             llvm::cl::desc("Use counterexample caching (default=on)"));
 
+llvm::cl::opt<bool>
+UseIntervalSolver("use-interval-solver",
+                  llvm::cl::init(false),
+                  llvm::cl::desc("Try to decide queries over intervals and "
+                                 "known bits before the caches "
+                                 "(default=off)"));
+
 llvm::cl::opt<bool>
 UseCache("use-cache",
          llvm::cl::init(true),
@@ -36,6 +43,14 @@ UseIndependentSolver("use-independent-solver",
                      llvm::cl::init(true),
                      llvm::cl::desc("Use constraint independence (default=on)"));
 
+llvm::cl::opt<unsigned>
+IndependentSolverThreads("independent-solver-threads",
+                         llvm::cl::init(0),
+                         llvm::cl::desc("Number of worker threads used to solve "
+                                        "independent constraint sets when "
+                                        "computing initial values; requires "
+                                        "the Z3 core solver (default=0 (off))"));
+
 llvm::cl::opt<bool>
 DebugValidateSolver("debug-validate-solver",
 		             llvm::cl::init(false));
@@ -77,11 +92,15 @@ llvm::cl::list<QueryLoggingSolverType> queryLoggingOptions(
         clEnumValN(ALL_PC, "all:pc", "All queries in .pc (KQuery) format"),
         clEnumValN(ALL_SMTLIB, "all:smt2",
                    "All queries in .smt2 (SMT-LIBv2) format"),
+        clEnumValN(ALL_BINARY, "all:bin",
+                   "All queries in the binary format, replayable by kleaver"),
         clEnumValN(SOLVER_PC, "solver:pc",
                    "All queries reaching the solver in .pc (KQuery) format"),
         clEnumValN(
             SOLVER_SMTLIB, "solver:smt2",
             "All queries reaching the solver in .smt2 (SMT-LIBv2) format"),
+        clEnumValN(SOLVER_BINARY, "solver:bin",
+                   "All queries reaching the solver in the binary format"),
         clEnumValEnd),
     llvm::cl::CommaSeparated);
 
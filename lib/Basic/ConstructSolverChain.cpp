@@ -13,23 +13,37 @@
 #include "klee/Common.h"
 #include "klee/CommandLine.h"
 #include "klee/Internal/Support/ErrorHandling.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/raw_ostream.h"
 
 namespace klee {
-Solver *constructSolverChain(Solver *coreSolver, std::string querySMT2LogPath,
-                             std::string baseSolverQuerySMT2LogPath,
-                             std::string queryPCLogPath,
-                             std::string baseSolverQueryPCLogPath) {
+SolverChainOptions::SolverChainOptions()
+    : coreSolver(CoreSolverToUse), cexCache(UseCexCache), cache(UseCache),
+      interval(UseIntervalSolver), independent(UseIndependentSolver),
+      independentThreads(IndependentSolverThreads), logQueries(true) {}
+
+/// Builds the part of the chain below the independent solver.
+static Solver *constructBaseSolverChain(Solver *coreSolver,
+                                        std::string baseSolverQuerySMT2LogPath,
+                                        std::string baseSolverQueryPCLogPath,
+                                        std::string baseSolverQueryBinaryLogPath,
+                                        const SolverChainOptions &options) {
   Solver *solver = coreSolver;
 
-  if (optionIsSet(queryLoggingOptions, SOLVER_PC)) {
+  if (options.logQueries && optionIsSet(queryLoggingOptions, SOLVER_BINARY)) {
+    solver = createBinaryLoggingSolver(solver, baseSolverQueryBinaryLogPath);
+    klee_message("Logging queries that reach solver in binary format to %s\n",
+                 baseSolverQueryBinaryLogPath.c_str());
+  }
+
+  if (options.logQueries && optionIsSet(queryLoggingOptions, SOLVER_PC)) {
     solver = createPCLoggingSolver(solver, baseSolverQueryPCLogPath,
                                    MinQueryTimeToLog);
     klee_message("Logging queries that reach solver in .pc format to %s\n",
                  baseSolverQueryPCLogPath.c_str());
   }
 
-  if (optionIsSet(queryLoggingOptions, SOLVER_SMTLIB)) {
+  if (options.logQueries && optionIsSet(queryLoggingOptions, SOLVER_SMTLIB)) {
     solver = createSMTLIBLoggingSolver(solver, baseSolverQuerySMT2LogPath,
                                        MinQueryTimeToLog);
     klee_message("Logging queries that reach solver in .smt2 format to %s\n",
@@ -39,30 +53,89 @@ Solver *constructSolverChain(Solver *coreSolver, std::string querySMT2LogPath,
   if (UseFastCexSolver)
     solver = createFastCexSolver(solver);
 
-  if (UseCexCache)
+  if (options.cexCache)
     solver = createCexCachingSolver(solver);
 
-  if (UseCache)
+  if (options.cache)
     solver = createCachingSolver(solver);
 
-  if (UseIndependentSolver)
-    solver = createIndependentSolver(solver);
+  if (options.interval)
+    solver = createIntervalSolver(solver);
+
+  return solver;
+}
+
+/// The log file of worker \a worker: "solver-queries.pc" becomes
+/// "solver-queries.worker1.pc".
+static std::string getWorkerLogPath(const std::string &path, unsigned worker) {
+  std::string tag = ".worker" + llvm::utostr(worker);
+  std::string::size_type dot = path.rfind('.');
+  std::string::size_type slash = path.rfind('/');
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+    return path + tag;
+  return path.substr(0, dot) + tag + path.substr(dot);
+}
+
+Solver *constructSolverChain(Solver *coreSolver, std::string querySMT2LogPath,
+                             std::string baseSolverQuerySMT2LogPath,
+                             std::string queryPCLogPath,
+                             std::string baseSolverQueryPCLogPath,
+                             std::string queryBinaryLogPath,
+                             std::string baseSolverQueryBinaryLogPath,
+                             const SolverChainOptions &options) {
+  Solver *solver = constructBaseSolverChain(coreSolver,
+                                            baseSolverQuerySMT2LogPath,
+                                            baseSolverQueryPCLogPath,
+                                            baseSolverQueryBinaryLogPath,
+                                            options);
+
+  if (options.independent) {
+    // Each worker thread gets its own copy of the chain above, so that its
+    // factors see the same caches and are logged the same way.
+    std::vector<Solver*> workerSolvers;
+    if (options.independentThreads && options.coreSolver != Z3_SOLVER) {
+      klee_warning("--independent-solver-threads requires the Z3 core "
+                   "solver, solving independent sets sequentially");
+    } else {
+      for (unsigned i = 1; i <= options.independentThreads; ++i) {
+        Solver *workerCore = createCoreSolver(options.coreSolver);
+        if (!workerCore)
+          klee_error("Failed to create core solver for worker thread\n");
+        if (MaxCoreSolverTime)
+          workerCore->setCoreSolverTimeout(MaxCoreSolverTime);
+        workerSolvers.push_back(constructBaseSolverChain(
+            workerCore, getWorkerLogPath(baseSolverQuerySMT2LogPath, i),
+            getWorkerLogPath(baseSolverQueryPCLogPath, i),
+            getWorkerLogPath(baseSolverQueryBinaryLogPath, i), options));
+      }
+    }
+    solver = createIndependentSolver(solver, workerSolvers);
+  } else if (options.independentThreads) {
+    klee_warning("--independent-solver-threads requires "
+                 "--use-independent-solver, solving sequentially");
+  }
 
   if (DebugValidateSolver)
     solver = createValidatingSolver(solver, coreSolver);
 
-  if (optionIsSet(queryLoggingOptions, ALL_PC)) {
+  if (options.logQueries && optionIsSet(queryLoggingOptions, ALL_PC)) {
     solver = createPCLoggingSolver(solver, queryPCLogPath, MinQueryTimeToLog);
     klee_message("Logging all queries in .pc format to %s\n",
                  queryPCLogPath.c_str());
   }
 
-  if (optionIsSet(queryLoggingOptions, ALL_SMTLIB)) {
+  if (options.logQueries && optionIsSet(queryLoggingOptions, ALL_SMTLIB)) {
     solver =
         createSMTLIBLoggingSolver(solver, querySMT2LogPath, MinQueryTimeToLog);
     klee_message("Logging all queries in .smt2 format to %s\n",
                  querySMT2LogPath.c_str());
   }
+
+  if (options.logQueries && optionIsSet(queryLoggingOptions, ALL_BINARY)) {
+    solver = createBinaryLoggingSolver(solver, queryBinaryLogPath);
+    klee_message("Logging all queries in binary format to %s\n",
+                 queryBinaryLogPath.c_str());
+  }
   if (DebugCrossCheckCoreSolverWith != NO_SOLVER) {
     Solver *oracleSolver = createCoreSolver(DebugCrossCheckCoreSolverWith);
     solver = createValidatingSolver(/*s=*/solver, /*oracle=*/oracleSolver);
@@ -9,21 +9,73 @@
 
 #include "klee/Statistics.h"
 
+#include <algorithm>
+#include <assert.h>
 #include <vector>
 
 using namespace klee;
 
+__thread uint64_t *StatisticManager::currentThreadStats = 0;
+
 StatisticManager::StatisticManager()
   : enabled(true),
     globalStats(0),
     indexedStats(0),
     contextStats(0),
-    index(0) {
+    index(0),
+    retiredThreadStats(0),
+    threadsUsed(false) {
+  pthread_mutex_init(&threadStatsLock, 0);
 }
 
 StatisticManager::~StatisticManager() {
   if (globalStats) delete[] globalStats;
   if (indexedStats) delete[] indexedStats;
+  if (retiredThreadStats) delete[] retiredThreadStats;
+  for (unsigned i = 0; i < threadStats.size(); ++i)
+    delete[] threadStats[i];
+  pthread_mutex_destroy(&threadStatsLock);
+}
+
+void StatisticManager::prepareWorkerThreads() {
+  if (threadsUsed)
+    return;
+  retiredThreadStats = new uint64_t[stats.size()];
+  memset(retiredThreadStats, 0, sizeof(*retiredThreadStats) * stats.size());
+  threadsUsed = true;
+}
+
+void StatisticManager::enterWorkerThread() {
+  assert(threadsUsed && "worker threads not prepared");
+  assert(!currentThreadStats && "thread already entered");
+  uint64_t *data = new uint64_t[stats.size()];
+  memset(data, 0, sizeof(*data) * stats.size());
+  pthread_mutex_lock(&threadStatsLock);
+  threadStats.push_back(data);
+  pthread_mutex_unlock(&threadStatsLock);
+  currentThreadStats = data;
+}
+
+void StatisticManager::leaveWorkerThread() {
+  uint64_t *data = currentThreadStats;
+  assert(data && "thread not entered");
+  currentThreadStats = 0;
+  pthread_mutex_lock(&threadStatsLock);
+  for (unsigned i = 0; i < stats.size(); ++i)
+    retiredThreadStats[i] += data[i];
+  threadStats.erase(std::find(threadStats.begin(), threadStats.end(), data));
+  pthread_mutex_unlock(&threadStatsLock);
+  delete[] data;
+}
+
+uint64_t StatisticManager::getValueWithThreads(const Statistic &s) const {
+  // The counters of the running threads may be read while they change.
+  pthread_mutex_lock(&threadStatsLock);
+  uint64_t value = globalStats[s.id] + retiredThreadStats[s.id];
+  for (unsigned i = 0; i < threadStats.size(); ++i)
+    value += threadStats[i][s.id];
+  pthread_mutex_unlock(&threadStatsLock);
+  return value;
 }
 
 void StatisticManager::useIndexedStats(unsigned totalIndices) {  
@@ -8,6 +8,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "AddressSpace.h"
+#include "Context.h"
 #include "CoreStats.h"
 #include "Memory.h"
 #include "TimingSolver.h"
@@ -19,13 +20,53 @@ using namespace klee;
 
 ///
 
+size_t AddressSpace::totalExclusiveBytes = 0;
+
+void AddressSpace::refreshLastWritten() const {
+  if (!lastWritten)
+    return;
+  ObjectState *os = const_cast<ObjectState*>(lastWritten);
+  exclusiveBytes -= os->accountedBytes;
+  totalExclusiveBytes -= os->accountedBytes;
+  os->accountedBytes = os->getMemoryUsage();
+  exclusiveBytes += os->accountedBytes;
+  totalExclusiveBytes += os->accountedBytes;
+  lastWritten = 0;
+}
+
+void AddressSpace::updateResolutionCache(const MemoryObject *mo,
+                                         const ObjectState *os) {
+  for (unsigned i = 0; i < ResolutionCacheSize; ++i)
+    if (resolutionCache[i].first == mo)
+      resolutionCache[i] = os ? ObjectPair(mo, os) : ObjectPair(0, 0);
+}
+
+size_t AddressSpace::getExclusiveBytes() const {
+  refreshLastWritten();
+  return exclusiveBytes;
+}
+
 void AddressSpace::bindObject(const MemoryObject *mo, ObjectState *os) {
   assert(os->copyOnWriteOwner==0 && "object already has owner");
+  // A rebinding replaces the previous object state.
+  unbindObject(mo);
   os->copyOnWriteOwner = cowKey;
+  os->accountedBytes = os->getMemoryUsage();
+  exclusiveBytes += os->accountedBytes;
+  totalExclusiveBytes += os->accountedBytes;
   objects = objects.replace(std::make_pair(mo, os));
 }
 
 void AddressSpace::unbindObject(const MemoryObject *mo) {
+  if (const ObjectState *os = findObject(mo)) {
+    if (os->copyOnWriteOwner == cowKey) {
+      exclusiveBytes -= os->accountedBytes;
+      totalExclusiveBytes -= os->accountedBytes;
+    }
+    if (os == lastWritten)
+      lastWritten = 0;
+    updateResolutionCache(mo, 0);
+  }
   objects = objects.remove(mo);
 }
 
@@ -39,12 +80,21 @@ ObjectState *AddressSpace::getWriteable(const MemoryObject *mo,
                                         const ObjectState *os) {
   assert(!os->readOnly);
 
+  // The caller may grow the object we return, so it is recharged on the
+  // next write or query.
+  refreshLastWritten();
   if (cowKey==os->copyOnWriteOwner) {
+    lastWritten = os;
     return const_cast<ObjectState*>(os);
   } else {
     ObjectState *n = new ObjectState(*os);
     n->copyOnWriteOwner = cowKey;
+    n->accountedBytes = n->getMemoryUsage();
+    exclusiveBytes += n->accountedBytes;
+    totalExclusiveBytes += n->accountedBytes;
+    lastWritten = n;
     objects = objects.replace(std::make_pair(mo, n));
+    updateResolutionCache(mo, n);
     return n;    
   }
 }
@@ -54,6 +104,20 @@ ObjectState *AddressSpace::getWriteable(const MemoryObject *mo,
 bool AddressSpace::resolveOne(const ref<ConstantExpr> &addr, 
                               ObjectPair &result) {
   uint64_t address = addr->getZExtValue();
+
+  // Accesses are mostly local, so try the object last resolved nearby.
+  ObjectPair &entry =
+      resolutionCache[(address >> 6) & (ResolutionCacheSize - 1)];
+  if (const MemoryObject *mo = entry.first) {
+    if ((mo->size==0 && address==mo->address) ||
+        (address - mo->address < mo->size)) {
+      ++stats::resolveCacheHits;
+      result = entry;
+      return true;
+    }
+  }
+  ++stats::resolveCacheMisses;
+
   MemoryObject hack(address);
 
   if (const MemoryMap::value_type *res = objects.lookup_previous(&hack)) {
@@ -63,6 +127,7 @@ bool AddressSpace::resolveOne(const ref<ConstantExpr> &addr,
     if ((mo->size==0 && address==mo->address) ||
         (address - mo->address < mo->size)) {
       result = *res;
+      entry = *res;
       return true;
     }
   }
@@ -301,26 +366,80 @@ void AddressSpace::copyOutConcretes() {
       uint8_t *address = (uint8_t*) (unsigned long) mo->address;
 
       if (!os->readOnly)
-        memcpy(address, os->concreteStore, mo->size);
+        os->copyOutConcretes(address);
+    }
+  }
+}
+
+void AddressSpace::copyOutReachableConcretes(
+    const std::vector<uint64_t> &roots, std::vector<ObjectPair> &reachable) {
+  if (objects.empty())
+    return;
+
+  // Most words are not pointers, so rule out those outside of every
+  // object before looking them up.
+  uint64_t low = objects.min().first->address;
+  uint64_t high = objects.max().first->address + objects.max().first->size;
+  Expr::Width width = Context::get().getPointerWidth();
+  unsigned wordSize = width / 8;
+
+  std::set<const MemoryObject *> visited;
+  std::vector<uint64_t> worklist(roots);
+  while (!worklist.empty()) {
+    uint64_t value = worklist.back();
+    worklist.pop_back();
+    ObjectPair op;
+    if (value < low || value >= high ||
+        !resolveOne(ConstantExpr::alloc(value, width), op) ||
+        !visited.insert(op.first).second)
+      continue;
+
+    const MemoryObject *mo = op.first;
+    if (mo->isUserSpecified)
+      continue;
+    reachable.push_back(op);
+
+    // The words are read back from the system memory, which now holds
+    // the contents of the object.
+    uint8_t *address = (uint8_t*) (unsigned long) mo->address;
+    if (!op.second->readOnly)
+      op.second->copyOutConcretes(address);
+    for (unsigned offset = 0; offset + wordSize <= mo->size;
+         offset += wordSize) {
+      uint64_t word = 0;
+      memcpy(&word, address + offset, wordSize);
+      worklist.push_back(word);
     }
   }
 }
 
 bool AddressSpace::copyInConcretes() {
+  std::vector<ObjectPair> all;
   for (MemoryMap::iterator it = objects.begin(), ie = objects.end(); 
+       it != ie; ++it)
+    all.push_back(*it);
+  return copyInConcretes(all);
+}
+
+bool AddressSpace::copyInConcretes(const std::vector<ObjectPair> &objects) {
+  for (std::vector<ObjectPair>::const_iterator it = objects.begin(),
+                                               ie = objects.end();
        it != ie; ++it) {
     const MemoryObject *mo = it->first;
 
     if (!mo->isUserSpecified) {
-      const ObjectState *os = it->second;
+      // The binding may have been copied on write since it was collected.
+      const ObjectState *os = findObject(mo);
       uint8_t *address = (uint8_t*) (unsigned long) mo->address;
 
-      if (memcmp(address, os->concreteStore, mo->size)!=0) {
+      if (os->concretesDiffer(address)) {
         if (os->readOnly) {
+          // The system memory no longer holds what was copied out.
+          forgetConcretes(objects);
           return false;
         } else {
           ObjectState *wos = getWriteable(mo, os);
-          memcpy(wos->concreteStore, address, mo->size);
+          wos->copyInConcretes(address);
         }
       }
     }
@@ -329,6 +448,19 @@ bool AddressSpace::copyInConcretes() {
   return true;
 }
 
+void AddressSpace::forgetConcretes() {
+  for (MemoryMap::iterator it = objects.begin(), ie = objects.end();
+       it != ie; ++it)
+    it->first->syncedVersions.clear();
+}
+
+void AddressSpace::forgetConcretes(const std::vector<ObjectPair> &objects) {
+  for (std::vector<ObjectPair>::const_iterator it = objects.begin(),
+                                               ie = objects.end();
+       it != ie; ++it)
+    it->first->syncedVersions.clear();
+}
+
 /***/
 
 bool MemoryObjectLT::operator()(const MemoryObject *a, const MemoryObject *b) const {
@@ -15,6 +15,8 @@
 #include "klee/Expr.h"
 #include "klee/Internal/ADT/ImmutableMap.h"
 
+#include <algorithm>
+
 namespace klee {
   class ExecutionState;
   class MemoryObject;
@@ -38,6 +40,40 @@ namespace klee {
     /// Epoch counter used to control ownership of objects.
     mutable unsigned cowKey;
 
+    /// Bytes held by the objects we own, as last charged to them.
+    mutable size_t exclusiveBytes;
+
+    /// The sum of exclusiveBytes over all live address spaces.
+    static size_t totalExclusiveBytes;
+
+    /// The owned object most recently handed out for writing, whose
+    /// usage may have grown since it was last charged.
+    mutable const ObjectState *lastWritten;
+
+    /// Recharge lastWritten for any growth since it was handed out.
+    void refreshLastWritten() const;
+
+    enum { ResolutionCacheSize = 16 };
+
+    /// A direct-mapped cache of recent resolutions of concrete addresses,
+    /// indexed by the bits above the low 6 of the address. Empty entries
+    /// have a null MemoryObject.
+    ObjectPair resolutionCache[ResolutionCacheSize];
+
+    /// Make the cached resolutions to \a mo resolve to \a os, or drop
+    /// them if \a os is null.
+    void updateResolutionCache(const MemoryObject *mo, const ObjectState *os);
+
+    void copyResolutionCache(const AddressSpace &b) {
+      std::copy(b.resolutionCache, b.resolutionCache + ResolutionCacheSize,
+                resolutionCache);
+    }
+
+    void clearResolutionCache() {
+      std::fill(resolutionCache, resolutionCache + ResolutionCacheSize,
+                ObjectPair(0, 0));
+    }
+
     /// Unsupported, use copy constructor
     AddressSpace &operator=(const AddressSpace&); 
     
@@ -52,9 +88,48 @@ namespace klee {
     MemoryMap objects;
     
   public:
-    AddressSpace() : cowKey(1) {}
-    AddressSpace(const AddressSpace &b) : cowKey(++b.cowKey), objects(b.objects) { }
-    ~AddressSpace() {}
+    AddressSpace() : cowKey(1), exclusiveBytes(0), lastWritten(0) {
+      clearResolutionCache();
+    }
+    AddressSpace(const AddressSpace &b)
+      : cowKey(++b.cowKey), exclusiveBytes(0), lastWritten(0),
+        objects(b.objects) {
+      // b no longer owns anything either.
+      totalExclusiveBytes -= b.exclusiveBytes;
+      b.exclusiveBytes = 0;
+      b.lastWritten = 0;
+      copyResolutionCache(b);
+    }
+    ~AddressSpace() { totalExclusiveBytes -= exclusiveBytes; }
+
+    /// Replace the contents with a copy of \a b, sharing its objects
+    /// copy-on-write as the copy constructor does.
+    void copyFrom(const AddressSpace &b) {
+      cowKey = ++b.cowKey;
+      objects = b.objects;
+      totalExclusiveBytes -= exclusiveBytes + b.exclusiveBytes;
+      exclusiveBytes = b.exclusiveBytes = 0;
+      lastWritten = b.lastWritten = 0;
+      copyResolutionCache(b);
+    }
+
+    /// Drop all bindings.
+    void clear() {
+      objects = MemoryMap();
+      totalExclusiveBytes -= exclusiveBytes;
+      exclusiveBytes = 0;
+      lastWritten = 0;
+      clearResolutionCache();
+    }
+
+    /// Approximate number of heap bytes held by the object states this
+    /// address space does not share with any other. Maintained as
+    /// objects are bound, unbound and copied on write.
+    size_t getExclusiveBytes() const;
+
+    /// The exclusive bytes of all live address spaces, as last charged.
+    /// Kept up to date alongside each getExclusiveBytes(), so it is cheap.
+    static size_t getTotalExclusiveBytes() { return totalExclusiveBytes; }
 
     /// Resolve address to an ObjectPair in result.
     /// \return true iff an object was found.
@@ -113,9 +188,18 @@ namespace klee {
     ObjectState *getWriteable(const MemoryObject *mo, const ObjectState *os);
 
     /// Copy the concrete values of all managed ObjectStates into the
-    /// actual system memory location they were allocated at.
+    /// actual system memory location they were allocated at. Pages which
+    /// the system memory already holds are not copied again.
     void copyOutConcretes();
 
+    /// Copy out, as copyOutConcretes does, only the objects which the
+    /// addresses in \a roots point into, and transitively those pointed
+    /// into by the pointer-sized words of their contents.
+    ///
+    /// \param[out] reachable The objects copied out.
+    void copyOutReachableConcretes(const std::vector<uint64_t> &roots,
+                                   std::vector<ObjectPair> &reachable);
+
     /// Copy the concrete values of all managed ObjectStates back from
     /// the actual system memory location they were allocated
     /// at. ObjectStates will only be written to (and thus,
@@ -125,6 +209,18 @@ namespace klee {
     /// \retval true The copy succeeded. 
     /// \retval false The copy failed because a read-only object was modified.
     bool copyInConcretes();
+
+    /// Copy back, as copyInConcretes does, only the given objects.
+    bool copyInConcretes(const std::vector<ObjectPair> &objects);
+
+    /// Forget which pages the system memory of the managed objects was
+    /// synchronized with, so that the next copy out writes them in full.
+    /// Used when an external call may have modified that memory without
+    /// it being copied back.
+    void forgetConcretes();
+
+    /// Forget, as forgetConcretes does, only for the given objects.
+    static void forgetConcretes(const std::vector<ObjectPair> &objects);
   };
 } // End klee namespace
 
@@ -22,8 +22,16 @@ Statistic stats::instructions("Instructions", "I");
 Statistic stats::minDistToReturn("MinDistToReturn", "Rdist");
 Statistic stats::minDistToUncovered("MinDistToUncovered", "UCdist");
 Statistic stats::reachableUncovered("ReachableUncovered", "IuncovReach");
+Statistic stats::resolveCacheHits("ResolveCacheHits", "RcacheHits");
+Statistic stats::resolveCacheMisses("ResolveCacheMisses", "RcacheMisses");
 Statistic stats::resolveTime("ResolveTime", "Rtime");
 Statistic stats::solverTime("SolverTime", "Stime");
 Statistic stats::states("States", "States");
+Statistic stats::swapInBytes("SwapInBytes", "SwapInB");
+Statistic stats::swapInTime("SwapInTime", "SwapInTime");
+Statistic stats::swapIns("SwapIns", "SwapIn");
+Statistic stats::swapOutBytes("SwapOutBytes", "SwapOutB");
+Statistic stats::swapOutTime("SwapOutTime", "SwapOutTime");
+Statistic stats::swapOuts("SwapOuts", "SwapOut");
 Statistic stats::trueBranches("TrueBranches", "Bt");
 Statistic stats::uncoveredInstructions("UncoveredInstructions", "Iuncov");
@@ -17,6 +17,12 @@ namespace stats {
 
   extern Statistic allocations;
   extern Statistic resolveTime;
+
+  /// Concrete address resolutions answered by, and missing, the
+  /// per-state resolution cache.
+  extern Statistic resolveCacheHits;
+  extern Statistic resolveCacheMisses;
+
   extern Statistic instructions;
   extern Statistic instructionTime;
   extern Statistic instructionRealTime;
@@ -30,6 +36,16 @@ namespace stats {
   /// The number of process forks.
   extern Statistic forks;
 
+  /// States swapped out to disk at the memory cap and swapped back in, the
+  /// bytes written and read for them, and the time spent on each, which
+  /// for swapping in is mostly replaying.
+  extern Statistic swapOuts;
+  extern Statistic swapIns;
+  extern Statistic swapOutBytes;
+  extern Statistic swapInBytes;
+  extern Statistic swapOutTime;
+  extern Statistic swapInTime;
+
   /// Number of states, this is a "fake" statistic used by istats, it
   /// isn't normally up-to-date.
   extern Statistic states;
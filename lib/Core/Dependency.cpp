@@ -805,6 +805,34 @@ Dependency::Dependency(Dependency *parent, llvm::DataLayout *_targetData)
   }
 }
 
+size_t Dependency::getMemoryUsage() const {
+  // A tree node holds three links and a colour besides its element.
+  const size_t treeNode = 4 * sizeof(void *);
+  typedef std::map<ref<TxStateAddress>,
+                   std::pair<ref<TxStateValue>, ref<TxStateValue> > > StoreMap;
+
+  size_t bytes = sizeof(*this);
+  bytes += argumentValuesList.capacity() * sizeof(ref<TxStateValue>);
+  bytes += (concretelyAddressedStore.size() +
+            symbolicallyAddressedStore.size()) *
+           (treeNode + sizeof(StoreMap::value_type));
+  bytes += (concretelyAddressedStoreKeys.capacity() +
+            symbolicallyAddressedStoreKeys.capacity()) *
+           sizeof(ref<TxStateAddress>);
+  bytes += coreLocations.size() * (treeNode + sizeof(ref<TxStateAddress>));
+
+  // The versioned values are created by this node.
+  for (std::map<llvm::Value *, std::vector<ref<TxStateValue> > >::const_iterator
+           it = valuesMap.begin(),
+           ie = valuesMap.end();
+       it != ie; ++it) {
+    bytes += treeNode + sizeof(*it) +
+             it->second.capacity() * sizeof(ref<TxStateValue>) +
+             it->second.size() * sizeof(TxStateValue);
+  }
+  return bytes;
+}
+
 Dependency::~Dependency() {
   // Delete the locally-constructed relations
   concretelyAddressedStore.clear();
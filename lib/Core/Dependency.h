@@ -450,6 +450,10 @@ namespace klee {
       llvm::errs() << "\n";
     }
 
+    /// \brief Approximate number of heap bytes held by the relations of
+    /// this node alone, estimated from the sizes of its containers.
+    size_t getMemoryUsage() const;
+
     /// \brief Print the content of the object into a stream.
     ///
     /// \param stream The stream to print the data to.
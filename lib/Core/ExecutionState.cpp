@@ -68,10 +68,19 @@ StackFrame::~StackFrame() {
 
 /***/
 
+MergeGroup::MergeGroup() : refCount(0) {
+  static uint64_t nextID = 0;
+  id = nextID++;
+}
+
+/***/
+
 ExecutionState::ExecutionState(KFunction *kf)
     : pc(kf->instructions), prevPC(pc), queryCost(0.), weight(1), depth(0),
-      instsSinceCovNew(0), coveredNew(false), forkDisabled(false), ptreeNode(0),
-      txTreeNode(0) {
+      resumeBegin(0), resumeEnd(0), lastSelected(0), swapOffset(-1),
+      swapHoldUntil(0), madeExternalCalls(false), instsSinceCovNew(0),
+      coveredNew(false), forkDisabled(false),
+      ptreeNode(0), txTreeNode(0) {
   pushFrame(0, kf);
 }
 
@@ -105,10 +114,15 @@ ExecutionState::ExecutionState(const ExecutionState &state)
       addressSpace(state.addressSpace), constraints(state.constraints),
       queryCost(state.queryCost), weight(state.weight), depth(state.depth),
       pathOS(state.pathOS), symPathOS(state.symPathOS),
+      branchDecisions(state.branchDecisions), resumeBegin(state.resumeBegin),
+      resumeEnd(state.resumeEnd), lastSelected(state.lastSelected),
+      swapOffset(state.swapOffset), swapHoldUntil(state.swapHoldUntil),
+      madeExternalCalls(state.madeExternalCalls),
       instsSinceCovNew(state.instsSinceCovNew), coveredNew(state.coveredNew),
       forkDisabled(state.forkDisabled), coveredLines(state.coveredLines),
       ptreeNode(state.ptreeNode), txTreeNode(state.txTreeNode),
-      symbolics(state.symbolics), arrayNames(state.arrayNames) {
+      symbolics(state.symbolics), arrayNames(state.arrayNames),
+      pendingMerges(state.pendingMerges) {
   for (unsigned int i=0; i<symbolics.size(); i++)
     symbolics[i].first->refCount++;
 }
@@ -128,6 +142,70 @@ void ExecutionState::addTxTreeConstraint(ref<Expr> e,
 
 }
 
+void ExecutionState::releaseExecution() {
+  for (unsigned int i=0; i<symbolics.size(); i++) {
+    const MemoryObject *mo = symbolics[i].first;
+    assert(mo->refCount > 0);
+    mo->refCount--;
+    if (mo->refCount == 0)
+      delete mo;
+  }
+  symbolics.clear();
+  arrayNames.clear();
+  fnAliases.clear();
+  // The top frame stays for the searchers and statistics, which look at the
+  // function and call path of every state, but without its values.
+  if (!stack.empty()) {
+    StackFrame top(stack.back());
+    stack.clear();
+    stack.push_back(top);
+    StackFrame &sf = stack.back();
+    for (unsigned i = 0; i < sf.kf->numRegisters; i++)
+      sf.locals[i] = Cell();
+    sf.allocas.clear();
+    sf.varargs = 0;
+  }
+  addressSpace.clear();
+  constraints = ConstraintManager();
+  pendingMerges.clear();
+}
+
+void ExecutionState::restartExecution(const ExecutionState &initial) {
+  releaseExecution();
+  fnAliases = initial.fnAliases;
+  pc = initial.pc;
+  prevPC = initial.prevPC;
+  stack.clear();
+  stack = initial.stack;
+  incomingBBIndex = initial.incomingBBIndex;
+  addressSpace.copyFrom(initial.addressSpace);
+  constraints = initial.constraints;
+  symbolics = initial.symbolics;
+  for (unsigned int i=0; i<symbolics.size(); i++)
+    symbolics[i].first->refCount++;
+  arrayNames = initial.arrayNames;
+  pendingMerges = initial.pendingMerges;
+}
+
+size_t ExecutionState::getExclusiveBytes() const {
+  size_t bytes = sizeof(*this) + addressSpace.getExclusiveBytes();
+
+  // The expressions are shared, but each state has its own list of them
+  // along with a partition representative per constraint.
+  bytes += constraints.size() * (sizeof(ref<Expr>) + sizeof(const Array *));
+
+  for (stack_ty::const_iterator it = stack.begin(), ie = stack.end();
+       it != ie; ++it)
+    bytes += sizeof(StackFrame) + it->kf->numRegisters * sizeof(Cell) +
+             it->allocas.capacity() * sizeof(const MemoryObject *);
+
+  bytes += branchDecisions.capacity() * sizeof(unsigned);
+
+  if (txTreeNode)
+    bytes += txTreeNode->getMemoryUsage();
+  return bytes;
+}
+
 ExecutionState *ExecutionState::branch() {
   depth++;
 
@@ -194,7 +272,7 @@ llvm::raw_ostream &klee::operator<<(llvm::raw_ostream &os, const MemoryMap &mm)
   return os;
 }
 
-bool ExecutionState::merge(const ExecutionState &b) {
+bool ExecutionState::merge(const ExecutionState &b, unsigned maxSelects) {
   if (DebugLogStateMerge)
     llvm::errs() << "-- attempting merge of A:" << this << " with B:" << &b
                  << "--\n";
@@ -296,6 +374,35 @@ bool ExecutionState::merge(const ExecutionState &b) {
       llvm::errs() << "\t\tmappings differ\n";
     return false;
   }
+
+  // Every differing value becomes an if-then-else which later queries have
+  // to reason about, so give up before touching anything if there are many.
+  if (maxSelects) {
+    unsigned selects = 0;
+    std::vector<StackFrame>::const_iterator itA = stack.begin();
+    std::vector<StackFrame>::const_iterator itB = b.stack.begin();
+    for (; itA != stack.end() && selects <= maxSelects; ++itA, ++itB) {
+      for (unsigned i = 0; i < itA->kf->numRegisters; i++) {
+        ref<Expr> av = itA->locals[i].getValue();
+        ref<Expr> bv = itB->locals[i].getValue();
+        if (!av.isNull() && !bv.isNull() && av != bv)
+          ++selects;
+      }
+    }
+    for (std::set<const MemoryObject *>::iterator it = mutated.begin(),
+                                                  ie = mutated.end();
+         it != ie && selects <= maxSelects; ++it) {
+      const ObjectState *os = addressSpace.findObject(*it);
+      const ObjectState *otherOS = b.addressSpace.findObject(*it);
+      if (os != otherOS)
+        selects += os->countDifferingBytes(*otherOS, maxSelects - selects);
+    }
+    if (selects > maxSelects) {
+      if (DebugLogStateMerge)
+        llvm::errs() << "\t\ttoo many values differ\n";
+      return false;
+    }
+  }
   
   // merge stack
 
@@ -318,13 +425,13 @@ bool ExecutionState::merge(const ExecutionState &b) {
     StackFrame &af = *itA;
     const StackFrame &bf = *itB;
     for (unsigned i=0; i<af.kf->numRegisters; i++) {
-      ref<Expr> &av = af.locals[i].value;
-      const ref<Expr> &bv = bf.locals[i].value;
+      ref<Expr> av = af.locals[i].getValue();
+      ref<Expr> bv = bf.locals[i].getValue();
       if (av.isNull() || bv.isNull()) {
         // if one is null then by implication (we are at same pc)
         // we cannot reuse this local, so just ignore
       } else {
-        av = SelectExpr::create(inA, av, bv);
+        af.locals[i].setValue(SelectExpr::create(inA, av, bv));
       }
     }
   }
@@ -377,7 +484,7 @@ void ExecutionState::dumpStack(llvm::raw_ostream &out) const {
 
       out << ai->getName().str();
       // XXX should go through function
-      ref<Expr> value = sf.locals[sf.kf->getArgRegister(index++)].value;
+      ref<Expr> value = sf.locals[sf.kf->getArgRegister(index++)].getValue();
       if (value.get() && isa<ConstantExpr>(value))
         out << "=" << value;
     }
@@ -31,7 +31,10 @@
 #include "klee/TimerStatIncrementer.h"
 #include "klee/CommandLine.h"
 #include "klee/Common.h"
+#include "klee/util/ArrayCache.h"
 #include "klee/util/Assignment.h"
+#include "klee/util/BatchEvaluator.h"
+#include "klee/util/ExprCloner.h"
 #include "klee/util/ExprPPrinter.h"
 #include "klee/util/ExprSMTLIBPrinter.h"
 #include "klee/util/ExprUtil.h"
@@ -45,6 +48,7 @@
 #include "klee/Internal/Module/KModule.h"
 #include "klee/Internal/Support/ErrorHandling.h"
 #include "klee/Internal/Support/FloatEvaluation.h"
+#include "klee/Internal/Support/IntEvaluation.h"
 #include "klee/Internal/System/Time.h"
 #include "klee/Internal/System/MemoryUsage.h"
 #include "klee/SolverStats.h"
@@ -107,6 +111,7 @@
 #include <string>
 
 #include <sys/mman.h>
+#include <unistd.h>
 
 #include <errno.h>
 #include <cxxabi.h>
@@ -132,6 +137,11 @@ namespace {
                         cl::init(false),
 			cl::desc("Allow calls with symbolic arguments to external functions.  This concretizes the symbolic arguments.  (default=off)"));
 
+  cl::opt<bool>
+  ExternalCallsReachableOnly("external-calls-reachable-only",
+                             cl::init(false),
+                             cl::desc("Only pass to and from external functions the memory reachable through pointers from their arguments.  Unsound for externals which keep pointers between calls, like strtok.  (default=off)"));
+
   /// The different query logging solvers that can switched on/off
   enum PrintDebugInstructionsType {
     STDERR_ALL, ///
@@ -173,6 +183,11 @@ namespace {
   cl::opt<bool>
   DebugCheckForImpliedValues("debug-check-for-implied-values");
 
+  cl::opt<bool>
+  BatchSeedEvaluation("batch-seed-evaluation", cl::init(true),
+                      cl::desc("Evaluate expressions against all seeds at "
+                               "once with a compiled evaluator (default=on)"));
+
   cl::opt<bool>
   SimplifySymIndices("simplify-sym-indices", cl::init(false),
                      cl::desc("Simplify symbolic accesses using equalities "
@@ -187,6 +202,15 @@ namespace {
   MaxSymArraySize("max-sym-array-size",
                   cl::init(0));
 
+  cl::opt<unsigned>
+  MergeResolutions("merge-resolutions",
+                   cl::init(0),
+                   cl::desc("Access memory through a symbolic pointer which "
+                            "may point into up to this many objects in a "
+                            "single state, with if-then-else expressions, "
+                            "instead of forking a state per object "
+                            "(default=0, off)"));
+
   cl::opt<bool> SuppressExternalWarnings(
       "suppress-external-warnings", cl::init(false),
       cl::desc("Supress warnings about calling external functions."));
@@ -310,6 +334,21 @@ namespace {
   MaxMemoryInhibit("max-memory-inhibit",
             cl::desc("Inhibit forking at memory cap (vs. random terminate) (default=on)"),
             cl::init(true));
+
+  cl::opt<bool>
+  SwapStates("swap-states",
+             cl::desc("At the memory cap, swap the least recently selected "
+                      "states out instead of terminating them, and replay "
+                      "them when selected again. Only the branch decisions "
+                      "go to disk; a stub of each state stays in memory, "
+                      "and replaying starts from the initial state, so it "
+                      "costs time in proportion to the path length. A state "
+                      "is not swapped out again until it has run for as "
+                      "long as its replay took. Not supported with "
+                      "interpolation (the default with Z3) or --auto-merge, "
+                      "where states are terminated at the cap instead "
+                      "(default=off)"),
+             cl::init(false));
 }
 
 
@@ -329,14 +368,24 @@ Executor::Executor(const InterpreterOptions &opts, InterpreterHandler *ih)
     : Interpreter(opts), kmodule(0), interpreterHandler(ih), searcher(0),
       externalDispatcher(new ExternalDispatcher()), statsTracker(0),
       pathWriter(0), symPathWriter(0), specialFunctionHandler(0),
-      processTree(0), txTree(0), replayKTest(0), replayPath(0), usingSeeds(0),
-      atMemoryLimit(false), inhibitForking(false), haltExecution(false),
+      processTree(0), txTree(0), replayKTest(0), replayPath(0),
+      replayPathIsPrefix(false), usingSeeds(0), atMemoryLimit(false),
+      inhibitForking(false), frontierDepth(0),
+      recordBranchDecisions(false),
+      checkpointInterval(-1), checkpointRequested(false), swapRoot(0),
+      swappingIn(0), swapFile(0), haltExecution(false),
       ivcEnabled(false),
       coreSolverTimeout(MaxCoreSolverTime != 0 && MaxInstructionTime != 0
                             ? std::min(MaxCoreSolverTime, MaxInstructionTime)
                             : std::max(MaxCoreSolverTime, MaxInstructionTime)),
       debugInstFile(0), debugLogBuffer(debugBufferString) {
 
+  // The dependency analysis of interpolation does not model the
+  // if-then-else stores a merged resolution makes.
+  if (MergeResolutions && INTERPOLATION_ENABLED)
+    klee_error("-merge-resolutions cannot be used with interpolation, "
+               "use -no-interpolation");
+
   if (coreSolverTimeout) UseForkedCoreSolver = true;
   Solver *coreSolver = klee::createCoreSolver(CoreSolverToUse);
   if (!coreSolver) {
@@ -347,7 +396,9 @@ Executor::Executor(const InterpreterOptions &opts, InterpreterHandler *ih)
       interpreterHandler->getOutputFilename(ALL_QUERIES_SMT2_FILE_NAME),
       interpreterHandler->getOutputFilename(SOLVER_QUERIES_SMT2_FILE_NAME),
       interpreterHandler->getOutputFilename(ALL_QUERIES_PC_FILE_NAME),
-      interpreterHandler->getOutputFilename(SOLVER_QUERIES_PC_FILE_NAME));
+      interpreterHandler->getOutputFilename(SOLVER_QUERIES_PC_FILE_NAME),
+      interpreterHandler->getOutputFilename(ALL_QUERIES_BINARY_FILE_NAME),
+      interpreterHandler->getOutputFilename(SOLVER_QUERIES_BINARY_FILE_NAME));
 
   this->solver = new TimingSolver(solver, EqualitySubstitution);
   memory = new MemoryManager(&arrayCache);
@@ -404,6 +455,9 @@ const Module *Executor::setModule(llvm::Module *module,
   kmodule->prepare(opts, interpreterHandler);
   specialFunctionHandler->bind();
 
+  if (unsigned region = userSearcherAutoMergeRegion())
+    kmodule->computeMergePoints(region);
+
   if (StatsTracker::useStatistics() || userSearcherRequiresMD2U()) {
     statsTracker = 
       new StatsTracker(*this,
@@ -425,6 +479,9 @@ Executor::~Executor() {
     delete statsTracker;
   delete solver;
   delete kmodule;
+  for (ExprHashMap<BatchEvaluator *>::iterator it = seedEvaluators.begin(),
+         ie = seedEvaluators.end(); it != ie; ++it)
+    delete it->second;
   while(!timers.empty()) {
     delete timers.back();
     timers.pop_back();
@@ -664,14 +721,111 @@ void Executor::initializeGlobals(ExecutionState &state) {
   }
 }
 
+void Executor::evaluateSeeds(std::vector<SeedInfo> &seeds, ref<Expr> e,
+                             std::vector< ref<Expr> > &results) {
+  results.resize(seeds.size());
+
+  BatchEvaluator *evaluator = 0;
+  if (BatchSeedEvaluation && !isa<ConstantExpr>(e) && seeds.size() > 1) {
+    ExprHashMap<BatchEvaluator *>::iterator it = seedEvaluators.find(e);
+    if (it != seedEvaluators.end()) {
+      evaluator = it->second;
+    } else {
+      // The evaluators hold their expressions alive, so bound the cache.
+      if (seedEvaluators.size() >= 4096) {
+        for (it = seedEvaluators.begin(); it != seedEvaluators.end(); ++it)
+          delete it->second;
+        seedEvaluators.clear();
+      }
+      evaluator = new BatchEvaluator(&e, &e + 1);
+      if (!evaluator->isSupported()) {
+        delete evaluator;
+        evaluator = 0;
+      }
+      seedEvaluators.insert(std::make_pair(e, evaluator));
+    }
+  }
+
+  if (!evaluator) {
+    for (unsigned i = 0; i != seeds.size(); ++i)
+      results[i] = seeds[i].assignment.evaluate(e);
+    return;
+  }
+
+  std::vector<Assignment*> assignments;
+  assignments.reserve(seeds.size());
+  for (std::vector<SeedInfo>::iterator siit = seeds.begin(),
+         siie = seeds.end(); siit != siie; ++siit)
+    assignments.push_back(&siit->assignment);
+
+  std::vector<uint64_t> values;
+  std::vector<bool> known;
+  evaluator->evaluate(0, assignments, values, known);
+  for (unsigned i = 0; i != seeds.size(); ++i) {
+    if (known[i])
+      results[i] = ConstantExpr::create(values[i], e->getWidth());
+    else
+      results[i] = seeds[i].assignment.evaluate(e);
+  }
+}
+
 void Executor::branch(ExecutionState &state, 
                       const std::vector< ref<Expr> > &conditions,
                       std::vector<ExecutionState*> &result) {
+  if (isResuming(state))
+    resumeBranch(state, conditions, result);
+  else
+    branchStates(state, conditions, result);
+
+  unsigned N = conditions.size();
+
+  // Successor i is written as i ones, then a zero unless it is the last one,
+  // so that replaying a path can tell which successor it took.
+  if (pathWriter && &state != swappingIn) {
+    for (unsigned i = 0; i < N; ++i)
+      if (result[i] && result[i] != &state)
+        result[i]->pathOS = pathWriter->open(state.pathOS);
+    for (unsigned i = 0; i < N; ++i) {
+      if (!result[i])
+        continue;
+      for (unsigned j = 0; j < i; ++j)
+        result[i]->pathOS << "1";
+      if (i + 1 < N)
+        result[i]->pathOS << "0";
+    }
+  }
+
+  if (frontierDepth) {
+    for (unsigned i = 0; i < N; ++i) {
+      if (result[i] && frontierDepth <= result[i]->depth) {
+        terminateStateOnFrontier(*result[i]);
+        result[i] = 0;
+      }
+    }
+  }
+}
+
+void Executor::branchStates(ExecutionState &state,
+                            const std::vector< ref<Expr> > &conditions,
+                            std::vector<ExecutionState*> &result) {
   TimerStatIncrementer timer(stats::forkTime);
   unsigned N = conditions.size();
   assert(N);
 
-  if (MaxForks!=~0u && stats::forks >= MaxForks) {
+  if (replayPath && !seedMap.count(&state) &&
+      (!replayPathIsPrefix || replayPosition < replayPath->size())) {
+    // Follow the successor written by branch.
+    unsigned taken = 0;
+    while (taken + 1 < N) {
+      assert(replayPosition < replayPath->size() &&
+             "ran out of branches in replay path mode");
+      if (!(*replayPath)[replayPosition++])
+        break;
+      ++taken;
+    }
+    for (unsigned i = 0; i < N; ++i)
+      result.push_back(i == taken ? &state : NULL);
+  } else if (MaxForks!=~0u && stats::forks >= MaxForks) {
     unsigned next = theRNG.getInt32() % N;
     for (unsigned i=0; i<N; ++i) {
       if (i == next) {
@@ -715,6 +869,10 @@ void Executor::branch(ExecutionState &state,
     std::vector<SeedInfo> seeds = it->second;
     seedMap.erase(it);
 
+    std::vector< std::vector< ref<Expr> > > evaluated(N);
+    for (unsigned i=0; i<N; ++i)
+      evaluateSeeds(seeds, conditions[i], evaluated[i]);
+
     // Assume each seed only satisfies one condition (necessarily true
     // when conditions are mutually exclusive and their conjunction is
     // a tautology).
@@ -724,8 +882,7 @@ void Executor::branch(ExecutionState &state,
       for (i=0; i<N; ++i) {
         ref<ConstantExpr> res;
         bool success = 
-          solver->getValue(state, siit->assignment.evaluate(conditions[i]), 
-                           res);
+          solver->getValue(state, evaluated[i][siit - seeds.begin()], res);
         assert(success && "FIXME: Unhandled solver failure");
         (void) success;
         if (res->isTrue())
@@ -752,9 +909,76 @@ void Executor::branch(ExecutionState &state,
     }
   }
 
-  for (unsigned i=0; i<N; ++i)
-    if (result[i])
+  for (unsigned i=0; i<N; ++i) {
+    if (result[i]) {
       addConstraint(*result[i], conditions[i]);
+      if (recordBranchDecisions)
+        result[i]->branchDecisions.push_back(i);
+    }
+  }
+}
+
+bool Executor::isResuming(ExecutionState &state) {
+  if (state.resumeBegin == state.resumeEnd)
+    return false;
+  if (resumeTrails[state.resumeBegin].size() > state.branchDecisions.size())
+    return true;
+
+  // The state has reached the checkpointed state.
+  state.resumeBegin = state.resumeEnd = 0;
+  return false;
+}
+
+unsigned Executor::getResumeSplit(const ExecutionState &state,
+                                  unsigned successor) {
+  unsigned position = state.branchDecisions.size();
+  unsigned i = state.resumeBegin;
+  while (i != state.resumeEnd && resumeTrails[i][position] < successor)
+    ++i;
+  return i;
+}
+
+void Executor::resumeBranch(ExecutionState &state,
+                            const std::vector< ref<Expr> > &conditions,
+                            std::vector<ExecutionState*> &result) {
+  unsigned N = conditions.size();
+  std::vector<unsigned> bounds;
+  for (unsigned i = 0; i <= N; ++i)
+    bounds.push_back(getResumeSplit(state, i));
+  if (bounds[N] != state.resumeEnd) {
+    klee_warning_once(0, "state diverged from its recorded branch decisions, "
+                         "exploring it from here");
+    state.resumeBegin = state.resumeEnd = 0;
+    branchStates(state, conditions, result);
+    return;
+  }
+
+  std::vector< ref<Expr> > taken;
+  std::vector<unsigned> takenIndex;
+  for (unsigned i = 0; i < N; ++i) {
+    if (bounds[i] != bounds[i + 1]) {
+      taken.push_back(conditions[i]);
+      takenIndex.push_back(i);
+    }
+  }
+
+  // Branch over the taken successors alone, then give each the trails which
+  // take it.
+  std::vector<ExecutionState*> takenResult;
+  state.resumeBegin = state.resumeEnd = 0;
+  branchStates(state, taken, takenResult);
+
+  result.assign(N, 0);
+  for (unsigned j = 0; j < taken.size(); ++j) {
+    ExecutionState *es = takenResult[j];
+    if (!es)
+      continue;
+    unsigned i = takenIndex[j];
+    es->resumeBegin = bounds[i];
+    es->resumeEnd = bounds[i + 1];
+    es->branchDecisions.back() = i;
+    result[i] = es;
+  }
 }
 
 Executor::StatePair 
@@ -809,7 +1033,8 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
   }
 
   if (!isSeeding) {
-    if (replayPath && !isInternal) {
+    if (replayPath && !isInternal &&
+        (!replayPathIsPrefix || replayPosition < replayPath->size())) {
       assert(replayPosition<replayPath->size() &&
              "ran out of branches in replay path mode");
       bool branch = (*replayPath)[replayPosition++];
@@ -828,6 +1053,23 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
           addConstraint(current, Expr::createIsZero(condition));
         }
       }
+    } else if (isResuming(current)) {
+      // Follow the checkpointed states, forking only where they differ.
+      unsigned split = getResumeSplit(current, 1);
+      bool toFalse = split != current.resumeBegin;
+      bool toTrue = split != current.resumeEnd;
+      if ((res == Solver::True && toFalse) ||
+          (res == Solver::False && toTrue)) {
+        klee_warning_once(0, "state diverged from its recorded branch "
+                             "decisions, exploring it from here");
+        current.resumeBegin = current.resumeEnd = 0;
+      } else if (res == Solver::Unknown && !toFalse) {
+        addConstraint(current, condition);
+        res = Solver::True;
+      } else if (res == Solver::Unknown && !toTrue) {
+        addConstraint(current, Expr::createIsZero(condition));
+        res = Solver::False;
+      }
     } else if (res==Solver::Unknown) {
       assert(!replayKTest && "in replay mode, only one branch can be true.");
 
@@ -863,12 +1105,13 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
       (current.forkDisabled || OnlyReplaySeeds) && 
       res == Solver::Unknown) {
     bool trueSeed=false, falseSeed=false;
+    std::vector< ref<Expr> > evaluated;
+    evaluateSeeds(it->second, condition, evaluated);
     // Is seed extension still ok here?
-    for (std::vector<SeedInfo>::iterator siit = it->second.begin(), 
-           siie = it->second.end(); siit != siie; ++siit) {
+    for (std::vector< ref<Expr> >::iterator eit = evaluated.begin(),
+           eie = evaluated.end(); eit != eie; ++eit) {
       ref<ConstantExpr> res;
-      bool success = 
-        solver->getValue(current, siit->assignment.evaluate(condition), res);
+      bool success = solver->getValue(current, *eit, res);
       assert(success && "FIXME: Unhandled solver failure");
       (void) success;
       if (res->isTrue()) {
@@ -897,11 +1140,14 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
   // search ones. If that makes sense.
   if (res==Solver::True) {
 
-    if (!isInternal) {
+    // A state being swapped in has already written its path.
+    if (!isInternal && &current != swappingIn) {
       if (pathWriter) {
         current.pathOS << "1";
       }
     }
+    if (recordBranchDecisions)
+      current.branchDecisions.push_back(1);
 
     if (INTERPOLATION_ENABLED) {
       // Validity proof succeeded of a query: antecedent -> consequent.
@@ -912,11 +1158,13 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
 
     return StatePair(&current, 0);
   } else if (res==Solver::False) {
-    if (!isInternal) {
+    if (!isInternal && &current != swappingIn) {
       if (pathWriter) {
         current.pathOS << "0";
       }
     }
+    if (recordBranchDecisions)
+      current.branchDecisions.push_back(0);
 
     if (INTERPOLATION_ENABLED) {
       // Falsity proof succeeded of a query: antecedent -> consequent,
@@ -943,11 +1191,13 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
       it->second.clear();
       std::vector<SeedInfo> &trueSeeds = seedMap[trueState];
       std::vector<SeedInfo> &falseSeeds = seedMap[falseState];
+      std::vector< ref<Expr> > evaluated;
+      evaluateSeeds(seeds, condition, evaluated);
       for (std::vector<SeedInfo>::iterator siit = seeds.begin(), 
              siie = seeds.end(); siit != siie; ++siit) {
         ref<ConstantExpr> res;
-        bool success =
-          solver->getValue(current, siit->assignment.evaluate(condition), res);
+        bool success = solver->getValue(current,
+                                        evaluated[siit - seeds.begin()], res);
         assert(success && "FIXME: Unhandled solver failure");
         (void) success;
         if (res->isTrue()) {
@@ -978,6 +1228,16 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
     falseState->ptreeNode = res.first;
     trueState->ptreeNode = res.second;
 
+    if (current.resumeBegin != current.resumeEnd) {
+      unsigned split = getResumeSplit(current, 1);
+      falseState->resumeEnd = split;
+      trueState->resumeBegin = split;
+    }
+    if (recordBranchDecisions) {
+      trueState->branchDecisions.push_back(1);
+      falseState->branchDecisions.push_back(0);
+    }
+
     if (!isInternal) {
       if (pathWriter) {
         falseState->pathOS = pathWriter->open(current.pathOS);
@@ -1008,6 +1268,12 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
       return StatePair(0, 0);
     }
 
+    if (frontierDepth && frontierDepth <= trueState->depth) {
+      terminateStateOnFrontier(*trueState);
+      terminateStateOnFrontier(*falseState);
+      return StatePair(0, 0);
+    }
+
     return StatePair(trueState, falseState);
   }
 }
@@ -1024,11 +1290,13 @@ void Executor::addConstraint(ExecutionState &state, ref<Expr> condition) {
     seedMap.find(&state);
   if (it != seedMap.end()) {
     bool warn = false;
+    std::vector< ref<Expr> > evaluated;
+    evaluateSeeds(it->second, condition, evaluated);
     for (std::vector<SeedInfo>::iterator siit = it->second.begin(), 
            siie = it->second.end(); siit != siie; ++siit) {
       bool res;
-      bool success = 
-        solver->mustBeFalse(state, siit->assignment.evaluate(condition), res);
+      bool success = solver->mustBeFalse(
+          state, evaluated[siit - it->second.begin()], res);
       assert(success && "FIXME: Unhandled solver failure");
       (void) success;
       if (res) {
@@ -1128,12 +1396,12 @@ const Cell& Executor::eval(KInstruction *ki, unsigned index,
 
 void Executor::bindLocal(KInstruction *target, ExecutionState &state, 
                          ref<Expr> value) {
-  getDestCell(state, target).value = value;
+  getDestCell(state, target).setValue(value);
 }
 
 void Executor::bindArgument(KFunction *kf, unsigned index, 
                             ExecutionState &state, ref<Expr> value) {
-  getArgumentCell(state, kf, index).value = value;
+  getArgumentCell(state, kf, index).setValue(value);
 }
 
 ref<Expr> Executor::toUnique(const ExecutionState &state, 
@@ -1205,11 +1473,12 @@ void Executor::executeGetValue(ExecutionState &state,
     }
   } else {
     std::set< ref<Expr> > values;
-    for (std::vector<SeedInfo>::iterator siit = it->second.begin(), 
-           siie = it->second.end(); siit != siie; ++siit) {
+    std::vector< ref<Expr> > evaluated;
+    evaluateSeeds(it->second, e, evaluated);
+    for (std::vector< ref<Expr> >::iterator eit = evaluated.begin(),
+           eie = evaluated.end(); eit != eie; ++eit) {
       ref<ConstantExpr> value;
-      bool success = 
-        solver->getValue(state, siit->assignment.evaluate(e), value);
+      bool success = solver->getValue(state, *eit, value);
       assert(success && "FIXME: Unhandled solver failure");
       (void) success;
       values.insert(value);
@@ -1552,9 +1821,113 @@ static inline const llvm::fltSemantics * fpWidthToSemantics(unsigned width) {
   }
 }
 
+bool Executor::executeImmediate(ExecutionState &state, KInstruction *ki) {
+  Instruction *i = ki->inst;
+  unsigned opcode = i->getOpcode();
+
+  if (Instruction::isCast(opcode)) {
+    if (opcode != Instruction::Trunc && opcode != Instruction::ZExt &&
+        opcode != Instruction::SExt)
+      return false;
+    const Cell &arg = eval(ki, 0, state);
+    Expr::Width width = getWidthForLLVMType(i->getType());
+    if (!arg.isConstant() || width > Expr::Int64)
+      return false;
+    uint64_t v = arg.getConstant();
+    if (opcode == Instruction::SExt)
+      v = ints::sext(v, width, arg.getWidth());
+    Cell &dest = getDestCell(state, ki);
+    dest.setConstant(v, width);
+
+    // Dependency tracking needs expressions, so only it conses them up.
+    if (INTERPOLATION_ENABLED)
+      txTree->execute(i, dest.getValue(), arg.getValue());
+    return true;
+  }
+
+  if (!Instruction::isBinaryOp(opcode) && opcode != Instruction::ICmp)
+    return false;
+  const Cell &left = eval(ki, 0, state);
+  const Cell &right = eval(ki, 1, state);
+  if (!left.isConstant() || !right.isConstant())
+    return false;
+  uint64_t l = left.getConstant(), r = right.getConstant();
+  Expr::Width w = left.getWidth();
+  uint64_t result;
+
+  switch (opcode) {
+  case Instruction::Add: result = ints::add(l, r, w); break;
+  case Instruction::Sub: result = ints::sub(l, r, w); break;
+  case Instruction::Mul: result = ints::mul(l, r, w); break;
+  case Instruction::And: result = ints::land(l, r, w); break;
+  case Instruction::Or: result = ints::lor(l, r, w); break;
+  case Instruction::Xor: result = ints::lxor(l, r, w); break;
+
+  // Division by zero, signed overflow and oversized shifts are left to the
+  // expression library, which defines what they do.
+  case Instruction::UDiv:
+  case Instruction::URem:
+    if (!r)
+      return false;
+    result = opcode == Instruction::UDiv ? ints::udiv(l, r, w)
+                                         : ints::urem(l, r, w);
+    break;
+  case Instruction::SDiv:
+  case Instruction::SRem:
+    if (!r || ints::sext(r, Expr::Int64, w) == ~0ULL)
+      return false;
+    result = opcode == Instruction::SDiv ? ints::sdiv(l, r, w)
+                                         : ints::srem(l, r, w);
+    break;
+  case Instruction::Shl:
+  case Instruction::LShr:
+  case Instruction::AShr:
+    if (r >= w)
+      return false;
+    result = opcode == Instruction::Shl
+                 ? ints::shl(l, r, w)
+                 : opcode == Instruction::LShr ? ints::lshr(l, r, w)
+                                               : ints::ashr(l, r, w);
+    break;
+
+  case Instruction::ICmp:
+    switch (cast<ICmpInst>(i)->getPredicate()) {
+    case ICmpInst::ICMP_EQ: result = ints::eq(l, r, w); break;
+    case ICmpInst::ICMP_NE: result = ints::ne(l, r, w); break;
+    case ICmpInst::ICMP_UGT: result = ints::ugt(l, r, w); break;
+    case ICmpInst::ICMP_UGE: result = ints::uge(l, r, w); break;
+    case ICmpInst::ICMP_ULT: result = ints::ult(l, r, w); break;
+    case ICmpInst::ICMP_ULE: result = ints::ule(l, r, w); break;
+    case ICmpInst::ICMP_SGT: result = ints::sgt(l, r, w); break;
+    case ICmpInst::ICMP_SGE: result = ints::sge(l, r, w); break;
+    case ICmpInst::ICMP_SLT: result = ints::slt(l, r, w); break;
+    case ICmpInst::ICMP_SLE: result = ints::sle(l, r, w); break;
+    default:
+      return false;
+    }
+    w = Expr::Bool;
+    break;
+
+  default:
+    // floating point
+    return false;
+  }
+
+  Cell &dest = getDestCell(state, ki);
+  dest.setConstant(result, w);
+
+  if (INTERPOLATION_ENABLED)
+    txTree->execute(i, dest.getValue(), left.getValue(), right.getValue());
+  return true;
+}
+
 void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   Instruction *i = ki->inst;
 
+  // Concrete integer operations work on the registers directly.
+  if (executeImmediate(state, ki))
+    return;
+
   switch (i->getOpcode()) {
     // Control flow
   case Instruction::Ret: {
@@ -1565,7 +1938,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     ref<Expr> result = ConstantExpr::alloc(0, Expr::Bool);
     
     if (!isVoidReturn) {
-      result = eval(ki, 0, state).value;
+      result = eval(ki, 0, state).getValue();
     }
 
     if (state.stack.size() <= 1) {
@@ -1658,7 +2031,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       // FIXME: Find a way that we don't have this hidden dependency.
       assert(bi->getCondition() == bi->getOperand(0) &&
              "Wrong operand index!");
-      ref<Expr> cond = eval(ki, 0, state).value;
+      ref<Expr> cond = eval(ki, 0, state).getValue();
       Executor::StatePair branches = fork(state, cond, false);
 
       // NOTE: There is a hidden dependency here, markBranchVisited
@@ -1673,6 +2046,18 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       if (branches.second)
         transferToBasicBlock(bi->getSuccessor(1), bi->getParent(), *branches.second);
 
+      // Both sides may be merged again where they join.
+      if (branches.first && branches.second) {
+        KFunction *kf = state.stack.back().kf;
+        std::map<BasicBlock *, Instruction *>::iterator it =
+            kf->mergePoints.find(bi->getParent());
+        if (it != kf->mergePoints.end()) {
+          PendingMerge pm(it->second, state.stack.size(), new MergeGroup());
+          branches.first->pendingMerges.push_back(pm);
+          branches.second->pendingMerges.push_back(pm);
+        }
+      }
+
       // Below we test if some of the branches are not available for
       // exploration, which means that there is a dependency of the program
       // state on the control variables in the conditional. Such variables
@@ -1690,7 +2075,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
   case Instruction::Switch: {
     SwitchInst *si = cast<SwitchInst>(i);
-    ref<Expr> cond = eval(ki, 0, state).value;
+    ref<Expr> cond = eval(ki, 0, state).getValue();
     BasicBlock *bb = si->getParent();
 
     cond = toUnique(state, cond);
@@ -1844,7 +2229,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     arguments.reserve(numArgs);
 
     for (unsigned j=0; j<numArgs; ++j)
-      arguments.push_back(eval(ki, j+1, state).value);
+      arguments.push_back(eval(ki, j+1, state).getValue());
 
     if (f) {
       const FunctionType *fType = 
@@ -1890,7 +2275,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       }
       executeCall(state, ki, f, arguments);
     } else {
-      ref<Expr> v = eval(ki, 0, state).value;
+      ref<Expr> v = eval(ki, 0, state).getValue();
 
       ExecutionState *free = &state;
       bool hasInvalid = false, first = true;
@@ -1932,9 +2317,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
   case Instruction::PHI: {
 #if LLVM_VERSION_CODE >= LLVM_VERSION(3, 0)
-    ref<Expr> result = eval(ki, state.incomingBBIndex, state).value;
+    ref<Expr> result = eval(ki, state.incomingBBIndex, state).getValue();
 #else
-    ref<Expr> result = eval(ki, state.incomingBBIndex * 2, state).value;
+    ref<Expr> result = eval(ki, state.incomingBBIndex * 2, state).getValue();
 #endif
     bindLocal(ki, state, result);
 
@@ -1952,9 +2337,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
     // Special instructions
   case Instruction::Select: {
-    ref<Expr> cond = eval(ki, 0, state).value;
-    ref<Expr> tExpr = eval(ki, 1, state).value;
-    ref<Expr> fExpr = eval(ki, 2, state).value;
+    ref<Expr> cond = eval(ki, 0, state).getValue();
+    ref<Expr> tExpr = eval(ki, 1, state).getValue();
+    ref<Expr> fExpr = eval(ki, 2, state).getValue();
     ref<Expr> result = SelectExpr::create(cond, tExpr, fExpr);
     bindLocal(ki, state, result);
 
@@ -1971,8 +2356,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     // Arithmetic / logical
 
   case Instruction::Add: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     ref<Expr> result = AddExpr::create(left, right);
     bindLocal(ki, state, result);
 
@@ -1983,8 +2368,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::Sub: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     ref<Expr> result = SubExpr::create(left, right);
     bindLocal(ki, state, result);
 
@@ -1995,8 +2380,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
  
   case Instruction::Mul: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     ref<Expr> result = MulExpr::create(left, right);
     bindLocal(ki, state, result);
 
@@ -2007,8 +2392,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::UDiv: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     ref<Expr> result = UDivExpr::create(left, right);
     bindLocal(ki, state, result);
 
@@ -2019,8 +2404,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::SDiv: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     ref<Expr> result = SDivExpr::create(left, right);
     bindLocal(ki, state, result);
 
@@ -2031,8 +2416,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::URem: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     ref<Expr> result = URemExpr::create(left, right);
     bindLocal(ki, state, result);
 
@@ -2043,8 +2428,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
  
   case Instruction::SRem: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     ref<Expr> result = SRemExpr::create(left, right);
     bindLocal(ki, state, result);
 
@@ -2055,8 +2440,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::And: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     ref<Expr> result = AndExpr::create(left, right);
     bindLocal(ki, state, result);
 
@@ -2067,8 +2452,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::Or: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     ref<Expr> result = OrExpr::create(left, right);
     bindLocal(ki, state, result);
 
@@ -2079,8 +2464,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::Xor: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     ref<Expr> result = XorExpr::create(left, right);
     bindLocal(ki, state, result);
 
@@ -2091,8 +2476,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::Shl: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     ref<Expr> result = ShlExpr::create(left, right);
     bindLocal(ki, state, result);
 
@@ -2103,8 +2488,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::LShr: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     ref<Expr> result = LShrExpr::create(left, right);
     bindLocal(ki, state, result);
 
@@ -2115,8 +2500,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::AShr: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     ref<Expr> result = AShrExpr::create(left, right);
     bindLocal(ki, state, result);
 
@@ -2135,80 +2520,80 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
     switch(ii->getPredicate()) {
     case ICmpInst::ICMP_EQ: {
-      left = eval(ki, 0, state).value;
-      right = eval(ki, 1, state).value;
+      left = eval(ki, 0, state).getValue();
+      right = eval(ki, 1, state).getValue();
       result = EqExpr::create(left, right);
       bindLocal(ki, state, result);
       break;
     }
 
     case ICmpInst::ICMP_NE: {
-      left = eval(ki, 0, state).value;
-      right = eval(ki, 1, state).value;
+      left = eval(ki, 0, state).getValue();
+      right = eval(ki, 1, state).getValue();
       result = NeExpr::create(left, right);
       bindLocal(ki, state, result);
       break;
     }
 
     case ICmpInst::ICMP_UGT: {
-      left = eval(ki, 0, state).value;
-      right = eval(ki, 1, state).value;
+      left = eval(ki, 0, state).getValue();
+      right = eval(ki, 1, state).getValue();
       result = UgtExpr::create(left, right);
       bindLocal(ki, state,result);
       break;
     }
 
     case ICmpInst::ICMP_UGE: {
-      left = eval(ki, 0, state).value;
-      right = eval(ki, 1, state).value;
+      left = eval(ki, 0, state).getValue();
+      right = eval(ki, 1, state).getValue();
       result = UgeExpr::create(left, right);
       bindLocal(ki, state, result);
       break;
     }
 
     case ICmpInst::ICMP_ULT: {
-      left = eval(ki, 0, state).value;
-      right = eval(ki, 1, state).value;
+      left = eval(ki, 0, state).getValue();
+      right = eval(ki, 1, state).getValue();
       result = UltExpr::create(left, right);
       bindLocal(ki, state, result);
       break;
     }
 
     case ICmpInst::ICMP_ULE: {
-      left = eval(ki, 0, state).value;
-      right = eval(ki, 1, state).value;
+      left = eval(ki, 0, state).getValue();
+      right = eval(ki, 1, state).getValue();
       result = UleExpr::create(left, right);
       bindLocal(ki, state, result);
       break;
     }
 
     case ICmpInst::ICMP_SGT: {
-      left = eval(ki, 0, state).value;
-      right = eval(ki, 1, state).value;
+      left = eval(ki, 0, state).getValue();
+      right = eval(ki, 1, state).getValue();
       result = SgtExpr::create(left, right);
       bindLocal(ki, state, result);
       break;
     }
 
     case ICmpInst::ICMP_SGE: {
-      left = eval(ki, 0, state).value;
-      right = eval(ki, 1, state).value;
+      left = eval(ki, 0, state).getValue();
+      right = eval(ki, 1, state).getValue();
       result = SgeExpr::create(left, right);
       bindLocal(ki, state, result);
       break;
     }
 
     case ICmpInst::ICMP_SLT: {
-      left = eval(ki, 0, state).value;
-      right = eval(ki, 1, state).value;
+      left = eval(ki, 0, state).getValue();
+      right = eval(ki, 1, state).getValue();
       result = SltExpr::create(left, right);
       bindLocal(ki, state, result);
       break;
     }
 
     case ICmpInst::ICMP_SLE: {
-      left = eval(ki, 0, state).value;
-      right = eval(ki, 1, state).value;
+      left = eval(ki, 0, state).getValue();
+      right = eval(ki, 1, state).getValue();
       result = SleExpr::create(left, right);
       bindLocal(ki, state, result);
       break;
@@ -2231,7 +2616,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       kmodule->targetData->getTypeStoreSize(ai->getAllocatedType());
     ref<Expr> size = Expr::createPointer(elementSize);
     if (ai->isArrayAllocation()) {
-      ref<Expr> count = eval(ki, 0, state).value;
+      ref<Expr> count = eval(ki, 0, state).getValue();
       count = Expr::createZExtToPointerWidth(count);
       size = MulExpr::create(size, count);
     }
@@ -2240,20 +2625,20 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::Load: {
-    ref<Expr> base = eval(ki, 0, state).value;
+    ref<Expr> base = eval(ki, 0, state).getValue();
     executeMemoryOperation(state, false, base, 0, ki);
     break;
   }
   case Instruction::Store: {
-    ref<Expr> base = eval(ki, 1, state).value;
-    ref<Expr> value = eval(ki, 0, state).value;
+    ref<Expr> base = eval(ki, 1, state).getValue();
+    ref<Expr> value = eval(ki, 0, state).getValue();
     executeMemoryOperation(state, true, base, value, ki);
     break;
   }
 
   case Instruction::GetElementPtr: {
     KGEPInstruction *kgepi = static_cast<KGEPInstruction*>(ki);
-    ref<Expr> base = eval(ki, 0, state).value;
+    ref<Expr> base = eval(ki, 0, state).getValue();
     ref<Expr> address(base);
     ref<Expr> offset(Expr::createPointer(0));
 
@@ -2261,7 +2646,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
            it = kgepi->indices.begin(), ie = kgepi->indices.end(); 
          it != ie; ++it) {
       uint64_t elementSize = it->second;
-      ref<Expr> index = eval(ki, it->first, state).value;
+      ref<Expr> index = eval(ki, it->first, state).getValue();
       address = AddExpr::create(
           address, MulExpr::create(Expr::createSExtToPointerWidth(index),
                                    Expr::createPointer(elementSize)));
@@ -2288,8 +2673,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     // Conversion
   case Instruction::Trunc: {
     CastInst *ci = cast<CastInst>(i);
-    ref<Expr> arg = eval(ki, 0, state).value;
-    ref<Expr> result = ExtractExpr::create(eval(ki, 0, state).value,
+    ref<Expr> arg = eval(ki, 0, state).getValue();
+    ref<Expr> result = ExtractExpr::create(eval(ki, 0, state).getValue(),
                                            0,
                                            getWidthForLLVMType(ci->getType()));
     bindLocal(ki, state, result);
@@ -2301,7 +2686,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
   case Instruction::ZExt: {
     CastInst *ci = cast<CastInst>(i);
-    ref<Expr> arg = eval(ki, 0, state).value;
+    ref<Expr> arg = eval(ki, 0, state).getValue();
     ref<Expr> result =
         ZExtExpr::create(arg, getWidthForLLVMType(ci->getType()));
     bindLocal(ki, state, result);
@@ -2313,7 +2698,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
   case Instruction::SExt: {
     CastInst *ci = cast<CastInst>(i);
-    ref<Expr> arg = eval(ki, 0, state).value;
+    ref<Expr> arg = eval(ki, 0, state).getValue();
     ref<Expr> result =
         SExtExpr::create(arg, getWidthForLLVMType(ci->getType()));
     bindLocal(ki, state, result);
@@ -2327,7 +2712,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::IntToPtr: {
     CastInst *ci = cast<CastInst>(i);
     Expr::Width pType = getWidthForLLVMType(ci->getType());
-    ref<Expr> arg = eval(ki, 0, state).value;
+    ref<Expr> arg = eval(ki, 0, state).getValue();
     ref<Expr> result = ZExtExpr::create(arg, pType);
     bindLocal(ki, state, result);
 
@@ -2339,7 +2724,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::PtrToInt: {
     CastInst *ci = cast<CastInst>(i);
     Expr::Width iType = getWidthForLLVMType(ci->getType());
-    ref<Expr> arg = eval(ki, 0, state).value;
+    ref<Expr> arg = eval(ki, 0, state).getValue();
     ref<Expr> result = ZExtExpr::create(arg, iType);
     bindLocal(ki, state, result);
 
@@ -2350,7 +2735,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::BitCast: {
-    ref<Expr> result = eval(ki, 0, state).value;
+    ref<Expr> result = eval(ki, 0, state).getValue();
     bindLocal(ki, state, result);
 
     // Update dependency
@@ -2362,9 +2747,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     // Floating point instructions
 
   case Instruction::FAdd: {
-    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).value,
+    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).getValue(),
                                         "floating point");
-    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).value,
+    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).getValue(),
                                          "floating point");
     if (!fpWidthToSemantics(left->getWidth()) ||
         !fpWidthToSemantics(right->getWidth()))
@@ -2387,9 +2772,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::FSub: {
-    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).value,
+    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).getValue(),
                                         "floating point");
-    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).value,
+    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).getValue(),
                                          "floating point");
     if (!fpWidthToSemantics(left->getWidth()) ||
         !fpWidthToSemantics(right->getWidth()))
@@ -2411,9 +2796,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
  
   case Instruction::FMul: {
-    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).value,
+    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).getValue(),
                                         "floating point");
-    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).value,
+    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).getValue(),
                                          "floating point");
     if (!fpWidthToSemantics(left->getWidth()) ||
         !fpWidthToSemantics(right->getWidth()))
@@ -2436,9 +2821,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::FDiv: {
-    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).value,
+    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).getValue(),
                                         "floating point");
-    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).value,
+    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).getValue(),
                                          "floating point");
     if (!fpWidthToSemantics(left->getWidth()) ||
         !fpWidthToSemantics(right->getWidth()))
@@ -2461,9 +2846,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::FRem: {
-    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).value,
+    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).getValue(),
                                         "floating point");
-    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).value,
+    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).getValue(),
                                          "floating point");
     if (!fpWidthToSemantics(left->getWidth()) ||
         !fpWidthToSemantics(right->getWidth()))
@@ -2488,7 +2873,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::FPTrunc: {
     FPTruncInst *fi = cast<FPTruncInst>(i);
     Expr::Width resultType = getWidthForLLVMType(fi->getType());
-    ref<Expr> origArg = eval(ki, 0, state).value;
+    ref<Expr> origArg = eval(ki, 0, state).getValue();
     ref<ConstantExpr> arg = toConstant(state, origArg, "floating point");
     if (!fpWidthToSemantics(arg->getWidth()) || resultType > arg->getWidth())
       return terminateStateOnExecError(state, "Unsupported FPTrunc operation");
@@ -2514,7 +2899,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::FPExt: {
     FPExtInst *fi = cast<FPExtInst>(i);
     Expr::Width resultType = getWidthForLLVMType(fi->getType());
-    ref<Expr> origArg = eval(ki, 0, state).value;
+    ref<Expr> origArg = eval(ki, 0, state).getValue();
     ref<ConstantExpr> arg = toConstant(state, origArg, "floating point");
     if (!fpWidthToSemantics(arg->getWidth()) || arg->getWidth() > resultType)
       return terminateStateOnExecError(state, "Unsupported FPExt operation");
@@ -2539,7 +2924,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::FPToUI: {
     FPToUIInst *fi = cast<FPToUIInst>(i);
     Expr::Width resultType = getWidthForLLVMType(fi->getType());
-    ref<Expr> origArg = eval(ki, 0, state).value;
+    ref<Expr> origArg = eval(ki, 0, state).getValue();
     ref<ConstantExpr> arg = toConstant(state, origArg, "floating point");
     if (!fpWidthToSemantics(arg->getWidth()) || resultType > 64)
       return terminateStateOnExecError(state, "Unsupported FPToUI operation");
@@ -2565,7 +2950,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::FPToSI: {
     FPToSIInst *fi = cast<FPToSIInst>(i);
     Expr::Width resultType = getWidthForLLVMType(fi->getType());
-    ref<Expr> origArg = eval(ki, 0, state).value;
+    ref<Expr> origArg = eval(ki, 0, state).getValue();
     ref<ConstantExpr> arg = toConstant(state, origArg, "floating point");
     if (!fpWidthToSemantics(arg->getWidth()) || resultType > 64)
       return terminateStateOnExecError(state, "Unsupported FPToSI operation");
@@ -2591,7 +2976,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::UIToFP: {
     UIToFPInst *fi = cast<UIToFPInst>(i);
     Expr::Width resultType = getWidthForLLVMType(fi->getType());
-    ref<Expr> origArg = eval(ki, 0, state).value;
+    ref<Expr> origArg = eval(ki, 0, state).getValue();
     ref<ConstantExpr> arg = toConstant(state, origArg, "floating point");
     const llvm::fltSemantics *semantics = fpWidthToSemantics(resultType);
     if (!semantics)
@@ -2612,7 +2997,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::SIToFP: {
     SIToFPInst *fi = cast<SIToFPInst>(i);
     Expr::Width resultType = getWidthForLLVMType(fi->getType());
-    ref<Expr> origArg = eval(ki, 0, state).value;
+    ref<Expr> origArg = eval(ki, 0, state).getValue();
     ref<ConstantExpr> arg = toConstant(state, origArg, "floating point");
     const llvm::fltSemantics *semantics = fpWidthToSemantics(resultType);
     if (!semantics)
@@ -2632,9 +3017,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
   case Instruction::FCmp: {
     FCmpInst *fi = cast<FCmpInst>(i);
-    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).value,
+    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).getValue(),
                                         "floating point");
-    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).value,
+    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).getValue(),
                                          "floating point");
     if (!fpWidthToSemantics(left->getWidth()) ||
         !fpWidthToSemantics(right->getWidth()))
@@ -2735,8 +3120,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::InsertValue: {
     KGEPInstruction *kgepi = static_cast<KGEPInstruction*>(ki);
 
-    ref<Expr> agg = eval(ki, 0, state).value;
-    ref<Expr> val = eval(ki, 1, state).value;
+    ref<Expr> agg = eval(ki, 0, state).getValue();
+    ref<Expr> val = eval(ki, 1, state).getValue();
 
     ref<Expr> l = NULL, r = NULL;
     unsigned lOffset = kgepi->offset*8, rOffset = kgepi->offset*8 + val->getWidth();
@@ -2766,7 +3151,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::ExtractValue: {
     KGEPInstruction *kgepi = static_cast<KGEPInstruction*>(ki);
 
-    ref<Expr> agg = eval(ki, 0, state).value;
+    ref<Expr> agg = eval(ki, 0, state).getValue();
 
     ref<Expr> result = ExtractExpr::create(agg, kgepi->offset*8, getWidthForLLVMType(i->getType()));
 
@@ -2884,11 +3269,11 @@ void Executor::bindModuleConstants() {
   kmodule->constantTable = new Cell[kmodule->constants.size()];
   for (unsigned i=0; i<kmodule->constants.size(); ++i) {
     Cell &c = kmodule->constantTable[i];
-    c.value = evalConstant(kmodule->constants[i]);
+    c.setValue(evalConstant(kmodule->constants[i]));
   }
 }
 
-void Executor::checkMemoryUsage() {
+void Executor::checkMemoryUsage(ExecutionState &current) {
   if (!MaxMemory)
     return;
   if ((stats::instructions & 0xFFFF) == 0) {
@@ -2899,22 +3284,38 @@ void Executor::checkMemoryUsage() {
                    (memory->getUsedDeterministicSize() >> 20);
 
     if (mbs > MaxMemory) {
-      if (mbs > MaxMemory + 100) {
-        // just guess at how many to kill
-        unsigned numStates = states.size();
-        unsigned toKill = std::max(1U, numStates - numStates * MaxMemory / mbs);
-        klee_warning("killing %d states (over memory cap)", toKill);
-        std::vector<ExecutionState *> arr(states.begin(), states.end());
-        for (unsigned i = 0, N = arr.size(); N && i < toKill; ++i, --N) {
-          unsigned idx = rand() % N;
-          // Make two pulls to try and not hit a state that
-          // covered new code.
-          if (arr[idx]->coveredNew)
-            idx = rand() % N;
-
-          std::swap(arr[idx], arr[N - 1]);
-          terminateStateEarly(*arr[N - 1], "Memory limit exceeded.");
+      // Swapped out states hold no memory to free. Those holding the most
+      // are evicted first, sparing the ones which covered new code.
+      std::vector<std::pair<std::pair<bool, size_t>, ExecutionState *> > arr;
+      for (std::set<ExecutionState *>::iterator it = states.begin(),
+                                                ie = states.end();
+           it != ie; ++it) {
+        if ((*it)->swapOffset < 0)
+          arr.push_back(std::make_pair(
+              std::make_pair(!(*it)->coveredNew, (*it)->getExclusiveBytes()),
+              *it));
+      }
+      std::sort(arr.rbegin(), arr.rend());
+
+      // just guess at how many to swap out or kill
+      unsigned numStates = arr.size();
+      unsigned excess = std::max(1U, numStates - numStates * MaxMemory / mbs);
+      size_t excessBytes = (size_t)(mbs - MaxMemory) << 20;
+      bool swapped =
+          swapRoot && swapOutStates(current, excess, excessBytes);
+
+      if (!swapped && mbs > MaxMemory + 100) {
+        size_t freed = 0;
+        unsigned killed = 0;
+        for (unsigned i = 0; i < arr.size() && killed < excess &&
+                             freed < excessBytes;
+             ++i) {
+          freed += arr[i].first.second;
+          ++killed;
+          terminateStateEarly(*arr[i].second, "Memory limit exceeded.");
         }
+        klee_warning("killed %d states freeing %lu KB (over memory cap)",
+                     killed, (unsigned long)(freed >> 10));
       }
       atMemoryLimit = true;
     } else {
@@ -2923,14 +3324,281 @@ void Executor::checkMemoryUsage() {
   }
 }
 
+namespace {
+/// Orders states holding more exclusive memory first, and among those the
+/// least recently selected first.
+struct SwapOrder {
+  bool operator()(const std::pair<size_t, ExecutionState *> &a,
+                  const std::pair<size_t, ExecutionState *> &b) const {
+    if (a.first != b.first)
+      return a.first > b.first;
+    return a.second->lastSelected < b.second->lastSelected;
+  }
+};
+}
+
+unsigned Executor::swapOutStates(ExecutionState &current, unsigned count,
+                                 size_t bytes) {
+  // States still following seeds or a checkpoint would lose them, and a
+  // replay would repeat the external calls of those which made any. Those
+  // swapped in recently are left alone, as they would otherwise thrash.
+  std::vector<std::pair<size_t, ExecutionState *> > candidates;
+  for (std::set<ExecutionState *>::iterator it = states.begin(),
+                                            ie = states.end();
+       it != ie; ++it) {
+    ExecutionState *es = *it;
+    if (es != &current && es->swapOffset < 0 && !es->madeExternalCalls &&
+        stats::instructions >= es->swapHoldUntil &&
+        es->resumeBegin == es->resumeEnd && !seedMap.count(es) &&
+        std::find(removedStates.begin(), removedStates.end(), es) ==
+            removedStates.end())
+      candidates.push_back(std::make_pair(es->getExclusiveBytes(), es));
+  }
+  count = std::min(count, (unsigned)candidates.size());
+  if (!count)
+    return 0;
+  std::partial_sort(candidates.begin(), candidates.begin() + count,
+                    candidates.end(), SwapOrder());
+
+  if (!swapFile) {
+    std::string path = interpreterHandler->getOutputFilename("swap");
+    swapFile = fopen(path.c_str(), "w+b");
+    if (!swapFile) {
+      klee_warning("unable to open swap file: %s", strerror(errno));
+      return 0;
+    }
+    // Only reachable through swapFile from here on.
+    unlink(path.c_str());
+  }
+
+  TimerStatIncrementer timer(stats::swapOutTime);
+  unsigned swapped = 0;
+  size_t freed = 0;
+  for (; swapped < count && freed < bytes; ++swapped) {
+    ExecutionState &es = *candidates[swapped].second;
+    std::vector<unsigned> &decisions = es.branchDecisions;
+    unsigned size = decisions.size();
+    if (fseek(swapFile, 0, SEEK_END) < 0)
+      break;
+    long offset = ftell(swapFile);
+    if (fwrite(&size, sizeof(size), 1, swapFile) != 1 ||
+        (size &&
+         fwrite(&decisions[0], sizeof(unsigned), size, swapFile) != size)) {
+      klee_warning("unable to write swap file: %s", strerror(errno));
+      break;
+    }
+    es.swapOffset = offset;
+    freed += candidates[swapped].first;
+    ++stats::swapOuts;
+    stats::swapOutBytes += sizeof(unsigned) * (size + 1);
+
+    // What is left of the state is a stub kept by the searcher and the
+    // process tree.
+    std::vector<unsigned>().swap(decisions);
+    es.releaseExecution();
+  }
+
+  if (swapped)
+    klee_warning("swapped out %d states freeing %lu KB (over memory cap)",
+                 swapped, (unsigned long)(freed >> 10));
+  return swapped;
+}
+
+void Executor::swapInState(ExecutionState &state, bool halting) {
+  TimerStatIncrementer timer(stats::swapInTime);
+  uint64_t startInstructions = stats::instructions;
+  std::vector<unsigned> decisions;
+  getBranchDecisions(state, decisions);
+  long offset = state.swapOffset;
+  state.swapOffset = -1;
+  ++stats::swapIns;
+  stats::swapInBytes += sizeof(unsigned) * (decisions.size() + 1);
+
+  // What the stub shows the searcher, should it be swapped out again.
+  KInstIterator pc = state.pc, prevPC = state.prevPC;
+  StackFrame top(state.stack.back());
+
+  state.restartExecution(*swapRoot);
+
+  // Follow the recorded decisions from the start. The state takes exactly
+  // one successor at each of them, so no state is added on the way, and
+  // nothing else runs until it has caught up.
+  resumeTrails.push_back(decisions);
+  state.resumeBegin = resumeTrails.size() - 1;
+  state.resumeEnd = resumeTrails.size();
+  swappingIn = &state;
+  bool halted = false;
+  while (state.branchDecisions.size() < decisions.size() &&
+         state.resumeBegin != state.resumeEnd &&
+         std::find(removedStates.begin(), removedStates.end(), &state) ==
+             removedStates.end()) {
+    KInstruction *ki = state.pc;
+    stepInstruction(state);
+    executeInstruction(state, ki);
+    if (!halting) {
+      processTimers(0, 0);
+      if (haltExecution) {
+        halted = true;
+        break;
+      }
+    }
+  }
+  swappingIn = 0;
+
+  // Swapping it straight back out would waste the replay.
+  state.swapHoldUntil =
+      stats::instructions + (stats::instructions - startInstructions);
+
+  // Its decisions are still in the swap file, so it can be replayed later.
+  if (halted && state.resumeBegin != state.resumeEnd &&
+      std::find(removedStates.begin(), removedStates.end(), &state) ==
+          removedStates.end()) {
+    std::vector<unsigned>().swap(state.branchDecisions);
+    state.releaseExecution();
+    state.stack.clear();
+    state.stack.push_back(top);
+    state.pc = pc;
+    state.prevPC = prevPC;
+    state.swapOffset = offset;
+  }
+  state.resumeBegin = state.resumeEnd = 0;
+  resumeTrails.pop_back();
+}
+
+void Executor::getBranchDecisions(const ExecutionState &state,
+                                  std::vector<unsigned> &decisions) {
+  if (&state == swappingIn) {
+    // Where its replay is heading, not how far it has got.
+    decisions = resumeTrails.back();
+    return;
+  }
+  if (state.swapOffset < 0) {
+    decisions = state.branchDecisions;
+    return;
+  }
+
+  unsigned size;
+  if (fseek(swapFile, state.swapOffset, SEEK_SET) < 0 ||
+      fread(&size, sizeof(size), 1, swapFile) != 1)
+    klee_error("unable to read swap file: %s", strerror(errno));
+  decisions.resize(size);
+  if (size && fread(&decisions[0], sizeof(unsigned), size, swapFile) != size)
+    klee_error("unable to read swap file: %s", strerror(errno));
+}
+
+/// Identifies the module a checkpoint was written for.
+static unsigned getCheckpointSignature(const KModule *kmodule) {
+  unsigned instructions = 0;
+  for (std::vector<KFunction *>::const_iterator it = kmodule->functions.begin(),
+                                                ie = kmodule->functions.end();
+       it != ie; ++it)
+    instructions += (*it)->numInstructions;
+  return instructions;
+}
+
+void Executor::writeCheckpoint() {
+  std::set<ExecutionState *> live(states);
+  live.insert(addedStates.begin(), addedStates.end());
+  for (std::vector<ExecutionState *>::iterator it = removedStates.begin(),
+                                               ie = removedStates.end();
+       it != ie; ++it)
+    live.erase(*it);
+
+  // Written aside and renamed, so that an interrupted write leaves the
+  // previous checkpoint intact.
+  llvm::raw_ostream *os = interpreterHandler->openOutputFile("checkpoint.tmp");
+  if (!os)
+    return;
+  *os << "klee-checkpoint " << getCheckpointSignature(kmodule) << "\n";
+  std::vector<unsigned> decisions;
+  for (std::set<ExecutionState *>::iterator it = live.begin(), ie = live.end();
+       it != ie; ++it) {
+    getBranchDecisions(**it, decisions);
+    *os << "state";
+    for (std::vector<unsigned>::const_iterator dit = decisions.begin(),
+                                               die = decisions.end();
+         dit != die; ++dit)
+      *os << " " << *dit;
+    *os << "\n";
+  }
+  delete os;
+
+  std::string file = interpreterHandler->getOutputFilename("checkpoint");
+  if (rename(interpreterHandler->getOutputFilename("checkpoint.tmp").c_str(),
+             file.c_str()) < 0) {
+    klee_warning("unable to write checkpoint: %s", strerror(errno));
+    return;
+  }
+  klee_message("wrote checkpoint of %u states to %s", (unsigned)live.size(),
+               file.c_str());
+}
+
+void Executor::setResumeCheckpoint(const std::string &file) {
+  assert(kmodule && "resuming a checkpoint requires a module");
+  std::ifstream is(file.c_str());
+  std::string line, magic;
+  unsigned signature = 0;
+  if (!std::getline(is, line))
+    klee_error("unable to read checkpoint \"%s\"", file.c_str());
+  std::istringstream header(line);
+  header >> magic >> signature;
+  if (magic != "klee-checkpoint")
+    klee_error("\"%s\" is not a checkpoint", file.c_str());
+  if (signature != getCheckpointSignature(kmodule))
+    klee_error("checkpoint \"%s\" was written for a different program",
+               file.c_str());
+
+  while (std::getline(is, line)) {
+    std::istringstream ls(line);
+    std::string tag;
+    if (!(ls >> tag))
+      continue;
+    if (tag != "state")
+      klee_error("malformed checkpoint \"%s\"", file.c_str());
+    std::vector<unsigned> decisions;
+    unsigned decision;
+    while (ls >> decision)
+      decisions.push_back(decision);
+    resumeTrails.push_back(decisions);
+  }
+  if (resumeTrails.empty())
+    klee_error("checkpoint \"%s\" has no states", file.c_str());
+
+  std::sort(resumeTrails.begin(), resumeTrails.end());
+  resumeTrails.erase(std::unique(resumeTrails.begin(), resumeTrails.end()),
+                     resumeTrails.end());
+  recordBranchDecisions = true;
+  klee_message("resuming %u states from \"%s\"",
+               (unsigned)resumeTrails.size(), file.c_str());
+}
+
 void Executor::doDumpStates() {
+  // Keep the states not yet explored for a later run to resume, or drop
+  // the last checkpoint once there are none.
+  if (checkpointInterval >= 0) {
+    if (!states.empty())
+      writeCheckpoint();
+    else
+      unlink(interpreterHandler->getOutputFilename("checkpoint").c_str());
+  }
+
   if (!DumpStatesOnHalt || states.empty())
     return;
   klee_message("halting execution, dumping remaining states");
-  for (std::set<ExecutionState *>::iterator it = states.begin(),
-                                            ie = states.end();
-       it != ie; ++it) {
-    ExecutionState &state = **it;
+  std::vector<ExecutionState *> dumped(states.begin(), states.end());
+  for (unsigned i = 0; i < dumped.size(); ++i) {
+    ExecutionState &state = *dumped[i];
+    // A swapped out state is replayed for its test case. One whose replay
+    // diverged is explored as usual from there, and may have forked.
+    if (state.swapOffset >= 0) {
+      swapInState(state, true);
+      dumped.insert(dumped.end(), addedStates.begin(), addedStates.end());
+      bool removed = std::find(removedStates.begin(), removedStates.end(),
+                               &state) != removedStates.end();
+      updateStates(0);
+      if (removed)
+        continue;
+    }
     stepInstruction(state); // keep stats rolling
     terminateStateEarly(state, "Execution halting.");
   }
@@ -3023,6 +3691,13 @@ void Executor::run(ExecutionState &initialState) {
 
   while (!states.empty() && !haltExecution) {
     ExecutionState &state = searcher->selectState();
+    state.lastSelected = stats::instructions;
+
+    if (state.swapOffset >= 0) {
+      swapInState(state);
+      updateStates(&state);
+      continue;
+    }
 
 #ifdef ENABLE_Z3
     if (INTERPOLATION_ENABLED) {
@@ -3074,7 +3749,7 @@ void Executor::run(ExecutionState &initialState) {
         }
         processTimers(&state, MaxInstructionTime);
 
-        checkMemoryUsage();
+        checkMemoryUsage(state);
       }
     updateStates(&state);
   }
@@ -3142,7 +3817,10 @@ void Executor::terminateState(ExecutionState &state) {
   }
 
   interpreterHandler->incPathsExplored();
+  removeState(state);
+}
 
+void Executor::removeState(ExecutionState &state) {
   std::vector<ExecutionState *>::iterator it =
       std::find(addedStates.begin(), addedStates.end(), &state);
   if (it==addedStates.end()) {
@@ -3164,6 +3842,11 @@ void Executor::terminateState(ExecutionState &state) {
   }
 }
 
+void Executor::terminateStateOnFrontier(ExecutionState &state) {
+  interpreterHandler->processFrontierState(state);
+  removeState(state);
+}
+
 void Executor::terminateStateOnSubsumption(ExecutionState &state) {
   assert(INTERPOLATION_ENABLED);
 
@@ -3359,6 +4042,8 @@ void Executor::callExternalFunction(ExecutionState &state,
     return;
   }
 
+  state.madeExternalCalls = true;
+
   // normal external function handling path
   // allocate 128 bits for each argument (+return value) to support fp80's;
   // we could iterate through all the arguments first and determine the exact
@@ -3366,6 +4051,8 @@ void Executor::callExternalFunction(ExecutionState &state,
   uint64_t *args = (uint64_t*) alloca(2*sizeof(*args) * (arguments.size() + 1));
   memset(args, 0, 2 * sizeof(*args) * (arguments.size() + 1));
   unsigned wordIndex = 2;
+  // The argument values which may point into memory the call can reach.
+  std::vector<uint64_t> roots;
   for (std::vector<ref<Expr> >::iterator ai = arguments.begin(), 
        ae = arguments.end(); ai!=ae; ++ai) {
     if (AllowExternalSymCalls) { // don't bother checking uniqueness
@@ -3375,12 +4062,16 @@ void Executor::callExternalFunction(ExecutionState &state,
       (void) success;
       ce->toMemory(&args[wordIndex]);
       wordIndex += (ce->getWidth()+63)/64;
+      if (ce->getWidth() <= 64)
+        roots.push_back(ce->getZExtValue());
     } else {
       ref<Expr> arg = toUnique(state, *ai);
       if (ConstantExpr *ce = dyn_cast<ConstantExpr>(arg)) {
         // XXX kick toMemory functions from here
         ce->toMemory(&args[wordIndex]);
         wordIndex += (ce->getWidth()+63)/64;
+        if (ce->getWidth() <= 64)
+          roots.push_back(ce->getZExtValue());
       } else {
         terminateStateOnExecError(state, 
                                   "external call with symbolic argument: " + 
@@ -3390,7 +4081,11 @@ void Executor::callExternalFunction(ExecutionState &state,
     }
   }
 
-  state.addressSpace.copyOutConcretes();
+  std::vector<ObjectPair> reachable;
+  if (ExternalCallsReachableOnly)
+    state.addressSpace.copyOutReachableConcretes(roots, reachable);
+  else
+    state.addressSpace.copyOutConcretes();
 
   if (!SuppressExternalWarnings) {
 
@@ -3412,12 +4107,19 @@ void Executor::callExternalFunction(ExecutionState &state,
 
   bool success = externalDispatcher->executeCall(function, target->inst, args);
   if (!success) {
+    // The call may have written to the memory copied out before failing.
+    if (ExternalCallsReachableOnly)
+      AddressSpace::forgetConcretes(reachable);
+    else
+      state.addressSpace.forgetConcretes();
     terminateStateOnError(state, "failed external call: " + function->getName(),
                           External);
     return;
   }
 
-  if (!state.addressSpace.copyInConcretes()) {
+  if (ExternalCallsReachableOnly
+          ? !state.addressSpace.copyInConcretes(reachable)
+          : !state.addressSpace.copyInConcretes()) {
     terminateStateOnError(state, "external modified read-only object",
                           External);
     return;
@@ -3761,6 +4463,17 @@ void Executor::executeMemoryOperation(ExecutionState &state, bool isWrite,
   // XXX there is some query wasteage here. who cares?
   ExecutionState *unbound = &state;
 
+  bool merge = !incomplete && rl.size() > 1 && rl.size() <= MergeResolutions;
+  // A write can only be made conditional if every candidate is writable.
+  for (ResolutionList::iterator i = rl.begin(), ie = rl.end();
+       merge && isWrite && i != ie; ++i)
+    merge = !i->second->readOnly;
+  if (merge) {
+    unbound = executeMergedMemoryOperation(state, isWrite, address, value,
+                                           target, rl);
+    rl.clear();
+  }
+
   for (ResolutionList::iterator i = rl.begin(), ie = rl.end(); i != ie; ++i) {
     const MemoryObject *mo = i->first;
     const ObjectState *os = i->second;
@@ -3818,6 +4531,63 @@ void Executor::executeMemoryOperation(ExecutionState &state, bool isWrite,
   }
 }
 
+ExecutionState *
+Executor::executeMergedMemoryOperation(ExecutionState &state, bool isWrite,
+                                       ref<Expr> address, ref<Expr> value,
+                                       KInstruction *target,
+                                       const ResolutionList &rl) {
+  Expr::Width type = (isWrite ? value->getWidth() :
+                     getWidthForLLVMType(target->inst->getType()));
+  unsigned bytes = Expr::getMinBytesForWidth(type);
+
+  std::vector<ref<Expr> > inBounds;
+  ref<Expr> anyInBounds = ConstantExpr::alloc(0, Expr::Bool);
+  for (ResolutionList::const_iterator i = rl.begin(), ie = rl.end(); i != ie;
+       ++i) {
+    inBounds.push_back(i->first->getBoundsCheckPointer(address, bytes));
+    anyInBounds = OrExpr::create(anyInBounds, inBounds.back());
+  }
+
+  StatePair branches = fork(state, anyInBounds, true);
+  ExecutionState *bound = branches.first;
+  if (!bound)
+    return branches.second;
+
+  if (isWrite) {
+    // Each candidate keeps its old contents unless the address is in it.
+    for (unsigned i = 0; i < rl.size(); ++i) {
+      const MemoryObject *mo = rl[i].first;
+      ref<Expr> offset = mo->getOffsetExpr(address);
+      ObjectState *wos = bound->addressSpace.getWriteable(mo, rl[i].second);
+      ref<Expr> old = wos->read(offset, type);
+      wos->write(offset, SelectExpr::create(inBounds[i], value, old));
+    }
+
+    // Update dependency
+    if (INTERPOLATION_ENABLED && target)
+      TxTree::executeMemoryOperationOnNode(bound->txTreeNode, target->inst,
+                                           value, address, false);
+  } else {
+    // The address is in one of the candidates, so the last needs no test.
+    unsigned last = rl.size() - 1;
+    ref<Expr> result =
+        rl[last].second->read(rl[last].first->getOffsetExpr(address), type);
+    for (unsigned i = last; i-- > 0;)
+      result = SelectExpr::create(
+          inBounds[i],
+          rl[i].second->read(rl[i].first->getOffsetExpr(address), type),
+          result);
+    bindLocal(target, *bound, result);
+
+    // Update dependency
+    if (INTERPOLATION_ENABLED && target)
+      TxTree::executeMemoryOperationOnNode(bound->txTreeNode, target->inst,
+                                           result, address, false);
+  }
+
+  return branches.second;
+}
+
 void Executor::executeMakeSymbolic(ExecutionState &state, 
                                    const MemoryObject *mo,
                                    const std::string &name) {
@@ -3952,6 +4722,7 @@ void Executor::runFunctionAsMain(Function *f,
   }
 
   ExecutionState *state = new ExecutionState(kmodule->functionMap[f]);
+  state->resumeEnd = resumeTrails.size();
   
   if (pathWriter) 
     state->pathOS = pathWriter->open();
@@ -4001,7 +4772,39 @@ void Executor::runFunctionAsMain(Function *f,
     TxTreeGraph::initialize(txTree->root);
   }
 
+  // A merged state cannot be replayed along a single path.
+  if (userSearcherAutoMergeRegion() &&
+      (checkpointInterval >= 0 || !resumeTrails.empty()))
+    klee_error("--auto-merge cannot be used with --checkpoint-interval, "
+               "--checkpoint-on-signal or --resume-checkpoint");
+
+  if (SwapStates) {
+    if (INTERPOLATION_ENABLED) {
+      klee_warning("--swap-states is not supported with interpolation, "
+                   "terminating states at the memory cap instead");
+    } else if (userSearcherAutoMergeRegion()) {
+      klee_warning("--swap-states is not supported with --auto-merge, "
+                   "terminating states at the memory cap instead");
+    } else {
+      // Copied before anything runs, for swapped out states to replay from.
+      swapRoot = new ExecutionState(*state);
+      recordBranchDecisions = true;
+    }
+  }
+
   run(*state);
+
+  // Test cases still being written count towards the final statistics, and
+  // refer to the arrays of this run.
+  interpreterHandler->waitForTestCases();
+
+  delete swapRoot;
+  swapRoot = 0;
+  if (swapFile) {
+    fclose(swapFile);
+    swapFile = 0;
+  }
+
   delete processTree;
   processTree = 0;
 
@@ -4131,6 +4934,160 @@ bool Executor::getSymbolicSolution(const ExecutionState &state,
   return true;
 }
 
+namespace {
+  /// ExecutorTestCaseSnapshot - Cloned constraints and symbolic objects of a
+  /// state, solved with a private solver so that it can be used while the
+  /// executor keeps running.
+  class ExecutorTestCaseSnapshot : public TestCaseSnapshot {
+    struct Symbolic {
+      std::string name;
+      const Array *array;
+      std::vector< ref<Expr> > cexPreferences;
+    };
+
+    ArrayCache arrayCache;
+    std::vector< ref<Expr> > constraints;
+    std::vector<Symbolic> symbolics;
+    double timeout;
+    Solver *solver;
+
+    Solver *getSolver() {
+      if (!solver) {
+        // The same chain as the executor's, except that it does not log
+        // into the executor's query logs, and already runs off the
+        // executor's thread.
+        SolverChainOptions options;
+        options.independentThreads = 0;
+        options.logQueries = false;
+        Solver *coreSolver = createCoreSolver(options.coreSolver);
+        if (!coreSolver)
+          klee_error("Failed to create core solver for test case snapshot");
+        solver = constructSolverChain(coreSolver, "", "", "", "", "", "",
+                                      options);
+        solver->setCoreSolverTimeout(timeout);
+      }
+      return solver;
+    }
+
+  public:
+    ExecutorTestCaseSnapshot(const ExecutionState &state, double _timeout)
+        : timeout(_timeout), solver(0) {
+      ExprCloner cloner(arrayCache);
+      for (ConstraintManager::const_iterator it = state.constraints.begin(),
+                                             ie = state.constraints.end();
+           it != ie; ++it)
+        constraints.push_back(cloner.clone(*it));
+      symbolics.resize(state.symbolics.size());
+      for (unsigned i = 0; i != state.symbolics.size(); ++i) {
+        const MemoryObject *mo = state.symbolics[i].first;
+        symbolics[i].name = mo->name;
+        symbolics[i].array = cloner.clone(state.symbolics[i].second);
+        for (std::vector< ref<Expr> >::const_iterator
+                 pi = mo->cexPreferences.begin(),
+                 pie = mo->cexPreferences.end();
+             pi != pie; ++pi)
+          symbolics[i].cexPreferences.push_back(cloner.clone(*pi));
+      }
+    }
+
+    ~ExecutorTestCaseSnapshot() { delete solver; }
+
+    void getConstraintLog(std::string &res, Interpreter::LogType logFormat);
+
+    bool getSymbolicSolution(std::vector<
+                             std::pair<std::string,
+                             std::vector<unsigned char> > > &res);
+  };
+}
+
+void ExecutorTestCaseSnapshot::getConstraintLog(std::string &res,
+                                                Interpreter::LogType logFormat) {
+  ConstraintManager cm(constraints);
+
+  switch (logFormat) {
+  case Interpreter::STP: {
+    Query query(cm, klee::ConstantExpr::alloc(0, Expr::Bool));
+    char *log = getSolver()->getConstraintLog(query);
+    res = std::string(log);
+    free(log);
+  } break;
+
+  case Interpreter::KQUERY: {
+    std::string Str;
+    llvm::raw_string_ostream info(Str);
+    ExprPPrinter::printConstraints(info, cm);
+    res = info.str();
+  } break;
+
+  case Interpreter::SMTLIB2: {
+    std::string Str;
+    llvm::raw_string_ostream info(Str);
+    ExprSMTLIBPrinter printer;
+    printer.setOutput(info);
+    Query query(cm, klee::ConstantExpr::alloc(0, Expr::Bool));
+    printer.setQuery(query);
+    printer.generateOutput();
+    res = info.str();
+  } break;
+
+  default:
+    klee_warning("TestCaseSnapshot::getConstraintLog() : Log format not "
+                 "supported!");
+  }
+}
+
+bool ExecutorTestCaseSnapshot::getSymbolicSolution(
+    std::vector<std::pair<std::string, std::vector<unsigned char> > > &res) {
+  Solver *solver = getSolver();
+  ConstraintManager tmp(constraints);
+
+  // See Executor::getSymbolicSolution, which this mirrors.
+  for (unsigned i = 0; i != symbolics.size(); ++i) {
+    std::vector< ref<Expr> >::const_iterator pi =
+      symbolics[i].cexPreferences.begin(),
+      pie = symbolics[i].cexPreferences.end();
+    for (; pi != pie; ++pi) {
+      ref<Expr> expr = Expr::createIsZero(*pi);
+      bool mustBeTrue;
+      if (klee::ConstantExpr *CE = dyn_cast<klee::ConstantExpr>(expr)) {
+        mustBeTrue = CE->isTrue();
+      } else {
+        if (EqualitySubstitution)
+          expr = tmp.simplifyExpr(expr);
+        if (!solver->mustBeTrue(Query(tmp, expr), mustBeTrue))
+          break;
+      }
+      if (!mustBeTrue) tmp.addConstraint(*pi);
+    }
+    if (pi!=pie) break;
+  }
+
+  std::vector< std::vector<unsigned char> > values;
+  std::vector<const Array*> objects;
+  for (unsigned i = 0; i != symbolics.size(); ++i)
+    objects.push_back(symbolics[i].array);
+  if (!solver->getInitialValues(Query(tmp, klee::ConstantExpr::alloc(0, Expr::Bool)),
+                                objects, values)) {
+    klee_warning("unable to compute initial values (invalid constraints?)!");
+    return false;
+  }
+
+  for (unsigned i = 0; i != symbolics.size(); ++i)
+    res.push_back(std::make_pair(symbolics[i].name, values[i]));
+  return true;
+}
+
+TestCaseSnapshot *
+Executor::createTestCaseSnapshot(const ExecutionState &state) {
+  // The snapshot gets its own solver chain, core solvers included; only Z3
+  // keeps no global state. Otherwise the test case is written in place.
+  if (CoreSolverToUse != Z3_SOLVER ||
+      (DebugCrossCheckCoreSolverWith != NO_SOLVER &&
+       DebugCrossCheckCoreSolverWith != Z3_SOLVER))
+    return 0;
+  return new ExecutorTestCaseSnapshot(state, coreSolverTimeout);
+}
+
 void Executor::getCoveredLines(const ExecutionState &state,
                                std::map<const std::string*, std::set<unsigned> > &res) {
   res = state.coveredLines;
@@ -21,10 +21,12 @@
 #include "klee/Internal/Module/KInstruction.h"
 #include "klee/Internal/Module/KModule.h"
 #include "klee/util/ArrayCache.h"
+#include "klee/util/ExprHashMap.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include "llvm/ADT/Twine.h"
 
+#include <cstdio>
 #include <vector>
 #include <string>
 #include <map>
@@ -52,7 +54,8 @@ namespace llvm {
 
 namespace klee {  
   class Array;
-  struct Cell;
+  class BatchEvaluator;
+  class Cell;
   class ExecutionState;
   class ExternalDispatcher;
   class Expr;
@@ -83,6 +86,7 @@ namespace klee {
   /// removedStates, and haltExecution, among others.
 
 class Executor : public Interpreter {
+  friend class AutoMergingSearcher;
   friend class BumpMergingSearcher;
   friend class MergingSearcher;
   friend class RandomPathSearcher;
@@ -158,6 +162,11 @@ private:
   /// happens with other states (that don't satisfy the seeds) depends
   /// on as-yet-to-be-determined flags.
   std::map<ExecutionState*, std::vector<SeedInfo> > seedMap;
+
+  /// The compiled evaluators of expressions checked against the seeds, or
+  /// null for those which cannot be compiled. The same branch conditions
+  /// are met again and again in seed mode.
+  ExprHashMap<BatchEvaluator *> seedEvaluators;
   
   /// Map of globals to their representative memory object.
   std::map<const llvm::GlobalValue*, MemoryObject*> globalObjects;
@@ -178,6 +187,8 @@ private:
   /// The index into the current \ref replayKTest or \ref replayPath
   /// object.
   unsigned replayPosition;
+  /// Whether \ref replayPath only fixes the first branch decisions.
+  bool replayPathIsPrefix;
 
   /// When non-null a list of "seed" inputs which will be used to
   /// drive execution.
@@ -190,6 +201,36 @@ private:
   /// Disables forking, set by client. \see setInhibitForking()
   bool inhibitForking;
 
+  /// The depth at which states are handed back to the client instead of
+  /// being explored, or 0. \see setFrontierDepth()
+  unsigned frontierDepth;
+
+  /// Whether states record their branch decisions, for writing or
+  /// resuming checkpoints. \see ExecutionState::branchDecisions
+  bool recordBranchDecisions;
+
+  /// The interval in seconds at which checkpoints are written, 0 for
+  /// never, or negative when checkpointing is disabled.
+  double checkpointInterval;
+
+  /// Set, possibly from a signal handler, to write a checkpoint at the
+  /// next timer check. \see requestCheckpoint()
+  volatile bool checkpointRequested;
+
+  /// The branch decisions of the checkpointed states being resumed, in
+  /// lexicographic order. \see ExecutionState::resumeBegin
+  std::vector<std::vector<unsigned> > resumeTrails;
+
+  /// A copy of the initial state from which swapped out states are
+  /// replayed, or null when states are not swapped. \see swapInState()
+  ExecutionState *swapRoot;
+
+  /// The state being replayed by swapInState, or null.
+  ExecutionState *swappingIn;
+
+  /// Holds the branch decisions of swapped out states.
+  FILE *swapFile;
+
   /// Signals the executor to halt execution at the next instruction
   /// step.
   bool haltExecution;  
@@ -219,6 +260,18 @@ private:
   
   void executeInstruction(ExecutionState &state, KInstruction *ki);
 
+  /// Execute an integer arithmetic, comparison or cast instruction whose
+  /// operands are all inline constants directly on the register cells.
+  /// Expressions are only built for the dependency tracking of
+  /// interpolation. Returns false, doing nothing, if the instruction must
+  /// go through executeInstruction instead.
+  bool executeImmediate(ExecutionState &state, KInstruction *ki);
+
+  /// Evaluate \a e under the assignment of each seed, giving the same
+  /// results as Assignment::evaluate.
+  void evaluateSeeds(std::vector<SeedInfo> &seeds, ref<Expr> e,
+                     std::vector<ref<Expr> > &results);
+
   void printFileLine(ExecutionState &state, KInstruction *ki,
                      llvm::raw_ostream &file);
 
@@ -307,6 +360,17 @@ private:
                               ref<Expr> value /* undef if read */,
                               KInstruction *target /* undef if write */);
 
+  /// Perform a memory operation at an address which may point into any
+  /// of the objects in \a rl in a single state: reads select among the
+  /// candidates and writes update each candidate conditionally. Returns
+  /// the state in which the address points into none of them, if any.
+  ExecutionState *executeMergedMemoryOperation(ExecutionState &state,
+                                               bool isWrite,
+                                               ref<Expr> address,
+                                               ref<Expr> value,
+                                               KInstruction *target,
+                                               const ResolutionList &rl);
+
   void executeMakeSymbolic(ExecutionState &state, const MemoryObject *mo,
                            const std::string &name);
 
@@ -318,6 +382,26 @@ private:
               const std::vector< ref<Expr> > &conditions,
               std::vector<ExecutionState*> &result);
 
+  /// The states created by branch, before the successors they take are
+  /// written to their paths and those at the swarm frontier are handed off.
+  void branchStates(ExecutionState &state,
+                    const std::vector< ref<Expr> > &conditions,
+                    std::vector<ExecutionState*> &result);
+
+  /// Whether the state is still following the decisions of checkpointed
+  /// states; once it has caught up with one it is explored as usual.
+  bool isResuming(ExecutionState &state);
+
+  /// The first of the state's resume trails whose next decision takes
+  /// \a successor or a later one.
+  unsigned getResumeSplit(const ExecutionState &state, unsigned successor);
+
+  /// Like branch, but only the successors taken by the checkpointed states
+  /// the state is resuming are created.
+  void resumeBranch(ExecutionState &state,
+                    const std::vector< ref<Expr> > &conditions,
+                    std::vector<ExecutionState*> &result);
+
   // Fork current and return states in which condition holds / does
   // not hold, respectively. One of the states is necessarily the
   // current state, and one of the states may be null.
@@ -387,6 +471,10 @@ private:
 
   // remove state from queue and delete
   void terminateState(ExecutionState &state);
+  // remove state from queue and delete, without counting a path
+  void removeState(ExecutionState &state);
+  // call frontier handler and remove state
+  void terminateStateOnFrontier(ExecutionState &state);
   // call subsumption handler and terminate state
   void terminateStateOnSubsumption(ExecutionState &state);
   // call exit handler and terminate state
@@ -435,7 +523,23 @@ private:
   void initTimers();
   void processTimers(ExecutionState *current,
                      double maxInstTime);
-  void checkMemoryUsage();
+  void checkMemoryUsage(ExecutionState &current);
+  /// Swap out up to count states other than current, those holding the
+  /// most exclusive memory first, stopping once they held at least bytes.
+  /// States swapped in recently are held back. Returns how many were
+  /// swapped out.
+  unsigned swapOutStates(ExecutionState &current, unsigned count,
+                         size_t bytes);
+  /// Rebuild a swapped out state by replaying its branch decisions from
+  /// \ref swapRoot. Timers run during the replay, and if they halt execution
+  /// the state is swapped out again, unless \a halting, when the state is
+  /// wanted for its test case.
+  void swapInState(ExecutionState &state, bool halting = false);
+  /// The branch decisions of a state, read back if it is swapped out.
+  void getBranchDecisions(const ExecutionState &state,
+                          std::vector<unsigned> &decisions);
+  /// Write the branch decisions of all live states to "checkpoint".
+  void writeCheckpoint();
   void printDebugInstructions(ExecutionState &state);
   void doDumpStates();
 
@@ -467,6 +571,12 @@ public:
     assert(!replayKTest && "cannot replay both buffer and path");
     replayPath = path;
     replayPosition = 0;
+    replayPathIsPrefix = false;
+  }
+
+  virtual void setReplayPathPrefix(const std::vector<bool> *path) {
+    setReplayPath(path);
+    replayPathIsPrefix = true;
   }
 
   virtual const llvm::Module *
@@ -491,6 +601,21 @@ public:
     inhibitForking = value;
   }
 
+  virtual void setFrontierDepth(unsigned depth) {
+    frontierDepth = depth;
+  }
+
+  virtual void setCheckpointing(double interval) {
+    recordBranchDecisions = true;
+    checkpointInterval = interval;
+  }
+
+  virtual void requestCheckpoint() {
+    checkpointRequested = true;
+  }
+
+  virtual void setResumeCheckpoint(const std::string &file);
+
   /*** State accessor methods ***/
 
   virtual unsigned getPathStreamID(const ExecutionState &state);
@@ -510,6 +635,9 @@ public:
   virtual void getCoveredLines(const ExecutionState &state,
                                std::map<const std::string*, std::set<unsigned> > &res);
 
+  virtual TestCaseSnapshot *
+  createTestCaseSnapshot(const ExecutionState &state);
+
   Expr::Width getWidthForLLVMType(LLVM_TYPE_Q llvm::Type *type) const;
 };
   
@@ -59,6 +59,18 @@ public:
 
 ///
 
+class CheckpointTimer : public Executor::Timer {
+  Executor *executor;
+
+public:
+  CheckpointTimer(Executor *_executor) : executor(_executor) {}
+  ~CheckpointTimer() {}
+
+  void run() { executor->requestCheckpoint(); }
+};
+
+///
+
 static const double kSecondsPerTick = .1;
 static volatile unsigned timerTicks = 0;
 
@@ -95,6 +107,10 @@ void Executor::initTimers() {
   if (MaxTime) {
     addTimer(new HaltTimer(this), MaxTime.getValue());
   }
+
+  if (checkpointInterval > 0) {
+    addTimer(new CheckpointTimer(this), checkpointInterval);
+  }
 }
 
 ///
@@ -117,7 +133,7 @@ void Executor::processTimers(ExecutionState *current,
     ticks = 1;
   }
 
-  if (ticks || dumpPTree || dumpStates) {
+  if (ticks || dumpPTree || dumpStates || checkpointRequested) {
     if (dumpPTree) {
       char name[32];
       sprintf(name, "ptree%08d.dot", (int) stats::instructions);
@@ -137,6 +153,8 @@ void Executor::processTimers(ExecutionState *current,
         for (std::set<ExecutionState*>::const_iterator it = states.begin(), 
                ie = states.end(); it != ie; ++it) {
           ExecutionState *es = *it;
+          if (es->swapOffset >= 0)
+            continue; // swapped out, nothing to show
           *os << "(" << es << ",";
           *os << "[";
           ExecutionState::stack_ty::iterator next = es->stack.begin();
@@ -179,6 +197,11 @@ void Executor::processTimers(ExecutionState *current,
       dumpStates = 0;
     }
 
+    if (checkpointRequested) {
+      checkpointRequested = false;
+      writeCheckpoint();
+    }
+
     if (maxInstTime > 0 && current &&
         std::find(removedStates.begin(), removedStates.end(), current) ==
             removedStates.end()) {
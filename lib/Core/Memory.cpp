@@ -100,18 +100,101 @@ void MemoryObject::getAllocInfo(std::string &result) const {
 
 /***/
 
+namespace klee {
+/// A piece of the contents of an ObjectState, shared copy-on-write
+/// between the object states copied from one another so that a write
+/// after a fork copies only the pages it touches.
+class ObjectPage {
+public:
+  enum { Bits = 12, Size = 1 << Bits, Mask = Size - 1 };
+
+  unsigned refCount;
+  unsigned size;
+
+  /// Identifies the contents: a page is given a new version whenever it
+  /// may be modified, and copies keep the version of the original.
+  uint64_t version;
+  static uint64_t nextVersion;
+
+  uint8_t *concreteStore;
+  // XXX cleanup name of flushMask (its backwards or something)
+  BitArray *concreteMask;
+  BitArray *flushMask;
+  ref<Expr> *knownSymbolics;
+
+  explicit ObjectPage(unsigned _size)
+    : refCount(1),
+      size(_size),
+      version(++nextVersion),
+      concreteStore(new uint8_t[_size]),
+      concreteMask(0),
+      flushMask(0),
+      knownSymbolics(0) {
+    memset(concreteStore, 0, size);
+  }
+
+  ObjectPage(const ObjectPage &p)
+    : refCount(1),
+      size(p.size),
+      version(p.version),
+      concreteStore(new uint8_t[p.size]),
+      concreteMask(p.concreteMask ? new BitArray(*p.concreteMask, p.size) : 0),
+      flushMask(p.flushMask ? new BitArray(*p.flushMask, p.size) : 0),
+      knownSymbolics(0) {
+    if (p.knownSymbolics) {
+      knownSymbolics = new ref<Expr>[size];
+      for (unsigned i=0; i<size; i++)
+        knownSymbolics[i] = p.knownSymbolics[i];
+    }
+    memcpy(concreteStore, p.concreteStore, size);
+  }
+
+  ~ObjectPage() {
+    delete concreteMask;
+    delete flushMask;
+    delete[] knownSymbolics;
+    delete[] concreteStore;
+  }
+
+  size_t getMemoryUsage() const {
+    size_t bytes = sizeof(*this) + size;
+    // BitArrays are rounded up to whole 32-bit words.
+    size_t maskBytes = ((size + 31) / 32) * sizeof(uint32_t);
+    if (concreteMask)
+      bytes += sizeof(BitArray) + maskBytes;
+    if (flushMask)
+      bytes += sizeof(BitArray) + maskBytes;
+    if (knownSymbolics)
+      bytes += size * sizeof(ref<Expr>);
+    return bytes;
+  }
+
+private:
+  ObjectPage &operator=(const ObjectPage &);
+};
+
+uint64_t ObjectPage::nextVersion = 0;
+}
+
+/// Create the pages for \a size bytes of zeroed, concrete contents.
+static void allocatePages(std::vector<ObjectPage *> &pages, unsigned size) {
+  pages.reserve((size + ObjectPage::Mask) >> ObjectPage::Bits);
+  for (unsigned base = 0; base < size; base += ObjectPage::Size)
+    pages.push_back(new ObjectPage(std::min(size - base,
+                                            (unsigned) ObjectPage::Size)));
+}
+
 ObjectState::ObjectState(const MemoryObject *mo)
   : copyOnWriteOwner(0),
     refCount(0),
     object(mo),
-    concreteStore(new uint8_t[mo->size]),
-    concreteMask(0),
-    flushMask(0),
-    knownSymbolics(0),
     updates(0, 0),
+    sharedUpdates(0),
+    accountedBytes(0),
     size(mo->size),
     readOnly(false) {
   mo->refCount++;
+  allocatePages(pages, size);
   if (!UseConstantArrays) {
     static unsigned id = 0;
     const std::string arrayName = "tmp_arr" + llvm::utostr(++id);
@@ -127,7 +210,6 @@ ObjectState::ObjectState(const MemoryObject *mo)
       ShadowArray::addShadowArrayMap(array, shadow);
     }
   }
-  memset(concreteStore, 0, size);
 }
 
 
@@ -135,47 +217,39 @@ ObjectState::ObjectState(const MemoryObject *mo, const Array *array)
   : copyOnWriteOwner(0),
     refCount(0),
     object(mo),
-    concreteStore(new uint8_t[mo->size]),
-    concreteMask(0),
-    flushMask(0),
-    knownSymbolics(0),
     updates(array, 0),
+    sharedUpdates(0),
+    accountedBytes(0),
     size(mo->size),
     readOnly(false) {
   mo->refCount++;
+  allocatePages(pages, size);
   makeSymbolic();
-  memset(concreteStore, 0, size);
 }
 
 ObjectState::ObjectState(const ObjectState &os) 
   : copyOnWriteOwner(0),
     refCount(0),
     object(os.object),
-    concreteStore(new uint8_t[os.size]),
-    concreteMask(os.concreteMask ? new BitArray(*os.concreteMask, os.size) : 0),
-    flushMask(os.flushMask ? new BitArray(*os.flushMask, os.size) : 0),
-    knownSymbolics(0),
+    pages(os.pages),
     updates(os.updates),
+    sharedUpdates(os.updates.getSize()),
+    accountedBytes(0),
     size(os.size),
     readOnly(false) {
   assert(!os.readOnly && "no need to copy read only object?");
   if (object)
     object->refCount++;
 
-  if (os.knownSymbolics) {
-    knownSymbolics = new ref<Expr>[size];
-    for (unsigned i=0; i<size; i++)
-      knownSymbolics[i] = os.knownSymbolics[i];
-  }
-
-  memcpy(concreteStore, os.concreteStore, size*sizeof(*concreteStore));
+  // The pages are copied as they are first written.
+  for (unsigned i=0; i<pages.size(); i++)
+    pages[i]->refCount++;
 }
 
 ObjectState::~ObjectState() {
-  if (concreteMask) delete concreteMask;
-  if (flushMask) delete flushMask;
-  if (knownSymbolics) delete[] knownSymbolics;
-  delete[] concreteStore;
+  for (unsigned i=0; i<pages.size(); i++)
+    if (--pages[i]->refCount == 0)
+      delete pages[i];
 
   if (object)
   {
@@ -193,6 +267,18 @@ ArrayCache *ObjectState::getArrayCache() const {
   return object->parent->getArrayCache();
 }
 
+size_t ObjectState::getMemoryUsage() const {
+  size_t bytes = sizeof(*this) + pages.capacity() * sizeof(ObjectPage *);
+  // Shared pages are charged to none of their holders.
+  for (unsigned i=0; i<pages.size(); i++)
+    if (pages[i]->refCount == 1)
+      bytes += pages[i]->getMemoryUsage();
+  unsigned numUpdates = updates.getSize();
+  if (numUpdates > sharedUpdates)
+    bytes += (numUpdates - sharedUpdates) * sizeof(UpdateNode);
+  return bytes;
+}
+
 /***/
 
 const UpdateList &ObjectState::getUpdates() const {
@@ -239,6 +325,7 @@ const UpdateList &ObjectState::getUpdates() const {
         arrayName, arrayWidth, &Contents[0],
         &Contents[0] + Contents.size());
     updates = UpdateList(array, 0);
+    sharedUpdates = 0;
 
     // Apply the remaining (non-constant) writes.
     for (; Begin != End; ++Begin)
@@ -255,13 +342,26 @@ const UpdateList &ObjectState::getUpdates() const {
   return updates;
 }
 
+ObjectPage *ObjectState::getWriteablePage(unsigned offset) const {
+  ObjectPage *&page = pages[offset >> ObjectPage::Bits];
+  if (page->refCount > 1) {
+    --page->refCount;
+    page = new ObjectPage(*page);
+  }
+  page->version = ++ObjectPage::nextVersion;
+  return page;
+}
+
 void ObjectState::makeConcrete() {
-  if (concreteMask) delete concreteMask;
-  if (flushMask) delete flushMask;
-  if (knownSymbolics) delete[] knownSymbolics;
-  concreteMask = 0;
-  flushMask = 0;
-  knownSymbolics = 0;
+  for (unsigned base=0; base<size; base+=ObjectPage::Size) {
+    ObjectPage *page = getWriteablePage(base);
+    delete page->concreteMask;
+    delete page->flushMask;
+    delete[] page->knownSymbolics;
+    page->concreteMask = 0;
+    page->flushMask = 0;
+    page->knownSymbolics = 0;
+  }
 }
 
 void ObjectState::makeSymbolic() {
@@ -278,14 +378,66 @@ void ObjectState::makeSymbolic() {
 
 void ObjectState::initializeToZero() {
   makeConcrete();
-  memset(concreteStore, 0, size);
+  for (unsigned i=0; i<pages.size(); i++)
+    memset(pages[i]->concreteStore, 0, pages[i]->size);
 }
 
 void ObjectState::initializeToRandom() {  
   makeConcrete();
-  for (unsigned i=0; i<size; i++) {
+  for (unsigned i=0; i<pages.size(); i++) {
     // randomly selected by 256 sided die
-    concreteStore[i] = 0xAB;
+    memset(pages[i]->concreteStore, 0xAB, pages[i]->size);
+  }
+}
+
+void ObjectState::copyOutConcretes(uint8_t *address) const {
+  std::vector<uint64_t> &synced = object->syncedVersions;
+  synced.resize(pages.size());
+  for (unsigned i=0; i<pages.size(); i++) {
+    if (synced[i] == pages[i]->version)
+      continue;
+    memcpy(address + (i << ObjectPage::Bits), pages[i]->concreteStore,
+           pages[i]->size);
+    synced[i] = pages[i]->version;
+  }
+}
+
+bool ObjectState::concretesDiffer(const uint8_t *address) const {
+  for (unsigned i=0; i<pages.size(); i++)
+    if (memcmp(address + (i << ObjectPage::Bits), pages[i]->concreteStore,
+               pages[i]->size) != 0)
+      return true;
+  return false;
+}
+
+unsigned ObjectState::countDifferingBytes(const ObjectState &b,
+                                          unsigned limit) const {
+  assert(pages.size() == b.pages.size() && "objects of different sizes");
+  // Flushed bytes are read through the update list, which may differ even
+  // where the page is shared.
+  bool sameUpdates =
+      updates.root == b.updates.root && updates.head == b.updates.head;
+  unsigned count = 0;
+  for (unsigned i=0; i<pages.size() && count <= limit; i++) {
+    if (pages[i] == b.pages[i] && (sameUpdates || !pages[i]->flushMask))
+      continue;
+    unsigned base = i << ObjectPage::Bits;
+    for (unsigned j=0; j<pages[i]->size && count <= limit; j++)
+      if (read8(base + j) != b.read8(base + j))
+        ++count;
+  }
+  return count;
+}
+
+void ObjectState::copyInConcretes(const uint8_t *address) {
+  for (unsigned i=0; i<pages.size(); i++) {
+    const uint8_t *src = address + (i << ObjectPage::Bits);
+    if (memcmp(src, pages[i]->concreteStore, pages[i]->size) != 0) {
+      ObjectPage *page = getWriteablePage(i << ObjectPage::Bits);
+      memcpy(page->concreteStore, src, page->size);
+      if (i < object->syncedVersions.size())
+        object->syncedVersions[i] = page->version;
+    }
   }
 }
 
@@ -306,42 +458,48 @@ void ObjectState::fastRangeCheckOffset(ref<Expr> offset,
 
 void ObjectState::flushRangeForRead(unsigned rangeBase, 
                                     unsigned rangeSize) const {
-  if (!flushMask) flushMask = new BitArray(size, true);
- 
   for (unsigned offset=rangeBase; offset<rangeBase+rangeSize; offset++) {
     if (!isByteFlushed(offset)) {
+      // The flushed bytes must agree with our own update list, so the
+      // page cannot stay shared.
+      ObjectPage *page = getWriteablePage(offset);
+      unsigned index = offset & ObjectPage::Mask;
       if (isByteConcrete(offset)) {
         updates.extend(ConstantExpr::create(offset, Expr::Int32),
-                       ConstantExpr::create(concreteStore[offset], Expr::Int8));
+                       ConstantExpr::create(page->concreteStore[index],
+                                            Expr::Int8));
       } else {
         assert(isByteKnownSymbolic(offset) && "invalid bit set in flushMask");
         updates.extend(ConstantExpr::create(offset, Expr::Int32),
-                       knownSymbolics[offset]);
+                       page->knownSymbolics[index]);
       }
 
-      flushMask->unset(offset);
+      if (!page->flushMask) page->flushMask = new BitArray(page->size, true);
+      page->flushMask->unset(index);
     }
   } 
 }
 
 void ObjectState::flushRangeForWrite(unsigned rangeBase, 
                                      unsigned rangeSize) {
-  if (!flushMask) flushMask = new BitArray(size, true);
-
   for (unsigned offset=rangeBase; offset<rangeBase+rangeSize; offset++) {
     if (!isByteFlushed(offset)) {
+      ObjectPage *page = getWriteablePage(offset);
+      unsigned index = offset & ObjectPage::Mask;
       if (isByteConcrete(offset)) {
         updates.extend(ConstantExpr::create(offset, Expr::Int32),
-                       ConstantExpr::create(concreteStore[offset], Expr::Int8));
+                       ConstantExpr::create(page->concreteStore[index],
+                                            Expr::Int8));
         markByteSymbolic(offset);
       } else {
         assert(isByteKnownSymbolic(offset) && "invalid bit set in flushMask");
         updates.extend(ConstantExpr::create(offset, Expr::Int32),
-                       knownSymbolics[offset]);
+                       page->knownSymbolics[index]);
         setKnownSymbolic(offset, 0);
       }
 
-      flushMask->unset(offset);
+      if (!page->flushMask) page->flushMask = new BitArray(page->size, true);
+      page->flushMask->unset(index);
     } else {
       // flushed bytes that are written over still need
       // to be marked out
@@ -355,49 +513,59 @@ void ObjectState::flushRangeForWrite(unsigned rangeBase,
 }
 
 bool ObjectState::isByteConcrete(unsigned offset) const {
-  return !concreteMask || concreteMask->get(offset);
+  const ObjectPage *page = pages[offset >> ObjectPage::Bits];
+  return !page->concreteMask ||
+         page->concreteMask->get(offset & ObjectPage::Mask);
 }
 
 bool ObjectState::isByteFlushed(unsigned offset) const {
-  return flushMask && !flushMask->get(offset);
+  const ObjectPage *page = pages[offset >> ObjectPage::Bits];
+  return page->flushMask && !page->flushMask->get(offset & ObjectPage::Mask);
 }
 
 bool ObjectState::isByteKnownSymbolic(unsigned offset) const {
-  return knownSymbolics && knownSymbolics[offset].get();
+  const ObjectPage *page = pages[offset >> ObjectPage::Bits];
+  return page->knownSymbolics &&
+         page->knownSymbolics[offset & ObjectPage::Mask].get();
 }
 
 void ObjectState::markByteConcrete(unsigned offset) {
-  if (concreteMask)
-    concreteMask->set(offset);
+  if (pages[offset >> ObjectPage::Bits]->concreteMask)
+    getWriteablePage(offset)->concreteMask->set(offset & ObjectPage::Mask);
 }
 
 void ObjectState::markByteSymbolic(unsigned offset) {
-  if (!concreteMask)
-    concreteMask = new BitArray(size, true);
-  concreteMask->unset(offset);
+  ObjectPage *page = getWriteablePage(offset);
+  if (!page->concreteMask)
+    page->concreteMask = new BitArray(page->size, true);
+  page->concreteMask->unset(offset & ObjectPage::Mask);
 }
 
 void ObjectState::markByteUnflushed(unsigned offset) {
-  if (flushMask)
-    flushMask->set(offset);
+  if (pages[offset >> ObjectPage::Bits]->flushMask)
+    getWriteablePage(offset)->flushMask->set(offset & ObjectPage::Mask);
 }
 
 void ObjectState::markByteFlushed(unsigned offset) {
-  if (!flushMask) {
-    flushMask = new BitArray(size, false);
+  ObjectPage *page = getWriteablePage(offset);
+  if (!page->flushMask) {
+    page->flushMask = new BitArray(page->size, false);
   } else {
-    flushMask->unset(offset);
+    page->flushMask->unset(offset & ObjectPage::Mask);
   }
 }
 
 void ObjectState::setKnownSymbolic(unsigned offset, 
                                    Expr *value /* can be null */) {
-  if (knownSymbolics) {
-    knownSymbolics[offset] = value;
+  ObjectPage *page = pages[offset >> ObjectPage::Bits];
+  if (page->knownSymbolics) {
+    getWriteablePage(offset)->knownSymbolics[offset & ObjectPage::Mask] =
+        value;
   } else {
     if (value) {
-      knownSymbolics = new ref<Expr>[size];
-      knownSymbolics[offset] = value;
+      page = getWriteablePage(offset);
+      page->knownSymbolics = new ref<Expr>[page->size];
+      page->knownSymbolics[offset & ObjectPage::Mask] = value;
     }
   }
 }
@@ -405,10 +573,12 @@ void ObjectState::setKnownSymbolic(unsigned offset,
 /***/
 
 ref<Expr> ObjectState::read8(unsigned offset) const {
+  const ObjectPage *page = pages[offset >> ObjectPage::Bits];
   if (isByteConcrete(offset)) {
-    return ConstantExpr::create(concreteStore[offset], Expr::Int8);
+    return ConstantExpr::create(page->concreteStore[offset & ObjectPage::Mask],
+                                Expr::Int8);
   } else if (isByteKnownSymbolic(offset)) {
-    return knownSymbolics[offset];
+    return page->knownSymbolics[offset & ObjectPage::Mask];
   } else {
     assert(isByteFlushed(offset) && "unflushed byte without cache value");
     
@@ -436,7 +606,7 @@ ref<Expr> ObjectState::read8(ref<Expr> offset) const {
 
 void ObjectState::write8(unsigned offset, uint8_t value) {
   //assert(read_only == false && "writing to read-only object!");
-  concreteStore[offset] = value;
+  getWriteablePage(offset)->concreteStore[offset & ObjectPage::Mask] = value;
   setKnownSymbolic(offset, 0);
 
   markByteConcrete(offset);
@@ -26,6 +26,7 @@ namespace klee {
 
 class BitArray;
 class MemoryManager;
+class ObjectPage;
 class Solver;
 class ArrayCache;
 
@@ -67,6 +68,12 @@ public:
   /// should sensibly be only at creation time).
   mutable std::vector< ref<Expr> > cexPreferences;
 
+  /// The versions of the pages of contents which the real memory at
+  /// address was last synchronized with for an external call, or 0 where
+  /// unknown. Mutable since it describes the real memory rather than the
+  /// object.
+  mutable std::vector<uint64_t> syncedVersions;
+
   // DO NOT IMPLEMENT
   MemoryObject(const MemoryObject &b);
   MemoryObject &operator=(const MemoryObject &b);
@@ -156,18 +163,23 @@ private:
 
   const MemoryObject *object;
 
-  uint8_t *concreteStore;
-  // XXX cleanup name of flushMask (its backwards or something)
-  BitArray *concreteMask;
-
-  // mutable because may need flushed during read of const
-  mutable BitArray *flushMask;
-
-  ref<Expr> *knownSymbolics;
+  // The contents, split into pages of ObjectPage::Size bytes which are
+  // shared copy-on-write with the object states copied from this one.
+  // mutable because pages may need to be unshared to flush them during a
+  // read of const.
+  mutable std::vector<ObjectPage *> pages;
 
   // mutable because we may need flush during read of const
   mutable UpdateList updates;
 
+  // Length of the update list inherited from the object this one was
+  // copied from; those nodes are shared with it.
+  mutable unsigned sharedUpdates;
+
+  // The usage last charged to the owning address space (exclusively for
+  // AddressSpace).
+  size_t accountedBytes;
+
 public:
   unsigned size;
 
@@ -190,6 +202,11 @@ public:
 
   void setReadOnly(bool ro) { readOnly = ro; }
 
+  /// Approximate number of heap bytes held by this object state alone:
+  /// its stores and masks plus the update nodes it does not share with
+  /// the object it was copied from.
+  size_t getMemoryUsage() const;
+
   // make contents all concrete and zero
   void initializeToZero();
   // make contents all concrete and random
@@ -208,6 +225,25 @@ public:
   void write32(unsigned offset, uint32_t value);
   void write64(unsigned offset, uint64_t value);
 
+  /// Copy the concrete cache of the contents to \a address, the real
+  /// memory of the object, which must hold size bytes. Pages which the
+  /// real memory already holds are skipped.
+  void copyOutConcretes(uint8_t *address) const;
+
+  /// Test whether the concrete cache of the contents differs from the
+  /// size bytes at \a address.
+  bool concretesDiffer(const uint8_t *address) const;
+
+  /// Count the bytes which differ from those of \a b at the same offsets,
+  /// stopping once more than \a limit do. Pages both share are skipped
+  /// without reading them.
+  unsigned countDifferingBytes(const ObjectState &b, unsigned limit) const;
+
+  /// Copy the size bytes at \a address, the real memory of the object,
+  /// into the concrete cache of the contents, unsharing only the pages
+  /// which differ.
+  void copyInConcretes(const uint8_t *address);
+
 private:
   const UpdateList &getUpdates() const;
 
@@ -219,6 +255,9 @@ private:
   void write8(unsigned offset, ref<Expr> value);
   void write8(ref<Expr> offset, ref<Expr> value);
 
+  /// The page holding the byte at \a offset, unshared first if needed.
+  ObjectPage *getWriteablePage(unsigned offset) const;
+
   void fastRangeCheckOffset(ref<Expr> offset, unsigned *base_r, 
                             unsigned *size_r) const;
   void flushRangeForRead(unsigned rangeBase, unsigned rangeSize) const;
@@ -176,6 +176,7 @@ WeightedRandomSearcher::WeightedRandomSearcher(WeightType _type)
   case QueryCost:
   case MinDistToUncovered:
   case CoveringNew:
+  case ExclusiveMemory:
     updateWeights = true;
     break;
   default:
@@ -210,6 +211,11 @@ double WeightedRandomSearcher::getWeight(ExecutionState *es) {
   }
   case QueryCost:
     return (es->queryCost < .1) ? 1. : 1./es->queryCost;
+  case ExclusiveMemory: {
+    // Favour states which hold little memory of their own.
+    uint64_t kbs = es->getExclusiveBytes() >> 10;
+    return 1. / std::max((uint64_t) 1, kbs);
+  }
   case CoveringNew:
   case MinDistToUncovered: {
     uint64_t md2u = computeMinDistToUncovered(es->pc,
@@ -506,6 +512,116 @@ MergingSearcher::update(ExecutionState *current,
 
 ///
 
+AutoMergingSearcher::AutoMergingSearcher(Executor &_executor,
+                                         Searcher *_baseSearcher,
+                                         unsigned _holdInstructions,
+                                         unsigned _maxSelects)
+  : executor(_executor),
+    baseSearcher(_baseSearcher),
+    holdInstructions(_holdInstructions),
+    maxSelects(_maxSelects) {
+}
+
+AutoMergingSearcher::~AutoMergingSearcher() {
+  delete baseSearcher;
+}
+
+///
+
+PendingMerge *AutoMergingSearcher::getMergePoint(ExecutionState &es) {
+  // Join points in frames which have returned can no longer be reached
+  while (!es.pendingMerges.empty() &&
+         es.pendingMerges.back().depth > es.stack.size())
+    es.pendingMerges.pop_back();
+
+  if (es.pendingMerges.empty())
+    return 0;
+
+  PendingMerge &pm = es.pendingMerges.back();
+  if (pm.depth == es.stack.size() && es.pc->inst == pm.point)
+    return &pm;
+  return 0;
+}
+
+void AutoMergingSearcher::release(std::map<uint64_t, HeldState>::iterator it) {
+  baseSearcher->addState(it->second.state);
+  heldStates.erase(it);
+}
+
+ExecutionState &AutoMergingSearcher::selectState() {
+  for (;;) {
+    // Stop waiting once no other state of the group is left, or after too
+    // long
+    for (std::map<uint64_t, HeldState>::iterator it = heldStates.begin(),
+           ie = heldStates.end(); it != ie;) {
+      std::map<uint64_t, HeldState>::iterator next = it;
+      ++next;
+      if (it->second.group->refCount == 1 ||
+          it->second.deadline <= stats::instructions)
+        release(it);
+      it = next;
+    }
+    if (baseSearcher->empty()) {
+      assert(!heldStates.empty() && "selectState() on an empty searcher");
+      release(heldStates.begin());
+    }
+
+    ExecutionState &es = baseSearcher->selectState();
+    PendingMerge *pm = getMergePoint(es);
+    if (!pm)
+      return es;
+
+    // Either way the state is done with this join point
+    ref<MergeGroup> group = pm->group;
+    es.pendingMerges.pop_back();
+
+    std::map<uint64_t, HeldState>::iterator it = heldStates.find(group->id);
+    if (it != heldStates.end()) {
+      if (it->second.state->merge(es, maxSelects)) {
+        baseSearcher->removeState(&es, &es);
+        mergedStates.insert(&es);
+        executor.terminateState(es);
+      }
+    } else if (group->refCount > 1) {
+      HeldState held;
+      held.state = &es;
+      held.group = group;
+      held.deadline = stats::instructions + holdInstructions;
+      baseSearcher->removeState(&es, &es);
+      heldStates.insert(std::make_pair(group->id, held));
+    }
+  }
+}
+
+void
+AutoMergingSearcher::update(ExecutionState *current,
+                            const std::vector<ExecutionState *> &addedStates,
+                            const std::vector<ExecutionState *> &removedStates) {
+  if (removedStates.empty()) {
+    baseSearcher->update(current, addedStates, removedStates);
+    return;
+  }
+
+  // Neither merged nor held states are known to the base searcher
+  std::vector<ExecutionState *> alt;
+  for (std::vector<ExecutionState *>::const_iterator it = removedStates.begin(),
+         ie = removedStates.end(); it != ie; ++it) {
+    ExecutionState *es = *it;
+    if (mergedStates.erase(es))
+      continue;
+    std::map<uint64_t, HeldState>::iterator it2 = heldStates.begin();
+    while (it2 != heldStates.end() && it2->second.state != es)
+      ++it2;
+    if (it2 != heldStates.end())
+      heldStates.erase(it2);
+    else
+      alt.push_back(es);
+  }
+  baseSearcher->update(current, addedStates, alt);
+}
+
+///
+
 BatchingSearcher::BatchingSearcher(Searcher *_baseSearcher,
                                    double _timeBudget,
                                    unsigned _instructionBudget) 
@@ -10,6 +10,8 @@
 #ifndef KLEE_SEARCHER_H
 #define KLEE_SEARCHER_H
 
+#include "klee/util/Ref.h"
+
 #include "llvm/Support/raw_ostream.h"
 #include <vector>
 #include <set>
@@ -27,6 +29,8 @@ namespace klee {
   template<class T> class DiscretePDF;
   class ExecutionState;
   class Executor;
+  struct MergeGroup;
+  struct PendingMerge;
 
   class Searcher {
   public:
@@ -76,7 +80,8 @@ namespace klee {
       NURS_Depth,
       NURS_ICnt,
       NURS_CPICnt,
-      NURS_QC
+      NURS_QC,
+      NURS_Mem
     };
   };
 
@@ -130,7 +135,8 @@ namespace klee {
       InstCount,
       CPInstCount,
       MinDistToUncovered,
-      CoveringNew
+      CoveringNew,
+      ExclusiveMemory
     };
 
   private:
@@ -158,6 +164,7 @@ namespace klee {
       case CPInstCount        : os << "CPInstCount\n"; return;
       case MinDistToUncovered : os << "MinDistToUncovered\n"; return;
       case CoveringNew        : os << "CoveringNew\n"; return;
+      case ExclusiveMemory    : os << "ExclusiveMemory\n"; return;
       default                 : os << "<unknown type>\n"; return;
       }
     }
@@ -226,6 +233,48 @@ namespace klee {
     }
   };
 
+  /// Holds a state which reaches the join point of a branch it forked at
+  /// until another state from the same branch arrives there, and merges the
+  /// two. The join points are found by KModule::computeMergePoints.
+  class AutoMergingSearcher : public Searcher {
+    struct HeldState {
+      ExecutionState *state;
+      ref<MergeGroup> group;
+      /// Instruction count at which the state stops waiting
+      uint64_t deadline;
+    };
+
+    Executor &executor;
+    Searcher *baseSearcher;
+    unsigned holdInstructions;
+    unsigned maxSelects;
+    /// States waiting at a join point, by merge group id
+    std::map<uint64_t, HeldState> heldStates;
+    /// States merged into a held state, which the base searcher no longer has
+    std::set<ExecutionState*> mergedStates;
+
+  private:
+    PendingMerge *getMergePoint(ExecutionState &es);
+    void release(std::map<uint64_t, HeldState>::iterator it);
+
+  public:
+    AutoMergingSearcher(Executor &executor, Searcher *baseSearcher,
+                        unsigned holdInstructions, unsigned maxSelects);
+    ~AutoMergingSearcher();
+
+    ExecutionState &selectState();
+    void update(ExecutionState *current,
+                const std::vector<ExecutionState *> &addedStates,
+                const std::vector<ExecutionState *> &removedStates);
+    bool empty() { return baseSearcher->empty() && heldStates.empty(); }
+    void printName(llvm::raw_ostream &os) {
+      os << "<AutoMergingSearcher> holding states for " << holdInstructions
+         << " instructions, containing searcher:\n";
+      baseSearcher->printName(os);
+      os << "</AutoMergingSearcher>\n";
+    }
+  };
+
   class BatchingSearcher : public Searcher {
     Searcher *baseSearcher;
     double timeBudget;
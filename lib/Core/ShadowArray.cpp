@@ -14,6 +14,8 @@
 
 #include "ShadowArray.h"
 
+#include "klee/util/ExprVisitor.h"
+
 /*
 #include "Dependency.h"
 
@@ -38,16 +40,59 @@ namespace klee {
 
 std::map<const Array *, const Array *> ShadowArray::shadowArray;
 
-UpdateNode *
-ShadowArray::getShadowUpdate(const UpdateNode *source,
-                             std::set<const Array *> &replacements) {
-  if (!source)
-    return 0;
+ExprHashMap<ShadowArray::ShadowEntry> ShadowArray::shadowCache;
 
-  return new UpdateNode(getShadowUpdate(source->next, replacements),
-                        getShadowExpression(source->index, replacements),
-                        getShadowExpression(source->value, replacements));
-}
+static const unsigned MaxShadowCacheSize = 1 << 16;
+
+/// \brief Rewrites an expression over the shadow arrays, memoizing the
+/// rewritten subexpressions (through ExprVisitor) and update nodes.
+class ShadowVisitor : public ExprVisitor {
+  std::set<const Array *> &replacements;
+
+  std::map<const UpdateNode *, const UpdateNode *> shadowUpdates;
+
+  /// \brief Keeps the memoized shadow update nodes alive
+  std::vector<UpdateList> heldUpdates;
+
+  const UpdateNode *getShadowUpdate(const UpdateNode *source) {
+    // Walk down to the first update already shadowed, then build the new
+    // updates from the bottom up.
+    std::vector<const UpdateNode *> pending;
+    const UpdateNode *un = source;
+    std::map<const UpdateNode *, const UpdateNode *>::iterator it;
+    for (; un; un = un->next) {
+      it = shadowUpdates.find(un);
+      if (it != shadowUpdates.end())
+        break;
+      pending.push_back(un);
+    }
+
+    const UpdateNode *shadow = un ? it->second : 0;
+    for (std::vector<const UpdateNode *>::reverse_iterator
+             pit = pending.rbegin(),
+             pie = pending.rend();
+         pit != pie; ++pit) {
+      shadow = new UpdateNode(shadow, visit((*pit)->index),
+                              visit((*pit)->value));
+      shadowUpdates[*pit] = shadow;
+      heldUpdates.push_back(UpdateList(0, shadow));
+    }
+    return shadow;
+  }
+
+protected:
+  Action visitRead(const ReadExpr &re) {
+    const Array *replacementArray = ShadowArray::shadowArray[re.updates.root];
+    replacements.insert(replacementArray);
+
+    UpdateList newUpdates(replacementArray, getShadowUpdate(re.updates.head));
+    return Action::changeTo(ReadExpr::create(newUpdates, visit(re.index)));
+  }
+
+public:
+  ShadowVisitor(std::set<const Array *> &_replacements)
+      : replacements(_replacements) {}
+};
 
 ref<Expr> ShadowArray::createBinaryOfSameKind(ref<Expr> originalExpr,
                                               ref<Expr> newLhs,
@@ -61,100 +106,34 @@ ref<Expr> ShadowArray::createBinaryOfSameKind(ref<Expr> originalExpr,
 }
 
 void ShadowArray::addShadowArrayMap(const Array *source, const Array *target) {
-  shadowArray[source] = target;
+  const Array *&shadow = shadowArray[source];
+  if (shadow && shadow != target)
+    shadowCache.clear();
+  shadow = target;
 }
 
 ref<Expr>
 ShadowArray::getShadowExpression(ref<Expr> expr,
                                  std::set<const Array *> &replacements) {
-  ref<Expr> ret;
-
-  switch (expr->getKind()) {
-  case Expr::Read: {
-    ReadExpr *readExpr = llvm::dyn_cast<ReadExpr>(expr);
-    const Array *replacementArray = shadowArray[readExpr->updates.root];
-
-    if (std::find(replacements.begin(), replacements.end(), replacementArray) ==
-        replacements.end()) {
-      replacements.insert(replacementArray);
-    }
-
-    UpdateList newUpdates(
-        replacementArray,
-        getShadowUpdate(readExpr->updates.head, replacements));
-    ret = ReadExpr::create(newUpdates,
-                           getShadowExpression(readExpr->index, replacements));
-    break;
-  }
-  case Expr::Constant: {
-    ret = expr;
-    break;
-  }
-  case Expr::Select: {
-    ret =
-        SelectExpr::create(getShadowExpression(expr->getKid(0), replacements),
-                           getShadowExpression(expr->getKid(1), replacements),
-                           getShadowExpression(expr->getKid(2), replacements));
-    break;
-  }
-  case Expr::Extract: {
-    ExtractExpr *extractExpr = llvm::dyn_cast<ExtractExpr>(expr);
-    ret =
-        ExtractExpr::create(getShadowExpression(expr->getKid(0), replacements),
-                            extractExpr->offset, extractExpr->width);
-    break;
-  }
-  case Expr::ZExt: {
-    CastExpr *castExpr = llvm::dyn_cast<CastExpr>(expr);
-    ret = ZExtExpr::create(getShadowExpression(expr->getKid(0), replacements),
-                           castExpr->getWidth());
-    break;
-  }
-  case Expr::SExt: {
-    CastExpr *castExpr = llvm::dyn_cast<CastExpr>(expr);
-    ret = SExtExpr::create(getShadowExpression(expr->getKid(0), replacements),
-                           castExpr->getWidth());
-    break;
-  }
-  case Expr::Concat:
-  case Expr::Add:
-  case Expr::Sub:
-  case Expr::Mul:
-  case Expr::UDiv:
-  case Expr::SDiv:
-  case Expr::URem:
-  case Expr::SRem:
-  case Expr::Not:
-  case Expr::And:
-  case Expr::Or:
-  case Expr::Xor:
-  case Expr::Shl:
-  case Expr::LShr:
-  case Expr::AShr:
-  case Expr::Eq:
-  case Expr::Ne:
-  case Expr::Ult:
-  case Expr::Ule:
-  case Expr::Ugt:
-  case Expr::Uge:
-  case Expr::Slt:
-  case Expr::Sle:
-  case Expr::Sgt:
-  case Expr::Sge: {
-    ret = createBinaryOfSameKind(
-        expr, getShadowExpression(expr->getKid(0), replacements),
-        getShadowExpression(expr->getKid(1), replacements));
-    break;
-  }
-  case Expr::NotOptimized: {
-    ret = NotOptimizedExpr::create(getShadowExpression(expr->getKid(0), replacements));
-    break;
-  }
-  default:
-    assert(!"unhandled Expr type");
+  if (isa<ConstantExpr>(expr))
+    return expr;
+
+  ExprHashMap<ShadowEntry>::iterator it = shadowCache.find(expr);
+  if (it == shadowCache.end()) {
+    // The cache holds its expressions alive, so bound it.
+    if (shadowCache.size() >= MaxShadowCacheSize)
+      shadowCache.clear();
+
+    std::set<const Array *> used;
+    ShadowEntry entry;
+    entry.shadow = ShadowVisitor(used).visit(expr);
+    entry.replacements.assign(used.begin(), used.end());
+    it = shadowCache.insert(std::make_pair(expr, entry)).first;
   }
 
-  return ret;
+  replacements.insert(it->second.replacements.begin(),
+                      it->second.replacements.end());
+  return it->second.shadow;
 }
 
 }
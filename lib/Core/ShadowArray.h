@@ -17,15 +17,26 @@
 
 #include "AddressSpace.h"
 
+#include "klee/util/ExprHashMap.h"
+
 namespace klee {
 
   /// \brief Implements the replacement mechanism for replacing variables, used in
   /// replacing free with bound variables.
   class ShadowArray {
+    friend class ShadowVisitor;
+
     static std::map<const Array *, const Array *> shadowArray;
 
-    static UpdateNode *getShadowUpdate(const UpdateNode *chain,
-				       std::set<const Array *> &replacements);
+    /// \brief An expression with its arrays replaced by their shadows
+    struct ShadowEntry {
+      ref<Expr> shadow;
+      std::vector<const Array *> replacements;
+    };
+
+    /// \brief The expressions already shadowed, which are often shadowed
+    /// again when storing interpolants
+    static ExprHashMap<ShadowEntry> shadowCache;
 
   public:
     static ref<Expr> createBinaryOfSameKind(ref<Expr> originalExpr,
@@ -33,6 +44,11 @@ namespace klee {
 
     static void addShadowArrayMap(const Array *source, const Array *target);
 
+    /// \brief Replace every array read in an expression with its shadow.
+    ///
+    /// Shared subexpressions and update lists are rewritten once per call.
+    ///
+    /// \param replacements Receives the shadow arrays used.
     static ref<Expr> getShadowExpression(ref<Expr> expr,
 					 std::set<const Array *> &replacements);
 
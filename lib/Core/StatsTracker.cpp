@@ -21,6 +21,7 @@
 #include "klee/Internal/Support/ErrorHandling.h"
 #include "klee/SolverStats.h"
 
+#include "AddressSpace.h"
 #include "CallPathManager.h"
 #include "CoreStats.h"
 #include "Executor.h"
@@ -416,6 +417,7 @@ void StatsTracker::writeStatsHeader() {
              << "'CexCacheTime',"
              << "'ForkTime',"
              << "'ResolveTime',"
+             << "'ExclusiveMemory',"
 #ifdef DEBUG
 	     << "'ArrayHashTime',"
 #endif
@@ -441,7 +443,8 @@ void StatsTracker::writeStatsLine() {
              << stats::solverTime / 1000000. << ","
              << stats::cexCacheTime / 1000000. << ","
              << stats::forkTime / 1000000. << ","
-             << stats::resolveTime / 1000000.
+             << stats::resolveTime / 1000000. << ","
+             << AddressSpace::getTotalExclusiveBytes()
 #ifdef DEBUG
              << "," << stats::arrayHashTime / 1000000.
 #endif
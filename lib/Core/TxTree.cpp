@@ -710,23 +710,39 @@ SubsumptionTableEntry::simplifyArithmeticBody(ref<Expr> existsExpr,
 ref<Expr> SubsumptionTableEntry::replaceExpr(ref<Expr> originalExpr,
                                              ref<Expr> replacedExpr,
                                              ref<Expr> replacementExpr) {
+  ExprHashMap<ref<Expr> > memo;
+  return replaceExpr(originalExpr, replacedExpr, replacementExpr, memo);
+}
+
+ref<Expr> SubsumptionTableEntry::replaceExpr(ref<Expr> originalExpr,
+                                             ref<Expr> replacedExpr,
+                                             ref<Expr> replacementExpr,
+                                             ExprHashMap<ref<Expr> > &memo) {
   // We only handle binary expressions
   if (!llvm::isa<BinaryExpr>(originalExpr) ||
       llvm::isa<ConcatExpr>(originalExpr))
     return originalExpr;
 
-  if (originalExpr->getKid(0) == replacedExpr)
-    return ShadowArray::createBinaryOfSameKind(originalExpr, replacementExpr,
-                                               originalExpr->getKid(1));
+  ExprHashMap<ref<Expr> >::iterator it = memo.find(originalExpr);
+  if (it != memo.end())
+    return it->second;
 
-  if (originalExpr->getKid(1) == replacedExpr)
-    return ShadowArray::createBinaryOfSameKind(
+  ref<Expr> result;
+  if (originalExpr->getKid(0) == replacedExpr)
+    result = ShadowArray::createBinaryOfSameKind(originalExpr, replacementExpr,
+                                                 originalExpr->getKid(1));
+  else if (originalExpr->getKid(1) == replacedExpr)
+    result = ShadowArray::createBinaryOfSameKind(
         originalExpr, originalExpr->getKid(0), replacementExpr);
+  else
+    result = ShadowArray::createBinaryOfSameKind(
+        originalExpr, replaceExpr(originalExpr->getKid(0), replacedExpr,
+                                  replacementExpr, memo),
+        replaceExpr(originalExpr->getKid(1), replacedExpr, replacementExpr,
+                    memo));
 
-  return ShadowArray::createBinaryOfSameKind(
-      originalExpr,
-      replaceExpr(originalExpr->getKid(0), replacedExpr, replacementExpr),
-      replaceExpr(originalExpr->getKid(1), replacedExpr, replacementExpr));
+  memo[originalExpr] = result;
+  return result;
 }
 
 bool SubsumptionTableEntry::hasSubExpression(ref<Expr> expr,
@@ -869,7 +885,7 @@ ref<Expr> SubsumptionTableEntry::simplifyEqualityExpr(
 
 void
 SubsumptionTableEntry::getSubstitution1(ref<Expr> equalities,
-                                        std::map<ref<Expr>, ref<Expr> > &map) {
+                                        ExprHashMap<ref<Expr> > &map) {
   // It is assumed the lhs is an expression on the existentially-quantified
   // variable whereas the rhs is an expression on the free variables.
   if (llvm::isa<EqExpr>(equalities)) {
@@ -906,7 +922,7 @@ SubsumptionTableEntry::getSubstitution1(ref<Expr> equalities,
 void
 SubsumptionTableEntry::getSubstitution2(std::set<const Array *> &replaced,
                                         ref<Expr> equalities,
-                                        std::map<ref<Expr>, ref<Expr> > &map) {
+                                        ExprHashMap<ref<Expr> > &map) {
   // It is assumed the lhs is an expression on the existentially-quantified
   // variable whereas the rhs is an expression on the free variables.
   if (llvm::isa<EqExpr>(equalities)) {
@@ -1050,7 +1066,7 @@ ref<Expr> SubsumptionTableEntry::simplifyExistsExpr(ref<Expr> existsExpr,
 
   assert(llvm::isa<AndExpr>(body));
 
-  std::map<ref<Expr>, ref<Expr> > substitution1;
+  ExprHashMap<ref<Expr> > substitution1;
   ref<Expr> equalities = body->getKid(1);
   getSubstitution1(equalities, substitution1);
 
@@ -1066,7 +1082,7 @@ ref<Expr> SubsumptionTableEntry::simplifyExistsExpr(ref<Expr> existsExpr,
 
   // We look for substitutions in the interpolant part and apply them to the
   // interpolant itself.
-  std::map<ref<Expr>, ref<Expr> > substitution2;
+  ExprHashMap<ref<Expr> > substitution2;
   getSubstitution2(expr->variables, interpolant, substitution2);
   interpolant = ApplySubstitutionVisitor(substitution2).visit(interpolant);
 
@@ -2652,6 +2668,21 @@ TxTreeNode::~TxTreeNode() {
     delete dependency;
 }
 
+size_t TxTreeNode::getMemoryUsage() const {
+  size_t bytes = sizeof(*this);
+  bytes += (entryCallHistory.capacity() + callHistory.capacity()) *
+           sizeof(llvm::Instruction *);
+
+  // The path condition entries beyond the parent's are our own.
+  PathCondition *ie = parent ? parent->pathCondition : 0;
+  for (PathCondition *it = pathCondition; it != ie; it = it->cdr())
+    bytes += sizeof(PathCondition);
+
+  if (dependency)
+    bytes += dependency->getMemoryUsage();
+  return bytes;
+}
+
 ref<Expr>
 TxTreeNode::getInterpolant(std::set<const Array *> &replacements) const {
   TimerStatIncrementer t(getInterpolantTime);
@@ -23,6 +23,7 @@
 #include "klee/Solver.h"
 #include "klee/Statistic.h"
 #include "klee/TimerStatIncrementer.h"
+#include "klee/util/ExprHashMap.h"
 #include "klee/util/ExprVisitor.h"
 
 #include "Dependency.h"
@@ -347,15 +348,14 @@ class SubsumptionTableEntry {
   /// \brief General substitution mechanism
   class ApplySubstitutionVisitor : public ExprVisitor {
   private:
-    const std::map<ref<Expr>, ref<Expr> > &replacements;
+    const ExprHashMap<ref<Expr> > &replacements;
 
   public:
-    ApplySubstitutionVisitor(
-        const std::map<ref<Expr>, ref<Expr> > &_replacements)
+    ApplySubstitutionVisitor(const ExprHashMap<ref<Expr> > &_replacements)
         : ExprVisitor(true), replacements(_replacements) {}
 
     Action visitExprPost(const Expr &e) {
-      std::map<ref<Expr>, ref<Expr> >::const_iterator it =
+      ExprHashMap<ref<Expr> >::const_iterator it =
           replacements.find(ref<Expr>(const_cast<Expr *>(&e)));
       if (it != replacements.end()) {
         return Action::changeTo(it->second);
@@ -412,6 +412,11 @@ class SubsumptionTableEntry {
   static ref<Expr> replaceExpr(ref<Expr> originalExpr, ref<Expr> replacedExpr,
                                ref<Expr> replacementExpr);
 
+  /// \brief Implements replaceExpr, rewriting each shared sub-expression once
+  static ref<Expr> replaceExpr(ref<Expr> originalExpr, ref<Expr> replacedExpr,
+                               ref<Expr> replacementExpr,
+                               ExprHashMap<ref<Expr> > &memo);
+
   /// \brief Simplifies the interpolant condition in subsumption check whenever
   /// it contains constant equalities or disequalities.
   static ref<Expr>
@@ -451,12 +456,12 @@ class SubsumptionTableEntry {
 
   /// \brief Function to collect substitution from a conjunction of equalities.
   static void getSubstitution1(ref<Expr> equalities,
-                               std::map<ref<Expr>, ref<Expr> > &map);
+                               ExprHashMap<ref<Expr> > &map);
 
   /// \brief Function to collect substitution from a conjunction of formulas.
   static void getSubstitution2(std::set<const Array *> &replaced,
                                ref<Expr> conjunction,
-                               std::map<ref<Expr>, ref<Expr> > &map);
+                               ExprHashMap<ref<Expr> > &map);
 
   /// \brief Function to remove equalities whose lhs is a variable in the set.
   static ref<Expr> removeUnsubstituted(std::set<const Array *> &variables,
@@ -607,6 +612,10 @@ public:
 
   uint64_t getNodeSequenceNumber() { return nodeSequenceNumber; }
 
+  /// \brief Approximate number of heap bytes held by the shadow data of
+  /// this node alone, excluding what it shares with its ancestors.
+  size_t getMemoryUsage() const;
+
   /// \brief Retrieve the interpolant for this node as KLEE expression object
   ///
   /// \param replacements The replacement bound variables for replacing the
@@ -12,6 +12,7 @@
 #include "Searcher.h"
 #include "Executor.h"
 
+#include "klee/CommandLine.h"
 #include "klee/Internal/Support/ErrorHandling.h"
 #include "llvm/Support/CommandLine.h"
 
@@ -31,6 +32,7 @@ namespace {
 			clEnumValN(Searcher::NURS_ICnt, "nurs:icnt", "use NURS with Instr-Count"),
 			clEnumValN(Searcher::NURS_CPICnt, "nurs:cpicnt", "use NURS with CallPath-Instr-Count"),
 			clEnumValN(Searcher::NURS_QC, "nurs:qc", "use NURS with Query-Cost"),
+			clEnumValN(Searcher::NURS_Mem, "nurs:mem", "use NURS with Exclusive-Memory"),
 			clEnumValEnd));
 
   cl::opt<bool>
@@ -61,6 +63,33 @@ namespace {
   UseBumpMerge("use-bump-merge", 
            cl::desc("Enable support for klee_merge() (extra experimental)"));
 
+  cl::opt<bool>
+  AutoMerge("auto-merge",
+            cl::desc("Merge the states forked at a branch where the sides of "
+                     "the branch join again (experimental, requires "
+                     "-no-interpolation)"),
+            cl::init(false));
+
+  cl::opt<unsigned>
+  AutoMergeRegion("auto-merge-region",
+                  cl::desc("Largest number of instructions between a branch "
+                           "and its join point for --auto-merge (default=50)"),
+                  cl::init(50));
+
+  cl::opt<unsigned>
+  AutoMergeHold("auto-merge-hold",
+                cl::desc("Number of instructions a state waits at a join "
+                         "point for the other states of its branch when "
+                         "using --auto-merge (default=10000)"),
+                cl::init(10000));
+
+  cl::opt<unsigned>
+  AutoMergeMaxSelects("auto-merge-max-selects",
+                      cl::desc("Do not merge states in which more than this "
+                               "many locals and memory bytes differ when "
+                               "using --auto-merge (0=no limit, default=64)"),
+                      cl::init(64));
+
 }
 
 
@@ -73,6 +102,11 @@ bool klee::userSearcherRequiresMD2U() {
 }
 
 
+unsigned klee::userSearcherAutoMergeRegion() {
+  return AutoMerge ? AutoMergeRegion : 0;
+}
+
+
 Searcher *getNewSearcher(Searcher::CoreSearchType type, Executor &executor) {
   Searcher *searcher = NULL;
   switch (type) {
@@ -86,6 +120,7 @@ Searcher *getNewSearcher(Searcher::CoreSearchType type, Executor &executor) {
   case Searcher::NURS_ICnt: searcher = new WeightedRandomSearcher(WeightedRandomSearcher::InstCount); break;
   case Searcher::NURS_CPICnt: searcher = new WeightedRandomSearcher(WeightedRandomSearcher::CPInstCount); break;
   case Searcher::NURS_QC: searcher = new WeightedRandomSearcher(WeightedRandomSearcher::QueryCost); break;
+  case Searcher::NURS_Mem: searcher = new WeightedRandomSearcher(WeightedRandomSearcher::ExclusiveMemory); break;
   }
 
   return searcher;
@@ -123,6 +158,18 @@ Searcher *klee::constructUserSearcher(Executor &executor) {
   } else if (UseBumpMerge) {
     searcher = new BumpMergingSearcher(executor, searcher);
   }
+
+  if (AutoMerge) {
+    if (INTERPOLATION_ENABLED)
+      klee_error("--auto-merge cannot be used with interpolation, please "
+                 "also use -no-interpolation");
+    // Held states stay in the process tree, where random-path would pick them
+    if (std::find(CoreSearch.begin(), CoreSearch.end(),
+                  Searcher::RandomPath) != CoreSearch.end())
+      klee_error("--auto-merge cannot be used with --search=random-path");
+    searcher = new AutoMergingSearcher(executor, searcher, AutoMergeHold,
+                                       AutoMergeMaxSelects);
+  }
   
   if (UseIterativeDeepeningTimeSearch) {
     searcher = new IterativeDeepeningTimeSearcher(searcher);
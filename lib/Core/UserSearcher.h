@@ -17,6 +17,10 @@ namespace klee {
   // XXX gross, should be on demand?
   bool userSearcherRequiresMD2U();
 
+  /// Largest region of a branch whose sides are merged again at their join
+  /// point, or 0 when automatic merging is off.
+  unsigned userSearcherAutoMergeRegion();
+
   Searcher *constructUserSearcher(Executor &executor);
 }
 
@@ -0,0 +1,405 @@
+//===-- BatchEvaluator.cpp ------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/util/BatchEvaluator.h"
+
+#include "klee/util/Assignment.h"
+
+#include <algorithm>
+
+using namespace klee;
+
+const unsigned BatchEvaluator::BlockSize;
+
+static inline uint64_t widthMask(Expr::Width w) {
+  return w >= 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << w) - 1;
+}
+
+static inline int64_t signExtend(uint64_t v, Expr::Width w) {
+  if (w >= 64)
+    return (int64_t) v;
+  uint64_t sign = (uint64_t) 1 << (w - 1);
+  return (int64_t) ((v ^ sign) - sign);
+}
+
+unsigned BatchEvaluator::compile(const ref<Expr> &e) {
+  std::map<const Expr*, unsigned>::iterator it = slots.find(e.get());
+  if (it != slots.end())
+    return it->second;
+
+  if (e->getWidth() > 64 || e->getKind() == Expr::Exists) {
+    supported = false;
+    return 0;
+  }
+
+  Instruction inst;
+  inst.kind = e->getKind();
+  inst.width = e->getWidth();
+  inst.ops[0] = inst.ops[1] = inst.ops[2] = 0;
+  inst.aux = 0;
+
+  switch (inst.kind) {
+  case Expr::Constant:
+    inst.aux = cast<ConstantExpr>(e)->getZExtValue();
+    break;
+
+  case Expr::Read:
+    inst.aux = compileRead(cast<ReadExpr>(e));
+    inst.ops[0] = compile(cast<ReadExpr>(e)->index);
+    break;
+
+  case Expr::Extract:
+    inst.aux = cast<ExtractExpr>(e)->offset;
+    inst.ops[0] = compile(e->getKid(0));
+    break;
+
+  case Expr::Concat:
+    inst.aux = e->getKid(1)->getWidth();
+    inst.ops[0] = compile(e->getKid(0));
+    inst.ops[1] = compile(e->getKid(1));
+    break;
+
+  default:
+    assert(e->getNumKids() <= 3);
+    for (unsigned i = 0; i != e->getNumKids(); ++i)
+      inst.ops[i] = compile(e->getKid(i));
+    break;
+  }
+
+  if (!supported)
+    return 0;
+
+  unsigned slot = tape.size();
+  tape.push_back(inst);
+  slots.insert(std::make_pair(e.get(), slot));
+  return slot;
+}
+
+unsigned BatchEvaluator::compileRead(const ReadExpr *re) {
+  const Array *root = re->updates.root;
+  if (root->getRange() > 64 || root->getDomain() > 64) {
+    supported = false;
+    return 0;
+  }
+
+  Read read;
+  std::map<const Array*, unsigned>::iterator it = arrayIndex.find(root);
+  if (it != arrayIndex.end()) {
+    read.array = it->second;
+  } else {
+    read.array = arrays.size();
+    arrayIndex.insert(std::make_pair(root, read.array));
+    arrays.push_back(ArrayInfo());
+    ArrayInfo &info = arrays.back();
+    info.array = root;
+    for (unsigned i = 0; i != root->constantValues.size(); ++i)
+      info.constantValues.push_back(root->constantValues[i]->getZExtValue());
+  }
+
+  for (const UpdateNode *un = re->updates.head; un;) {
+    // The writes in a snapshot are to distinct indices, so their order does
+    // not matter.
+    if (const UpdateSnapshot *snapshot = un->getSnapshot()) {
+      for (UpdateSnapshot::entries_ty::const_iterator
+             it = snapshot->entries.begin(), ie = snapshot->entries.end();
+           it != ie; ++it) {
+        unsigned index = compile(it->second->index);
+        unsigned value = compile(it->second->value);
+        read.updates.push_back(std::make_pair(index, value));
+      }
+      un = snapshot->tail;
+      continue;
+    }
+    unsigned index = compile(un->index);
+    unsigned value = compile(un->value);
+    read.updates.push_back(std::make_pair(index, value));
+    un = un->next;
+  }
+
+  reads.push_back(read);
+  return reads.size() - 1;
+}
+
+void BatchEvaluator::evaluateBlock(Assignment *const *assignments,
+                                   unsigned n, uint64_t &unknown) {
+  assert(n <= BlockSize);
+  values.resize(tape.size() * BlockSize);
+  unknown = 0;
+
+  // The binding of each array under each assignment, or null if the array
+  // is unbound and reads as zero.
+  std::vector<const std::vector<unsigned char>*> bindings(arrays.size() *
+                                                          BlockSize);
+  for (unsigned a = 0; a != arrays.size(); ++a) {
+    for (unsigned j = 0; j != n; ++j) {
+      Assignment::bindings_ty::const_iterator it =
+        assignments[j]->bindings.find(arrays[a].array);
+      bindings[a * BlockSize + j] =
+        it == assignments[j]->bindings.end() ? 0 : &it->second;
+    }
+  }
+
+  for (unsigned i = 0; i != tape.size(); ++i) {
+    const Instruction &inst = tape[i];
+    uint64_t *out = &values[i * BlockSize];
+    const uint64_t *a = &values[inst.ops[0] * BlockSize];
+    const uint64_t *b = &values[inst.ops[1] * BlockSize];
+    const uint64_t *c = &values[inst.ops[2] * BlockSize];
+    Expr::Width w = inst.width;
+    uint64_t m = widthMask(w);
+
+    switch (inst.kind) {
+    case Expr::Constant:
+      for (unsigned j = 0; j != n; ++j)
+        out[j] = inst.aux;
+      break;
+
+    case Expr::NotOptimized:
+    case Expr::ZExt:
+      for (unsigned j = 0; j != n; ++j)
+        out[j] = a[j];
+      break;
+
+    case Expr::Read: {
+      const Read &read = reads[inst.aux];
+      const ArrayInfo &info = arrays[read.array];
+      for (unsigned j = 0; j != n; ++j) {
+        uint64_t index = a[j];
+        bool found = false;
+        for (std::vector< std::pair<unsigned, unsigned> >::const_iterator
+               it = read.updates.begin(), ie = read.updates.end();
+             it != ie; ++it) {
+          if (values[it->first * BlockSize + j] == index) {
+            out[j] = values[it->second * BlockSize + j];
+            found = true;
+            break;
+          }
+        }
+        if (found)
+          continue;
+        if (index < info.constantValues.size()) {
+          out[j] = info.constantValues[index];
+        } else {
+          const std::vector<unsigned char> *bytes =
+            bindings[read.array * BlockSize + j];
+          if (bytes && index < bytes->size()) {
+            out[j] = (*bytes)[index];
+          } else {
+            // A free value stays symbolic under Assignment::evaluate.
+            if (assignments[j]->allowFreeValues)
+              unknown |= (uint64_t) 1 << j;
+            out[j] = 0;
+          }
+        }
+      }
+    } break;
+
+    case Expr::Select:
+      for (unsigned j = 0; j != n; ++j)
+        out[j] = a[j] ? b[j] : c[j];
+      break;
+
+    case Expr::Concat:
+      for (unsigned j = 0; j != n; ++j)
+        out[j] = ((a[j] << inst.aux) | b[j]) & m;
+      break;
+
+    case Expr::Extract:
+      for (unsigned j = 0; j != n; ++j)
+        out[j] = (a[j] >> inst.aux) & m;
+      break;
+
+    case Expr::SExt: {
+      Expr::Width from = tape[inst.ops[0]].width;
+      for (unsigned j = 0; j != n; ++j)
+        out[j] = (uint64_t) signExtend(a[j], from) & m;
+    } break;
+
+    case Expr::Not:
+      for (unsigned j = 0; j != n; ++j)
+        out[j] = ~a[j] & m;
+      break;
+
+    case Expr::Add:
+      for (unsigned j = 0; j != n; ++j)
+        out[j] = (a[j] + b[j]) & m;
+      break;
+    case Expr::Sub:
+      for (unsigned j = 0; j != n; ++j)
+        out[j] = (a[j] - b[j]) & m;
+      break;
+    case Expr::Mul:
+      for (unsigned j = 0; j != n; ++j)
+        out[j] = (a[j] * b[j]) & m;
+      break;
+
+    // Division by zero is left unevaluated by ExprEvaluator; such
+    // assignments are checked individually.
+    case Expr::UDiv:
+    case Expr::URem:
+      for (unsigned j = 0; j != n; ++j) {
+        if (!b[j]) {
+          unknown |= (uint64_t) 1 << j;
+          out[j] = 0;
+        } else {
+          out[j] = inst.kind == Expr::UDiv ? a[j] / b[j] : a[j] % b[j];
+        }
+      }
+      break;
+    case Expr::SDiv:
+    case Expr::SRem:
+      for (unsigned j = 0; j != n; ++j) {
+        if (!b[j]) {
+          unknown |= (uint64_t) 1 << j;
+          out[j] = 0;
+          continue;
+        }
+        int64_t x = signExtend(a[j], w), y = signExtend(b[j], w);
+        int64_t r;
+        if (y == -1) // avoid overflowing on INT64_MIN / -1
+          r = inst.kind == Expr::SDiv ? (int64_t) (0 - (uint64_t) x) : 0;
+        else
+          r = inst.kind == Expr::SDiv ? x / y : x % y;
+        out[j] = (uint64_t) r & m;
+      }
+      break;
+
+    case Expr::And:
+      for (unsigned j = 0; j != n; ++j)
+        out[j] = a[j] & b[j];
+      break;
+    case Expr::Or:
+      for (unsigned j = 0; j != n; ++j)
+        out[j] = a[j] | b[j];
+      break;
+    case Expr::Xor:
+      for (unsigned j = 0; j != n; ++j)
+        out[j] = a[j] ^ b[j];
+      break;
+
+    case Expr::Shl:
+      for (unsigned j = 0; j != n; ++j)
+        out[j] = b[j] >= w ? 0 : (a[j] << b[j]) & m;
+      break;
+    case Expr::LShr:
+      for (unsigned j = 0; j != n; ++j)
+        out[j] = b[j] >= w ? 0 : a[j] >> b[j];
+      break;
+    case Expr::AShr:
+      for (unsigned j = 0; j != n; ++j) {
+        int64_t x = signExtend(a[j], w);
+        out[j] = (uint64_t) (b[j] >= w ? (x < 0 ? -1 : 0) : x >> b[j]) & m;
+      }
+      break;
+
+    case Expr::Eq:
+      for (unsigned j = 0; j != n; ++j)
+        out[j] = a[j] == b[j];
+      break;
+    case Expr::Ne:
+      for (unsigned j = 0; j != n; ++j)
+        out[j] = a[j] != b[j];
+      break;
+    case Expr::Ult:
+      for (unsigned j = 0; j != n; ++j)
+        out[j] = a[j] < b[j];
+      break;
+    case Expr::Ule:
+      for (unsigned j = 0; j != n; ++j)
+        out[j] = a[j] <= b[j];
+      break;
+    case Expr::Ugt:
+      for (unsigned j = 0; j != n; ++j)
+        out[j] = a[j] > b[j];
+      break;
+    case Expr::Uge:
+      for (unsigned j = 0; j != n; ++j)
+        out[j] = a[j] >= b[j];
+      break;
+
+    case Expr::Slt:
+    case Expr::Sle:
+    case Expr::Sgt:
+    case Expr::Sge: {
+      Expr::Width from = tape[inst.ops[0]].width;
+      for (unsigned j = 0; j != n; ++j) {
+        int64_t x = signExtend(a[j], from), y = signExtend(b[j], from);
+        switch (inst.kind) {
+        case Expr::Slt: out[j] = x < y; break;
+        case Expr::Sle: out[j] = x <= y; break;
+        case Expr::Sgt: out[j] = x > y; break;
+        default: out[j] = x >= y; break;
+        }
+      }
+    } break;
+
+    default:
+      assert(0 && "unexpected expression kind on tape");
+    }
+  }
+}
+
+unsigned BatchEvaluator::findFirstSatisfying(
+    const std::vector<Assignment*> &assignments) {
+  assert(supported && "constraints cannot be evaluated in batch");
+  unsigned size = assignments.size();
+
+  for (unsigned start = 0; start < size; start += BlockSize) {
+    unsigned n = std::min(size - start, BlockSize);
+    uint64_t unknown;
+    evaluateBlock(&assignments[start], n, unknown);
+
+    uint64_t satisfied = n == BlockSize ? ~(uint64_t) 0
+                                        : ((uint64_t) 1 << n) - 1;
+    for (std::vector<unsigned>::iterator it = roots.begin(), ie = roots.end();
+         it != ie; ++it) {
+      const uint64_t *v = &values[*it * BlockSize];
+      Expr::Width w = tape[*it].width;
+      for (unsigned j = 0; j != n; ++j)
+        if (w != Expr::Bool || v[j] != 1)
+          satisfied &= ~((uint64_t) 1 << j);
+    }
+    satisfied &= ~unknown;
+
+    for (unsigned j = 0; j != n; ++j) {
+      uint64_t bit = (uint64_t) 1 << j;
+      if (satisfied & bit)
+        return start + j;
+      if ((unknown & bit) &&
+          assignments[start + j]->satisfies(constraints.begin(),
+                                            constraints.end()))
+        return start + j;
+    }
+  }
+  return size;
+}
+
+void BatchEvaluator::evaluate(unsigned index,
+                              const std::vector<Assignment*> &assignments,
+                              std::vector<uint64_t> &results,
+                              std::vector<bool> &known) {
+  assert(supported && "expressions cannot be evaluated in batch");
+  assert(index < roots.size() && "invalid expression index");
+  unsigned size = assignments.size();
+  results.resize(size);
+  known.resize(size);
+
+  unsigned root = roots[index];
+  for (unsigned start = 0; start < size; start += BlockSize) {
+    unsigned n = std::min(size - start, BlockSize);
+    uint64_t unknown;
+    evaluateBlock(&assignments[start], n, unknown);
+
+    const uint64_t *v = &values[root * BlockSize];
+    for (unsigned j = 0; j != n; ++j) {
+      results[start + j] = v[j];
+      known[start + j] = !(unknown & ((uint64_t) 1 << j));
+    }
+  }
+}
@@ -10,6 +10,7 @@
 #include "klee/Constraints.h"
 
 #include "klee/util/ExprPPrinter.h"
+#include "klee/util/ExprUtil.h"
 #include "klee/util/ExprVisitor.h"
 #if LLVM_VERSION_CODE >= LLVM_VERSION(3, 3)
 #include "llvm/IR/Function.h"
@@ -20,6 +21,7 @@
 #include "klee/Internal/Module/KModule.h"
 
 #include <map>
+#include <set>
 
 using namespace klee;
 
@@ -75,21 +77,184 @@ public:
   }
 };
 
-bool ConstraintManager::rewriteConstraints(ExprVisitor &visitor) {
+/***/
+
+const Array *ArrayPartition::find(const Array *array) const {
+  std::map<const Array*, const Array*>::const_iterator it = parent.find(array);
+  while (it != parent.end() && it->second != array) {
+    array = it->second;
+    it = parent.find(array);
+  }
+  return array;
+}
+
+void ArrayPartition::unite(const Array *a, const Array *b) {
+  a = find(a);
+  b = find(b);
+  if (a == b)
+    return;
+
+  // Attach the shallower tree below the root of the deeper one.
+  unsigned rankA = rank[a], rankB = rank[b];
+  if (rankA < rankB)
+    std::swap(a, b);
+  else if (rankA == rankB)
+    ++rank[a];
+  parent[a] = a;
+  parent[b] = a;
+}
+
+/***/
+
+static std::pair< ref<Expr>, ref<Expr> > getSubstitution(ref<Expr> e) {
+  if (const EqExpr *ee = dyn_cast<EqExpr>(e))
+    if (isa<ConstantExpr>(ee->left))
+      return std::make_pair(ee->right, ee->left);
+  return std::make_pair(e, ConstantExpr::alloc(1, Expr::Bool));
+}
+
+void EqualityIndex::add(ref<Expr> constraint) {
+  std::pair< ref<Expr>, ref<Expr> > sub = getSubstitution(constraint);
+  equalities.insert(sub);
+  ++uses[sub.first];
+}
+
+void EqualityIndex::remove(ref<Expr> constraint) {
+  ref<Expr> key = getSubstitution(constraint).first;
+  std::map< ref<Expr>, unsigned >::iterator it = uses.find(key);
+  assert(it != uses.end() && "constraint not in index");
+  if (--it->second == 0) {
+    uses.erase(it);
+    equalities.erase(key);
+  }
+}
+
+/***/
+
+void ConstraintManager::findDependentArrays(ref<Expr> e,
+                                            std::vector<const Array*> &result) {
+  std::vector< ref<ReadExpr> > reads;
+  findReads(e, /* visitUpdates= */ true, reads);
+
+  std::set<const Array*> seen;
+  for (unsigned i = 0; i != reads.size(); ++i) {
+    const UpdateList &ul = reads[i]->updates;
+    // Reads of a constant array don't alias.
+    if (ul.root->isConstantArray() && !ul.head)
+      continue;
+    if (seen.insert(ul.root).second)
+      result.push_back(ul.root);
+  }
+}
+
+void ConstraintManager::pushConstraint(ref<Expr> e) {
+  constraints.push_back(e);
+  if (!tracksPartition)
+    return;
+
+  if (equalities.isNull())
+    equalities = new EqualityIndex();
+  else if (equalities->refCount > 1)
+    equalities = new EqualityIndex(*equalities);
+  equalities->add(e);
+
+  std::vector<const Array*> arrays;
+  findDependentArrays(e, arrays);
+  if (arrays.empty()) {
+    representatives.push_back(0);
+    return;
+  }
+
+  // Copy the partition if it is still shared with another state.
+  if (partition.isNull())
+    partition = new ArrayPartition();
+  else if (partition->refCount > 1)
+    partition = new ArrayPartition(*partition);
+
+  for (unsigned i = 1; i < arrays.size(); ++i)
+    partition->unite(arrays[0], arrays[i]);
+  representatives.push_back(arrays[0]);
+}
+
+void ConstraintManager::getDependentConstraints(
+    const std::vector<const Array*> &arrays,
+    std::vector< ref<Expr> > &result) const {
+  assert(tracksPartition && "constraint set has no array partition");
+  if (arrays.empty() || partition.isNull())
+    return;
+
+  std::set<const Array*> classes;
+  for (std::vector<const Array*>::const_iterator it = arrays.begin(),
+         ie = arrays.end(); it != ie; ++it)
+    classes.insert(partition->find(*it));
+
+  for (unsigned i = 0, e = constraints.size(); i != e; ++i) {
+    const Array *rep = representatives[i];
+    if (rep && classes.count(partition->find(rep)))
+      result.push_back(constraints[i]);
+  }
+}
+
+void ConstraintManager::getPartitionClasses(
+    std::vector< std::vector< ref<Expr> > > &result) const {
+  assert(tracksPartition && "constraint set has no array partition");
+  std::map<const Array*, unsigned> classIndex;
+  for (unsigned i = 0, e = constraints.size(); i != e; ++i) {
+    const Array *rep = representatives[i];
+    if (!rep)
+      continue;
+    std::pair<std::map<const Array*, unsigned>::iterator, bool> res =
+      classIndex.insert(std::make_pair(partition->find(rep), result.size()));
+    if (res.second)
+      result.push_back(std::vector< ref<Expr> >());
+    result[res.first->second].push_back(constraints[i]);
+  }
+}
+
+/***/
+
+bool ConstraintManager::rewriteConstraints(
+    ExprVisitor &visitor, const std::vector<const Array*> *arrays) {
   ConstraintManager::constraints_ty old;
+  std::vector<const Array*> oldRepresentatives;
   bool changed = false;
 
+  // A constraint can only be affected if it reads one of the arrays, and
+  // so is in the same partition class. Decide up front, as re-adding the
+  // rewritten constraints below can merge classes.
+  std::vector<bool> affected;
+  if (arrays && !arrays->empty() && tracksPartition && !partition.isNull()) {
+    std::set<const Array*> classes;
+    for (unsigned i = 0; i != arrays->size(); ++i)
+      classes.insert(partition->find((*arrays)[i]));
+    affected.reserve(constraints.size());
+    for (unsigned i = 0, ie = constraints.size(); i != ie; ++i)
+      affected.push_back(representatives[i] &&
+                         classes.count(partition->find(representatives[i])));
+  }
+
   constraints.swap(old);
-  for (ConstraintManager::constraints_ty::iterator 
-         it = old.begin(), ie = old.end(); it != ie; ++it) {
-    ref<Expr> &ce = *it;
-    ref<Expr> e = visitor.visit(ce);
+  representatives.swap(oldRepresentatives);
+  for (unsigned i = 0, ie = old.size(); i != ie; ++i) {
+    ref<Expr> &ce = old[i];
+    ref<Expr> e = ce;
+    if (affected.empty() || affected[i])
+      e = visitor.visit(ce);
 
     if (e!=ce) {
+      if (tracksPartition) {
+        if (equalities->refCount > 1)
+          equalities = new EqualityIndex(*equalities);
+        equalities->remove(ce);
+      }
       addConstraintInternal(e); // enable further reductions
       changed = true;
     } else {
+      // Rewriting only ever removes reads, so the classes of the
+      // unchanged constraints are still valid.
       constraints.push_back(ce);
+      if (tracksPartition)
+        representatives.push_back(oldRepresentatives[i]);
     }
   }
 
@@ -104,23 +269,17 @@ ref<Expr> ConstraintManager::simplifyExpr(ref<Expr> e) const {
   if (isa<ConstantExpr>(e))
     return e;
 
+  if (tracksPartition) {
+    if (equalities.isNull())
+      return e;
+    return ExprReplaceVisitor2(equalities->getEqualities()).visit(e);
+  }
+
   std::map< ref<Expr>, ref<Expr> > equalities;
   
   for (ConstraintManager::constraints_ty::const_iterator 
-         it = constraints.begin(), ie = constraints.end(); it != ie; ++it) {
-    if (const EqExpr *ee = dyn_cast<EqExpr>(*it)) {
-      if (isa<ConstantExpr>(ee->left)) {
-        equalities.insert(std::make_pair(ee->right,
-                                         ee->left));
-      } else {
-        equalities.insert(std::make_pair(*it,
-                                         ConstantExpr::alloc(1, Expr::Bool)));
-      }
-    } else {
-      equalities.insert(std::make_pair(*it,
-                                       ConstantExpr::alloc(1, Expr::Bool)));
-    }
-  }
+         it = constraints.begin(), ie = constraints.end(); it != ie; ++it)
+    equalities.insert(getSubstitution(*it));
 
   return ExprReplaceVisitor2(equalities).visit(e);
 }
@@ -144,23 +303,22 @@ void ConstraintManager::addConstraintInternal(ref<Expr> e) {
 
   case Expr::Eq: {
     if (RewriteEqualities) {
-      // XXX: should profile the effects of this and the overhead.
-      // traversing the constraints looking for equalities is hardly the
-      // slowest thing we do, but it is probably nicer to have a
-      // ConstraintSet ADT which efficiently remembers obvious patterns
-      // (byte-constant comparison).
+      // Only constraints reading the arrays of the rewritten expression
+      // can contain it, and the array partition tells which those are.
       BinaryExpr *be = cast<BinaryExpr>(e);
       if (isa<ConstantExpr>(be->left)) {
 	ExprReplaceVisitor visitor(be->right, be->left);
-	rewriteConstraints(visitor);
+        std::vector<const Array*> arrays;
+        findDependentArrays(be->right, arrays);
+	rewriteConstraints(visitor, &arrays);
       }
     }
-    constraints.push_back(e);
+    pushConstraint(e);
     break;
   }
     
   default:
-    constraints.push_back(e);
+    pushConstraint(e);
     break;
   }
 }
@@ -35,7 +35,47 @@ namespace {
 
 /***/
 
-unsigned Expr::count = 0;
+__thread unsigned Expr::count = 0;
+
+/***/
+
+unsigned Expr::internedCount = 0;
+
+namespace {
+  // Canonical expressions by hash. The table holds no references, so that
+  // entries go away with their last user; it is allocated on first use and
+  // never freed, since expressions may outlive static destructors.
+  typedef std::multimap<unsigned, Expr*> InternTable;
+  InternTable *internTable = 0;
+}
+
+ref<Expr> Expr::intern(const ref<Expr> &e) {
+  if (!internTable)
+    internTable = new InternTable();
+
+  std::pair<InternTable::iterator, InternTable::iterator> range =
+    internTable->equal_range(e->hashValue);
+  for (InternTable::iterator it = range.first; it != range.second; ++it)
+    if (it->second == e.get() || it->second->compare(*e) == 0)
+      return it->second;
+
+  internTable->insert(range.second, std::make_pair(e->hashValue, e.get()));
+  ++internedCount;
+  return e;
+}
+
+void Expr::unintern(Expr *e) {
+  // Called from ~Expr, so only the hash and the address may be used.
+  std::pair<InternTable::iterator, InternTable::iterator> range =
+    internTable->equal_range(e->hashValue);
+  for (InternTable::iterator it = range.first; it != range.second; ++it) {
+    if (it->second == e) {
+      internTable->erase(it);
+      --internedCount;
+      return;
+    }
+  }
+}
 
 ref<Expr> Expr::createTempRead(const Array *array, Expr::Width w) {
   UpdateList ul(array, 0);
@@ -540,6 +580,18 @@ ref<Expr> ReadExpr::create(const UpdateList &ul, ref<Expr> index) {
   // a smart UpdateList so it is not worth rescanning.
 
   const UpdateNode *un = ul.head;
+
+  // Constant indices are looked up without building comparisons, using the
+  // snapshots along long sequences.
+  ConstantExpr *CE = dyn_cast<ConstantExpr>(index);
+  if (un && CE && CE->getWidth() <= Expr::Int64) {
+    const UpdateNode *barrier;
+    if (const UpdateNode *write =
+          un->findConstantWrite(CE->getZExtValue(), barrier))
+      return write->value;
+    return ReadExpr::alloc(ul, index);
+  }
+
   for (; un; un=un->next) {
     ref<Expr> cond = EqExpr::create(index, un->index);
     
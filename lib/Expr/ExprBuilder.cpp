@@ -1052,6 +1052,147 @@ namespace {
 
   typedef ConstantSpecializedExprBuilder<SimplifyingBuilder>
     SimplifyingExprBuilder;
+
+  /// HashConsingExprBuilder - An expression builder which returns the
+  /// canonical node for every expression its base builder constructs.
+  class HashConsingExprBuilder : public ExprBuilder {
+    ExprBuilder *Base;
+
+  public:
+    HashConsingExprBuilder(ExprBuilder *_Base) : Base(_Base) {}
+    ~HashConsingExprBuilder() { delete Base; }
+
+    virtual ref<Expr> Constant(const llvm::APInt &Value) {
+      return Expr::intern(Base->Constant(Value));
+    }
+
+    virtual ref<Expr> NotOptimized(const ref<Expr> &Index) {
+      return Expr::intern(Base->NotOptimized(Index));
+    }
+
+    virtual ref<Expr> Read(const UpdateList &Updates,
+                           const ref<Expr> &Index) {
+      return Expr::intern(Base->Read(Updates, Index));
+    }
+
+    virtual ref<Expr> Select(const ref<Expr> &Cond,
+                             const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->Select(Cond, LHS, RHS));
+    }
+
+    virtual ref<Expr> Concat(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->Concat(LHS, RHS));
+    }
+
+    virtual ref<Expr> Extract(const ref<Expr> &LHS,
+                              unsigned Offset, Expr::Width W) {
+      return Expr::intern(Base->Extract(LHS, Offset, W));
+    }
+
+    virtual ref<Expr> ZExt(const ref<Expr> &LHS, Expr::Width W) {
+      return Expr::intern(Base->ZExt(LHS, W));
+    }
+
+    virtual ref<Expr> SExt(const ref<Expr> &LHS, Expr::Width W) {
+      return Expr::intern(Base->SExt(LHS, W));
+    }
+
+    virtual ref<Expr> Not(const ref<Expr> &LHS) {
+      return Expr::intern(Base->Not(LHS));
+    }
+
+    virtual ref<Expr> Add(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->Add(LHS, RHS));
+    }
+
+    virtual ref<Expr> Sub(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->Sub(LHS, RHS));
+    }
+
+    virtual ref<Expr> Mul(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->Mul(LHS, RHS));
+    }
+
+    virtual ref<Expr> UDiv(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->UDiv(LHS, RHS));
+    }
+
+    virtual ref<Expr> SDiv(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->SDiv(LHS, RHS));
+    }
+
+    virtual ref<Expr> URem(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->URem(LHS, RHS));
+    }
+
+    virtual ref<Expr> SRem(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->SRem(LHS, RHS));
+    }
+
+    virtual ref<Expr> And(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->And(LHS, RHS));
+    }
+
+    virtual ref<Expr> Or(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->Or(LHS, RHS));
+    }
+
+    virtual ref<Expr> Xor(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->Xor(LHS, RHS));
+    }
+
+    virtual ref<Expr> Shl(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->Shl(LHS, RHS));
+    }
+
+    virtual ref<Expr> LShr(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->LShr(LHS, RHS));
+    }
+
+    virtual ref<Expr> AShr(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->AShr(LHS, RHS));
+    }
+
+    virtual ref<Expr> Eq(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->Eq(LHS, RHS));
+    }
+
+    virtual ref<Expr> Ne(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->Ne(LHS, RHS));
+    }
+
+    virtual ref<Expr> Ult(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->Ult(LHS, RHS));
+    }
+
+    virtual ref<Expr> Ule(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->Ule(LHS, RHS));
+    }
+
+    virtual ref<Expr> Ugt(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->Ugt(LHS, RHS));
+    }
+
+    virtual ref<Expr> Uge(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->Uge(LHS, RHS));
+    }
+
+    virtual ref<Expr> Slt(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->Slt(LHS, RHS));
+    }
+
+    virtual ref<Expr> Sle(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->Sle(LHS, RHS));
+    }
+
+    virtual ref<Expr> Sgt(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->Sgt(LHS, RHS));
+    }
+
+    virtual ref<Expr> Sge(const ref<Expr> &LHS, const ref<Expr> &RHS) {
+      return Expr::intern(Base->Sge(LHS, RHS));
+    }
+  };
 }
 
 ExprBuilder *klee::createDefaultExprBuilder() {
@@ -1065,3 +1206,7 @@ ExprBuilder *klee::createConstantFoldingExprBuilder(ExprBuilder *Base) {
 ExprBuilder *klee::createSimplifyingExprBuilder(ExprBuilder *Base) {
   return new SimplifyingExprBuilder(Base);
 }
+
+ExprBuilder *klee::createHashConsingExprBuilder(ExprBuilder *Base) {
+  return new HashConsingExprBuilder(Base);
+}
@@ -0,0 +1,96 @@
+//===-- ExprCloner.cpp ----------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/util/ExprCloner.h"
+
+#include "klee/util/ArrayCache.h"
+
+#include <vector>
+
+using namespace klee;
+
+bool ArrayContentLT::operator()(const Array *a, const Array *b) const {
+  if (a->hash() != b->hash())
+    return a->hash() < b->hash();
+  if (a->size != b->size)
+    return a->size < b->size;
+  if (a->domain != b->domain)
+    return a->domain < b->domain;
+  if (a->range != b->range)
+    return a->range < b->range;
+  if (a->name != b->name)
+    return a->name < b->name;
+  if (a->constantValues.size() != b->constantValues.size())
+    return a->constantValues.size() < b->constantValues.size();
+  for (unsigned i = 0; i < a->constantValues.size(); ++i)
+    if (int res = a->constantValues[i]->compareContents(*b->constantValues[i]))
+      return res < 0;
+  return false;
+}
+
+const Array *ExprCloner::clone(const Array *array) {
+  if (array->isSymbolicArray())
+    return array;
+  ArrayCopySet::iterator it = arrays.find(array);
+  if (it != arrays.end())
+    return *it;
+
+  std::vector< ref<ConstantExpr> > values;
+  values.reserve(array->constantValues.size());
+  for (unsigned i = 0; i < array->constantValues.size(); ++i)
+    values.push_back(ConstantExpr::alloc(
+        array->constantValues[i]->getAPValue()));
+  const Array *res = arrayCache.CreateArray(
+      array->name, array->size, &values[0], &values[0] + values.size(),
+      array->domain, array->range);
+  arrays.insert(res);
+  return res;
+}
+
+UpdateList ExprCloner::clone(const UpdateList &ul) {
+  // Find the longest suffix of the list that was already copied.
+  std::vector<const UpdateNode*> chain;
+  std::map<const UpdateNode*, UpdateList>::iterator it = updates.end();
+  for (const UpdateNode *un = ul.head; un; un = un->next) {
+    it = updates.find(un);
+    if (it != updates.end())
+      break;
+    chain.push_back(un);
+  }
+
+  UpdateList res = it != updates.end() ? it->second
+                                       : UpdateList(clone(ul.root), 0);
+  for (std::vector<const UpdateNode*>::reverse_iterator
+         ri = chain.rbegin(), re = chain.rend(); ri != re; ++ri) {
+    res.extend(clone((*ri)->index), clone((*ri)->value));
+    updates.insert(std::make_pair(*ri, res));
+  }
+  return res;
+}
+
+ref<Expr> ExprCloner::clone(const ref<Expr> &e) {
+  if (ConstantExpr *CE = dyn_cast<ConstantExpr>(e))
+    return ConstantExpr::alloc(CE->getAPValue());
+
+  std::map<const Expr*, ref<Expr> >::iterator it = exprs.find(e.get());
+  if (it != exprs.end())
+    return it->second;
+
+  ref<Expr> res;
+  if (ReadExpr *re = dyn_cast<ReadExpr>(e)) {
+    res = ReadExpr::create(clone(re->updates), clone(re->index));
+  } else {
+    ref<Expr> kids[8];
+    for (unsigned i = 0; i < e->getNumKids(); ++i)
+      kids[i] = clone(e->getKid(i));
+    res = e->rebuild(kids);
+  }
+  exprs.insert(std::make_pair(e.get(), res));
+  return res;
+}
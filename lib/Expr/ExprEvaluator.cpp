@@ -13,12 +13,22 @@ using namespace klee;
 
 ExprVisitor::Action ExprEvaluator::evalRead(const UpdateList &ul,
                                             unsigned index) {
-  for (const UpdateNode *un=ul.head; un; un=un->next) {
+  const UpdateNode *un = ul.head;
+  while (un) {
+    // Updates at other constant indices are skipped without visiting them.
+    const UpdateNode *barrier;
+    if (const UpdateNode *write = un->findConstantWrite(index, barrier))
+      return Action::changeTo(visit(write->value));
+    if (!barrier)
+      break;
+    un = barrier;
+
     ref<Expr> ui = visit(un->index);
     
     if (ConstantExpr *CE = dyn_cast<ConstantExpr>(ui)) {
       if (CE->getZExtValue() == index)
         return Action::changeTo(visit(un->value));
+      un = un->next;
     } else {
       // update index is unknown, so may or may not be index, we
       // cannot guarantee value. we can rewrite to read at this
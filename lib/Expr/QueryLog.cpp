@@ -0,0 +1,544 @@
+//===-- QueryLog.cpp ------------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Internal/Support/QueryLog.h"
+
+#include "klee/Constraints.h"
+#include "klee/ExprBuilder.h"
+#include "klee/Solver.h"
+#include "klee/util/ArrayCache.h"
+
+#include "llvm/ADT/APInt.h"
+
+#include <string.h>
+
+using namespace klee;
+
+namespace {
+  const char Magic[] = "KQLB";
+  const unsigned MagicSize = 4;
+  const uint64_t Version = 1;
+
+  enum RecordTag {
+    ExprRecord = 1,
+    UpdateRecord,
+    ArrayRecord,
+    QueryRecord,
+    ResetRecord
+  };
+}
+
+static void writeVarint(std::string &out, uint64_t value) {
+  while (value >= 0x80) {
+    out += (char) ((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  out += (char) value;
+}
+
+static void writeConstant(std::string &out, const ConstantExpr *CE) {
+  Expr::Width width = CE->getWidth();
+  writeVarint(out, width);
+  if (width <= Expr::Int64) {
+    writeVarint(out, CE->getZExtValue());
+  } else {
+    const llvm::APInt &value = CE->getAPValue();
+    const uint64_t *words = value.getRawData();
+    for (unsigned i = 0, e = value.getNumWords(); i != e; ++i)
+      writeVarint(out, words[i]);
+  }
+}
+
+///
+
+QueryLogEntry::QueryLogEntry(const QueryLogEntry &b)
+  : exprs(b.exprs),
+    type(b.type),
+    query(b.query),
+    instruction(b.instruction),
+    objects(b.objects) {
+}
+
+QueryLogEntry::QueryLogEntry(const Query &_query,
+                             Type _type,
+                             const std::vector<const Array*> *_objects)
+  : exprs(_query.constraints.begin(), _query.constraints.end()),
+    type(_type),
+    query(_query.expr),
+    instruction(0) {
+  if (_objects)
+    objects = *_objects;
+}
+
+///
+
+void QueryLogWriter::writeHeader(std::string &out) {
+  out.append(Magic, MagicSize);
+  writeVarint(out, Version);
+}
+
+unsigned QueryLogWriter::writeArray(std::string &out, const Array *array) {
+  std::map<const Array*, unsigned>::iterator it = arrayIds.find(array);
+  if (it != arrayIds.end())
+    return it->second;
+
+  out += (char) ArrayRecord;
+  writeVarint(out, array->name.size());
+  out += array->name;
+  writeVarint(out, array->size);
+  writeVarint(out, array->getDomain());
+  writeVarint(out, array->getRange());
+  writeVarint(out, array->constantValues.size());
+  for (unsigned i = 0, e = array->constantValues.size(); i != e; ++i)
+    writeConstant(out, array->constantValues[i].get());
+
+  unsigned id = arrayIds.size() + 1;
+  arrayIds.insert(std::make_pair(array, id));
+  return id;
+}
+
+unsigned QueryLogWriter::writeUpdates(std::string &out,
+                                      const UpdateNode *head) {
+  // Update lists can be long, so find the written prefix iteratively and
+  // define the remaining nodes oldest first.
+  std::vector<const UpdateNode*> pending;
+  unsigned next = 0;
+  for (const UpdateNode *un = head; un; un = un->next) {
+    std::map<const UpdateNode*, unsigned>::iterator it = updateIds.find(un);
+    if (it != updateIds.end()) {
+      next = it->second;
+      break;
+    }
+    pending.push_back(un);
+  }
+
+  for (std::vector<const UpdateNode*>::reverse_iterator
+         it = pending.rbegin(), ie = pending.rend(); it != ie; ++it) {
+    unsigned index = writeExpr(out, (*it)->index);
+    unsigned value = writeExpr(out, (*it)->value);
+    out += (char) UpdateRecord;
+    writeVarint(out, next);
+    writeVarint(out, index);
+    writeVarint(out, value);
+    next = updateIds.size() + 1;
+    updateIds.insert(std::make_pair(*it, next));
+  }
+  return next;
+}
+
+unsigned QueryLogWriter::writeExpr(std::string &out, const ref<Expr> &e) {
+  ExprHashMap<unsigned>::iterator it = exprIds.find(e);
+  if (it != exprIds.end())
+    return it->second;
+
+  // Define the operands first.
+  std::vector<uint64_t> operands;
+  switch (e->getKind()) {
+  case Expr::Constant:
+    break;
+
+  case Expr::Read: {
+    ReadExpr *re = cast<ReadExpr>(e);
+    operands.push_back(writeArray(out, re->updates.root));
+    operands.push_back(writeUpdates(out, re->updates.head));
+    operands.push_back(writeExpr(out, re->index));
+    break;
+  }
+
+  case Expr::Extract: {
+    ExtractExpr *ee = cast<ExtractExpr>(e);
+    operands.push_back(writeExpr(out, ee->expr));
+    operands.push_back(ee->offset);
+    operands.push_back(ee->width);
+    break;
+  }
+
+  case Expr::ZExt:
+  case Expr::SExt:
+    operands.push_back(writeExpr(out, e->getKid(0)));
+    operands.push_back(e->getWidth());
+    break;
+
+  case Expr::Exists: {
+    ExistsExpr *ee = cast<ExistsExpr>(e);
+    operands.push_back(ee->variables.size());
+    for (std::set<const Array*>::const_iterator ai = ee->variables.begin(),
+           ae = ee->variables.end(); ai != ae; ++ai)
+      operands.push_back(writeArray(out, *ai));
+    operands.push_back(writeExpr(out, ee->body));
+    break;
+  }
+
+  default:
+    for (unsigned i = 0, n = e->getNumKids(); i != n; ++i)
+      operands.push_back(writeExpr(out, e->getKid(i)));
+    break;
+  }
+
+  out += (char) ExprRecord;
+  writeVarint(out, e->getKind());
+  if (ConstantExpr *CE = dyn_cast<ConstantExpr>(e))
+    writeConstant(out, CE);
+  for (unsigned i = 0; i != operands.size(); ++i)
+    writeVarint(out, operands[i]);
+
+  unsigned id = exprIds.size() + 1;
+  exprIds.insert(std::make_pair(e, id));
+  return id;
+}
+
+void QueryLogWriter::write(std::string &out, const QueryLogEntry &entry,
+                           const QueryLogResult &result) {
+  if (exprIds.size() + updateIds.size() + arrayIds.size() > maxDefinitions) {
+    out += (char) ResetRecord;
+    exprIds.clear();
+    updateIds.clear();
+    arrayIds.clear();
+  }
+
+  std::vector<unsigned> constraints;
+  constraints.reserve(entry.exprs.size());
+  for (QueryLogEntry::exprs_ty::const_iterator it = entry.exprs.begin(),
+         ie = entry.exprs.end(); it != ie; ++it)
+    constraints.push_back(writeExpr(out, *it));
+  unsigned query = writeExpr(out, entry.query);
+  std::vector<unsigned> objects;
+  objects.reserve(entry.objects.size());
+  for (std::vector<const Array*>::const_iterator it = entry.objects.begin(),
+         ie = entry.objects.end(); it != ie; ++it)
+    objects.push_back(writeArray(out, *it));
+
+  out += (char) QueryRecord;
+  writeVarint(out, entry.type);
+  writeVarint(out, entry.instruction);
+  writeVarint(out, constraints.size());
+  for (unsigned i = 0; i != constraints.size(); ++i)
+    writeVarint(out, constraints[i]);
+  writeVarint(out, query);
+  writeVarint(out, objects.size());
+  for (unsigned i = 0; i != objects.size(); ++i)
+    writeVarint(out, objects[i]);
+  writeVarint(out, result.result);
+  // The time in microseconds, offset by one; zero marks a failed query.
+  writeVarint(out, result.time < 0 ? 0 : (uint64_t) (result.time * 1e6) + 1);
+}
+
+///
+
+QueryLogReader::QueryLogReader(const char *begin, const char *_end,
+                               ExprBuilder *_builder, ArrayCache &_arrayCache)
+  : pos((const unsigned char*) begin),
+    end((const unsigned char*) _end),
+    builder(_builder),
+    arrayCache(_arrayCache) {
+  uint64_t version;
+  if (!isQueryLog(begin, _end)) {
+    fail("missing query log header");
+  } else {
+    pos += MagicSize;
+    if (!readVarint(version) || version != Version)
+      fail("unsupported query log version");
+  }
+}
+
+bool QueryLogReader::isQueryLog(const char *begin, const char *end) {
+  return (size_t) (end - begin) >= MagicSize &&
+         memcmp(begin, Magic, MagicSize) == 0;
+}
+
+bool QueryLogReader::fail(const char *message) {
+  if (error.empty())
+    error = message;
+  pos = end;
+  return false;
+}
+
+bool QueryLogReader::readVarint(uint64_t &value) {
+  value = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    if (pos == end)
+      return fail("truncated query log");
+    unsigned char byte = *pos++;
+    value |= (uint64_t) (byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return fail("malformed integer");
+}
+
+bool QueryLogReader::readExprId(ref<Expr> &e) {
+  uint64_t id;
+  if (!readVarint(id))
+    return false;
+  if (id == 0 || id > exprs.size())
+    return fail("undefined expression");
+  e = exprs[id - 1];
+  return true;
+}
+
+bool QueryLogReader::readArrayId(const Array *&array) {
+  uint64_t id;
+  if (!readVarint(id))
+    return false;
+  if (id == 0 || id > arrays.size())
+    return fail("undefined array");
+  array = arrays[id - 1];
+  return true;
+}
+
+static bool isValidWidth(uint64_t width) {
+  return width != 0 && width <= 0xFFFFFFFF;
+}
+
+bool QueryLogReader::readArray() {
+  uint64_t length, size, domain, range, numConstants;
+  if (!readVarint(length))
+    return false;
+  if ((uint64_t) (end - pos) < length)
+    return fail("truncated query log");
+  std::string name((const char*) pos, length);
+  pos += length;
+  if (!readVarint(size) || !readVarint(domain) || !readVarint(range) ||
+      !readVarint(numConstants))
+    return false;
+  if (!isValidWidth(domain) || !isValidWidth(range) ||
+      (numConstants && numConstants != size))
+    return fail("malformed array");
+
+  std::vector< ref<ConstantExpr> > constants;
+  for (uint64_t i = 0; i != numConstants; ++i) {
+    uint64_t width, value;
+    if (!readVarint(width) || !readVarint(value))
+      return false;
+    if (width != range || width > Expr::Int64)
+      return fail("malformed array");
+    constants.push_back(ConstantExpr::create(value, width));
+  }
+
+  const ref<ConstantExpr> *begin = constants.empty() ? 0 : &constants[0];
+  arrays.push_back(arrayCache.CreateArray(name, size, begin,
+                                          begin + constants.size(),
+                                          domain, range));
+  return true;
+}
+
+bool QueryLogReader::readUpdate() {
+  uint64_t next;
+  ref<Expr> index, value;
+  if (!readVarint(next) || !readExprId(index) || !readExprId(value))
+    return false;
+  if (next > updates.size())
+    return fail("undefined update");
+
+  UpdateList ul(0, next ? updates[next - 1].head : 0);
+  ul.extend(index, value);
+  updates.push_back(ul);
+  return true;
+}
+
+bool QueryLogReader::readExpr() {
+  uint64_t kind;
+  if (!readVarint(kind))
+    return false;
+
+  ref<Expr> result, a, b, c;
+  uint64_t x, y;
+  switch (kind) {
+  case Expr::Constant: {
+    uint64_t width;
+    if (!readVarint(width))
+      return false;
+    if (!isValidWidth(width))
+      return fail("malformed constant");
+    if (width <= Expr::Int64) {
+      if (!readVarint(x))
+        return false;
+      result = builder->Constant(llvm::APInt(width, x));
+    } else {
+      std::vector<uint64_t> words((width + 63) / 64);
+      for (unsigned i = 0; i != words.size(); ++i)
+        if (!readVarint(words[i]))
+          return false;
+      result = builder->Constant(llvm::APInt(width, words));
+    }
+    break;
+  }
+
+  case Expr::Read: {
+    const Array *array;
+    if (!readArrayId(array) || !readVarint(x) || !readExprId(a))
+      return false;
+    if (x > updates.size())
+      return fail("undefined update");
+    if (a->getWidth() != array->getDomain())
+      return fail("type mismatch");
+    result = builder->Read(UpdateList(array, x ? updates[x - 1].head : 0), a);
+    break;
+  }
+
+  case Expr::Extract:
+    if (!readExprId(a) || !readVarint(x) || !readVarint(y))
+      return false;
+    if (!isValidWidth(y) || x + y > a->getWidth())
+      return fail("malformed extract");
+    result = builder->Extract(a, x, y);
+    break;
+
+  case Expr::ZExt:
+  case Expr::SExt:
+    if (!readExprId(a) || !readVarint(x))
+      return false;
+    if (!isValidWidth(x))
+      return fail("malformed cast");
+    result = kind == Expr::ZExt ? builder->ZExt(a, x) : builder->SExt(a, x);
+    break;
+
+  case Expr::Exists: {
+    std::set<const Array*> variables;
+    if (!readVarint(x))
+      return false;
+    for (uint64_t i = 0; i != x; ++i) {
+      const Array *array;
+      if (!readArrayId(array))
+        return false;
+      variables.insert(array);
+    }
+    if (!readExprId(a))
+      return false;
+    result = ExistsExpr::create(variables, a);
+    break;
+  }
+
+  case Expr::NotOptimized:
+  case Expr::Not:
+    if (!readExprId(a))
+      return false;
+    result = kind == Expr::Not ? builder->Not(a) : builder->NotOptimized(a);
+    break;
+
+  case Expr::Select:
+    if (!readExprId(a) || !readExprId(b) || !readExprId(c))
+      return false;
+    if (a->getWidth() != Expr::Bool || b->getWidth() != c->getWidth())
+      return fail("type mismatch");
+    result = builder->Select(a, b, c);
+    break;
+
+  case Expr::Concat:
+    if (!readExprId(a) || !readExprId(b))
+      return false;
+    result = builder->Concat(a, b);
+    break;
+
+  default:
+    if (kind < Expr::BinaryKindFirst || kind > Expr::BinaryKindLast)
+      return fail("unknown expression kind");
+    if (!readExprId(a) || !readExprId(b))
+      return false;
+    if (a->getWidth() != b->getWidth())
+      return fail("type mismatch");
+
+    switch (kind) {
+    case Expr::Add:  result = builder->Add(a, b); break;
+    case Expr::Sub:  result = builder->Sub(a, b); break;
+    case Expr::Mul:  result = builder->Mul(a, b); break;
+    case Expr::UDiv: result = builder->UDiv(a, b); break;
+    case Expr::SDiv: result = builder->SDiv(a, b); break;
+    case Expr::URem: result = builder->URem(a, b); break;
+    case Expr::SRem: result = builder->SRem(a, b); break;
+    case Expr::And:  result = builder->And(a, b); break;
+    case Expr::Or:   result = builder->Or(a, b); break;
+    case Expr::Xor:  result = builder->Xor(a, b); break;
+    case Expr::Shl:  result = builder->Shl(a, b); break;
+    case Expr::LShr: result = builder->LShr(a, b); break;
+    case Expr::AShr: result = builder->AShr(a, b); break;
+    case Expr::Eq:   result = builder->Eq(a, b); break;
+    case Expr::Ne:   result = builder->Ne(a, b); break;
+    case Expr::Ult:  result = builder->Ult(a, b); break;
+    case Expr::Ule:  result = builder->Ule(a, b); break;
+    case Expr::Ugt:  result = builder->Ugt(a, b); break;
+    case Expr::Uge:  result = builder->Uge(a, b); break;
+    case Expr::Slt:  result = builder->Slt(a, b); break;
+    case Expr::Sle:  result = builder->Sle(a, b); break;
+    case Expr::Sgt:  result = builder->Sgt(a, b); break;
+    case Expr::Sge:  result = builder->Sge(a, b); break;
+    default:
+      return fail("unknown expression kind");
+    }
+    break;
+  }
+
+  exprs.push_back(result);
+  return true;
+}
+
+bool QueryLogReader::read(QueryLogEntry &entry, QueryLogResult &result) {
+  while (pos != end) {
+    unsigned char tag = *pos++;
+    switch (tag) {
+    case ExprRecord:
+      if (!readExpr())
+        return false;
+      break;
+
+    case UpdateRecord:
+      if (!readUpdate())
+        return false;
+      break;
+
+    case ArrayRecord:
+      if (!readArray())
+        return false;
+      break;
+
+    case ResetRecord:
+      exprs.clear();
+      updates.clear();
+      arrays.clear();
+      break;
+
+    case QueryRecord: {
+      uint64_t type, instruction, count, value, time;
+      if (!readVarint(type) || !readVarint(instruction) || !readVarint(count))
+        return false;
+      if (type > QueryLogEntry::Cex)
+        return fail("unknown query type");
+      entry.type = (QueryLogEntry::Type) type;
+      entry.instruction = instruction;
+
+      entry.exprs.clear();
+      for (uint64_t i = 0; i != count; ++i) {
+        ref<Expr> e;
+        if (!readExprId(e))
+          return false;
+        entry.exprs.push_back(e);
+      }
+      if (!readExprId(entry.query) || !readVarint(count))
+        return false;
+
+      entry.objects.clear();
+      for (uint64_t i = 0; i != count; ++i) {
+        const Array *array;
+        if (!readArrayId(array))
+          return false;
+        entry.objects.push_back(array);
+      }
+
+      if (!readVarint(value) || !readVarint(time))
+        return false;
+      result = QueryLogResult(time != 0, value, (time - 1) / 1e6);
+      return true;
+    }
+
+    default:
+      return fail("unknown record");
+    }
+  }
+  return false;
+}
@@ -9,19 +9,59 @@
 
 #include "klee/Expr.h"
 
+#include <algorithm>
 #include <cassert>
 
 using namespace klee;
 
 ///
 
+namespace {
+  struct EntryLess {
+    bool operator()(const UpdateSnapshot::entries_ty::value_type &a,
+                    const UpdateSnapshot::entries_ty::value_type &b) const {
+      return a.first < b.first;
+    }
+  };
+
+  struct EntryIndexLess {
+    bool operator()(const UpdateSnapshot::entries_ty::value_type &a,
+                    uint64_t b) const {
+      return a.first < b;
+    }
+  };
+}
+
+const UpdateNode *UpdateSnapshot::lookup(uint64_t index) const {
+  entries_ty::const_iterator it =
+    std::lower_bound(entries.begin(), entries.end(), index, EntryIndexLess());
+  if (it != entries.end() && it->first == index)
+    return it->second;
+  return 0;
+}
+
+///
+
+const unsigned UpdateNode::SnapshotInterval;
+
+/// Return the value of \a e if it is a constant index which fits in 64 bits.
+static bool getConstantIndex(const ref<Expr> &e, uint64_t &index) {
+  ConstantExpr *CE = dyn_cast<ConstantExpr>(e);
+  if (!CE || CE->getWidth() > Expr::Int64)
+    return false;
+  index = CE->getZExtValue();
+  return true;
+}
+
 UpdateNode::UpdateNode(const UpdateNode *_next, 
                        const ref<Expr> &_index, 
                        const ref<Expr> &_value) 
   : refCount(0),    
     next(_next),
     index(_index),
-    value(_value) {
+    value(_value),
+    snapshot(0),
+    snapshotBase(0) {
   // FIXME: What we need to check here instead is that _value is of the same width 
   // as the range of the array that the update node is part of.
   /*
@@ -34,6 +74,94 @@ UpdateNode::UpdateNode(const UpdateNode *_next,
     size = 1 + next->size;
   }
   else size = 1;
+
+  if (next) {
+    uint64_t unused;
+    if (next->snapshot || !getConstantIndex(next->index, unused))
+      snapshotBase = next;
+    else
+      snapshotBase = next->snapshotBase;
+  }
+  buildSnapshot();
+}
+
+void UpdateNode::buildSnapshot() {
+  uint64_t idx;
+  if (!getConstantIndex(index, idx))
+    return;
+
+  const UpdateSnapshot *base = snapshotBase ? snapshotBase->snapshot : 0;
+  unsigned distance = size - (snapshotBase ? snapshotBase->size : 0);
+  unsigned interval = SnapshotInterval;
+  if (base)
+    interval = std::max(interval, (unsigned) base->entries.size() / 4);
+  if (distance < interval)
+    return;
+
+  // Collect the segment down to the base, most recent write first; a stable
+  // sort then leaves the most recent write of each index at the front of its
+  // run.
+  UpdateSnapshot::entries_ty writes;
+  for (const UpdateNode *un = this; un != snapshotBase; un = un->next) {
+    bool isConstant = getConstantIndex(un->index, idx);
+    assert(isConstant && "non-constant update within a snapshot segment");
+    (void) isConstant;
+    writes.push_back(std::make_pair(idx, un));
+  }
+  std::stable_sort(writes.begin(), writes.end(), EntryLess());
+
+  snapshot = new UpdateSnapshot();
+  snapshot->tail = base ? base->tail : snapshotBase;
+  UpdateSnapshot::entries_ty &entries = snapshot->entries;
+  entries.reserve(writes.size() + (base ? base->entries.size() : 0));
+
+  // Merge with the base, preferring the newer writes.
+  UpdateSnapshot::entries_ty::const_iterator it = writes.begin(),
+    ie = writes.end();
+  UpdateSnapshot::entries_ty::const_iterator bit, bie;
+  if (base) {
+    bit = base->entries.begin();
+    bie = base->entries.end();
+  } else {
+    bit = bie = writes.end();
+  }
+  while (it != ie || bit != bie) {
+    if (bit == bie || (it != ie && it->first <= bit->first)) {
+      if (bit != bie && it->first == bit->first)
+        ++bit;
+      entries.push_back(*it);
+      uint64_t written = it->first;
+      while (it != ie && it->first == written)
+        ++it;
+    } else {
+      entries.push_back(*bit++);
+    }
+  }
+
+  // Later snapshots are built from this one instead.
+  snapshotBase = this;
+}
+
+const UpdateNode *UpdateNode::findConstantWrite(uint64_t index,
+                                                const UpdateNode *&barrier)
+  const {
+  for (const UpdateNode *un = this; un; un = un->next) {
+    if (un->snapshot) {
+      if (const UpdateNode *res = un->snapshot->lookup(index))
+        return res;
+      barrier = un->snapshot->tail;
+      return 0;
+    }
+    uint64_t idx;
+    if (!getConstantIndex(un->index, idx)) {
+      barrier = un;
+      return 0;
+    }
+    if (idx == index)
+      return un;
+  }
+  barrier = 0;
+  return 0;
 }
 
 extern "C" void vc_DeleteExpr(void*);
@@ -44,6 +172,7 @@ extern "C" void vc_DeleteExpr(void*);
 // non-recursively.
 UpdateNode::~UpdateNode() {
     assert(refCount == 0 && "Deleted UpdateNode when a reference is still held");
+    delete snapshot;
 }
 
 int UpdateNode::compare(const UpdateNode &b) const {
@@ -43,10 +43,13 @@
 
 #if LLVM_VERSION_CODE < LLVM_VERSION(3, 5)
 #include "llvm/Support/CallSite.h"
+#include "llvm/Support/CFG.h"
 #else
 #include "llvm/IR/CallSite.h"
+#include "llvm/IR/CFG.h"
 #endif
 
+#include "llvm/Analysis/PostDominators.h"
 #include "llvm/PassManager.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
@@ -491,6 +494,51 @@ unsigned KModule::getConstantID(Constant *c, KInstruction* ki) {
   return id;
 }
 
+void KModule::computeMergePoints(unsigned maxRegionSize) {
+  for (std::vector<KFunction*>::iterator it = functions.begin(),
+         ie = functions.end(); it != ie; ++it) {
+    KFunction *kf = *it;
+    PostDominatorTree pdt;
+    pdt.runOnFunction(*kf->function);
+
+    for (llvm::Function::iterator bbit = kf->function->begin(),
+           bbie = kf->function->end(); bbit != bbie; ++bbit) {
+      BasicBlock *bb = bbit;
+      BranchInst *bi = dyn_cast<BranchInst>(bb->getTerminator());
+      if (!bi || !bi->isConditional())
+        continue;
+
+      // Branches where one side never returns, or which join only at the
+      // virtual exit of a function with several returns, have no join block.
+      DomTreeNode *node = pdt.getNode(bb);
+      if (!node || !node->getIDom() || !node->getIDom()->getBlock())
+        continue;
+      BasicBlock *join = node->getIDom()->getBlock();
+
+      // Walk the blocks between the branch and the join block. Merging
+      // after a loop through the branch would join different iterations.
+      std::set<BasicBlock*> region;
+      std::vector<BasicBlock*> worklist(succ_begin(bb), succ_end(bb));
+      unsigned size = 0;
+      bool small = true;
+      while (small && !worklist.empty()) {
+        BasicBlock *b = worklist.back();
+        worklist.pop_back();
+        if (b == join || !region.insert(b).second)
+          continue;
+        size += b->size();
+        if (b == bb || size > maxRegionSize)
+          small = false;
+        else
+          worklist.insert(worklist.end(), succ_begin(b), succ_end(b));
+      }
+
+      if (small)
+        kf->mergePoints[bb] = join->getFirstNonPHI();
+    }
+  }
+}
+
 /***/
 
 KConstant::KConstant(llvm::Constant* _ct, unsigned _id, KInstruction* _ki) {
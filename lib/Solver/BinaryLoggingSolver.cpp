@@ -0,0 +1,168 @@
+//===-- BinaryLoggingSolver.cpp -------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Solver.h"
+#include "klee/SolverImpl.h"
+#include "klee/Statistics.h"
+#include "klee/Internal/Support/ErrorHandling.h"
+#include "klee/Internal/Support/QueryLog.h"
+#include "klee/Internal/System/Thread.h"
+#include "klee/Internal/System/Time.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+using namespace klee;
+using namespace klee::util;
+
+namespace {
+  /// Writes one chunk of the log on the writer thread.
+  class WriteChunk : public WorkerPool::Task {
+    FILE *file;
+    std::string data;
+
+  public:
+    WriteChunk(FILE *_file, std::string &_data) : file(_file) {
+      data.swap(_data);
+    }
+
+    void run(unsigned worker) {
+      if (fwrite(data.data(), 1, data.size(), file) != data.size())
+        klee_warning("error writing binary query log: %s", strerror(errno));
+      delete this;
+    }
+  };
+}
+
+/// BinaryLoggingSolver - Logs every query and its result in the binary
+/// query log format (see QueryLogWriter).
+///
+/// Queries are encoded on the calling thread, where their expressions may
+/// be used, into a buffer which is written out by a background thread once
+/// it is large enough.
+///
+/// The logged results are: whether the query is valid for truth queries,
+/// the validity plus one for validity queries, the value (if it fits in 64
+/// bits) for value queries, and whether a solution exists for initial
+/// value queries.
+class BinaryLoggingSolver : public SolverImpl {
+  static const size_t ChunkSize = 1 << 20;
+  static const unsigned MaxPendingChunks = 16;
+
+  Solver *solver;
+  FILE *file;
+  WorkerPool writerThread;
+  QueryLogWriter writer;
+  std::string buffer;
+  double startTime;
+
+  void startQuery() { startTime = getWallTime(); }
+
+  void finishQuery(const Query &query, QueryLogEntry::Type type,
+                   bool success, uint64_t result,
+                   const std::vector<const Array*> *objects = 0) {
+    QueryLogResult logResult(success, result, getWallTime() - startTime);
+    QueryLogEntry entry(query, type, objects);
+    Statistic *S = theStatisticManager->getStatisticByName("Instructions");
+    entry.instruction = S ? S->getValue() : 0;
+
+    writer.write(buffer, entry, logResult);
+    if (buffer.size() >= ChunkSize)
+      flush();
+  }
+
+  void flush() {
+    if (buffer.empty())
+      return;
+    // Bound the memory held by chunks waiting for the disk.
+    writerThread.wait(MaxPendingChunks);
+    writerThread.enqueue(new WriteChunk(file, buffer));
+    buffer.clear();
+  }
+
+public:
+  BinaryLoggingSolver(Solver *_solver, std::string path)
+    : solver(_solver), file(fopen(path.c_str(), "wb")), writerThread(1),
+      startTime(0) {
+    if (!file)
+      klee_error("Could not open file %s : %s", path.c_str(),
+                 strerror(errno));
+    QueryLogWriter::writeHeader(buffer);
+  }
+
+  ~BinaryLoggingSolver() {
+    flush();
+    writerThread.wait();
+    fclose(file);
+    delete solver;
+  }
+
+  bool computeTruth(const Query &query, bool &isValid) {
+    startQuery();
+    bool success = solver->impl->computeTruth(query, isValid);
+    finishQuery(query, QueryLogEntry::Truth, success, success && isValid);
+    return success;
+  }
+
+  bool computeValidity(const Query &query, Solver::Validity &result) {
+    startQuery();
+    bool success = solver->impl->computeValidity(query, result);
+    finishQuery(query, QueryLogEntry::Validity, success,
+                success ? result + 1 : 0);
+    return success;
+  }
+
+  bool computeValue(const Query &query, ref<Expr> &result) {
+    startQuery();
+    bool success = solver->impl->computeValue(query, result);
+    uint64_t value = 0;
+    if (success)
+      if (ConstantExpr *CE = dyn_cast<ConstantExpr>(result))
+        if (CE->getWidth() <= Expr::Int64)
+          value = CE->getZExtValue();
+    finishQuery(query, QueryLogEntry::Value, success, value);
+    return success;
+  }
+
+  bool computeInitialValues(const Query &query,
+                            const std::vector<const Array*> &objects,
+                            std::vector< std::vector<unsigned char> > &values,
+                            bool &hasSolution) {
+    startQuery();
+    bool success = solver->impl->computeInitialValues(query, objects, values,
+                                                      hasSolution);
+    finishQuery(query, QueryLogEntry::Cex, success, success && hasSolution,
+                &objects);
+    return success;
+  }
+
+  SolverRunStatus getOperationStatusCode() {
+    return solver->impl->getOperationStatusCode();
+  }
+
+  char *getConstraintLog(const Query &query) {
+    return solver->impl->getConstraintLog(query);
+  }
+
+  void setCoreSolverTimeout(double timeout) {
+    solver->impl->setCoreSolverTimeout(timeout);
+  }
+
+  std::vector< ref<Expr> > &getUnsatCore() { return solver->getUnsatCore(); }
+};
+
+const size_t BinaryLoggingSolver::ChunkSize;
+const unsigned BinaryLoggingSolver::MaxPendingChunks;
+
+///
+
+Solver *klee::createBinaryLoggingSolver(Solver *_solver, std::string path) {
+  return new Solver(new BinaryLoggingSolver(_solver, path));
+}
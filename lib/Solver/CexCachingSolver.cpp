@@ -14,9 +14,10 @@
 #include "klee/SolverImpl.h"
 #include "klee/TimerStatIncrementer.h"
 #include "klee/util/Assignment.h"
+#include "klee/util/BatchEvaluator.h"
 #include "klee/util/ExprUtil.h"
 #include "klee/util/ExprVisitor.h"
-#include "klee/Internal/ADT/MapOfSets.h"
+#include "klee/Internal/ADT/SetTrie.h"
 
 #include "klee/SolverStats.h"
 
@@ -24,6 +25,8 @@
 
 #include "llvm/Support/CommandLine.h"
 
+#include <list>
+
 using namespace klee;
 using namespace llvm;
 
@@ -44,29 +47,89 @@ namespace {
   cl::opt<bool>
   CexCacheExperimental("cex-cache-exp", cl::init(false));
 
+  cl::opt<unsigned>
+  CexCacheMaxCandidates("cex-cache-max-candidates",
+                        cl::desc("Maximum number of cache nodes visited by a "
+                                 "subset or superset search, and of "
+                                 "assignments tried by --cex-cache-try-all, "
+                                 "per query (0=no limit, default)"),
+                        cl::init(0));
+
+  cl::opt<unsigned>
+  CexCacheMaxMemory("cex-cache-max-memory",
+                    cl::desc("Approximate limit in MB on the memory used by "
+                             "the counterexample cache, past which the least "
+                             "recently used entries are evicted (0=no limit, "
+                             "default)"),
+                    cl::init(0));
+
 }
 
 ///
 
-typedef std::set< ref<Expr> > KeyType;
+/// ExprHashLess - Orders expressions by hash, falling back to a structural
+/// comparison only on collisions.
+struct ExprHashLess {
+  bool operator()(const ref<Expr> &a, const ref<Expr> &b) const {
+    unsigned ha = a->hash(), hb = b->hash();
+    if (ha != hb)
+      return ha < hb;
+    return a < b;
+  }
+};
+
+typedef std::set< ref<Expr>, ExprHashLess > KeyType;
 
 struct AssignmentLessThan {
-  bool operator()(const Assignment *a, const Assignment *b) {
+  bool operator()(const Assignment *a, const Assignment *b) const {
     return a->bindings < b->bindings;
   }
 };
 
+/// CacheEntry - The cached result for one set of constraints: either a
+/// satisfying assignment, or null and the unsatisfiability core.
+struct CacheEntry;
+typedef SetTrie<ref<Expr>, CacheEntry*, ExprHashLess> CacheTrie;
+
+struct CacheEntry {
+  Assignment *assignment;
+  std::vector< ref<Expr> > unsatCore;
+  CacheTrie::Node *node;
+  std::list<CacheEntry*>::iterator lruPosition;
+};
 
 class CexCachingSolver : public SolverImpl {
-  typedef std::set<Assignment*, AssignmentLessThan> assignmentsTable_ty;
+  // Distinct assignments, shared between entries, and their use counts.
+  typedef std::map<Assignment*, unsigned, AssignmentLessThan>
+    assignmentsTable_ty;
 
   Solver *solver;
   
-  MapOfSets<ref<Expr>, AssignmentCacheWrapper*> cache;
+  CacheTrie cache;
+  // cache entries, most recently used first
+  std::list<CacheEntry*> lru;
   // memo table
   assignmentsTable_ty assignmentsTable;
+  // approximate memory used by entries and assignments, excluding trie nodes
+  size_t cacheBytes;
   std::vector<ref<Expr> > unsatCore;
 
+  void touch(CacheEntry *entry) {
+    lru.splice(lru.begin(), lru, entry->lruPosition);
+  }
+
+  void useEntry(CacheEntry *entry, Assignment *&result) {
+    touch(entry);
+    result = entry->assignment;
+    unsatCore = entry->unsatCore;
+  }
+
+  void insertEntry(const KeyType &key, Assignment *binding);
+
+  void evictEntry(CacheEntry *entry);
+
+  size_t getMemoryUsage() const;
+
   bool searchForAssignment(KeyType &key, 
                            Assignment *&result);
   
@@ -80,7 +143,7 @@ class CexCachingSolver : public SolverImpl {
   bool getAssignment(const Query& query, Assignment *&result);
   
 public:
-  CexCachingSolver(Solver *_solver) : solver(_solver) {}
+  CexCachingSolver(Solver *_solver) : solver(_solver), cacheBytes(0) {}
   ~CexCachingSolver();
   
   bool computeTruth(const Query&, bool &isValid);
@@ -99,14 +162,14 @@ public:
 ///
 
 struct NullAssignment {
-  bool operator()(AssignmentCacheWrapper *a) const {
-    return !(a->getAssignment());
+  bool operator()(CacheEntry *e) const {
+    return !e->assignment;
   }
 };
 
 struct NonNullAssignment {
-  bool operator()(AssignmentCacheWrapper *a) const {
-    return (a->getAssignment())!=0;
+  bool operator()(CacheEntry *e) const {
+    return e->assignment!=0;
   }
 };
 
@@ -115,12 +178,73 @@ struct NullOrSatisfyingAssignment {
   
   NullOrSatisfyingAssignment(KeyType &_key) : key(_key) {}
 
-  bool operator()(AssignmentCacheWrapper *a) const {
-    return !(a->getAssignment()) ||
-	a->getAssignment()->satisfies(key.begin(), key.end());
+  bool operator()(CacheEntry *e) const {
+    return !e->assignment ||
+	e->assignment->satisfies(key.begin(), key.end());
   }
 };
 
+static size_t getAssignmentSize(const Assignment *a) {
+  size_t size = sizeof(Assignment);
+  for (Assignment::bindings_ty::const_iterator it = a->bindings.begin(),
+         ie = a->bindings.end(); it != ie; ++it)
+    size += 4 * sizeof(void*) + sizeof(it->second) + it->second.size();
+  return size;
+}
+
+/// insertEntry - Cache \a binding, or the current unsatisfiability core if
+/// it is null, as the result for \a key, evicting old entries as needed.
+void CexCachingSolver::insertEntry(const KeyType &key, Assignment *binding) {
+  CacheEntry *entry = new CacheEntry();
+  entry->assignment = binding;
+  if (binding) {
+    std::pair<assignmentsTable_ty::iterator, bool> res =
+      assignmentsTable.insert(std::make_pair(binding, 0));
+    assert(res.first->first == binding && "assignment not memoized");
+    ++res.first->second;
+  } else {
+    entry->unsatCore = unsatCore;
+  }
+
+  if (CacheTrie::Node *n = cache.lookup(key.begin(), key.end()))
+    evictEntry(n->value);
+
+  entry->node = cache.insert(key.begin(), key.end(), entry).first;
+  entry->lruPosition = lru.insert(lru.begin(), entry);
+  cacheBytes += sizeof(CacheEntry) + 3 * sizeof(void*) +
+                entry->unsatCore.size() * sizeof(ref<Expr>);
+
+  if (CexCacheMaxMemory) {
+    size_t limit = (size_t) CexCacheMaxMemory << 20;
+    // Never evict the entry just added, its assignment is about to be used.
+    while (lru.size() > 1 && getMemoryUsage() > limit)
+      evictEntry(lru.back());
+  }
+}
+
+void CexCachingSolver::evictEntry(CacheEntry *entry) {
+  if (Assignment *a = entry->assignment) {
+    assignmentsTable_ty::iterator it = assignmentsTable.find(a);
+    assert(it != assignmentsTable.end() && it->first == a);
+    if (--it->second == 0) {
+      cacheBytes -= getAssignmentSize(a);
+      assignmentsTable.erase(it);
+      delete a;
+    }
+  }
+  cacheBytes -= sizeof(CacheEntry) + 3 * sizeof(void*) +
+                entry->unsatCore.size() * sizeof(ref<Expr>);
+  cache.erase(entry->node);
+  lru.erase(entry->lruPosition);
+  delete entry;
+}
+
+size_t CexCachingSolver::getMemoryUsage() const {
+  // Each trie node is a map node holding a key and a Node.
+  return cacheBytes +
+         cache.nodeCount() * (sizeof(CacheTrie::Node) + 6 * sizeof(void*));
+}
+
 /// searchForAssignment - Look for a cached solution for a query.
 ///
 /// \param key - The query to look up.
@@ -129,51 +253,71 @@ struct NullOrSatisfyingAssignment {
 /// unsatisfiable query).
 /// \return - True if a cached result was found.
 bool CexCachingSolver::searchForAssignment(KeyType &key, Assignment *&result) {
-  AssignmentCacheWrapper * const *lookup = cache.lookup(key);
+  CacheTrie::Node *lookup = cache.lookup(key.begin(), key.end());
 
   if (lookup) {
-    result = (*lookup)->getAssignment();
-    unsatCore = (*lookup)->getCore();
+    useEntry(lookup->value, result);
     return true;
   }
 
   if (CexCacheTryAll) {
     // Look for a satisfying assignment for a superset, which is trivially an
     // assignment for any subset.
-    AssignmentCacheWrapper **lookup = 0;
     if (CexCacheSuperSet)
-      lookup = cache.findSuperset(key, NonNullAssignment());
+      lookup = cache.findSuperset(key.begin(), key.end(), NonNullAssignment(),
+                                  CexCacheMaxCandidates);
 
     // Otherwise, look for a subset which is unsatisfiable, see below.
     if (!lookup) 
-      lookup = cache.findSubset(key, NullAssignment());
+      lookup = cache.findSubset(key.begin(), key.end(), NullAssignment(),
+                                CexCacheMaxCandidates);
 
     // If either lookup succeeded, then we have a cached solution.
     if (lookup) {
-      result = (*lookup)->getAssignment();
-      unsatCore = (*lookup)->getCore();
+      useEntry(lookup->value, result);
       return true;
     }
 
-    // Otherwise, iterate through the set of current assignments to see if one
-    // of them satisfies the query.
-    for (assignmentsTable_ty::iterator it = assignmentsTable.begin(), 
-           ie = assignmentsTable.end(); it != ie; ++it) {
-      Assignment *a = *it;
-      if (a->satisfies(key.begin(), key.end())) {
-        result = a;
-        unsatCore.clear();
-        return true;
-      }
+    // Otherwise, try the assignments of recently used entries to see if one
+    // of them satisfies the query, evaluating the query for all of them at
+    // once where possible.
+    std::set<Assignment*> seen;
+    std::vector<Assignment*> candidates;
+    std::vector<CacheEntry*> candidateEntries;
+    for (std::list<CacheEntry*>::iterator it = lru.begin(), ie = lru.end();
+         it != ie; ++it) {
+      Assignment *a = (*it)->assignment;
+      if (!a || !seen.insert(a).second)
+        continue;
+      candidates.push_back(a);
+      candidateEntries.push_back(*it);
+      if (candidates.size() == CexCacheMaxCandidates)
+        break;
+    }
+
+    unsigned found = 0;
+    BatchEvaluator evaluator(key.begin(), key.end());
+    if (evaluator.isSupported())
+      found = evaluator.findFirstSatisfying(candidates);
+    else
+      while (found != candidates.size() &&
+             !candidates[found]->satisfies(key.begin(), key.end()))
+        ++found;
+
+    if (found != candidates.size()) {
+      touch(candidateEntries[found]);
+      result = candidates[found];
+      unsatCore.clear();
+      return true;
     }
   } else {
     // FIXME: Which order? one is sure to be better.
 
     // Look for a satisfying assignment for a superset, which is trivially an
     // assignment for any subset.
-    AssignmentCacheWrapper **lookup = 0;
     if (CexCacheSuperSet)
-      lookup = cache.findSuperset(key, NonNullAssignment());
+      lookup = cache.findSuperset(key.begin(), key.end(), NonNullAssignment(),
+                                  CexCacheMaxCandidates);
 
     // Otherwise, look for a subset which is unsatisfiable -- if the subset is
     // unsatisfiable then no additional constraints can produce a valid
@@ -181,12 +325,13 @@ bool CexCachingSolver::searchForAssignment(KeyType &key, Assignment *&result) {
     // satisfiable subsets to see if they solve the current query and return
     // them if so. This is cheap and frequently succeeds.
     if (!lookup) 
-      lookup = cache.findSubset(key, NullOrSatisfyingAssignment(key));
+      lookup = cache.findSubset(key.begin(), key.end(),
+                                NullOrSatisfyingAssignment(key),
+                                CexCacheMaxCandidates);
 
     // If either lookup succeeded, then we have a cached solution.
     if (lookup) {
-      result = (*lookup)->getAssignment();
-      unsatCore = (*lookup)->getCore();
+      useEntry(lookup->value, result);
       return true;
     }
   }
@@ -249,17 +394,18 @@ bool CexCachingSolver::getAssignment(const Query& query, Assignment *&result) {
                                           hasSolution))
     return false;
     
-  AssignmentCacheWrapper *bindingWrapper;
   Assignment *binding;
   if (hasSolution) {
     binding = new Assignment(objects, values);
 
     // Memoize the result.
     std::pair<assignmentsTable_ty::iterator, bool>
-      res = assignmentsTable.insert(binding);
+      res = assignmentsTable.insert(std::make_pair(binding, 0));
     if (!res.second) {
       delete binding;
-      binding = *res.first;
+      binding = res.first->first;
+    } else {
+      cacheBytes += getAssignmentSize(binding);
     }
     
     if (DebugCexCacheCheckBinding)
@@ -269,15 +415,13 @@ bool CexCachingSolver::getAssignment(const Query& query, Assignment *&result) {
         klee_error("Generated assignment doesn't match query");
       }
 
-    bindingWrapper = new AssignmentCacheWrapper(binding);
   } else {
     unsatCore = solver->impl->getUnsatCore();
     binding = (Assignment *) 0;
-    bindingWrapper = new AssignmentCacheWrapper(unsatCore);
   }
   
   result = binding;
-  cache.insert(key, bindingWrapper);
+  insertEntry(key, binding);
 
   return true;
 }
@@ -287,9 +431,12 @@ bool CexCachingSolver::getAssignment(const Query& query, Assignment *&result) {
 CexCachingSolver::~CexCachingSolver() {
   cache.clear();
   delete solver;
+  for (std::list<CacheEntry*>::iterator it = lru.begin(), ie = lru.end();
+       it != ie; ++it)
+    delete *it;
   for (assignmentsTable_ty::iterator it = assignmentsTable.begin(), 
          ie = assignmentsTable.end(); it != ie; ++it)
-    delete *it;
+    delete it->first;
 }
 
 bool CexCachingSolver::computeValidity(const Query& query,
@@ -188,6 +188,11 @@ public:
     }
   }
 
+  ValueRange binaryNot(unsigned width) const {
+    uint64_t mask = bits64::maxValueOfNBits(width);
+    return ValueRange(mask - m_max, mask - m_min);
+  }
+
   ValueRange binaryShiftLeft(unsigned bits) const {
     return ValueRange(m_min<<bits, m_max<<bits);
   }
@@ -202,6 +207,38 @@ public:
     return binaryShiftRight(lowBit).binaryAnd(bits64::maxValueOfNBits(maxBit-lowBit));
   }
 
+  ValueRange zext(unsigned width) const { return *this; }
+  ValueRange sext(unsigned srcWidth, unsigned width) const {
+    uint64_t signBit = (uint64_t) 1 << (srcWidth - 1);
+    if (m_max < signBit)
+      return *this;
+    if (m_min >= signBit) {
+      uint64_t ext = bits64::maxValueOfNBits(width) &
+                     ~bits64::maxValueOfNBits(srcWidth);
+      return ValueRange(m_min | ext, m_max | ext);
+    }
+    return ValueRange(0, bits64::maxValueOfNBits(width));
+  }
+
+  ValueRange shl(const ValueRange &b, unsigned width) const {
+    uint64_t mask = bits64::maxValueOfNBits(width);
+    if (b.isFixed() && b.m_min < width && (m_max << b.m_min) <= mask &&
+        ((m_max << b.m_min) >> b.m_min) == m_max)
+      return binaryShiftLeft(b.m_min);
+    return ValueRange(0, mask);
+  }
+  ValueRange lshr(const ValueRange &b, unsigned width) const {
+    if (b.isFixed() && b.m_min < width)
+      return binaryShiftRight(b.m_min);
+    // Shifting right never increases the value.
+    return ValueRange(0, m_max);
+  }
+  ValueRange ashr(const ValueRange &b, unsigned width) const {
+    if (m_max < ((uint64_t) 1 << (width - 1)))
+      return lshr(b, width);
+    return ValueRange(0, bits64::maxValueOfNBits(width));
+  }
+
   ValueRange add(const ValueRange &b, unsigned width) const {
     return ValueRange(0, bits64::maxValueOfNBits(width));
   }
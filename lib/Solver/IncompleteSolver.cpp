@@ -61,7 +61,8 @@ IncompleteSolver::computeValidity(const Query& query) {
 StagedSolverImpl::StagedSolverImpl(IncompleteSolver *_primary, 
                                    Solver *_secondary) 
   : primary(_primary),
-    secondary(_secondary) {
+    secondary(_secondary),
+    usePrimaryCore(false) {
 }
 
 StagedSolverImpl::~StagedSolverImpl() {
@@ -69,11 +70,18 @@ StagedSolverImpl::~StagedSolverImpl() {
   delete secondary;
 }
 
+void StagedSolverImpl::setPrimaryDecided() {
+  usePrimaryCore = primary->getUnsatCore(primaryCore);
+}
+
 bool StagedSolverImpl::computeTruth(const Query& query, bool &isValid) {
+  usePrimaryCore = false;
   IncompleteSolver::PartialValidity trueResult = primary->computeTruth(query); 
   
   if (trueResult != IncompleteSolver::None) {
     isValid = (trueResult == IncompleteSolver::MustBeTrue);
+    if (isValid)
+      setPrimaryDecided();
     return true;
   } 
 
@@ -83,12 +91,15 @@ bool StagedSolverImpl::computeTruth(const Query& query, bool &isValid) {
 bool StagedSolverImpl::computeValidity(const Query& query,
                                        Solver::Validity &result) {
   bool tmp;
+  usePrimaryCore = false;
   switch(primary->computeValidity(query)) {
   case IncompleteSolver::MustBeTrue: 
     result = Solver::True;
+    setPrimaryDecided();
     break;
   case IncompleteSolver::MustBeFalse: 
     result = Solver::False;
+    setPrimaryDecided();
     break;
   case IncompleteSolver::TrueOrFalse: 
     result = Solver::Unknown;
@@ -146,3 +157,9 @@ void StagedSolverImpl::setCoreSolverTimeout(double timeout) {
   secondary->impl->setCoreSolverTimeout(timeout);
 }
 
+std::vector<ref<Expr> > &StagedSolverImpl::getUnsatCore() {
+  if (usePrimaryCore)
+    return primaryCore;
+  return secondary->impl->getUnsatCore();
+}
+
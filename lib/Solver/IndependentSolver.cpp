@@ -14,11 +14,15 @@
 #include "klee/Constraints.h"
 #include "klee/SolverImpl.h"
 #include "klee/Internal/Support/Debug.h"
+#include "klee/Internal/System/Thread.h"
 
+#include "klee/util/ArrayCache.h"
+#include "klee/util/ExprCloner.h"
 #include "klee/util/ExprUtil.h"
 #include "klee/util/Assignment.h"
 
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <map>
 #include <vector>
 #include <ostream>
@@ -256,33 +260,9 @@ inline llvm::raw_ostream &operator<<(llvm::raw_ostream &os,
   return os;
 }
 
-// Breaks down a constraint into all of it's individual pieces, returning a
-// list of IndependentElementSets or the independent factors.
-//
-// Caller takes ownership of returned std::list.
-static std::list<IndependentElementSet>*
-getAllIndependentConstraintsSets(const Query &query) {
-  std::list<IndependentElementSet> *factors = new std::list<IndependentElementSet>();
-  ConstantExpr *CE = dyn_cast<ConstantExpr>(query.expr);
-  if (CE) {
-    assert(CE && CE->isFalse() && "the expr should always be false and "
-                                  "therefore not included in factors");
-  } else {
-    ref<Expr> neg = Expr::createIsZero(query.expr);
-    factors->push_back(IndependentElementSet(neg));
-  }
-
-  for (ConstraintManager::const_iterator it = query.constraints.begin(),
-                                         ie = query.constraints.end();
-       it != ie; ++it) {
-    // iterate through all the previously separated constraints.  Until we
-    // actually return, factors is treated as a queue of expressions to be
-    // evaluated.  If the queue property isn't maintained, then the exprs
-    // could be returned in an order different from how they came it, negatively
-    // affecting later stages.
-    factors->push_back(IndependentElementSet(*it));
-  }
-
+// Repeatedly merges intersecting factors until all factors in the list are
+// pairwise independent. Replaces ``factors`` by a newly allocated list.
+static void mergeIntersectingFactors(std::list<IndependentElementSet> *&factors) {
   bool doneLoop = false;
   do {
     doneLoop = true;
@@ -316,7 +296,72 @@ getAllIndependentConstraintsSets(const Query &query) {
     delete factors;
     factors = done;
   } while (!doneLoop);
+}
+
+// Breaks down a constraint into all of it's individual pieces, returning a
+// list of IndependentElementSets or the independent factors.
+//
+// Caller takes ownership of returned std::list.
+static std::list<IndependentElementSet>*
+getAllIndependentConstraintsSets(const Query &query) {
+  std::list<IndependentElementSet> *factors = new std::list<IndependentElementSet>();
+  ConstantExpr *CE = dyn_cast<ConstantExpr>(query.expr);
+  ref<Expr> neg;
+  if (CE) {
+    assert(CE && CE->isFalse() && "the expr should always be false and "
+                                  "therefore not included in factors");
+  } else {
+    neg = Expr::createIsZero(query.expr);
+  }
+
+  if (query.constraints.hasArrayPartition()) {
+    // Constraints in different classes of the array partition never
+    // intersect, so only refine the factors within each class.
+    std::vector< std::vector< ref<Expr> > > classes;
+    query.constraints.getPartitionClasses(classes);
+    for (unsigned i = 0; i < classes.size(); ++i) {
+      std::list<IndependentElementSet> *classFactors =
+          new std::list<IndependentElementSet>();
+      for (unsigned j = 0; j < classes[i].size(); ++j)
+        classFactors->push_back(IndependentElementSet(classes[i][j]));
+      mergeIntersectingFactors(classFactors);
+      factors->splice(factors->end(), *classFactors);
+      delete classFactors;
+    }
 
+    // The factors are now pairwise independent, so a single pass merging
+    // everything the query expression touches keeps them so.
+    if (!neg.isNull()) {
+      IndependentElementSet current(neg);
+      for (std::list<IndependentElementSet>::iterator it = factors->begin();
+           it != factors->end();) {
+        if (current.intersects(*it)) {
+          current.add(*it);
+          it = factors->erase(it);
+        } else {
+          ++it;
+        }
+      }
+      factors->push_front(current);
+    }
+    return factors;
+  }
+
+  if (!neg.isNull())
+    factors->push_back(IndependentElementSet(neg));
+
+  for (ConstraintManager::const_iterator it = query.constraints.begin(),
+                                         ie = query.constraints.end();
+       it != ie; ++it) {
+    // iterate through all the previously separated constraints.  Until we
+    // actually return, factors is treated as a queue of expressions to be
+    // evaluated.  If the queue property isn't maintained, then the exprs
+    // could be returned in an order different from how they came it, negatively
+    // affecting later stages.
+    factors->push_back(IndependentElementSet(*it));
+  }
+
+  mergeIntersectingFactors(factors);
   return factors;
 }
 
@@ -326,9 +371,21 @@ IndependentElementSet getIndependentConstraints(const Query& query,
   IndependentElementSet eltsClosure(query.expr);
   std::vector< std::pair<ref<Expr>, IndependentElementSet> > worklist;
 
-  for (ConstraintManager::const_iterator it = query.constraints.begin(), 
-         ie = query.constraints.end(); it != ie; ++it)
-    worklist.push_back(std::make_pair(*it, IndependentElementSet(*it)));
+  if (query.constraints.hasArrayPartition()) {
+    // Only constraints in the partition classes of the query's arrays can
+    // join the closure; skip computing element sets for everything else.
+    std::vector<const Array*> arrays;
+    ConstraintManager::findDependentArrays(query.expr, arrays);
+    std::vector< ref<Expr> > candidates;
+    query.constraints.getDependentConstraints(arrays, candidates);
+    for (std::vector< ref<Expr> >::iterator it = candidates.begin(),
+           ie = candidates.end(); it != ie; ++it)
+      worklist.push_back(std::make_pair(*it, IndependentElementSet(*it)));
+  } else {
+    for (ConstraintManager::const_iterator it = query.constraints.begin(),
+           ie = query.constraints.end(); it != ie; ++it)
+      worklist.push_back(std::make_pair(*it, IndependentElementSet(*it)));
+  }
 
   // XXX This should be more efficient (in terms of low level copy stuff).
   bool done = false;
@@ -390,14 +447,111 @@ void calculateArrayReferences(const IndependentElementSet & ie,
   }
 }
 
+namespace {
+/// A factor of a getInitialValues query, together with its answer.
+struct FactorQuery {
+  IndependentElementSet *factor;
+  std::vector<const Array*> arrays;
+  std::vector< std::vector<unsigned char> > values;
+  bool success;
+  bool hasSolution;
+  /// Whether a worker solved the factor, and if so its status afterwards.
+  bool onWorker;
+  SolverImpl::SolverRunStatus status;
+
+  FactorQuery()
+    : factor(0), success(false), hasSolution(false), onWorker(false),
+      status(SolverImpl::SOLVER_RUN_STATUS_FAILURE) {}
+};
+
+/// A worker solver chain, with the copies of the constant arrays its caches
+/// may refer to. Both live as long as the independent solver, and are used
+/// by one batch at a time. The copies are found by content rather than by
+/// the address of the original, which may since have been freed and reused.
+struct FactorWorker {
+  Solver *solver;
+  ArrayCache arrayCache;
+  ArrayCopySet arrays;
+
+  explicit FactorWorker(Solver *_solver) : solver(_solver) {}
+  ~FactorWorker() { delete solver; }
+};
+
+/// A batch of factors solved on a worker thread by a worker solver chain.
+///
+/// The factors are copied with an ExprCloner on the calling thread, as
+/// reference counts are not thread safe.
+class FactorBatch : public WorkerPool::Task {
+  FactorWorker &worker;
+  std::vector<FactorQuery*> queries;
+  std::vector< std::vector< ref<Expr> > > constraints;
+  std::vector< std::vector<const Array*> > arrays;
+
+public:
+  explicit FactorBatch(FactorWorker &_worker) : worker(_worker) {}
+
+  void add(FactorQuery *fq) {
+    queries.push_back(fq);
+  }
+
+  void prepare() {
+    ExprCloner cloner(worker.arrayCache, worker.arrays);
+    constraints.resize(queries.size());
+    arrays.resize(queries.size());
+    for (unsigned i = 0; i < queries.size(); ++i) {
+      const std::vector< ref<Expr> > &exprs = queries[i]->factor->exprs;
+      for (unsigned j = 0; j < exprs.size(); ++j)
+        constraints[i].push_back(cloner.clone(exprs[j]));
+      for (unsigned j = 0; j < queries[i]->arrays.size(); ++j)
+        arrays[i].push_back(cloner.clone(queries[i]->arrays[j]));
+    }
+  }
+
+  void run(unsigned thread) {
+    for (unsigned i = 0; i < queries.size(); ++i) {
+      FactorQuery *fq = queries[i];
+      ConstraintManager tmp(constraints[i]);
+      fq->success = worker.solver->impl->computeInitialValues(
+          Query(tmp, ConstantExpr::alloc(0, Expr::Bool)), arrays[i],
+          fq->values, fq->hasSolution);
+      fq->onWorker = true;
+      fq->status = worker.solver->impl->getOperationStatusCode();
+      if (!fq->success || !fq->hasSolution)
+        break;
+    }
+  }
+};
+}
+
 class IndependentSolver : public SolverImpl {
 private:
   Solver *solver;
 
+  /// Threads solving independent factors of getInitialValues queries in
+  /// parallel, or null if all factors are solved on the calling thread.
+  WorkerPool *pool;
+  std::vector<FactorWorker*> workers;
+
+  /// Whether the last query failed on a worker, and the worker's status.
+  bool workerFailed;
+  SolverRunStatus workerStatus;
+
+  void solveFactors(std::vector<FactorQuery> &factorQueries);
+
 public:
-  IndependentSolver(Solver *_solver) 
-    : solver(_solver) {}
-  ~IndependentSolver() { delete solver; }
+  IndependentSolver(Solver *_solver, const std::vector<Solver*> &workerSolvers)
+    : solver(_solver),
+      pool(workerSolvers.empty() ? 0 : new WorkerPool(workerSolvers.size())),
+      workerFailed(false), workerStatus(SOLVER_RUN_STATUS_SUCCESS_SOLVABLE) {
+    for (unsigned i = 0; i < workerSolvers.size(); ++i)
+      workers.push_back(new FactorWorker(workerSolvers[i]));
+  }
+  ~IndependentSolver() {
+    delete pool;
+    for (unsigned i = 0; i < workers.size(); ++i)
+      delete workers[i];
+    delete solver;
+  }
 
   bool computeTruth(const Query&, bool &isValid);
   bool computeValidity(const Query&, Solver::Validity &result);
@@ -414,6 +568,7 @@ public:
   
 bool IndependentSolver::computeValidity(const Query& query,
                                         Solver::Validity &result) {
+  workerFailed = false;
   std::vector< ref<Expr> > required;
   IndependentElementSet eltsClosure =
     getIndependentConstraints(query, required);
@@ -422,6 +577,7 @@ bool IndependentSolver::computeValidity(const Query& query,
 }
 
 bool IndependentSolver::computeTruth(const Query& query, bool &isValid) {
+  workerFailed = false;
   std::vector< ref<Expr> > required;
   IndependentElementSet eltsClosure = 
     getIndependentConstraints(query, required);
@@ -431,6 +587,7 @@ bool IndependentSolver::computeTruth(const Query& query, bool &isValid) {
 }
 
 bool IndependentSolver::computeValue(const Query& query, ref<Expr> &result) {
+  workerFailed = false;
   std::vector< ref<Expr> > required;
   IndependentElementSet eltsClosure = 
     getIndependentConstraints(query, required);
@@ -475,6 +632,48 @@ bool assertCreatedPointEvaluatesToTrue(
   return cast<ConstantExpr>(q)->isTrue();
 }
 
+// Solves every factor, stopping at the first failure or unsatisfiable
+// factor when solving sequentially.
+void IndependentSolver::solveFactors(std::vector<FactorQuery> &factorQueries) {
+  unsigned numBatches = 0;
+  if (pool && factorQueries.size() > 1)
+    numBatches = std::min<unsigned>(pool->size(), factorQueries.size() - 1);
+
+  // The calling thread keeps the first factors for the regular solver chain
+  // (and its caches); the rest are spread round-robin over the workers.
+  std::vector<FactorBatch*> batches;
+  for (unsigned i = 0; i < numBatches; ++i)
+    batches.push_back(new FactorBatch(*workers[i]));
+  std::vector<FactorQuery*> local;
+  for (unsigned i = 0; i < factorQueries.size(); ++i) {
+    unsigned slot = i % (numBatches + 1);
+    if (slot == 0)
+      local.push_back(&factorQueries[i]);
+    else
+      batches[slot - 1]->add(&factorQueries[i]);
+  }
+  for (unsigned i = 0; i < numBatches; ++i) {
+    batches[i]->prepare();
+    pool->enqueue(batches[i]);
+  }
+
+  for (unsigned i = 0; i < local.size(); ++i) {
+    FactorQuery *fq = local[i];
+    ConstraintManager tmp(fq->factor->exprs);
+    fq->success = solver->impl->computeInitialValues(
+        Query(tmp, ConstantExpr::alloc(0, Expr::Bool)), fq->arrays,
+        fq->values, fq->hasSolution);
+    if (!fq->success || !fq->hasSolution)
+      break;
+  }
+
+  if (numBatches) {
+    pool->wait();
+    for (unsigned i = 0; i < numBatches; ++i)
+      delete batches[i];
+  }
+}
+
 bool IndependentSolver::computeInitialValues(const Query& query,
                                              const std::vector<const Array*> &objects,
                                              std::vector< std::vector<unsigned char> > &values,
@@ -483,25 +682,36 @@ bool IndependentSolver::computeInitialValues(const Query& query,
   // This is important in case we don't have any constraints but
   // we need initial values for requested array objects.
   hasSolution = true;
+  workerFailed = false;
   // FIXME: When we switch to C++11 this should be a std::unique_ptr so we don't need
   // to remember to manually call delete
   std::list<IndependentElementSet> *factors = getAllIndependentConstraintsSets(query);
 
-  //Used to rearrange all of the answers into the correct order
-  std::map<const Array*, std::vector<unsigned char> > retMap;
+  std::vector<FactorQuery> factorQueries;
   for (std::list<IndependentElementSet>::iterator it = factors->begin();
        it != factors->end(); ++it) {
-    std::vector<const Array*> arraysInFactor;
-    calculateArrayReferences(*it, arraysInFactor);
     // Going to use this as the "fresh" expression for the Query() invocation below
     assert(it->exprs.size() >= 1 && "No null/empty factors");
-    if (arraysInFactor.size() == 0){
+    FactorQuery fq;
+    calculateArrayReferences(*it, fq.arrays);
+    if (fq.arrays.size() == 0){
       continue;
     }
-    ConstraintManager tmp(it->exprs);
-    std::vector<std::vector<unsigned char> > tempValues;
-    if (!solver->impl->computeInitialValues(Query(tmp, ConstantExpr::alloc(0, Expr::Bool)),
-                                            arraysInFactor, tempValues, hasSolution)){
+    fq.factor = &*it;
+    factorQueries.push_back(fq);
+  }
+  solveFactors(factorQueries);
+
+  //Used to rearrange all of the answers into the correct order
+  std::map<const Array*, std::vector<unsigned char> > retMap;
+  for (std::vector<FactorQuery>::iterator it = factorQueries.begin();
+       it != factorQueries.end(); ++it) {
+    const std::vector<const Array*> &arraysInFactor = it->arrays;
+    std::vector<std::vector<unsigned char> > &tempValues = it->values;
+    hasSolution = it->hasSolution;
+    if (!it->success){
+      workerFailed = it->onWorker;
+      workerStatus = it->status;
       values.clear();
       delete factors;
       return false;
@@ -520,7 +730,7 @@ bool IndependentSolver::computeInitialValues(const Query& query,
           std::vector<unsigned char> * tempPtr = &retMap[arraysInFactor[i]];
           assert(tempPtr->size() == tempValues[i].size() &&
                  "we're talking about the same array here");
-          ::DenseSet<unsigned> * ds = &(it->elements[arraysInFactor[i]]);
+          ::DenseSet<unsigned> * ds = &(it->factor->elements[arraysInFactor[i]]);
           for (std::set<unsigned>::iterator it2 = ds->begin(); it2 != ds->end(); it2++){
             unsigned index = * it2;
             (* tempPtr)[index] = tempValues[i][index];
@@ -552,6 +762,8 @@ bool IndependentSolver::computeInitialValues(const Query& query,
 }
 
 SolverImpl::SolverRunStatus IndependentSolver::getOperationStatusCode() {
+  if (workerFailed)
+    return workerStatus;
   return solver->impl->getOperationStatusCode();      
 }
 
@@ -561,8 +773,11 @@ char *IndependentSolver::getConstraintLog(const Query& query) {
 
 void IndependentSolver::setCoreSolverTimeout(double timeout) {
   solver->impl->setCoreSolverTimeout(timeout);
+  for (unsigned i = 0; i < workers.size(); ++i)
+    workers[i]->solver->impl->setCoreSolverTimeout(timeout);
 }
 
-Solver *klee::createIndependentSolver(Solver *s) {
-  return new Solver(new IndependentSolver(s));
+Solver *klee::createIndependentSolver(Solver *s,
+                                      const std::vector<Solver*> &workerSolvers) {
+  return new Solver(new IndependentSolver(s, workerSolvers));
 }
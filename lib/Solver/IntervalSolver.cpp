@@ -0,0 +1,746 @@
+//===-- IntervalSolver.cpp ------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Solver.h"
+
+#include "klee/Constraints.h"
+#include "klee/Expr.h"
+#include "klee/IncompleteSolver.h"
+#include "klee/SolverStats.h"
+#include "klee/util/ExprHashMap.h"
+#include "klee/util/ExprRangeEvaluator.h"
+#include "klee/Internal/Support/IntEvaluation.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace klee;
+
+/***/
+
+/// Return the mask of all bits at or below the highest set bit of \a x.
+static uint64_t smearRight(uint64_t x) {
+  x |= x >> 1;
+  x |= x >> 2;
+  x |= x >> 4;
+  x |= x >> 8;
+  x |= x >> 16;
+  x |= x >> 32;
+  return x;
+}
+
+/// Return the mask of the \a n lowest bits.
+static uint64_t lowBits(unsigned n) {
+  return n >= 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << n) - 1;
+}
+
+/// KnownBitsRange - The reduced product of an unsigned interval and a set of
+/// bits known to be zero or one, for values of at most 64 bits.
+///
+/// Values are zero extended to 64 bits, so the bits above the width of an
+/// expression are known to be zero once the range has been normalized.
+class KnownBitsRange {
+private:
+  uint64_t m_min, m_max;
+  uint64_t m_zero, m_one;
+
+  void setEmpty() {
+    m_min = 1;
+    m_max = 0;
+    m_zero = m_one = 0;
+  }
+
+  /// Tighten the interval and the known bits with respect to each other.
+  void normalize() {
+    if (isEmpty())
+      return;
+    if (m_zero & m_one)
+      return setEmpty();
+    m_min = std::max(m_min, m_one);
+    m_max = std::min(m_max, ~m_zero);
+    if (m_min > m_max)
+      return setEmpty();
+    // The common prefix of the bounds is shared by all values in between.
+    uint64_t prefix = ~smearRight(m_min ^ m_max);
+    m_one |= m_min & prefix;
+    m_zero |= ~m_min & prefix;
+    if (m_zero & m_one)
+      setEmpty();
+  }
+
+  KnownBitsRange(uint64_t _min, uint64_t _max, uint64_t _zero, uint64_t _one)
+    : m_min(_min), m_max(_max), m_zero(_zero), m_one(_one) {
+    normalize();
+  }
+
+  /// Return the mask of the low bits known in both \a a and \a b.
+  static uint64_t knownLowBits(const KnownBitsRange &a,
+                               const KnownBitsRange &b) {
+    uint64_t unknown = ~((a.m_zero | a.m_one) & (b.m_zero | b.m_one));
+    return unknown ? (unknown & -unknown) - 1 : ~(uint64_t) 0;
+  }
+
+  static unsigned knownTrailingZeros(const KnownBitsRange &a) {
+    uint64_t notZero = ~a.m_zero;
+    return notZero ? bits64::indexOfRightmostBit(notZero) : 64;
+  }
+
+  static KnownBitsRange full(unsigned width) {
+    return KnownBitsRange(0, bits64::maxValueOfNBits(width));
+  }
+
+public:
+  KnownBitsRange() { setEmpty(); }
+  KnownBitsRange(const ref<ConstantExpr> &ce)
+    : m_min(ce->getZExtValue()), m_max(m_min), m_zero(~m_min), m_one(m_min) {}
+  KnownBitsRange(uint64_t value)
+    : m_min(value), m_max(value), m_zero(~value), m_one(value) {}
+  KnownBitsRange(uint64_t _min, uint64_t _max)
+    : m_min(_min), m_max(_max), m_zero(0), m_one(0) {
+    normalize();
+  }
+
+  /// Return the values of \a width bits in which the bits of \a mask are
+  /// those of \a bits.
+  static KnownBitsRange withBits(unsigned width, uint64_t mask, uint64_t bits) {
+    return KnownBitsRange(0, bits64::maxValueOfNBits(width), mask & ~bits,
+                          mask & bits);
+  }
+
+  bool isEmpty() const { return m_min > m_max; }
+  bool isFixed() const { return m_min == m_max; }
+
+  bool isFullRange(unsigned bits) const {
+    return m_min == 0 && m_max == bits64::maxValueOfNBits(bits);
+  }
+
+  /// Return whether nothing is known about a value of \a bits bits.
+  bool isUnknown(unsigned bits) const {
+    uint64_t mask = bits64::maxValueOfNBits(bits);
+    return isFullRange(bits) && !((m_zero | m_one) & mask);
+  }
+
+  KnownBitsRange set_intersection(const KnownBitsRange &b) const {
+    if (isEmpty() || b.isEmpty())
+      return KnownBitsRange();
+    return KnownBitsRange(std::max(m_min, b.m_min), std::min(m_max, b.m_max),
+                          m_zero | b.m_zero, m_one | b.m_one);
+  }
+  KnownBitsRange set_union(const KnownBitsRange &b) const {
+    if (isEmpty())
+      return b;
+    if (b.isEmpty())
+      return *this;
+    return KnownBitsRange(std::min(m_min, b.m_min), std::max(m_max, b.m_max),
+                          m_zero & b.m_zero, m_one & b.m_one);
+  }
+
+  bool mustEqual(const uint64_t b) const { return isFixed() && m_min == b; }
+  bool mayEqual(const uint64_t b) const {
+    return m_min <= b && b <= m_max && !(b & m_zero) && (b & m_one) == m_one;
+  }
+  bool mustEqual(const KnownBitsRange &b) const {
+    return isFixed() && b.isFixed() && m_min == b.m_min;
+  }
+  bool mayEqual(const KnownBitsRange &b) const {
+    return !set_intersection(b).isEmpty();
+  }
+
+  uint64_t min() const {
+    assert(!isEmpty() && "cannot get minimum of empty range");
+    return m_min;
+  }
+  uint64_t max() const {
+    assert(!isEmpty() && "cannot get maximum of empty range");
+    return m_max;
+  }
+
+  int64_t minSigned(unsigned bits) const {
+    uint64_t smallest = ((uint64_t) 1 << (bits - 1));
+    if (m_max >= smallest && m_min < smallest)
+      return ints::sext(smallest, 64, bits);
+    return ints::sext(m_min, 64, bits);
+  }
+  int64_t maxSigned(unsigned bits) const {
+    uint64_t smallest = ((uint64_t) 1 << (bits - 1));
+    if (m_min < smallest && m_max >= smallest)
+      return smallest - 1;
+    return ints::sext(m_max, 64, bits);
+  }
+
+  KnownBitsRange binaryAnd(const KnownBitsRange &b) const {
+    return KnownBitsRange(0, std::min(m_max, b.m_max), m_zero | b.m_zero,
+                          m_one & b.m_one);
+  }
+  KnownBitsRange binaryOr(const KnownBitsRange &b) const {
+    return KnownBitsRange(std::max(m_min, b.m_min), ~(uint64_t) 0,
+                          m_zero & b.m_zero, m_one | b.m_one);
+  }
+  KnownBitsRange binaryXor(const KnownBitsRange &b) const {
+    return KnownBitsRange(0, ~(uint64_t) 0,
+                          (m_zero & b.m_zero) | (m_one & b.m_one),
+                          (m_zero & b.m_one) | (m_one & b.m_zero));
+  }
+  KnownBitsRange binaryNot(unsigned width) const {
+    uint64_t mask = bits64::maxValueOfNBits(width);
+    return KnownBitsRange(mask - m_max, mask - m_min, (m_one & mask) | ~mask,
+                          m_zero & mask);
+  }
+
+  KnownBitsRange concat(const KnownBitsRange &b, unsigned bits) const {
+    assert(bits < 64 && "concatenation wider than 64 bits");
+    return KnownBitsRange((m_min << bits) | b.m_min, (m_max << bits) | b.m_max,
+                          (m_zero << bits) | (b.m_zero & lowBits(bits)),
+                          (m_one << bits) | b.m_one);
+  }
+  KnownBitsRange extract(uint64_t lowBit, uint64_t maxBit) const {
+    uint64_t mask = bits64::maxValueOfNBits(maxBit - lowBit);
+    uint64_t min = m_min >> lowBit, max = m_max >> lowBit;
+    if (max > mask) {
+      min = 0;
+      max = mask;
+    }
+    return KnownBitsRange(min, max, (m_zero >> lowBit) | ~mask,
+                          (m_one >> lowBit) & mask);
+  }
+  KnownBitsRange zext(unsigned width) const { return *this; }
+  KnownBitsRange sext(unsigned srcWidth, unsigned width) const {
+    uint64_t signBit = (uint64_t) 1 << (srcWidth - 1);
+    uint64_t srcMask = bits64::maxValueOfNBits(srcWidth);
+    uint64_t ext = bits64::maxValueOfNBits(width) & ~srcMask;
+    if (m_max < signBit)
+      return *this;
+    if (m_min >= signBit)
+      return KnownBitsRange(m_min | ext, m_max | ext, m_zero & ~ext,
+                            m_one | ext);
+    return KnownBitsRange(0, bits64::maxValueOfNBits(width),
+                          (m_zero & srcMask) | ~(ext | srcMask),
+                          m_one & srcMask);
+  }
+
+  KnownBitsRange add(const KnownBitsRange &b, unsigned width) const {
+    uint64_t mask = bits64::maxValueOfNBits(width);
+    if (isFixed() && b.isFixed())
+      return KnownBitsRange((m_min + b.m_min) & mask);
+    // The low bits known in both operands are known in the sum.
+    uint64_t low = knownLowBits(*this, b) & mask;
+    uint64_t sum = m_one + b.m_one;
+    uint64_t max = m_max + b.m_max;
+    if (max >= m_max && max <= mask)
+      return KnownBitsRange(m_min + b.m_min, max, ~sum & low, sum & low);
+    return KnownBitsRange(0, mask, (~sum & low) | ~mask, sum & low);
+  }
+  KnownBitsRange sub(const KnownBitsRange &b, unsigned width) const {
+    uint64_t mask = bits64::maxValueOfNBits(width);
+    if (isFixed() && b.isFixed())
+      return KnownBitsRange((m_min - b.m_min) & mask);
+    uint64_t low = knownLowBits(*this, b) & mask;
+    uint64_t diff = m_one - b.m_one;
+    if (m_min >= b.m_max)
+      return KnownBitsRange(m_min - b.m_max, m_max - b.m_min, ~diff & low,
+                            diff & low);
+    // The difference is always negative, so all of it wraps around.
+    if (m_max < b.m_min)
+      return KnownBitsRange((m_min - b.m_max) & mask, (m_max - b.m_min) & mask,
+                            (~diff & low) | ~mask, diff & low);
+    return KnownBitsRange(0, mask, (~diff & low) | ~mask, diff & low);
+  }
+  KnownBitsRange mul(const KnownBitsRange &b, unsigned width) const {
+    uint64_t mask = bits64::maxValueOfNBits(width);
+    if (isFixed() && b.isFixed())
+      return KnownBitsRange((m_min * b.m_min) & mask);
+    if (b.m_max == 0 || m_max <= mask / b.m_max)
+      return KnownBitsRange(m_min * b.m_min, m_max * b.m_max);
+    unsigned zeros = knownTrailingZeros(*this) + knownTrailingZeros(b);
+    return KnownBitsRange(0, mask, lowBits(zeros) | ~mask, 0);
+  }
+  KnownBitsRange udiv(const KnownBitsRange &b, unsigned width) const {
+    if (b.m_min == 0)
+      return full(width);
+    return KnownBitsRange(m_min / b.m_max, m_max / b.m_min);
+  }
+  KnownBitsRange sdiv(const KnownBitsRange &b, unsigned width) const {
+    uint64_t signBit = (uint64_t) 1 << (width - 1);
+    if (m_max < signBit && b.m_max < signBit)
+      return udiv(b, width);
+    return full(width);
+  }
+  KnownBitsRange urem(const KnownBitsRange &b, unsigned width) const {
+    if (b.m_min == 0)
+      return full(width);
+    if (m_max < b.m_min)
+      return *this;
+    // The remainder of a power of two is the low bits.
+    if (b.isFixed() && bits64::isPowerOfTwo(b.m_min))
+      return binaryAnd(KnownBitsRange(b.m_min - 1));
+    return KnownBitsRange(0, std::min(m_max, b.m_max - 1));
+  }
+  KnownBitsRange srem(const KnownBitsRange &b, unsigned width) const {
+    uint64_t signBit = (uint64_t) 1 << (width - 1);
+    if (m_max < signBit && b.m_max < signBit)
+      return urem(b, width);
+    return full(width);
+  }
+
+  KnownBitsRange shl(const KnownBitsRange &b, unsigned width) const {
+    uint64_t mask = bits64::maxValueOfNBits(width);
+    if (!b.isFixed() || b.m_min >= width)
+      return full(width);
+    unsigned shift = b.m_min;
+    uint64_t min = 0, max = mask;
+    if ((m_max << shift) <= mask && ((m_max << shift) >> shift) == m_max) {
+      min = m_min << shift;
+      max = m_max << shift;
+    }
+    return KnownBitsRange(min, max, (m_zero << shift) | lowBits(shift) | ~mask,
+                          (m_one << shift) & mask);
+  }
+  KnownBitsRange lshr(const KnownBitsRange &b, unsigned width) const {
+    uint64_t mask = bits64::maxValueOfNBits(width);
+    if (!b.isFixed() || b.m_min >= width)
+      return KnownBitsRange(0, m_max);
+    unsigned shift = b.m_min;
+    return KnownBitsRange(m_min >> shift, m_max >> shift,
+                          (m_zero >> shift) | ~(mask >> shift),
+                          m_one >> shift);
+  }
+  KnownBitsRange ashr(const KnownBitsRange &b, unsigned width) const {
+    if (m_max < ((uint64_t) 1 << (width - 1)))
+      return lshr(b, width);
+    return full(width);
+  }
+};
+
+/***/
+
+/// The largest number of constant array elements read through a symbolic
+/// index that are looked at individually.
+static const uint64_t MaxConstantReadRange = 1024;
+
+/// IntervalEvaluator - Evaluates expressions over the ranges implied by a
+/// set of constraints.
+///
+/// The constraints are turned into facts about the range of terms: bounds
+/// against constants, (dis)equalities with constants and masked equalities
+/// imply a range (or known bits) for the term they compare, and any
+/// constraint is known to be true itself. Every evaluated term is refined by
+/// its facts; the constraints whose facts were used are recorded so that
+/// they can be returned as an unsatisfiability core.
+class IntervalEvaluator : public ExprRangeEvaluator<KnownBitsRange> {
+  struct Fact {
+    KnownBitsRange range;
+    std::vector<unsigned> sources;
+  };
+
+  /// A signed bound which is not an unsigned interval by itself.
+  struct SignedBound {
+    ref<Expr> term;
+    uint64_t min, max;
+    unsigned source;
+  };
+
+  const Query &query;
+  ExprHashMap<Fact> facts;
+  ExprHashMap<KnownBitsRange> ranges;
+  std::vector<SignedBound> signedBounds;
+  std::vector<bool> used;
+
+  void addFact(const ref<Expr> &e, const KnownBitsRange &range,
+               unsigned source);
+  void assumeRange(const ref<Expr> &e, uint64_t min, uint64_t max,
+                   bool isSigned, unsigned source);
+  void assumeCompare(const BinaryExpr *be, bool isSigned, bool isStrict,
+                     bool value, unsigned source);
+  void assumeEqual(const ref<Expr> &e, uint64_t value, unsigned source);
+  void assumeNotEqual(const ref<Expr> &e, uint64_t value, unsigned source);
+  void assume(const ref<Expr> &e, bool value, unsigned source);
+
+protected:
+  KnownBitsRange getInitialReadRange(const Array &array,
+                                     KnownBitsRange index);
+  bool getCachedRange(const ref<Expr> &e, KnownBitsRange &res);
+  KnownBitsRange refineRange(const ref<Expr> &e, const KnownBitsRange &res);
+
+public:
+  /// The constraints contradict each other, so nothing can be concluded.
+  bool infeasible;
+  /// An expression wider than 64 bits was reached.
+  bool unsupported;
+
+  explicit IntervalEvaluator(const Query &_query);
+
+  void getUsedConstraints(std::vector< ref<Expr> > &result);
+};
+
+IntervalEvaluator::IntervalEvaluator(const Query &_query)
+  : query(_query), used(_query.constraints.size(), false), infeasible(false),
+    unsupported(false) {
+  unsigned source = 0;
+  for (ConstraintManager::const_iterator it = query.constraints.begin(),
+         ie = query.constraints.end(); it != ie; ++it, ++source)
+    assume(*it, true, source);
+
+  // A signed bound splits into two unsigned intervals, one of which may be
+  // excluded by the other facts about the term.
+  for (std::vector<SignedBound>::iterator it = signedBounds.begin(),
+         ie = signedBounds.end(); it != ie; ++it) {
+    ExprHashMap<Fact>::iterator fact = facts.find(it->term);
+    if (fact == facts.end() || fact->second.range.isEmpty())
+      continue;
+    unsigned width = it->term->getWidth();
+    uint64_t signBit = (uint64_t) 1 << (width - 1);
+    if (fact->second.range.max() < signBit)
+      addFact(it->term, KnownBitsRange(0, it->max - signBit), it->source);
+    else if (fact->second.range.min() >= signBit)
+      addFact(it->term, KnownBitsRange(it->min + signBit,
+                                       bits64::maxValueOfNBits(width)),
+              it->source);
+  }
+}
+
+void IntervalEvaluator::addFact(const ref<Expr> &e,
+                                const KnownBitsRange &range,
+                                unsigned source) {
+  if (e->getWidth() > Expr::Int64)
+    return;
+  ExprHashMap<Fact>::iterator it = facts.find(e);
+  if (it == facts.end()) {
+    Fact &fact = facts[e];
+    fact.range = range;
+    fact.sources.push_back(source);
+  } else {
+    it->second.range = it->second.range.set_intersection(range);
+    if (std::find(it->second.sources.begin(), it->second.sources.end(),
+                  source) == it->second.sources.end())
+      it->second.sources.push_back(source);
+  }
+  KnownBitsRange known = facts[e].range;
+  if (known.isEmpty()) {
+    infeasible = true;
+    return;
+  }
+
+  // Comparisons with constants are split along concatenations, so pass what
+  // is known about a concatenation on to its parts.
+  if (const ConcatExpr *ce = dyn_cast<ConcatExpr>(e)) {
+    unsigned rightWidth = ce->getRight()->getWidth();
+    KnownBitsRange left = known.extract(rightWidth, e->getWidth());
+    KnownBitsRange right = known.extract(0, rightWidth);
+    if (!left.isUnknown(ce->getLeft()->getWidth()))
+      addFact(ce->getLeft(), left, source);
+    if (!right.isUnknown(rightWidth))
+      addFact(ce->getRight(), right, source);
+  }
+}
+
+/// Assume \a e lies in [\a min, \a max], where for signed bounds the sign bit
+/// of the bounds is flipped so that the signed order is the unsigned one.
+void IntervalEvaluator::assumeRange(const ref<Expr> &e, uint64_t min,
+                                    uint64_t max, bool isSigned,
+                                    unsigned source) {
+  if (!isSigned)
+    return addFact(e, KnownBitsRange(min, max), source);
+
+  uint64_t signBit = (uint64_t) 1 << (e->getWidth() - 1);
+  if (max < signBit) {
+    addFact(e, KnownBitsRange(min + signBit, max + signBit), source);
+  } else if (min >= signBit) {
+    addFact(e, KnownBitsRange(min - signBit, max - signBit), source);
+  } else {
+    SignedBound bound = { e, min, max, source };
+    signedBounds.push_back(bound);
+  }
+}
+
+void IntervalEvaluator::assumeCompare(const BinaryExpr *be, bool isSigned,
+                                      bool isStrict, bool value,
+                                      unsigned source) {
+  unsigned width = be->left->getWidth();
+  if (width > Expr::Int64)
+    return;
+  uint64_t mask = bits64::maxValueOfNBits(width);
+  uint64_t flip = isSigned ? (uint64_t) 1 << (width - 1) : 0;
+
+  // The comparison holds as small < large (or small <= large).
+  ref<Expr> small = value ? be->left : be->right;
+  ref<Expr> large = value ? be->right : be->left;
+  bool strict = value == isStrict;
+
+  if (const ConstantExpr *CE = dyn_cast<ConstantExpr>(large)) {
+    uint64_t c = CE->getZExtValue() ^ flip;
+    if (!strict)
+      assumeRange(small, 0, c, isSigned, source);
+    else if (c > 0)
+      assumeRange(small, 0, c - 1, isSigned, source);
+    else
+      infeasible = true;
+  }
+  if (const ConstantExpr *CE = dyn_cast<ConstantExpr>(small)) {
+    uint64_t c = CE->getZExtValue() ^ flip;
+    if (!strict)
+      assumeRange(large, c, mask, isSigned, source);
+    else if (c < mask)
+      assumeRange(large, c + 1, mask, isSigned, source);
+    else
+      infeasible = true;
+  }
+}
+
+/// Return the constant operand of \a be, if any, and set \a term to the
+/// other one. Canonical expressions have the constant on the left.
+static const ConstantExpr *getConstantOperand(const BinaryExpr *be,
+                                              ref<Expr> &term) {
+  if (const ConstantExpr *CE = dyn_cast<ConstantExpr>(be->left)) {
+    term = be->right;
+    return CE;
+  }
+  term = be->left;
+  return dyn_cast<ConstantExpr>(be->right);
+}
+
+void IntervalEvaluator::assumeEqual(const ref<Expr> &e, uint64_t value,
+                                    unsigned source) {
+  addFact(e, KnownBitsRange(value), source);
+
+  // (x & mask) == value fixes the bits of mask in x.
+  ref<Expr> term;
+  if (const AndExpr *ae = dyn_cast<AndExpr>(e))
+    if (const ConstantExpr *CE = getConstantOperand(ae, term)) {
+      uint64_t mask = CE->getZExtValue();
+      if (value & ~mask)
+        infeasible = true;
+      else
+        addFact(term, KnownBitsRange::withBits(e->getWidth(), mask, value),
+                source);
+    }
+
+  if (const ZExtExpr *ze = dyn_cast<ZExtExpr>(e)) {
+    if (value <= bits64::maxValueOfNBits(ze->src->getWidth()))
+      addFact(ze->src, KnownBitsRange(value), source);
+    else
+      infeasible = true;
+  }
+}
+
+void IntervalEvaluator::assumeNotEqual(const ref<Expr> &e, uint64_t value,
+                                       unsigned source) {
+  uint64_t max = bits64::maxValueOfNBits(e->getWidth());
+  if (value == 0)
+    addFact(e, KnownBitsRange(1, max), source);
+  else if (value == max)
+    addFact(e, KnownBitsRange(0, max - 1), source);
+
+  // (x & bit) != value fixes the bit in x.
+  ref<Expr> term;
+  if (const AndExpr *ae = dyn_cast<AndExpr>(e))
+    if (const ConstantExpr *CE = getConstantOperand(ae, term)) {
+      uint64_t mask = CE->getZExtValue();
+      if (bits64::isPowerOfTwo(mask) && (value == 0 || value == mask))
+        addFact(term,
+                KnownBitsRange::withBits(e->getWidth(), mask, value ^ mask),
+                source);
+    }
+}
+
+/// Rebuild the comparisons which are not used in canonical form. Queries
+/// which were not built through the simplifying constructors (e.g. parsed
+/// ones) may still contain them.
+static ref<Expr> canonicalize(const ref<Expr> &e) {
+  switch (e->getKind()) {
+  case Expr::Ne:
+    return NeExpr::create(e->getKid(0), e->getKid(1));
+  case Expr::Ugt:
+    return UgtExpr::create(e->getKid(0), e->getKid(1));
+  case Expr::Uge:
+    return UgeExpr::create(e->getKid(0), e->getKid(1));
+  case Expr::Sgt:
+    return SgtExpr::create(e->getKid(0), e->getKid(1));
+  case Expr::Sge:
+    return SgeExpr::create(e->getKid(0), e->getKid(1));
+  default:
+    return e;
+  }
+}
+
+/// Add the facts implied by \a e having the truth value \a value.
+void IntervalEvaluator::assume(const ref<Expr> &e, bool value,
+                               unsigned source) {
+  if (isa<ConstantExpr>(e))
+    return;
+  addFact(e, KnownBitsRange(value), source);
+
+  ref<Expr> canonical = canonicalize(e);
+  if (canonical != e)
+    return assume(canonical, value, source);
+
+  switch (e->getKind()) {
+  case Expr::And: {
+    const AndExpr *ae = cast<AndExpr>(e);
+    if (value && e->getWidth() == Expr::Bool) {
+      assume(ae->left, true, source);
+      assume(ae->right, true, source);
+    }
+    break;
+  }
+  case Expr::Or: {
+    const OrExpr *oe = cast<OrExpr>(e);
+    if (!value && e->getWidth() == Expr::Bool) {
+      assume(oe->left, false, source);
+      assume(oe->right, false, source);
+    }
+    break;
+  }
+  case Expr::Eq: {
+    ref<Expr> term;
+    const ConstantExpr *CE = getConstantOperand(cast<EqExpr>(e), term);
+    if (!CE || term->getWidth() > Expr::Int64)
+      break;
+    uint64_t c = CE->getZExtValue();
+    if (term->getWidth() == Expr::Bool)
+      assume(term, value == (c != 0), source);
+    else if (value)
+      assumeEqual(term, c, source);
+    else
+      assumeNotEqual(term, c, source);
+    break;
+  }
+  case Expr::Ult:
+    assumeCompare(cast<BinaryExpr>(e), false, true, value, source);
+    break;
+  case Expr::Ule:
+    assumeCompare(cast<BinaryExpr>(e), false, false, value, source);
+    break;
+  case Expr::Slt:
+    assumeCompare(cast<BinaryExpr>(e), true, true, value, source);
+    break;
+  case Expr::Sle:
+    assumeCompare(cast<BinaryExpr>(e), true, false, value, source);
+    break;
+  default:
+    break;
+  }
+}
+
+KnownBitsRange
+IntervalEvaluator::getInitialReadRange(const Array &array,
+                                       KnownBitsRange index) {
+  if (!array.isConstantArray() || index.isEmpty() ||
+      index.max() >= array.size ||
+      index.max() - index.min() >= MaxConstantReadRange)
+    return KnownBitsRange(0, 255);
+
+  KnownBitsRange res;
+  for (uint64_t i = index.min(); i <= index.max(); ++i)
+    if (index.mayEqual(i))
+      res = res.set_union(KnownBitsRange(array.constantValues[i]));
+  return res.isEmpty() ? KnownBitsRange(0, 255) : res;
+}
+
+bool IntervalEvaluator::getCachedRange(const ref<Expr> &e,
+                                       KnownBitsRange &res) {
+  if (e->getWidth() > Expr::Int64) {
+    unsupported = true;
+    res = KnownBitsRange(0, ~(uint64_t) 0);
+    return true;
+  }
+  ExprHashMap<KnownBitsRange>::iterator it = ranges.find(e);
+  if (it != ranges.end()) {
+    res = it->second;
+    return true;
+  }
+  ref<Expr> canonical = canonicalize(e);
+  if (canonical == e)
+    return false;
+  res = refineRange(e, evaluate(canonical));
+  return true;
+}
+
+KnownBitsRange IntervalEvaluator::refineRange(const ref<Expr> &e,
+                                              const KnownBitsRange &res) {
+  KnownBitsRange refined = res;
+  ExprHashMap<Fact>::iterator it = facts.find(e);
+  if (it != facts.end()) {
+    refined = res.set_intersection(it->second.range);
+    for (std::vector<unsigned>::iterator si = it->second.sources.begin(),
+           se = it->second.sources.end(); si != se; ++si)
+      used[*si] = true;
+    if (refined.isEmpty()) {
+      infeasible = true;
+      refined = res;
+    }
+  }
+  ranges.insert(std::make_pair(e, refined));
+  return refined;
+}
+
+void IntervalEvaluator::getUsedConstraints(std::vector< ref<Expr> > &result) {
+  result.clear();
+  unsigned source = 0;
+  for (ConstraintManager::const_iterator it = query.constraints.begin(),
+         ie = query.constraints.end(); it != ie; ++it, ++source)
+    if (used[source])
+      result.push_back(*it);
+}
+
+/***/
+
+/// IntervalSolver - An incomplete solver deciding queries by evaluating them
+/// over intervals and known bits implied by the constraints.
+///
+/// It only proves that a query is true (or false) for all assignments; when
+/// it does, the constraints used form an unsatisfiability core.
+class IntervalSolver : public IncompleteSolver {
+  std::vector< ref<Expr> > unsatCore;
+
+public:
+  IncompleteSolver::PartialValidity computeValidity(const Query&);
+  IncompleteSolver::PartialValidity computeTruth(const Query&);
+  bool computeValue(const Query&, ref<Expr> &result) { return false; }
+  bool computeInitialValues(const Query&,
+                            const std::vector<const Array*> &objects,
+                            std::vector< std::vector<unsigned char> > &values,
+                            bool &hasSolution) {
+    return false;
+  }
+  bool getUnsatCore(std::vector< ref<Expr> > &core) {
+    core = unsatCore;
+    return true;
+  }
+};
+
+IncompleteSolver::PartialValidity
+IntervalSolver::computeValidity(const Query &query) {
+  IntervalEvaluator evaluator(query);
+  KnownBitsRange res;
+  if (!evaluator.infeasible)
+    res = evaluator.evaluate(query.expr);
+
+  if (evaluator.infeasible || evaluator.unsupported || res.isEmpty() ||
+      !res.isFixed()) {
+    ++stats::queryIntervalMisses;
+    return IncompleteSolver::None;
+  }
+
+  ++stats::queryIntervalHits;
+  evaluator.getUsedConstraints(unsatCore);
+  return res.min() ? IncompleteSolver::MustBeTrue
+                   : IncompleteSolver::MustBeFalse;
+}
+
+IncompleteSolver::PartialValidity
+IntervalSolver::computeTruth(const Query &query) {
+  // A query which is always false is only invalid if the constraints are
+  // satisfiable, which is not checked.
+  IncompleteSolver::PartialValidity res = computeValidity(query);
+  return res == IncompleteSolver::MustBeTrue ? res : IncompleteSolver::None;
+}
+
+Solver *klee::createIntervalSolver(Solver *s) {
+  return new Solver(new StagedSolverImpl(new IntervalSolver(), s));
+}
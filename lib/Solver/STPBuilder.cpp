@@ -480,10 +480,26 @@ ExprHandle STPBuilder::getInitialRead(const Array *root, unsigned index) {
       bool hashed = _arr_hash.lookupUpdateNodeExpr(un, un_expr);
       
       if (!hashed) {
-	un_expr = vc_writeExpr(vc,
-                               getArrayForUpdate(root, un->next),
-                               construct(un->index, 0),
-                               construct(un->value, 0));
+        if (const UpdateSnapshot *snapshot = un->getSnapshot()) {
+          // Only the last write to each constant index is needed.
+          ::VCExpr tail = getArrayForUpdate(root, snapshot->tail);
+          un_expr = tail;
+          for (UpdateSnapshot::entries_ty::const_iterator
+                 it = snapshot->entries.begin(),
+                 ie = snapshot->entries.end(); it != ie; ++it) {
+            ::VCExpr prev = un_expr;
+            un_expr = vc_writeExpr(vc, prev,
+                                   construct(it->second->index, 0),
+                                   construct(it->second->value, 0));
+            if (prev != tail)
+              vc_DeleteExpr(prev);
+          }
+        } else {
+	  un_expr = vc_writeExpr(vc,
+                                 getArrayForUpdate(root, un->next),
+                                 construct(un->index, 0),
+                                 construct(un->value, 0));
+        }
 	
 	_arr_hash.hashUpdateNodeExpr(un, un_expr);
       }
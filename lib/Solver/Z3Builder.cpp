@@ -26,6 +26,13 @@ llvm::cl::opt<bool> UseConstructHashZ3(
     "use-construct-hash-z3",
     llvm::cl::desc("Use hash-consing during Z3 query construction."),
     llvm::cl::init(true));
+
+llvm::cl::opt<unsigned> Z3ConstantArrayLookupLimit(
+    "z3-constant-array-lookup-limit",
+    llvm::cl::desc("Encode symbolic reads of unmodified constant arrays of at "
+                   "most this many elements as lookups on the bits of the "
+                   "index instead of array reads (default=0 (off))."),
+    llvm::cl::init(0));
 }
 
 void custom_z3_error_handler(Z3_context ctx, Z3_error_code ec) {
@@ -56,7 +63,7 @@ void Z3ArrayExprHash::clear() {
 }
 
 Z3Builder::Z3Builder(bool autoClearConstructCache)
-    : autoClearConstructCache(autoClearConstructCache) {
+    : uniqueArrayCount(0), autoClearConstructCache(autoClearConstructCache) {
   // FIXME: Should probably let the client pass in a Z3_config instead
   Z3_config cfg = Z3_mk_config();
   // It is very important that we ask Z3 to let us manage memory so that
@@ -74,6 +81,7 @@ Z3Builder::~Z3Builder() {
   // they aren associated with.
   clearConstructCache();
   _arr_hash.clear();
+  _constant_base_hash.clear();
   Z3_del_context(ctx);
 }
 
@@ -378,29 +386,11 @@ Z3ASTHandle Z3Builder::getInitialArray(const Array *root) {
       }
     }
 
-    // Unique arrays by name, so we make sure the name is unique by
-    // using the size of the array hash as a counter.
-    std::string unique_id = llvm::itostr(_arr_hash._array_hash.size());
-    unsigned const uid_length = unique_id.length();
-    unsigned const space = (root->name.length() > 32 - uid_length)
-                               ? (32 - uid_length)
-                               : root->name.length();
-    std::string unique_name = root->name.substr(0, space) + unique_id;
-
-    array_expr =
-        buildArray(unique_name.c_str(), root->getDomain(), root->getRange());
-
-    if (root->isConstantArray()) {
-      // FIXME: Flush the concrete values into Z3. Ideally we would do this
-      // using assertions, which might be faster, but we need to fix the caching
-      // to work correctly in that case.
-      for (unsigned i = 0, e = root->size; i != e; ++i) {
-        Z3ASTHandle prev = array_expr;
-        array_expr = writeExpr(
-            prev, construct(ConstantExpr::alloc(i, root->getDomain()), 0),
-            construct(root->constantValues[i], 0));
-      }
-    }
+    if (root->isConstantArray())
+      array_expr = buildConstantArray(root);
+    else
+      array_expr = buildArray(getUniqueArrayName(root).c_str(),
+                              root->getDomain(), root->getRange());
 
     _arr_hash.hashArrayExpr(root, array_expr);
   }
@@ -408,6 +398,78 @@ Z3ASTHandle Z3Builder::getInitialArray(const Array *root) {
   return (array_expr);
 }
 
+std::string Z3Builder::getUniqueArrayName(const Array *root) {
+  // Unique arrays by name, so we make sure the name is unique by
+  // using a counter.
+  std::string unique_id = llvm::itostr(uniqueArrayCount++);
+  unsigned const uid_length = unique_id.length();
+  unsigned const space = (root->name.length() > 32 - uid_length)
+                             ? (32 - uid_length)
+                             : root->name.length();
+  return root->name.substr(0, space) + unique_id;
+}
+
+Z3ASTHandle Z3Builder::getConstantArrayBase(const Array *root) {
+  Z3ASTHandle base;
+  if (!_constant_base_hash.lookupArrayExpr(root, base)) {
+    base = buildArray(getUniqueArrayName(root).c_str(), root->getDomain(),
+                      root->getRange());
+    _constant_base_hash.hashArrayExpr(root, base);
+  }
+  return base;
+}
+
+Z3ASTHandle Z3Builder::buildConstantArray(const Array *root) {
+  // FIXME: Flush the concrete values into Z3. Ideally we would do this
+  // using assertions, which might be faster, but we need to fix the caching
+  // to work correctly in that case.
+  //
+  // The definition is not shared with other arrays of the same contents:
+  // each starts from its own unconstrained array, so that reads past the end
+  // of one are unrelated to those of another.
+  Z3ASTHandle array_expr = getConstantArrayBase(root);
+  for (unsigned i = 0, e = root->size; i != e; ++i) {
+    Z3ASTHandle prev = array_expr;
+    array_expr = writeExpr(
+        prev, construct(ConstantExpr::alloc(i, root->getDomain()), 0),
+        construct(root->constantValues[i], 0));
+  }
+  return array_expr;
+}
+
+/// Read the constant array \a root at a symbolic \a index through a
+/// decision tree on the bits of the index, rather than through the chain of
+/// stores which defines the array.
+Z3ASTHandle Z3Builder::constructConstantLookup(const Array *root,
+                                               Z3ASTHandle index) {
+  unsigned bits = 0;
+  while (((uint64_t) 1 << bits) < root->size)
+    ++bits;
+  Z3ASTHandle tree = buildLookupTree(root, index, (int) bits - 1, 0);
+
+  // Reads past the end are unconstrained. They read the array the stores
+  // of the definition start from, as reads through those stores would.
+  return iteExpr(bvLtExpr(index, bvConst64(root->getDomain(), root->size)),
+                 tree, readExpr(getConstantArrayBase(root), index));
+}
+
+Z3ASTHandle Z3Builder::buildLookupTree(const Array *root, Z3ASTHandle index,
+                                       int bit, uint64_t base) {
+  if (bit < 0)
+    return construct(root->constantValues[base], 0);
+
+  Z3ASTHandle low = buildLookupTree(root, index, bit - 1, base);
+  uint64_t highBase = base | ((uint64_t) 1 << bit);
+  // Entries past the end are guarded off by the caller.
+  if (highBase >= root->size)
+    return low;
+  Z3ASTHandle high = buildLookupTree(root, index, bit - 1, highBase);
+  // Z3 hash-conses its terms, so runs of equal entries collapse here.
+  if ((Z3_ast) low == (Z3_ast) high)
+    return low;
+  return iteExpr(bvBoolExtract(index, bit), high, low);
+}
+
 Z3ASTHandle Z3Builder::getInitialRead(const Array *root, unsigned index) {
   return readExpr(getInitialArray(root), bvConst32(32, index));
 }
@@ -422,8 +484,18 @@ Z3ASTHandle Z3Builder::getArrayForUpdate(const Array *root,
     bool hashed = _arr_hash.lookupUpdateNodeExpr(un, un_expr);
 
     if (!hashed) {
-      un_expr = writeExpr(getArrayForUpdate(root, un->next),
-                          construct(un->index, 0), construct(un->value, 0));
+      if (const UpdateSnapshot *snapshot = un->getSnapshot()) {
+        // Only the last write to each constant index is needed.
+        un_expr = getArrayForUpdate(root, snapshot->tail);
+        for (UpdateSnapshot::entries_ty::const_iterator
+               it = snapshot->entries.begin(), ie = snapshot->entries.end();
+             it != ie; ++it)
+          un_expr = writeExpr(un_expr, construct(it->second->index, 0),
+                              construct(it->second->value, 0));
+      } else {
+        un_expr = writeExpr(getArrayForUpdate(root, un->next),
+                            construct(un->index, 0), construct(un->value, 0));
+      }
 
       _arr_hash.hashUpdateNodeExpr(un, un_expr);
     }
@@ -505,6 +577,10 @@ Z3ASTHandle Z3Builder::constructActual(ref<Expr> e, int *width_out) {
     ReadExpr *re = cast<ReadExpr>(e);
     assert(re && re->updates.root);
     *width_out = re->updates.root->getRange();
+    const Array *root = re->updates.root;
+    if (!re->updates.head && root->isConstantArray() && root->size &&
+        root->size <= Z3ConstantArrayLookupLimit)
+      return constructConstantLookup(root, construct(re->index, 0));
     return readExpr(getArrayForUpdate(re->updates.root, re->updates.head),
                     construct(re->index, 0));
   }
@@ -139,6 +139,10 @@ class Z3Builder {
 
   ExprHashMap<std::pair<Z3ASTHandle, unsigned> > constructed;
   Z3ArrayExprHash _arr_hash;
+  /// The unconstrained arrays which the definitions of constant arrays
+  /// store their contents onto.
+  Z3ArrayExprHash _constant_base_hash;
+  unsigned uniqueArrayCount;
 
 private:
   Z3ASTHandle bvOne(unsigned width);
@@ -193,6 +197,12 @@ private:
                                       Z3ASTHandle isSigned);
 
   Z3ASTHandle getInitialArray(const Array *os);
+  std::string getUniqueArrayName(const Array *root);
+  Z3ASTHandle getConstantArrayBase(const Array *root);
+  Z3ASTHandle buildConstantArray(const Array *root);
+  Z3ASTHandle constructConstantLookup(const Array *root, Z3ASTHandle index);
+  Z3ASTHandle buildLookupTree(const Array *root, Z3ASTHandle index, int bit,
+                              uint64_t base);
   Z3ASTHandle getArrayForUpdate(const Array *root, const UpdateNode *un);
 
   Z3ASTHandle constructActual(ref<Expr> e, int *width_out);
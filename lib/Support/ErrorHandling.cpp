@@ -11,6 +11,7 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <pthread.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
@@ -24,6 +25,10 @@ using namespace klee;
 FILE *klee::klee_warning_file = NULL;
 FILE *klee::klee_message_file = NULL;
 
+// Worker threads report problems too; keep their lines whole and the
+// once-only set consistent.
+static pthread_mutex_t messageLock = PTHREAD_MUTEX_INITIALIZER;
+
 static const char *warningPrefix = "WARNING";
 static const char *warningOncePrefix = "WARNING ONCE";
 static const char *errorPrefix = "ERROR";
@@ -103,6 +108,7 @@ static void klee_vfmessage(FILE *fp, const char *pfx, const char *msg,
 */
 static void klee_vmessage(const char *pfx, bool onlyToFile, const char *msg,
                           va_list ap) {
+  pthread_mutex_lock(&messageLock);
   if (!onlyToFile) {
     va_list ap2;
     va_copy(ap2, ap);
@@ -111,6 +117,7 @@ static void klee_vmessage(const char *pfx, bool onlyToFile, const char *msg,
   }
 
   klee_vfmessage(pfx ? klee_warning_file : klee_message_file, pfx, msg, ap);
+  pthread_mutex_unlock(&messageLock);
 }
 
 void klee::klee_message(const char *msg, ...) {
@@ -156,8 +163,10 @@ void klee::klee_warning_once(const void *id, const char *msg, ...) {
   else
     key = std::make_pair(id, "calling external");
 
-  if (!keys.count(key)) {
-    keys.insert(key);
+  pthread_mutex_lock(&messageLock);
+  bool first = keys.insert(key).second;
+  pthread_mutex_unlock(&messageLock);
+  if (first) {
     va_list ap;
     va_start(ap, msg);
     klee_vmessage(warningOncePrefix, false, msg, ap);
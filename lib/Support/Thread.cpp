@@ -0,0 +1,140 @@
+//===-- Thread.cpp --------------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Internal/System/Thread.h"
+
+#include "klee/Internal/Support/ErrorHandling.h"
+#include "klee/Statistics.h"
+
+#include <string.h>
+
+using namespace klee;
+
+Mutex::Mutex() {
+  pthread_mutex_init(&mutex, 0);
+}
+
+Mutex::~Mutex() {
+  pthread_mutex_destroy(&mutex);
+}
+
+void Mutex::lock() {
+  pthread_mutex_lock(&mutex);
+}
+
+void Mutex::unlock() {
+  pthread_mutex_unlock(&mutex);
+}
+
+/***/
+
+Condition::Condition() {
+  pthread_cond_init(&cond, 0);
+}
+
+Condition::~Condition() {
+  pthread_cond_destroy(&cond);
+}
+
+void Condition::wait(Mutex &mutex) {
+  pthread_cond_wait(&cond, &mutex.mutex);
+}
+
+void Condition::signal() {
+  pthread_cond_signal(&cond);
+}
+
+void Condition::broadcast() {
+  pthread_cond_broadcast(&cond);
+}
+
+/***/
+
+namespace {
+  struct ThreadStart {
+    WorkerPool *pool;
+    unsigned worker;
+  };
+}
+
+WorkerPool::WorkerPool(unsigned numThreads)
+  : pending(0), shuttingDown(false) {
+  if (theStatisticManager)
+    theStatisticManager->prepareWorkerThreads();
+  threads.reserve(numThreads);
+  for (unsigned i = 0; i < numThreads; ++i) {
+    ThreadStart *start = new ThreadStart();
+    start->pool = this;
+    start->worker = i;
+    pthread_t thread;
+    int res = pthread_create(&thread, 0, &WorkerPool::threadMain, start);
+    if (res)
+      klee_error("unable to create worker thread: %s", strerror(res));
+    threads.push_back(thread);
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  wait();
+  {
+    MutexLock lock(mutex);
+    shuttingDown = true;
+    workAvailable.broadcast();
+  }
+  for (unsigned i = 0; i < threads.size(); ++i)
+    pthread_join(threads[i], 0);
+}
+
+void *WorkerPool::threadMain(void *arg) {
+  ThreadStart *start = static_cast<ThreadStart*>(arg);
+  WorkerPool *pool = start->pool;
+  unsigned worker = start->worker;
+  delete start;
+  // Keep the statistics of the tasks apart from the main thread's.
+  if (theStatisticManager)
+    theStatisticManager->enterWorkerThread();
+  pool->workerLoop(worker);
+  if (theStatisticManager)
+    theStatisticManager->leaveWorkerThread();
+  return 0;
+}
+
+void WorkerPool::workerLoop(unsigned worker) {
+  for (;;) {
+    Task *task;
+    {
+      MutexLock lock(mutex);
+      while (queue.empty() && !shuttingDown)
+        workAvailable.wait(mutex);
+      if (queue.empty())
+        return;
+      task = queue.front();
+      queue.pop_front();
+    }
+
+    task->run(worker);
+
+    MutexLock lock(mutex);
+    --pending;
+    workDone.broadcast();
+  }
+}
+
+void WorkerPool::enqueue(Task *task) {
+  MutexLock lock(mutex);
+  queue.push_back(task);
+  ++pending;
+  workAvailable.signal();
+}
+
+void WorkerPool::wait(unsigned maxPending) {
+  MutexLock lock(mutex);
+  while (pending > maxPending)
+    workDone.wait(mutex);
+}
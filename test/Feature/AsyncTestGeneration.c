@@ -0,0 +1,29 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out -no-interpolation --write-pcs --async-test-generation-threads=2 %t1.bc 2> %t.log
+// RUN: grep "generated tests = 9" %t.log
+// RUN: ls %t.klee-out/ | grep .ktest | wc -l | grep 9
+// RUN: ls %t.klee-out/ | grep .pc | wc -l | grep 9
+// RUN: ls %t.klee-out/ | grep .assert.err | wc -l | grep 1
+// RUN: test -f %t.klee-out/test000009.ktest
+// RUN: not test -f %t.klee-out/test000010.ktest
+
+#include <assert.h>
+
+int main() {
+  unsigned char buf[3];
+  int i, count = 0;
+
+  klee_make_symbolic(buf, sizeof buf, "buf");
+
+  // One error, whose message is written by a worker too.
+  if (buf[0] == 42)
+    assert(0);
+
+  // Then eight paths, each writing its test case while exploration goes on.
+  for (i = 0; i < 3; ++i)
+    if (buf[i] > 100)
+      ++count;
+
+  return count;
+}
@@ -0,0 +1,31 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out -no-interpolation --search=dfs %t1.bc 2> %t.log
+// RUN: grep "generated tests = 81" %t.log
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out -no-interpolation --search=dfs --auto-merge --exit-on-error %t1.bc 2> %t.log
+// RUN: grep "generated tests = 2" %t.log
+// RUN: not grep "ASSERTION FAIL" %t.log
+// RUN: rm -rf %t.klee-out
+// RUN: not %klee --output-dir=%t.klee-out -no-interpolation --auto-merge --checkpoint-interval=3600 %t1.bc 2> %t.log
+// RUN: grep "auto-merge cannot be used with --checkpoint-interval" %t.log
+
+#include <assert.h>
+
+int main() {
+  char buf[4];
+  int i, digits = 0;
+
+  klee_make_symbolic(buf, sizeof buf, "buf");
+
+  // Each byte takes one of three paths through the check, all of which
+  // join again before the next byte.
+  for (i = 0; i < 4; ++i)
+    if (buf[i] >= '0' && buf[i] <= '9')
+      ++digits;
+
+  assert(digits <= 4);
+  if (digits == 4)
+    return 1;
+  return 0;
+}
@@ -0,0 +1,25 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out %t.klee-out-halted %t.klee-out-resumed
+// RUN: %klee --output-dir=%t.klee-out -no-interpolation --search=dfs %t1.bc 2> %t.log
+// RUN: grep "completed paths = 16" %t.log
+// RUN: %klee --output-dir=%t.klee-out-halted -no-interpolation --search=dfs --checkpoint-interval=3600 --stop-after-n-tests=5 --dump-states-on-halt=false %t1.bc 2> %t.halted.log
+// RUN: grep "completed paths = 5" %t.halted.log
+// RUN: test -f %t.klee-out-halted/checkpoint
+// RUN: %klee --output-dir=%t.klee-out-resumed -no-interpolation --search=dfs --resume-checkpoint=%t.klee-out-halted/checkpoint %t1.bc 2> %t.resumed.log
+// RUN: grep "completed paths = 11" %t.resumed.log
+// RUN: grep "generated tests = 11" %t.resumed.log
+
+int main() {
+  char buf[4];
+  int i, n = 0;
+
+  klee_make_symbolic(buf, sizeof buf, "buf");
+
+  // Sixteen paths, five of them explored before the checkpoint and the
+  // other eleven after resuming it.
+  for (i = 0; i < 4; ++i)
+    if (buf[i] > 'm')
+      ++n;
+
+  return n;
+}
@@ -0,0 +1,40 @@
+// RUN: %llvmgcc %s -emit-llvm -g -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --external-calls-reachable-only --exit-on-error %t1.bc 2>%t.log | FileCheck %s
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+char greeting[] = "hello ";
+char unrelated[64];
+
+int main() {
+  char name[16];
+  struct iovec iov[2];
+  char *end;
+
+  // Memory written directly through an argument.
+  sprintf(name, "world%d\n", 42);
+  assert(strcmp(name, "world42\n") == 0);
+
+  // Written through a pointer argument into a local.
+  assert(strtol("17abc", &end, 10) == 17);
+  assert(strcmp(end, "abc") == 0);
+
+  // Read through pointers held in an argument.
+  iov[0].iov_base = greeting;
+  iov[0].iov_len = strlen(greeting);
+  iov[1].iov_base = name;
+  iov[1].iov_len = strlen(name);
+  fflush(stdout);
+  // CHECK: hello world42
+  writev(1, iov, 2);
+
+  // Objects which are not reachable keep their contents.
+  memset(unrelated, 'x', sizeof unrelated - 1);
+  assert(strlen(unrelated) == sizeof unrelated - 1);
+  return 0;
+}
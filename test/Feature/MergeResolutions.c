@@ -0,0 +1,32 @@
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out -no-interpolation --merge-resolutions=4 %t1.bc 2> %t.log
+// RUN: grep "completed paths = 1" %t.log
+// RUN: not grep "ASSERTION FAIL" %t.log
+
+#include <assert.h>
+#include <stdlib.h>
+
+int *make_int(int i) {
+  int *x = malloc(sizeof(*x));
+  *x = i;
+  return x;
+}
+
+int main() {
+  int *buf[4];
+  int i, s;
+
+  for (i = 0; i < 4; i++)
+    buf[i] = make_int((i + 1) * 2);
+
+  klee_make_symbolic(&s, sizeof s);
+  klee_assume(s >= 0 & s < 4);
+
+  // The pointer may point into any of the four objects, which are read
+  // and written without forking.
+  assert(*buf[s] == (s + 1) * 2);
+  *buf[s] = 5;
+  assert(*buf[0] + *buf[1] + *buf[2] + *buf[3] == 20 - (s + 1) * 2 + 5);
+  return 0;
+}
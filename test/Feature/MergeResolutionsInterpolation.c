@@ -0,0 +1,9 @@
+// REQUIRES: z3
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: not %klee --output-dir=%t.klee-out --solver-backend=z3 --merge-resolutions=4 %t1.bc 2> %t.log
+// RUN: grep "cannot be used with interpolation" %t.log
+
+int main() {
+  return 0;
+}
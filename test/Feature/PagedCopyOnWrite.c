@@ -0,0 +1,45 @@
+// RUN: %llvmgcc %s -emit-llvm -g -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --exit-on-error %t1.bc
+
+#include <assert.h>
+
+// Spans several pages, the last one partial.
+#define N (3 * 4096 + 100)
+
+unsigned char table[N];
+
+int main() {
+  unsigned i;
+  int x, y;
+  klee_make_symbolic(&x, sizeof x);
+  klee_make_symbolic(&y, sizeof y);
+
+  for (i = 0; i < N; ++i)
+    table[i] = i % 251;
+
+  // Each side of the fork writes a different page.
+  if (x) {
+    table[10] = 1;
+    table[N - 1] = 2;
+  } else {
+    table[5000] = 3;
+  }
+
+  if (x) {
+    assert(table[10] == 1 && table[N - 1] == 2);
+    assert(table[5000] == 5000 % 251);
+  } else {
+    assert(table[10] == 10 && table[N - 1] == (N - 1) % 251);
+    assert(table[5000] == 3);
+  }
+
+  // A symbolic write after the fork must not leak into the sibling.
+  if (y >= 0 && y < N) {
+    table[y] = 0;
+    assert(table[y] == 0);
+  } else {
+    assert(table[12300] == 12300 % 251);
+  }
+  return 0;
+}
@@ -0,0 +1,43 @@
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out %t1.bc 2>&1 | FileCheck %s
+// RUN: test -f %t.klee-out/test000001.ptr.err
+// RUN: not test -f %t.klee-out/test000001.assert.err
+// RUN: grep "resolve cache hits = [1-9][0-9]* of" %t.klee-out/info
+
+#include <assert.h>
+#include <stdlib.h>
+
+int main() {
+  int i, sum = 0;
+  int *p, *q;
+
+  // Repeated accesses to the same objects are resolved from the cache.
+  p = malloc(16 * sizeof(*p));
+  for (i = 0; i < 16; ++i)
+    p[i] = i;
+  for (i = 0; i < 16; ++i)
+    sum += p[i];
+  assert(sum == 120);
+
+  // The object is rebound elsewhere, and the old address freed.
+  p = realloc(p, 32 * sizeof(*p));
+  for (i = 16; i < 32; ++i)
+    p[i] = i;
+  for (i = 0; i < 32; ++i)
+    sum += p[i];
+  assert(sum == 120 + 496);
+
+  // A new object may be given the address of one freed.
+  q = malloc(32 * sizeof(*q));
+  free(q);
+  q = malloc(32 * sizeof(*q));
+  for (i = 0; i < 32; ++i)
+    q[i] = p[i] * 2;
+  assert(q[31] == 62);
+
+  // An address resolved before its object was freed must not resolve now.
+  free(p);
+  // CHECK: memory error: out of bound pointer
+  return p[1];
+}
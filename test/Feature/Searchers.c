@@ -8,6 +8,8 @@
 // RUN: rm -rf %t.klee-out
 // RUN: %klee --output-dir=%t.klee-out --search=nurs:qc %t2.bc
 // RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --search=nurs:mem %t2.bc
+// RUN: rm -rf %t.klee-out
 // RUN: %klee --output-dir=%t.klee-out --use-batching-search %t2.bc
 // RUN: rm -rf %t.klee-out
 // RUN: %klee --output-dir=%t.klee-out --use-batching-search --search=random-state %t2.bc
@@ -0,0 +1,36 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out -no-interpolation --search=nurs:covnew %t1.bc 2> %t.log
+// RUN: grep "completed paths = 64" %t.log
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out -no-interpolation --search=nurs:covnew --swap-states --max-memory=1 --max-memory-inhibit=false --stats-write-interval=0.01 --istats-write-interval=0.01 %t1.bc 2> %t.log
+// RUN: grep "completed paths = 64" %t.log
+// RUN: grep "states swapped in" %t.klee-out/info
+//
+// States swapped out when execution halts are replayed for their test case.
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out -no-interpolation --search=dfs --stop-after-n-tests=8 %t1.bc 2> %t.log
+// RUN: grep "generated tests" %t.log > %t.resident
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out -no-interpolation --search=dfs --stop-after-n-tests=8 --swap-states --max-memory=1 --max-memory-inhibit=false %t1.bc 2> %t.log
+// RUN: grep "generated tests" %t.log > %t.swapped
+// RUN: diff %t.resident %t.swapped
+// RUN: grep "states swapped out" %t.klee-out/info
+
+int main() {
+  char buf[6];
+  int i, j, sum = 0;
+
+  klee_make_symbolic(buf, sizeof buf, "buf");
+
+  // Sixty-four paths, with enough work on each for the memory cap to be
+  // checked, and states swapped out, several times.
+  for (i = 0; i < 6; ++i) {
+    if (buf[i] > 'm')
+      ++sum;
+    for (j = 0; j < 1000; ++j)
+      sum += j & 1;
+  }
+
+  return sum;
+}
@@ -0,0 +1,38 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out -no-interpolation %t1.bc 2> %t.log
+// RUN: grep "completed paths = 24" %t.log
+// RUN: grep "generated tests = 24" %t.log
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out -no-interpolation --swarm-workers=2 --swarm-frontier-depth=2 %t1.bc 2> %t.log
+// RUN: grep "completed paths = 24" %t.log
+// RUN: grep "generated tests = 24" %t.log
+// RUN: grep "swarm: frontier states = [1-9]" %t.log
+// RUN: grep "failed workers = 0" %t.log
+// RUN: ls %t.klee-out/ | grep .ktest | wc -l | grep 24
+
+int main() {
+  char buf[4];
+  int i, n;
+
+  klee_make_symbolic(buf, sizeof buf, "buf");
+
+  // Forks three ways at once, so that some states reach the frontier on a
+  // switch rather than a branch.
+  switch (buf[0]) {
+  case 'a':
+    n = 1;
+    break;
+  case 'b':
+    n = 2;
+    break;
+  default:
+    n = 3;
+  }
+
+  for (i = 1; i < 4; ++i)
+    if (buf[i] > 'm')
+      ++n;
+
+  return n;
+}
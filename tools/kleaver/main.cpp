@@ -22,14 +22,23 @@
 #include "klee/util/ExprPPrinter.h"
 #include "klee/util/ExprVisitor.h"
 #include "klee/util/ExprSMTLIBPrinter.h"
+#include "klee/util/ArrayCache.h"
 #include "klee/Internal/Support/PrintVersion.h"
+#include "klee/Internal/Support/QueryLog.h"
+#include "klee/Internal/System/Thread.h"
+#include "klee/Internal/System/Time.h"
 
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
+#include <fstream>
+
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -54,7 +63,8 @@ namespace {
     PrintTokens,
     PrintAST,
     PrintSMTLIBv2,
-    Evaluate
+    Evaluate,
+    Benchmark
   };
 
   static llvm::cl::opt<ToolActions> 
@@ -69,8 +79,52 @@ namespace {
                         "Print parsed AST nodes from the input file."),
              clEnumValN(Evaluate, "evaluate",
                         "Print parsed AST nodes from the input file."),
+             clEnumValN(Benchmark, "benchmark",
+                        "Time the queries of the input file, or of the query "
+                        "files in the input directory, on several solver "
+                        "configurations."),
              clEnumValEnd));
 
+  llvm::cl::list<std::string>
+  BenchmarkConfigs("benchmark-config",
+                   llvm::cl::desc("A solver configuration to benchmark: a "
+                                  "'+'-separated list of a core solver (stp, "
+                                  "metasmt, z3, dummy or core for "
+                                  "-solver-backend) and the layers to use "
+                                  "(cex, cache, interval, indep). May be "
+                                  "repeated; disagreements are counted "
+                                  "against the first configuration "
+                                  "(default: the configuration of the solver "
+                                  "options)."));
+
+  llvm::cl::opt<unsigned>
+  BenchmarkThreads("benchmark-threads",
+                   llvm::cl::desc("Number of threads running benchmark "
+                                  "queries; requires the Z3 core solver "
+                                  "(default=1)."),
+                   llvm::cl::init(1));
+
+  llvm::cl::opt<std::string>
+  BenchmarkOutput("benchmark-output",
+                  llvm::cl::desc("File to write the result and time of every "
+                                 "benchmark query to."));
+
+  enum BenchmarkFormats {
+    BenchmarkCSV,
+    BenchmarkJSON
+  };
+
+  llvm::cl::opt<BenchmarkFormats>
+  BenchmarkFormat("benchmark-format",
+                  llvm::cl::desc("Format of the benchmark output file:"),
+                  llvm::cl::init(BenchmarkCSV),
+                  llvm::cl::values(
+                  clEnumValN(BenchmarkCSV, "csv",
+                             "One line per query (default)."),
+                  clEnumValN(BenchmarkJSON, "json",
+                             "The queries and per-configuration summaries."),
+                  clEnumValEnd));
+
 
   enum BuilderKinds {
     DefaultBuilder,
@@ -91,6 +145,11 @@ namespace {
                          "Fold constants and simplify expressions."),
               clEnumValEnd));
 
+  static llvm::cl::opt<bool>
+  HashConsExprs("hash-cons-exprs",
+                llvm::cl::desc("Share a single node between structurally "
+                               "equal expressions (default=off)."),
+                llvm::cl::init(false));
 
   llvm::cl::opt<std::string> directoryToWriteQueryLogs("query-log-dir",llvm::cl::desc("The folder to write query logs to. Defaults is current working directory."),
 		                                               llvm::cl::init("."));
@@ -194,6 +253,49 @@ static bool PrintInputAST(const char *Filename,
   return success;
 }
 
+static ExprBuilder *createBuilder() {
+  ExprBuilder *Builder = 0;
+  switch (BuilderKind) {
+  case DefaultBuilder:
+    Builder = createDefaultExprBuilder();
+    break;
+  case ConstantFoldingBuilder:
+    Builder = createDefaultExprBuilder();
+    Builder = createConstantFoldingExprBuilder(Builder);
+    break;
+  case SimplifyingBuilder:
+    Builder = createDefaultExprBuilder();
+    Builder = createConstantFoldingExprBuilder(Builder);
+    Builder = createSimplifyingExprBuilder(Builder);
+    break;
+  }
+  if (HashConsExprs)
+    Builder = createHashConsingExprBuilder(Builder);
+  return Builder;
+}
+
+static Solver *
+createSolver(const SolverChainOptions &options = SolverChainOptions()) {
+  Solver *coreSolver = klee::createCoreSolver(options.coreSolver);
+  if (!coreSolver)
+    return 0;
+
+  if (options.coreSolver != DUMMY_SOLVER) {
+    if (0 != MaxCoreSolverTime) {
+      coreSolver->setCoreSolverTimeout(MaxCoreSolverTime);
+    }
+  }
+
+  return constructSolverChain(coreSolver,
+                              getQueryLogPath(ALL_QUERIES_SMT2_FILE_NAME),
+                              getQueryLogPath(SOLVER_QUERIES_SMT2_FILE_NAME),
+                              getQueryLogPath(ALL_QUERIES_PC_FILE_NAME),
+                              getQueryLogPath(SOLVER_QUERIES_PC_FILE_NAME),
+                              getQueryLogPath(ALL_QUERIES_BINARY_FILE_NAME),
+                              getQueryLogPath(SOLVER_QUERIES_BINARY_FILE_NAME),
+                              options);
+}
+
 static bool EvaluateInputAST(const char *Filename,
                              const MemoryBuffer *MB,
                              ExprBuilder *Builder) {
@@ -214,19 +316,12 @@ static bool EvaluateInputAST(const char *Filename,
   if (!success)
     return false;
 
-  Solver *coreSolver = klee::createCoreSolver(CoreSolverToUse);
-
-  if (CoreSolverToUse != DUMMY_SOLVER) {
-    if (0 != MaxCoreSolverTime) {
-      coreSolver->setCoreSolverTimeout(MaxCoreSolverTime);
-    }
-  }
+  // Structurally equal expressions in the input share a single node.
+  if (HashConsExprs)
+    llvm::outs() << "Interned expressions: " << Expr::getInternedCount()
+                 << "\n";
 
-  Solver *S = constructSolverChain(coreSolver,
-                                   getQueryLogPath(ALL_QUERIES_SMT2_FILE_NAME),
-                                   getQueryLogPath(SOLVER_QUERIES_SMT2_FILE_NAME),
-                                   getQueryLogPath(ALL_QUERIES_PC_FILE_NAME),
-                                   getQueryLogPath(SOLVER_QUERIES_PC_FILE_NAME));
+  Solver *S = createSolver();
 
   unsigned Index = 0;
   for (std::vector<Decl*>::iterator it = Decls.begin(),
@@ -327,6 +422,621 @@ static bool EvaluateInputAST(const char *Filename,
   return success;
 }
 
+static void printLoggedResult(llvm::raw_ostream &os, QueryLogEntry::Type type,
+                              uint64_t result) {
+  switch (type) {
+  case QueryLogEntry::Truth:
+  case QueryLogEntry::Cex:
+    // A counterexample exists exactly when the query is invalid.
+    os << ((result != 0) == (type == QueryLogEntry::Truth) ? "VALID"
+                                                           : "INVALID");
+    break;
+  case QueryLogEntry::Validity:
+    os << (result == Solver::True + 1 ? "TRUE"
+           : result == Solver::False + 1 ? "FALSE" : "UNKNOWN");
+    break;
+  case QueryLogEntry::Value:
+    os << "VALUE " << result;
+    break;
+  }
+}
+
+/// Pose \a entry to \a S in the form it was logged in, storing its result
+/// in the encoding of the binary query log.
+static bool runLoggedQuery(Solver *S, const QueryLogEntry &entry,
+                           uint64_t &result) {
+  ConstraintManager constraints(entry.exprs);
+  Query query(constraints, entry.query);
+
+  bool success = false;
+  result = 0;
+  switch (entry.type) {
+  case QueryLogEntry::Truth: {
+    bool isValid;
+    success = S->impl->computeTruth(query, isValid);
+    result = isValid;
+    break;
+  }
+  case QueryLogEntry::Validity: {
+    Solver::Validity validity;
+    success = S->impl->computeValidity(query, validity);
+    result = validity + 1;
+    break;
+  }
+  case QueryLogEntry::Value: {
+    ref<Expr> value;
+    success = S->impl->computeValue(query, value);
+    if (success)
+      if (ConstantExpr *CE = dyn_cast<ConstantExpr>(value))
+        if (CE->getWidth() <= Expr::Int64)
+          result = CE->getZExtValue();
+    break;
+  }
+  case QueryLogEntry::Cex: {
+    std::vector< std::vector<unsigned char> > values;
+    bool hasSolution;
+    success = S->impl->computeInitialValues(query, entry.objects, values,
+                                            hasSolution);
+    result = hasSolution;
+    break;
+  }
+  }
+  return success;
+}
+
+/// Print the queries of a binary query log in KQuery form.
+static bool PrintQueryLog(const char *Filename, const MemoryBuffer *MB,
+                          ExprBuilder *Builder) {
+  ArrayCache arrayCache;
+  QueryLogReader reader(MB->getBufferStart(), MB->getBufferEnd(), Builder,
+                        arrayCache);
+  QueryLogEntry entry;
+  QueryLogResult result;
+  for (unsigned index = 0; reader.read(entry, result); ++index) {
+    llvm::outs() << "# Query " << index << " -- Instructions: "
+                 << entry.instruction << "\n";
+
+    ConstraintManager constraints(entry.exprs);
+    ref<Expr> query = entry.query;
+    const ref<Expr> *evalExprsBegin = 0, *evalExprsEnd = 0;
+    if (entry.type == QueryLogEntry::Value) {
+      evalExprsBegin = &entry.query;
+      evalExprsEnd = evalExprsBegin + 1;
+      query = ConstantExpr::alloc(0, Expr::Bool);
+    }
+    const Array *const *evalArraysBegin = 0, *const *evalArraysEnd = 0;
+    if (!entry.objects.empty()) {
+      evalArraysBegin = &entry.objects[0];
+      evalArraysEnd = evalArraysBegin + entry.objects.size();
+    }
+    ExprPPrinter::printQuery(llvm::outs(), constraints, query,
+                             evalExprsBegin, evalExprsEnd,
+                             evalArraysBegin, evalArraysEnd);
+
+    llvm::outs() << "#   ";
+    if (result.time < 0)
+      llvm::outs() << "FAIL";
+    else
+      printLoggedResult(llvm::outs(), entry.type, result.result);
+    llvm::outs() << " -- Elapsed: " << result.time << "\n\n";
+  }
+
+  if (!reader.getError().empty()) {
+    llvm::errs() << Filename << ": " << reader.getError() << "\n";
+    return false;
+  }
+  return true;
+}
+
+/// Replay the queries of a binary query log, in the form in which they were
+/// posed, comparing the results with the logged ones.
+static bool ReplayQueryLog(const char *Filename, const MemoryBuffer *MB,
+                           ExprBuilder *Builder) {
+  ArrayCache arrayCache;
+  QueryLogReader reader(MB->getBufferStart(), MB->getBufferEnd(), Builder,
+                        arrayCache);
+  Solver *S = createSolver();
+
+  unsigned index = 0, mismatches = 0;
+  double loggedTime = 0, replayTime = 0;
+  QueryLogEntry entry;
+  QueryLogResult logged;
+  for (; reader.read(entry, logged); ++index) {
+    uint64_t result;
+    double start = util::getWallTime();
+    bool success = runLoggedQuery(S, entry, result);
+    replayTime += util::getWallTime() - start;
+
+    llvm::outs() << "Query " << index << ":\t";
+    if (!success) {
+      llvm::outs() << "FAIL (reason: "
+                   << SolverImpl::getOperationStatusString(
+                          S->impl->getOperationStatusCode())
+                   << ")";
+    } else {
+      printLoggedResult(llvm::outs(), entry.type, result);
+    }
+
+    if (logged.time >= 0) {
+      loggedTime += logged.time;
+      // Any model value may be returned, so only decisions are compared.
+      if (entry.type != QueryLogEntry::Value &&
+          (!success || result != logged.result)) {
+        llvm::outs() << "\tMISMATCH (logged: ";
+        printLoggedResult(llvm::outs(), entry.type, logged.result);
+        llvm::outs() << ")";
+        ++mismatches;
+      }
+    }
+    llvm::outs() << "\n";
+  }
+
+  delete S;
+
+  llvm::outs() << "--\n"
+               << "replayed queries = " << index << "\n"
+               << "mismatches = " << mismatches << "\n"
+               << "logged time = " << loggedTime << "\n"
+               << "replay time = " << replayTime << "\n";
+
+  if (!reader.getError().empty()) {
+    llvm::errs() << Filename << ": " << reader.getError() << "\n";
+    return false;
+  }
+  return true;
+}
+
+/// A solver chain configuration to benchmark.
+struct BenchmarkConfig {
+  std::string name;
+  CoreSolverType coreSolver;
+  bool cexCache, cache, interval, independent;
+};
+
+/// The outcome of running one query of a benchmark file.
+struct BenchmarkResult {
+  QueryLogEntry::Type type;
+  SolverImpl::SolverRunStatus status;
+  bool success;
+  uint64_t result;
+  double time;
+};
+
+static const char *getCoreSolverName(CoreSolverType type) {
+  switch (type) {
+  case STP_SOLVER: return "stp";
+  case METASMT_SOLVER: return "metasmt";
+  case DUMMY_SOLVER: return "dummy";
+  case Z3_SOLVER: return "z3";
+  default: return "none";
+  }
+}
+
+static const char *getQueryTypeName(QueryLogEntry::Type type) {
+  switch (type) {
+  case QueryLogEntry::Validity: return "validity";
+  case QueryLogEntry::Truth: return "truth";
+  case QueryLogEntry::Value: return "value";
+  case QueryLogEntry::Cex: return "cex";
+  }
+  return "unknown";
+}
+
+/// Parse a '+'-separated benchmark configuration such as "z3+cex+indep".
+static bool parseBenchmarkConfig(const std::string &spec,
+                                 BenchmarkConfig &config) {
+  config.name = spec;
+  config.coreSolver = CoreSolverToUse;
+  config.cexCache = config.cache = config.interval = false;
+  config.independent = false;
+
+  std::string::size_type start = 0;
+  while (start <= spec.size()) {
+    std::string::size_type end = spec.find('+', start);
+    if (end == std::string::npos)
+      end = spec.size();
+    std::string part = spec.substr(start, end - start);
+    if (part == "stp")
+      config.coreSolver = STP_SOLVER;
+    else if (part == "metasmt")
+      config.coreSolver = METASMT_SOLVER;
+    else if (part == "dummy")
+      config.coreSolver = DUMMY_SOLVER;
+    else if (part == "z3")
+      config.coreSolver = Z3_SOLVER;
+    else if (part == "cex")
+      config.cexCache = true;
+    else if (part == "cache")
+      config.cache = true;
+    else if (part == "interval")
+      config.interval = true;
+    else if (part == "indep")
+      config.independent = true;
+    else if (part != "core") {
+      llvm::errs() << "kleaver: error: invalid benchmark configuration \""
+                   << spec << "\": unknown component \"" << part << "\"\n";
+      return false;
+    }
+    start = end + 1;
+  }
+  return true;
+}
+
+static Solver *createBenchmarkSolver(const BenchmarkConfig &config) {
+  SolverChainOptions options;
+  options.coreSolver = config.coreSolver;
+  options.cexCache = config.cexCache;
+  options.cache = config.cache;
+  options.interval = config.interval;
+  options.independent = config.independent;
+  return createSolver(options);
+}
+
+static MemoryBuffer *readFile(const std::string &path, std::string &error) {
+#if LLVM_VERSION_CODE < LLVM_VERSION(3, 5)
+  OwningPtr<MemoryBuffer> MB;
+  error_code ec = MemoryBuffer::getFile(path.c_str(), MB);
+  if (ec) {
+    error = ec.message();
+    return 0;
+  }
+  return MB.take();
+#else
+  auto MBResult = MemoryBuffer::getFile(path.c_str());
+  if (!MBResult) {
+    error = MBResult.getError().message();
+    return 0;
+  }
+  return MBResult->release();
+#endif
+}
+
+namespace {
+  /// Runs the queries of one file against one configuration.
+  ///
+  /// Every task parses its file with its own builder and solver chain, as
+  /// expressions may not be shared between threads. The chain is fresh for
+  /// every file, so that its caches only hold queries of that file and the
+  /// results do not depend on the number of threads.
+  class BenchmarkTask : public WorkerPool::Task {
+  public:
+    const BenchmarkConfig &config;
+    std::string path;
+    std::string error;
+    std::vector<BenchmarkResult> results;
+
+    BenchmarkTask(const BenchmarkConfig &_config, const std::string &_path)
+      : config(_config), path(_path) {}
+
+    void run(unsigned worker);
+  };
+}
+
+void BenchmarkTask::run(unsigned worker) {
+  MemoryBuffer *MB = readFile(path, error);
+  if (!MB)
+    return;
+
+  ExprBuilder *builder = createBuilder();
+  ArrayCache arrayCache;
+  Parser *P = 0;
+  std::vector<Decl*> decls;
+  std::vector<QueryLogEntry> queries;
+
+  if (QueryLogReader::isQueryLog(MB->getBufferStart(), MB->getBufferEnd())) {
+    QueryLogReader reader(MB->getBufferStart(), MB->getBufferEnd(), builder,
+                          arrayCache);
+    QueryLogEntry entry;
+    QueryLogResult logged;
+    while (reader.read(entry, logged))
+      queries.push_back(entry);
+    error = reader.getError();
+  } else {
+    P = Parser::Create(path, MB, builder, ClearArrayAfterQuery);
+    P->SetMaxErrors(20);
+    while (Decl *D = P->ParseTopLevelDecl()) {
+      decls.push_back(D);
+      QueryCommand *QC = dyn_cast<QueryCommand>(D);
+      if (!QC)
+        continue;
+
+      // Pose the query the way the evaluate action does.
+      QueryLogEntry entry;
+      entry.exprs = QC->Constraints;
+      entry.instruction = 0;
+      if (QC->Values.empty() && QC->Objects.empty()) {
+        entry.type = QueryLogEntry::Truth;
+        entry.query = QC->Query;
+      } else if (!QC->Values.empty()) {
+        entry.type = QueryLogEntry::Value;
+        entry.query = QC->Values[0];
+      } else {
+        entry.type = QueryLogEntry::Cex;
+        entry.query = QC->Query;
+        entry.objects = QC->Objects;
+      }
+      queries.push_back(entry);
+    }
+    if (unsigned N = P->GetNumErrors()) {
+      std::string str;
+      llvm::raw_string_ostream os(str);
+      os << "parse failure: " << N << " errors.";
+      error = os.str();
+    }
+  }
+
+  if (error.empty()) {
+    Solver *S = createBenchmarkSolver(config);
+    if (!S) {
+      error = "cannot create the core solver";
+    } else {
+      for (unsigned i = 0; i != queries.size(); ++i) {
+        BenchmarkResult result;
+        result.type = queries[i].type;
+        double start = util::getWallTime();
+        result.success = runLoggedQuery(S, queries[i], result.result);
+        result.time = util::getWallTime() - start;
+        result.status = S->impl->getOperationStatusCode();
+        results.push_back(result);
+      }
+      delete S;
+    }
+  }
+
+  // The queries refer to arrays owned by the parser.
+  queries.clear();
+  for (std::vector<Decl*>::iterator it = decls.begin(), ie = decls.end();
+       it != ie; ++it)
+    delete *it;
+  delete P;
+  delete builder;
+  delete MB;
+}
+
+static std::string jsonString(const std::string &s) {
+  std::string str;
+  llvm::raw_string_ostream os(str);
+  os << '"';
+  for (unsigned i = 0; i != s.size(); ++i) {
+    unsigned char c = s[i];
+    if (c == '"' || c == '\\')
+      os << '\\' << c;
+    else if (c < 0x20)
+      os << "\\u00" << hexdigit(c >> 4) << hexdigit(c & 0xF);
+    else
+      os << c;
+  }
+  os << '"';
+  return os.str();
+}
+
+/// Return the \a p-th percentile (nearest rank) of the sorted \a times.
+static double percentile(const std::vector<double> &times, unsigned p) {
+  if (times.empty())
+    return 0;
+  unsigned rank = (p * times.size() + 99) / 100;
+  return times[rank ? rank - 1 : 0];
+}
+
+/// Run every query file of a directory (or a single query file) against
+/// each of the -benchmark-config solver configurations, and report the
+/// latency distribution, failures, timeouts and disagreements with the
+/// first configuration.
+static bool RunBenchmark(const std::string &input) {
+  std::vector<BenchmarkConfig> configs;
+  for (unsigned i = 0; i != BenchmarkConfigs.size(); ++i) {
+    BenchmarkConfig config;
+    if (!parseBenchmarkConfig(BenchmarkConfigs[i], config))
+      return false;
+    configs.push_back(config);
+  }
+  if (configs.empty()) {
+    BenchmarkConfig config;
+    config.name = getCoreSolverName(CoreSolverToUse);
+    config.coreSolver = CoreSolverToUse;
+    config.cexCache = UseCexCache;
+    config.cache = UseCache;
+    config.interval = UseIntervalSolver;
+    config.independent = UseIndependentSolver;
+    if (config.cexCache)
+      config.name += "+cex";
+    if (config.cache)
+      config.name += "+cache";
+    if (config.interval)
+      config.name += "+interval";
+    if (config.independent)
+      config.name += "+indep";
+    configs.push_back(config);
+  }
+
+  std::vector<std::string> files;
+  if (llvm::sys::fs::is_directory(input)) {
+#if LLVM_VERSION_CODE < LLVM_VERSION(3, 5)
+    error_code ec;
+#else
+    std::error_code ec;
+#endif
+    for (llvm::sys::fs::directory_iterator i(input, ec), e; i != e && !ec;
+         i.increment(ec)) {
+      std::string f = (*i).path();
+      StringRef ext = llvm::sys::path::extension(f);
+      if (ext == ".kquery" || ext == ".pc" || ext == ".kqlog")
+        files.push_back(f);
+    }
+    if (ec) {
+      llvm::errs() << "kleaver: error: unable to read directory " << input
+                   << ": " << ec.message() << "\n";
+      return false;
+    }
+    std::sort(files.begin(), files.end());
+  } else {
+    files.push_back(input);
+  }
+
+  unsigned numThreads = std::max(1U, (unsigned) BenchmarkThreads);
+  if (numThreads > 1 && HashConsExprs) {
+    // The intern table is shared by all threads and not locked.
+    llvm::errs() << "kleaver: error: --hash-cons-exprs cannot be used with "
+                 << "--benchmark-threads\n";
+    return false;
+  }
+  for (unsigned i = 0; i != configs.size(); ++i) {
+    if (numThreads > 1 && configs[i].coreSolver != Z3_SOLVER &&
+        configs[i].coreSolver != DUMMY_SOLVER) {
+      llvm::errs() << "kleaver: warning: --benchmark-threads requires the Z3 "
+                   << "core solver, running queries on a single thread\n";
+      numThreads = 1;
+      break;
+    }
+  }
+  if (!queryLoggingOptions.empty()) {
+    llvm::errs() << "kleaver: warning: query logging is disabled when "
+                 << "benchmarking\n";
+    queryLoggingOptions.clear();
+  }
+
+  std::vector<BenchmarkTask*> tasks;
+  for (unsigned i = 0; i != configs.size(); ++i)
+    for (unsigned j = 0; j != files.size(); ++j)
+      tasks.push_back(new BenchmarkTask(configs[i], files[j]));
+  {
+    WorkerPool pool(numThreads);
+    for (unsigned i = 0; i != tasks.size(); ++i)
+      pool.enqueue(tasks[i]);
+    pool.wait();
+  }
+
+  bool success = true;
+  for (unsigned i = 0; i != tasks.size(); ++i) {
+    if (!tasks[i]->error.empty()) {
+      llvm::errs() << tasks[i]->path << " (" << tasks[i]->config.name
+                   << "): " << tasks[i]->error << "\n";
+      success = false;
+    }
+  }
+
+  // Per-query records, in the order of configurations, files and queries.
+  std::string records;
+  llvm::raw_string_ostream os(records);
+  bool json = BenchmarkFormat == BenchmarkJSON;
+  if (json)
+    os << "{\n  \"queries\": [";
+  else
+    os << "config,file,query,type,status,result,time\n";
+  bool first = true;
+
+  std::vector<unsigned> disagreements(configs.size(), 0);
+  for (unsigned i = 0; i != configs.size(); ++i) {
+    for (unsigned j = 0; j != files.size(); ++j) {
+      const std::vector<BenchmarkResult> &results =
+          tasks[i * files.size() + j]->results;
+      const std::vector<BenchmarkResult> &reference = tasks[j]->results;
+      for (unsigned k = 0; k != results.size(); ++k) {
+        const BenchmarkResult &r = results[k];
+        const char *status =
+            r.success ? "ok"
+                      : r.status == SolverImpl::SOLVER_RUN_STATUS_TIMEOUT
+                            ? "timeout" : "fail";
+        std::string resultStr;
+        if (r.success) {
+          llvm::raw_string_ostream ros(resultStr);
+          printLoggedResult(ros, r.type, r.result);
+          ros.flush();
+        }
+        // Any model value may be returned, so only decisions are compared.
+        if (i && k < reference.size() && r.success && reference[k].success &&
+            r.type != QueryLogEntry::Value && r.result != reference[k].result)
+          ++disagreements[i];
+
+        if (json) {
+          os << (first ? "\n" : ",\n")
+             << "    {\"config\": " << jsonString(configs[i].name)
+             << ", \"file\": " << jsonString(files[j])
+             << ", \"query\": " << k
+             << ", \"type\": \"" << getQueryTypeName(r.type) << "\""
+             << ", \"status\": \"" << status << "\""
+             << ", \"result\": " << jsonString(resultStr)
+             << ", \"time\": " << r.time << "}";
+        } else {
+          os << configs[i].name << "," << files[j] << "," << k << ","
+             << getQueryTypeName(r.type) << "," << status << "," << resultStr
+             << "," << r.time << "\n";
+        }
+        first = false;
+      }
+    }
+  }
+
+  // Per-configuration summaries.
+  if (json)
+    os << "\n  ],\n  \"configs\": [";
+  for (unsigned i = 0; i != configs.size(); ++i) {
+    unsigned queries = 0, failures = 0, timeouts = 0;
+    double total = 0;
+    std::vector<double> times;
+    for (unsigned j = 0; j != files.size(); ++j) {
+      const std::vector<BenchmarkResult> &results =
+          tasks[i * files.size() + j]->results;
+      for (unsigned k = 0; k != results.size(); ++k) {
+        ++queries;
+        total += results[k].time;
+        if (results[k].success)
+          times.push_back(results[k].time);
+        else if (results[k].status == SolverImpl::SOLVER_RUN_STATUS_TIMEOUT)
+          ++timeouts;
+        else
+          ++failures;
+      }
+    }
+    std::sort(times.begin(), times.end());
+
+    llvm::outs() << (i ? "\n" : "")
+                 << "Config " << i << ":\t" << configs[i].name << "\n"
+                 << "queries = " << queries << "\n"
+                 << "failures = " << failures << "\n"
+                 << "timeouts = " << timeouts << "\n"
+                 << "disagreements = " << disagreements[i] << "\n"
+                 << "total time = " << total << "\n"
+                 << "mean time = " << (queries ? total / queries : 0) << "\n"
+                 << "p50 time = " << percentile(times, 50) << "\n"
+                 << "p90 time = " << percentile(times, 90) << "\n"
+                 << "p99 time = " << percentile(times, 99) << "\n"
+                 << "max time = " << (times.empty() ? 0 : times.back())
+                 << "\n";
+
+    if (json)
+      os << (i ? ",\n" : "\n")
+         << "    {\"config\": " << jsonString(configs[i].name)
+         << ", \"queries\": " << queries
+         << ", \"failures\": " << failures
+         << ", \"timeouts\": " << timeouts
+         << ", \"disagreements\": " << disagreements[i]
+         << ", \"total\": " << total
+         << ", \"mean\": " << (queries ? total / queries : 0)
+         << ", \"p50\": " << percentile(times, 50)
+         << ", \"p90\": " << percentile(times, 90)
+         << ", \"p99\": " << percentile(times, 99)
+         << ", \"max\": " << (times.empty() ? 0 : times.back()) << "}";
+  }
+  if (json)
+    os << "\n  ]\n}\n";
+  os.flush();
+
+  for (unsigned i = 0; i != tasks.size(); ++i)
+    delete tasks[i];
+
+  if (!BenchmarkOutput.empty()) {
+    std::ofstream out(BenchmarkOutput.c_str());
+    out << records;
+    if (!out) {
+      llvm::errs() << "kleaver: error: unable to write "
+                   << BenchmarkOutput << "\n";
+      return false;
+    }
+  }
+  return success;
+}
+
 static bool printInputAsSMTLIBv2(const char *Filename,
                              const MemoryBuffer *MB,
                              ExprBuilder *Builder)
@@ -402,6 +1112,21 @@ int main(int argc, char **argv) {
   llvm::cl::SetVersionPrinter(klee::printVersion);
   llvm::cl::ParseCommandLineOptions(argc, argv);
 
+  // Worker solvers destroy their copies of the expressions, which looks
+  // them up in the intern table while this thread may be adding to it.
+  if (HashConsExprs && IndependentSolverThreads) {
+    llvm::errs() << argv[0] << ": error: --hash-cons-exprs cannot be used "
+                 << "with --independent-solver-threads\n";
+    return 1;
+  }
+
+  // The input of a benchmark is usually a directory of query files.
+  if (ToolAction == Benchmark) {
+    success = RunBenchmark(InputFile);
+    llvm::llvm_shutdown();
+    return success ? 0 : 1;
+  }
+
   std::string ErrorStr;
   
 #if LLVM_VERSION_CODE < LLVM_VERSION(3,5)
@@ -421,20 +1146,26 @@ int main(int argc, char **argv) {
   std::unique_ptr<MemoryBuffer> &MB = *MBResult;
 #endif
   
-  ExprBuilder *Builder = 0;
-  switch (BuilderKind) {
-  case DefaultBuilder:
-    Builder = createDefaultExprBuilder();
-    break;
-  case ConstantFoldingBuilder:
-    Builder = createDefaultExprBuilder();
-    Builder = createConstantFoldingExprBuilder(Builder);
-    break;
-  case SimplifyingBuilder:
-    Builder = createDefaultExprBuilder();
-    Builder = createConstantFoldingExprBuilder(Builder);
-    Builder = createSimplifyingExprBuilder(Builder);
-    break;
+  ExprBuilder *Builder = createBuilder();
+
+  // Binary query logs are printed or replayed directly.
+  const char *Filename = InputFile=="-" ? "<stdin>" : InputFile.c_str();
+  if (QueryLogReader::isQueryLog(MB->getBufferStart(), MB->getBufferEnd())) {
+    switch (ToolAction) {
+    case PrintAST:
+      success = PrintQueryLog(Filename, MB.get(), Builder);
+      break;
+    case Evaluate:
+      success = ReplayQueryLog(Filename, MB.get(), Builder);
+      break;
+    default:
+      llvm::errs() << argv[0] << ": error: Unsupported action for a binary "
+                   << "query log!\n";
+      success = false;
+    }
+    delete Builder;
+    llvm::llvm_shutdown();
+    return success ? 0 : 1;
   }
 
   switch (ToolAction) {
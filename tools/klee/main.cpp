@@ -19,6 +19,7 @@
 #include "klee/Internal/ADT/TreeStream.h"
 #include "klee/Internal/Support/Debug.h"
 #include "klee/Internal/Support/ModuleUtil.h"
+#include "klee/Internal/System/Thread.h"
 #include "klee/Internal/System/Time.h"
 #include "klee/Internal/Support/PrintVersion.h"
 #include "klee/Internal/Support/ErrorHandling.h"
@@ -61,15 +62,18 @@
 #endif
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <signal.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
 
+#include <cctype>
 #include <cerrno>
 #include <fstream>
 #include <iomanip>
 #include <iterator>
+#include <set>
 #include <sstream>
 
 
@@ -195,6 +199,50 @@ namespace {
                  cl::desc("Specify a path file to replay"),
                  cl::value_desc("path file"));
 
+  cl::opt<bool>
+  ReplayPathPrefix("replay-path-prefix",
+                   cl::desc("Only fix the first branch decisions with "
+                            "--replay-path, then explore as usual"));
+
+  cl::opt<unsigned>
+  SwarmWorkers("swarm-workers",
+               cl::desc("Explore each state reaching "
+                        "--swarm-frontier-depth branches in its own klee "
+                        "process, running this many at once, and merge "
+                        "their output (default=0 (off))"),
+               cl::init(0));
+
+  cl::opt<unsigned>
+  SwarmFrontierDepth("swarm-frontier-depth",
+                     cl::desc("Number of branches explored before states "
+                              "are handed to swarm workers (default=6)"),
+                     cl::init(6));
+
+  cl::opt<double>
+  CheckpointInterval("checkpoint-interval",
+                     cl::desc("Write the live states to the checkpoint file "
+                              "in the output directory every this many "
+                              "seconds, and when execution halts "
+                              "(default=0 (off))"),
+                     cl::init(0));
+
+  cl::opt<bool>
+  CheckpointOnSignal("checkpoint-on-signal",
+                     cl::desc("Write the live states to the checkpoint file "
+                              "on SIGUSR1, and when execution halts"));
+
+  cl::opt<std::string>
+  ResumeCheckpoint("resume-checkpoint",
+                   cl::desc("Resume the live states of a checkpoint written "
+                            "by an earlier run on the same program"),
+                   cl::value_desc("checkpoint file"));
+
+  cl::opt<int>
+  SwarmReportFD("swarm-report-fd",
+                cl::desc("Write the results of a swarm worker to this file "
+                         "descriptor (used internally by --swarm-workers)"),
+                cl::init(-1), cl::Hidden);
+
   cl::list<std::string>
   SeedOutFile("seed-out");
 
@@ -218,6 +266,14 @@ namespace {
 	     cl::desc("Stop execution after generating the given number of tests.  Extra tests corresponding to partially explored paths will also be dumped."),
 	     cl::init(0));
 
+  cl::opt<unsigned>
+  AsyncTestGenerationThreads("async-test-generation-threads",
+                             cl::desc("Solve for and write test cases on this "
+                                      "many background threads instead of on "
+                                      "the exploration thread (requires "
+                                      "--solver-backend=z3, default=0 (off))"),
+                             cl::init(0));
+
   cl::opt<bool>
   Watchdog("watchdog",
            cl::desc("Use a watchdog process to enforce --max-time."),
@@ -228,11 +284,23 @@ extern cl::opt<double> MaxTime;
 
 /***/
 
+/// TestCaseOutput - The parts of a test case which depend on the terminated
+/// state but not on the solver, captured before the state goes away.
+struct TestCaseOutput {
+  unsigned id; // 0 until the test case is numbered
+  bool hasError;
+  std::string errorMessage, errorSuffix;
+  bool hasPath, hasSymPath;
+  std::vector<unsigned char> concreteBranches, symbolicBranches;
+  std::map<const std::string*, std::set<unsigned> > cov;
+};
+
 class KleeHandler : public InterpreterHandler {
 private:
   Interpreter *m_interpreter;
   TreeStreamWriter *m_pathWriter, *m_symPathWriter;
   llvm::raw_ostream *m_infoFile;
+  WorkerPool *m_testCasePool; // null unless test cases are written async
 
   SmallString<128> m_outputDirectory;
 
@@ -270,6 +338,9 @@ private:
 
   std::string m_subsumptionStats; // subsumption statistics result
 
+  // .path files of the states handed to swarm workers
+  std::vector<std::string> m_frontier;
+
   // used for writing .ktest files
   int m_argc;
   char **m_argv;
@@ -283,6 +354,11 @@ public:
   unsigned getNumPathsExplored() { return m_pathsExplored; }
   void incPathsExplored() { m_pathsExplored++; }
 
+  // account for the tests and paths of a merged swarm worker
+  void addTestCases(unsigned n) { m_testIndex += n; }
+  void addPathsExplored(unsigned n) { m_pathsExplored += n; }
+  const std::vector<std::string> &getFrontier() const { return m_frontier; }
+
   void incBranchingDepthOnExitTermination(unsigned branchingDepth) {
     m_totalBranchingDepthOnExitTermination += branchingDepth;
   }
@@ -376,10 +452,19 @@ public:
 
   void setInterpreter(Interpreter *i);
 
+  void processFrontierState(const ExecutionState &state);
+
   void processTestCase(const ExecutionState  &state,
                        const char *errorMessage,
                        const char *errorSuffix);
 
+  /// Solve for and write out a test case, taking ownership of \a snapshot.
+  /// Called on a background thread when test cases are written async.
+  void writeTestCase(const TestCaseOutput &tc, TestCaseSnapshot *snapshot);
+
+  /// Block until all test cases handed to background threads are written.
+  void waitForTestCases();
+
   std::string getOutputFilename(const std::string &filename);
   llvm::raw_fd_ostream *openOutputFile(const std::string &filename);
   std::string getTestFilename(const std::string &suffix, unsigned id);
@@ -397,7 +482,7 @@ public:
 
 KleeHandler::KleeHandler(int argc, char **argv)
     : m_interpreter(0), m_pathWriter(0), m_symPathWriter(0), m_infoFile(0),
-      m_outputDirectory(), m_testIndex(0), m_pathsExplored(0),
+      m_testCasePool(0), m_outputDirectory(), m_testIndex(0), m_pathsExplored(0),
       m_totalBranchingDepthOnExitTermination(0),
       m_totalInstructionsDepthOnExitTermination(0),
       m_totalBranchingDepthOnEarlyTermination(0),
@@ -480,6 +565,7 @@ KleeHandler::KleeHandler(int argc, char **argv)
 }
 
 KleeHandler::~KleeHandler() {
+  delete m_testCasePool;
   if (m_pathWriter) delete m_pathWriter;
   if (m_symPathWriter) delete m_symPathWriter;
   fclose(klee_warning_file);
@@ -490,7 +576,8 @@ KleeHandler::~KleeHandler() {
 void KleeHandler::setInterpreter(Interpreter *i) {
   m_interpreter = i;
 
-  if (WritePaths) {
+  // swarm workers are started from the paths of the frontier states
+  if (WritePaths || SwarmWorkers) {
     m_pathWriter = new TreeStreamWriter(getOutputFilename("paths.ts"));
     assert(m_pathWriter->good());
     m_interpreter->setPathWriter(m_pathWriter);
@@ -501,6 +588,14 @@ void KleeHandler::setInterpreter(Interpreter *i) {
     assert(m_symPathWriter->good());
     m_interpreter->setSymbolicPathWriter(m_symPathWriter);
   }
+
+  if (AsyncTestGenerationThreads) {
+    if (CoreSolverToUse != Z3_SOLVER)
+      klee_warning("--async-test-generation-threads requires the Z3 core "
+                   "solver, writing test cases synchronously");
+    else
+      m_testCasePool = new WorkerPool(AsyncTestGenerationThreads);
+  }
 }
 
 std::string KleeHandler::getOutputFilename(const std::string &filename) {
@@ -544,6 +639,72 @@ llvm::raw_fd_ostream *KleeHandler::openTestFile(const std::string &suffix,
 }
 
 
+namespace {
+  /// StateTestCaseSnapshot - Answers for a live state through the
+  /// interpreter; used when test cases are written synchronously.
+  class StateTestCaseSnapshot : public TestCaseSnapshot {
+    Interpreter *interpreter;
+    const ExecutionState &state;
+
+  public:
+    StateTestCaseSnapshot(Interpreter *_interpreter,
+                          const ExecutionState &_state)
+        : interpreter(_interpreter), state(_state) {}
+
+    void getConstraintLog(std::string &res, Interpreter::LogType logFormat) {
+      interpreter->getConstraintLog(state, res, logFormat);
+    }
+
+    bool getSymbolicSolution(std::vector<
+                             std::pair<std::string,
+                             std::vector<unsigned char> > > &res) {
+      return interpreter->getSymbolicSolution(state, res);
+    }
+  };
+
+  class TestCaseTask : public WorkerPool::Task {
+    KleeHandler *handler;
+    TestCaseOutput tc;
+    TestCaseSnapshot *snapshot;
+
+  public:
+    TestCaseTask(KleeHandler *_handler, TestCaseSnapshot *_snapshot)
+        : handler(_handler), snapshot(_snapshot) {}
+
+    TestCaseOutput &getOutput() { return tc; }
+
+    void run(unsigned worker) {
+      handler->writeTestCase(tc, snapshot);
+      delete this;
+    }
+  };
+}
+
+/* Writes the branch decisions leading to a frontier state, from which a
+   swarm worker continues exploring it */
+void KleeHandler::processFrontierState(const ExecutionState &state) {
+  if (m_frontier.empty() && mkdir(getOutputFilename("swarm").c_str(), 0775) < 0)
+    klee_error("cannot create \"%s\": %s",
+               getOutputFilename("swarm").c_str(), strerror(errno));
+
+  std::vector<unsigned char> branches;
+  m_pathWriter->readStream(m_interpreter->getPathStreamID(state), branches);
+
+  std::stringstream filename;
+  filename << "swarm/prefix" << std::setfill('0') << std::setw(6)
+           << m_frontier.size() + 1 << ".path";
+  llvm::raw_fd_ostream *f = openOutputFile(filename.str());
+  if (!f)
+    klee_error("cannot write swarm path prefix");
+  for (std::vector<unsigned char>::const_iterator I = branches.begin(),
+                                                  E = branches.end();
+       I != E; ++I) {
+    *f << *I << "\n";
+  }
+  delete f;
+  m_frontier.push_back(getOutputFilename(filename.str()));
+}
+
 /* Outputs all files (.ktest, .pc, .cov etc.) describing a test case */
 void KleeHandler::processTestCase(const ExecutionState &state,
                                   const char *errorMessage,
@@ -554,125 +715,169 @@ void KleeHandler::processTestCase(const ExecutionState &state,
   }
 
   if (!NoOutput) {
-    std::vector< std::pair<std::string, std::vector<unsigned char> > > out;
-    bool success = m_interpreter->getSymbolicSolution(state, out);
-
-    if (!success)
-      klee_warning("unable to get symbolic solution, losing test case");
-
-    double start_time = util::getWallTime();
-
-    unsigned id = ++m_testIndex;
-
-    if (success) {
-      KTest b;
-      b.numArgs = m_argc;
-      b.args = m_argv;
-      b.symArgvs = 0;
-      b.symArgvLen = 0;
-      b.numObjects = out.size();
-      b.objects = new KTestObject[b.numObjects];
-      assert(b.objects);
-      for (unsigned i=0; i<b.numObjects; i++) {
-        KTestObject *o = &b.objects[i];
-        o->name = const_cast<char*>(out[i].first.c_str());
-        o->numBytes = out[i].second.size();
-        o->bytes = new unsigned char[o->numBytes];
-        assert(o->bytes);
-        std::copy(out[i].second.begin(), out[i].second.end(), o->bytes);
-      }
+    TestCaseSnapshot *snapshot = 0;
+    if (m_testCasePool)
+      snapshot = m_interpreter->createTestCaseSnapshot(state);
 
-      if (!kTest_toFile(&b, getOutputFilename(getTestFilename("ktest", id)).c_str())) {
-        klee_warning("unable to write output test case, losing it");
-      }
-
-      for (unsigned i=0; i<b.numObjects; i++)
-        delete[] b.objects[i].bytes;
-      delete[] b.objects;
-    }
+    TestCaseTask *task = 0;
+    TestCaseOutput local;
+    if (snapshot)
+      task = new TestCaseTask(this, snapshot);
+    TestCaseOutput &tc = task ? task->getOutput() : local;
 
+    tc.hasError = errorMessage != 0;
     if (errorMessage) {
-      llvm::raw_ostream *f = openTestFile(errorSuffix, id);
-      *f << errorMessage;
-      delete f;
+      tc.errorMessage = errorMessage;
+      tc.errorSuffix = errorSuffix;
     }
 
-    if (m_pathWriter) {
-      std::vector<unsigned char> concreteBranches;
+    tc.hasPath = WritePaths;
+    if (WritePaths)
       m_pathWriter->readStream(m_interpreter->getPathStreamID(state),
-                               concreteBranches);
-      llvm::raw_fd_ostream *f = openTestFile("path", id);
-      for (std::vector<unsigned char>::iterator I = concreteBranches.begin(),
-                                                E = concreteBranches.end();
-           I != E; ++I) {
-        *f << *I << "\n";
-      }
-      delete f;
-    }
+                               tc.concreteBranches);
 
-    if (errorMessage || WritePCs) {
-      std::string constraints;
-      m_interpreter->getConstraintLog(state, constraints,Interpreter::KQUERY);
-      llvm::raw_ostream *f = openTestFile("pc", id);
-      *f << constraints;
-      delete f;
-    }
+    tc.hasSymPath = m_symPathWriter != 0;
+    if (m_symPathWriter)
+      m_symPathWriter->readStream(
+          m_interpreter->getSymbolicPathStreamID(state), tc.symbolicBranches);
 
-    if (WriteCVCs) {
-      // FIXME: If using Z3 as the core solver the emitted file is actually
-      // SMT-LIBv2 not CVC which is a bit confusing
-      std::string constraints;
-      m_interpreter->getConstraintLog(state, constraints, Interpreter::STP);
-      llvm::raw_ostream *f = openTestFile("cvc", id);
-      *f << constraints;
-      delete f;
+    if (WriteCov)
+      m_interpreter->getCoveredLines(state, tc.cov);
+
+    if (!task) {
+      // The id is taken once the solution is known, as it always was.
+      tc.id = 0;
+      writeTestCase(tc, new StateTestCaseSnapshot(m_interpreter, state));
+    } else {
+      tc.id = ++m_testIndex;
+      // Bound the number of cloned states waiting for a worker.
+      m_testCasePool->wait(4 * m_testCasePool->size());
+      m_testCasePool->enqueue(task);
     }
 
-    if(WriteSMT2s) {
-      std::string constraints;
-        m_interpreter->getConstraintLog(state, constraints, Interpreter::SMTLIB2);
-        llvm::raw_ostream *f = openTestFile("smt2", id);
-        *f << constraints;
-        delete f;
+    if (m_testIndex == StopAfterNTests)
+      m_interpreter->setHaltExecution(true);
+  }
+}
+
+void KleeHandler::waitForTestCases() {
+  if (m_testCasePool)
+    m_testCasePool->wait();
+}
+
+void KleeHandler::writeTestCase(const TestCaseOutput &tc,
+                                TestCaseSnapshot *snapshot) {
+  std::vector< std::pair<std::string, std::vector<unsigned char> > > out;
+  bool success = snapshot->getSymbolicSolution(out);
+
+  if (!success)
+    klee_warning("unable to get symbolic solution, losing test case");
+
+  double start_time = util::getWallTime();
+
+  unsigned id = tc.id ? tc.id : ++m_testIndex;
+
+  if (success) {
+    KTest b;
+    b.numArgs = m_argc;
+    b.args = m_argv;
+    b.symArgvs = 0;
+    b.symArgvLen = 0;
+    b.numObjects = out.size();
+    b.objects = new KTestObject[b.numObjects];
+    assert(b.objects);
+    for (unsigned i=0; i<b.numObjects; i++) {
+      KTestObject *o = &b.objects[i];
+      o->name = const_cast<char*>(out[i].first.c_str());
+      o->numBytes = out[i].second.size();
+      o->bytes = new unsigned char[o->numBytes];
+      assert(o->bytes);
+      std::copy(out[i].second.begin(), out[i].second.end(), o->bytes);
     }
 
-    if (m_symPathWriter) {
-      std::vector<unsigned char> symbolicBranches;
-      m_symPathWriter->readStream(m_interpreter->getSymbolicPathStreamID(state),
-                                  symbolicBranches);
-      llvm::raw_fd_ostream *f = openTestFile("sym.path", id);
-      for (std::vector<unsigned char>::iterator I = symbolicBranches.begin(), E = symbolicBranches.end(); I!=E; ++I) {
-        *f << *I << "\n";
-      }
-      delete f;
+    if (!kTest_toFile(&b, getOutputFilename(getTestFilename("ktest", id)).c_str())) {
+      klee_warning("unable to write output test case, losing it");
     }
 
-    if (WriteCov) {
-      std::map<const std::string*, std::set<unsigned> > cov;
-      m_interpreter->getCoveredLines(state, cov);
-      llvm::raw_ostream *f = openTestFile("cov", id);
-      for (std::map<const std::string*, std::set<unsigned> >::iterator
-             it = cov.begin(), ie = cov.end();
-           it != ie; ++it) {
-        for (std::set<unsigned>::iterator
-               it2 = it->second.begin(), ie = it->second.end();
-             it2 != ie; ++it2)
-          *f << *it->first << ":" << *it2 << "\n";
-      }
-      delete f;
+    for (unsigned i=0; i<b.numObjects; i++)
+      delete[] b.objects[i].bytes;
+    delete[] b.objects;
+  }
+
+  if (tc.hasError) {
+    llvm::raw_ostream *f = openTestFile(tc.errorSuffix, id);
+    *f << tc.errorMessage;
+    delete f;
+  }
+
+  if (tc.hasPath) {
+    llvm::raw_fd_ostream *f = openTestFile("path", id);
+    for (std::vector<unsigned char>::const_iterator
+             I = tc.concreteBranches.begin(), E = tc.concreteBranches.end();
+         I != E; ++I) {
+      *f << *I << "\n";
     }
+    delete f;
+  }
 
-    if (m_testIndex == StopAfterNTests)
-      m_interpreter->setHaltExecution(true);
+  if (tc.hasError || WritePCs) {
+    std::string constraints;
+    snapshot->getConstraintLog(constraints, Interpreter::KQUERY);
+    llvm::raw_ostream *f = openTestFile("pc", id);
+    *f << constraints;
+    delete f;
+  }
 
-    if (WriteTestInfo) {
-      double elapsed_time = util::getWallTime() - start_time;
-      llvm::raw_ostream *f = openTestFile("info", id);
-      *f << "Time to generate test case: "
-         << elapsed_time << "s\n";
+  if (WriteCVCs) {
+    // FIXME: If using Z3 as the core solver the emitted file is actually
+    // SMT-LIBv2 not CVC which is a bit confusing
+    std::string constraints;
+    snapshot->getConstraintLog(constraints, Interpreter::STP);
+    llvm::raw_ostream *f = openTestFile("cvc", id);
+    *f << constraints;
+    delete f;
+  }
+
+  if(WriteSMT2s) {
+    std::string constraints;
+      snapshot->getConstraintLog(constraints, Interpreter::SMTLIB2);
+      llvm::raw_ostream *f = openTestFile("smt2", id);
+      *f << constraints;
       delete f;
+  }
+
+  if (tc.hasSymPath) {
+    llvm::raw_fd_ostream *f = openTestFile("sym.path", id);
+    for (std::vector<unsigned char>::const_iterator
+             I = tc.symbolicBranches.begin(), E = tc.symbolicBranches.end();
+         I != E; ++I) {
+      *f << *I << "\n";
+    }
+    delete f;
+  }
+
+  if (WriteCov) {
+    llvm::raw_ostream *f = openTestFile("cov", id);
+    for (std::map<const std::string*, std::set<unsigned> >::const_iterator
+           it = tc.cov.begin(), ie = tc.cov.end();
+         it != ie; ++it) {
+      for (std::set<unsigned>::const_iterator
+             it2 = it->second.begin(), ie = it->second.end();
+           it2 != ie; ++it2)
+        *f << *it->first << ":" << *it2 << "\n";
     }
+    delete f;
   }
+
+  if (WriteTestInfo) {
+    double elapsed_time = util::getWallTime() - start_time;
+    llvm::raw_ostream *f = openTestFile("info", id);
+    *f << "Time to generate test case: "
+       << elapsed_time << "s\n";
+    delete f;
+  }
+
+  delete snapshot;
 }
 
   // load a .path file
@@ -1105,6 +1310,11 @@ static void interrupt_handle() {
   interrupted = true;
 }
 
+static void checkpoint_handle(int) {
+  if (theInterpreter)
+    theInterpreter->requestCheckpoint();
+}
+
 static void interrupt_handle_watchdog() {
   // just wait for the child to finish
 }
@@ -1288,6 +1498,385 @@ static llvm::Module *linkWithUclibc(llvm::Module *mainModule, StringRef libDir)
 }
 #endif
 
+/***/
+
+/// A klee process exploring the subtree below one frontier state of the
+/// swarm coordinator.
+struct SwarmWorker {
+  unsigned index; // of the frontier state, numbered from 1 like its prefix
+  int reportFD;   // read end of the pipe the worker reports its results to
+};
+
+static std::string getSwarmWorkerDir(KleeHandler *handler, unsigned index) {
+  std::stringstream name;
+  name << "swarm/worker" << std::setfill('0') << std::setw(6) << index;
+  return handler->getOutputFilename(name.str());
+}
+
+/// The command line of the coordinator without argv[0] and the options only
+/// it handles. Options come before the program; everything from the program
+/// on is kept unchanged, as it is what the program is run with.
+static std::vector<std::string> getSwarmWorkerArgs(int argc, char **argv) {
+  std::vector<std::string> args;
+  int i = 1;
+  for (; i < argc && InputFile != argv[i]; ++i) {
+    std::string arg = argv[i];
+    std::string::size_type start = arg.find_first_not_of('-');
+    if (start != 0 && start != std::string::npos) {
+      std::string::size_type eq = arg.find('=');
+      std::string name = arg.substr(start, eq == std::string::npos
+                                               ? std::string::npos
+                                               : eq - start);
+      if (name == "swarm-workers" || name == "swarm-frontier-depth" ||
+          name == "output-dir" || name == "max-time") {
+        if (eq == std::string::npos)
+          ++i; // skip the value given as the next argument
+        continue;
+      }
+    }
+    args.push_back(arg);
+  }
+  for (; i < argc; ++i)
+    args.push_back(argv[i]);
+  return args;
+}
+
+static pid_t startSwarmWorker(const char *argv0,
+                              const std::vector<std::string> &options,
+                              const std::string &prefix,
+                              const std::string &dir,
+                              const std::string &startDir, double maxTime,
+                              int &reportFD) {
+  int fds[2];
+  if (pipe(fds) < 0)
+    klee_error("swarm: unable to create pipe: %s", strerror(errno));
+  // Later workers must not hold this worker's pipe open.
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+
+  std::stringstream fd;
+  fd << "--swarm-report-fd=" << fds[1];
+  std::vector<std::string> args;
+  args.push_back(argv0);
+  args.push_back("--output-dir=" + dir);
+  args.push_back("--replay-path=" + prefix);
+  args.push_back("--replay-path-prefix");
+  args.push_back(fd.str());
+  if (maxTime) {
+    std::stringstream time;
+    time << "--max-time=" << maxTime;
+    args.push_back(time.str());
+  }
+  args.insert(args.end(), options.begin(), options.end());
+
+  std::string log = dir + ".log";
+  pid_t pid = fork();
+  if (pid < 0)
+    klee_error("swarm: unable to fork worker: %s", strerror(errno));
+
+  if (pid == 0) {
+    int logFD = open(log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0664);
+    if (logFD >= 0) {
+      dup2(logFD, STDOUT_FILENO);
+      dup2(logFD, STDERR_FILENO);
+      close(logFD);
+    }
+
+    std::vector<char *> cargs;
+    for (unsigned i = 0; i < args.size(); ++i)
+      cargs.push_back(const_cast<char *>(args[i].c_str()));
+    cargs.push_back(0);
+
+    // Relative paths on the command line are relative to where klee was
+    // started, not to --run-in.
+    if (chdir(startDir.c_str()) == 0)
+      execvp(cargs[0], &cargs[0]);
+    perror("swarm worker");
+    _exit(1);
+  }
+
+  close(fds[1]);
+  reportFD = fds[0];
+  return pid;
+}
+
+/// Moves the test cases of a worker into the output directory, numbered
+/// after those already there.
+static void mergeSwarmTests(KleeHandler *handler, const std::string &dir) {
+  DIR *d = opendir(dir.c_str());
+  if (!d) {
+    klee_warning("swarm: cannot open \"%s\": %s", dir.c_str(),
+                 strerror(errno));
+    return;
+  }
+
+  unsigned base = handler->getNumTestCases(), last = 0;
+  while (struct dirent *entry = readdir(d)) {
+    std::string name = entry->d_name;
+    // test<6 digits>.<suffix>
+    if (name.size() < 12 || name.compare(0, 4, "test") || name[10] != '.' ||
+        name.find_first_not_of("0123456789", 4) != 10)
+      continue;
+    unsigned id = atoi(name.substr(4, 6).c_str());
+    std::string from = dir + "/" + name;
+    std::string to = handler->getOutputFilename(
+        handler->getTestFilename(name.substr(11), base + id));
+    if (rename(from.c_str(), to.c_str()) < 0)
+      klee_warning("swarm: cannot move \"%s\": %s", from.c_str(),
+                   strerror(errno));
+    last = std::max(last, id);
+  }
+  closedir(d);
+
+  handler->addTestCases(last);
+}
+
+/// Explores the subtree below each frontier state of the coordinator in a
+/// worker process, running up to --swarm-workers of them at once, and merges
+/// their tests and paths into the handler. Workers are given what is left of
+/// --max-time at \a deadline, and none are started after it. Returns the
+/// number of instructions the workers executed.
+static uint64_t runSwarm(KleeHandler *handler, int argc, char **argv,
+                         const std::string &startDir, double deadline) {
+  const std::vector<std::string> &frontier = handler->getFrontier();
+  std::vector<std::string> options = getSwarmWorkerArgs(argc, argv);
+  std::vector<std::string> reports(frontier.size());
+  std::map<pid_t, SwarmWorker> running;
+  unsigned next = 0, failed = 0;
+
+  klee_message("swarm: exploring %u frontier states with up to %u workers",
+               (unsigned)frontier.size(), (unsigned)SwarmWorkers);
+
+  bool outOfTime = false;
+  while (!running.empty() ||
+         (next < frontier.size() && !interrupted && !outOfTime)) {
+    while (next < frontier.size() && running.size() < SwarmWorkers &&
+           !interrupted && !outOfTime) {
+      double maxTime = 0;
+      if (deadline) {
+        maxTime = deadline - util::getWallTime();
+        if (maxTime <= 0) {
+          klee_warning("swarm: out of time, %u frontier states unexplored",
+                       (unsigned)(frontier.size() - next));
+          outOfTime = true;
+          break;
+        }
+      }
+      SwarmWorker worker;
+      worker.index = ++next;
+      pid_t pid = startSwarmWorker(
+          argv[0], options, frontier[worker.index - 1],
+          getSwarmWorkerDir(handler, worker.index), startDir, maxTime,
+          worker.reportFD);
+      running[pid] = worker;
+    }
+    if (running.empty())
+      break;
+
+    int status;
+    pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0) {
+      if (errno == EINTR)
+        continue;
+      klee_error("swarm: waitpid failed: %s", strerror(errno));
+    }
+    std::map<pid_t, SwarmWorker>::iterator it = running.find(pid);
+    if (it == running.end())
+      continue;
+
+    // The worker has exited, so its report is all in the pipe.
+    SwarmWorker &worker = it->second;
+    std::string &report = reports[worker.index - 1];
+    char buf[256];
+    for (;;) {
+      ssize_t n = read(worker.reportFD, buf, sizeof(buf));
+      if (n > 0)
+        report.append(buf, n);
+      else if (n < 0 && errno == EINTR)
+        continue;
+      else
+        break;
+    }
+    close(worker.reportFD);
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || report.empty()) {
+      klee_warning("swarm: worker %u failed, see %s.log", worker.index,
+                   getSwarmWorkerDir(handler, worker.index).c_str());
+      ++failed;
+    }
+    running.erase(it);
+  }
+
+  // Merge in frontier order, so that test numbers do not depend on which
+  // worker finished first.
+  unsigned tests = 0, paths = 0;
+  uint64_t instructions = 0;
+  for (unsigned i = 0; i < frontier.size(); ++i) {
+    unsigned workerTests, workerPaths;
+    unsigned long long workerInstructions;
+    if (sscanf(reports[i].c_str(), "tests=%u paths=%u instructions=%llu",
+               &workerTests, &workerPaths, &workerInstructions) != 3)
+      continue;
+    mergeSwarmTests(handler, getSwarmWorkerDir(handler, i + 1));
+    handler->addPathsExplored(workerPaths);
+    tests += workerTests;
+    paths += workerPaths;
+    instructions += workerInstructions;
+  }
+
+  std::stringstream summary;
+  summary << "KLEE: done: swarm: frontier states = " << frontier.size()
+          << ", explored = " << next << ", failed workers = " << failed
+          << "\n"
+          << "KLEE: done: swarm: worker tests = " << tests
+          << ", worker paths = " << paths << "\n";
+  llvm::errs() << summary.str();
+  handler->getInfoStream() << summary.str();
+
+  return instructions;
+}
+
+/// Splits a line of run.stats, "(a,b,...)", into its fields.
+static std::vector<std::string> splitStatsLine(const std::string &line) {
+  std::vector<std::string> fields;
+  std::string::size_type begin = line.find('(') + 1, end = line.rfind(')');
+  std::stringstream ss(line.substr(begin, end - begin));
+  std::string field;
+  while (std::getline(ss, field, ','))
+    if (!field.empty())
+      fields.push_back(field);
+  return fields;
+}
+
+/// Adds the instructions an istats file reports as covered to \a covered.
+/// Returns false if the file cannot be read.
+static bool readIStatsCoverage(const std::string &path,
+                               std::set<unsigned> &covered) {
+  std::ifstream f(path.c_str());
+  std::string line;
+  int icov = -1;
+  bool callCosts = false;
+  while (std::getline(f, line)) {
+    if (!line.compare(0, 8, "events: ")) {
+      std::stringstream events(line.substr(8));
+      std::string event;
+      for (int i = 0; events >> event; ++i)
+        if (event == "Icov")
+          icov = i;
+    } else if (!line.compare(0, 6, "calls=")) {
+      // The next line holds the costs of the call, not of the instruction.
+      callCosts = true;
+    } else if (!line.empty() && isdigit(line[0])) {
+      if (callCosts) {
+        callCosts = false;
+        continue;
+      }
+      // <instruction> <source line> <event values>
+      std::stringstream costs(line);
+      unsigned instruction, sourceLine;
+      uint64_t value = 0;
+      costs >> instruction >> sourceLine;
+      for (int i = 0; i <= icov; ++i)
+        costs >> value;
+      if (value)
+        covered.insert(instruction);
+    }
+  }
+  return icov >= 0;
+}
+
+/// Appends a line to run.stats combining the final statistics of the
+/// coordinator with those of the swarm workers. Counts and times are summed,
+/// and the wall time is that of the whole run. Covered instructions are the
+/// union of those in the run.istats of every process; branch counts, and
+/// coverage when an istats file is missing, take the best worker.
+static void mergeSwarmStats(KleeHandler *handler, double swarmWallTime) {
+  std::string path = handler->getOutputFilename("run.stats");
+  std::vector<std::string> names, totals;
+  std::vector<bool> integral;
+  std::vector<double> values;
+  double coverable = 0;
+
+  std::set<unsigned> covered;
+  bool unionCoverage =
+      readIStatsCoverage(handler->getOutputFilename("run.istats"), covered);
+
+  for (unsigned i = 0; i <= handler->getFrontier().size(); ++i) {
+    std::ifstream f(i ? (getSwarmWorkerDir(handler, i) + "/run.stats").c_str()
+                      : path.c_str());
+    std::string header, line, last;
+    if (!std::getline(f, header)) {
+      if (!i)
+        return;
+      continue;
+    }
+    while (std::getline(f, line))
+      if (!line.empty())
+        last = line;
+    std::vector<std::string> fields = splitStatsLine(last);
+
+    if (names.empty()) {
+      names = splitStatsLine(header);
+      values.assign(names.size(), 0);
+      integral.assign(names.size(), true);
+    }
+    if (fields.size() != names.size())
+      continue;
+    if (i && unionCoverage &&
+        !readIStatsCoverage(getSwarmWorkerDir(handler, i) + "/run.istats",
+                            covered))
+      unionCoverage = false;
+
+    for (unsigned j = 0; j < names.size(); ++j) {
+      double value = strtod(fields[j].c_str(), 0);
+      const std::string &name = names[j];
+      if (fields[j].find_first_of(".eE") != std::string::npos)
+        integral[j] = false;
+
+      if (name == "'WallTime'") {
+        if (!i)
+          values[j] = value + swarmWallTime;
+      } else if (name == "'UncoveredInstructions'") {
+        values[j] = i ? std::min(values[j], value) : value;
+        // Every process has the same instructions to cover.
+        if (!i)
+          coverable += value;
+      } else if (name == "'CoveredInstructions'") {
+        values[j] = std::max(values[j], value);
+        if (!i)
+          coverable += value;
+      } else if (name == "'FullBranches'" || name == "'PartialBranches'" ||
+                 name == "'NumBranches'" || name == "'MallocUsage'" ||
+                 name == "'ExclusiveMemory'") {
+        values[j] = std::max(values[j], value);
+      } else {
+        values[j] += value;
+      }
+    }
+  }
+
+  if (names.empty())
+    return;
+
+  if (unionCoverage) {
+    for (unsigned j = 0; j < names.size(); ++j) {
+      if (names[j] == "'CoveredInstructions'")
+        values[j] = covered.size();
+      else if (names[j] == "'UncoveredInstructions'")
+        values[j] = coverable - covered.size();
+    }
+  }
+
+  std::ofstream f(path.c_str(), std::ios::app);
+  f << "(";
+  for (unsigned j = 0; j < values.size(); ++j) {
+    if (integral[j])
+      f << (uint64_t)values[j];
+    else
+      f << values[j];
+    f << (j + 1 < values.size() ? "," : ")\n");
+  }
+}
+
 int main(int argc, char **argv, char **envp) {
   atexit(llvm_shutdown);  // Call llvm_shutdown() on exit.
 
@@ -1296,6 +1885,10 @@ int main(int argc, char **argv, char **envp) {
   parseArguments(argc, argv);
   sys::PrintStackTraceOnErrorSignal();
 
+  // swarm workers are started from here, whatever --run-in says
+  SmallString<128> startDir;
+  sys::fs::current_path(startDir);
+
   if (Watchdog) {
     if (MaxTime==0) {
       klee_error("--watchdog used without --max-time");
@@ -1511,6 +2104,33 @@ int main(int argc, char **argv, char **envp) {
 
   if (ReplayPathFile != "") {
     KleeHandler::loadPathFile(ReplayPathFile, replayPath);
+  } else if (ReplayPathPrefix) {
+    klee_error("--replay-path-prefix used without --replay-path");
+  }
+
+  if (SwarmWorkers) {
+    if (ReplayPathFile != "" || !ReplayKTestFile.empty() ||
+        !ReplayKTestDir.empty() || !SeedOutFile.empty() ||
+        !SeedOutDir.empty())
+      klee_error("--swarm-workers cannot be used with replay or seeds");
+    if (!SwarmFrontierDepth)
+      klee_error("--swarm-frontier-depth must be at least 1");
+    // Subsumption in the coordinator would rely on interpolants of subtrees
+    // it has handed to workers instead of exploring.
+    NoInterpolation = true;
+  }
+
+  if (ResumeCheckpoint != "") {
+    if (ReplayPathFile != "" || !ReplayKTestFile.empty() ||
+        !ReplayKTestDir.empty() || !SeedOutFile.empty() ||
+        !SeedOutDir.empty() || SwarmWorkers)
+      klee_error("--resume-checkpoint cannot be used with replay, seeds or "
+                 "--swarm-workers");
+    // The subtrees explored before the checkpoint are not explored again,
+    // so their interpolants are not available for subsumption.
+    if (INTERPOLATION_ENABLED)
+      klee_warning("interpolation is disabled when resuming a checkpoint");
+    NoInterpolation = true;
   }
 
   Interpreter::InterpreterOptions IOpts;
@@ -1530,12 +2150,27 @@ int main(int argc, char **argv, char **envp) {
   externalsAndGlobalsCheck(finalModule);
 
   if (ReplayPathFile != "") {
-    interpreter->setReplayPath(&replayPath);
+    if (ReplayPathPrefix)
+      interpreter->setReplayPathPrefix(&replayPath);
+    else
+      interpreter->setReplayPath(&replayPath);
   }
 
+  if (SwarmWorkers)
+    interpreter->setFrontierDepth(SwarmFrontierDepth);
+
+  if (CheckpointInterval > 0 || CheckpointOnSignal)
+    interpreter->setCheckpointing(CheckpointInterval);
+  if (CheckpointOnSignal)
+    signal(SIGUSR1, checkpoint_handle);
+  if (ResumeCheckpoint != "")
+    interpreter->setResumeCheckpoint(ResumeCheckpoint);
+
   char buf[256];
   time_t t[2];
   t[0] = time(NULL);
+  // --max-time bounds the whole run, swarm workers included.
+  double deadline = MaxTime ? util::getWallTime() + MaxTime : 0;
   strftime(buf, sizeof(buf), "Started: %Y-%m-%d %H:%M:%S\n", localtime(&t[0]));
   handler->getInfoStream() << buf;
   handler->getInfoStream().flush();
@@ -1636,6 +2271,15 @@ int main(int argc, char **argv, char **envp) {
     }
   }
 
+  uint64_t swarmInstructions = 0;
+  double swarmWallTime = 0;
+  if (SwarmWorkers) {
+    double start = util::getWallTime();
+    swarmInstructions =
+        runSwarm(handler, argc, argv, startDir.c_str(), deadline);
+    swarmWallTime = util::getWallTime() - start;
+  }
+
   t[1] = time(NULL);
   strftime(buf, sizeof(buf), "Finished: %Y-%m-%d %H:%M:%S\n", localtime(&t[1]));
   handler->getInfoStream() << buf;
@@ -1651,6 +2295,9 @@ int main(int argc, char **argv, char **envp) {
 
   delete interpreter;
 
+  if (SwarmWorkers)
+    mergeSwarmStats(handler, swarmWallTime);
+
   uint64_t queries =
     *theStatisticManager->getStatisticByName("Queries");
   uint64_t queriesValid =
@@ -1662,9 +2309,24 @@ int main(int argc, char **argv, char **envp) {
   uint64_t queryConstructs =
     *theStatisticManager->getStatisticByName("QueriesConstructs");
   uint64_t instructions =
-    *theStatisticManager->getStatisticByName("Instructions");
+    *theStatisticManager->getStatisticByName("Instructions") +
+    swarmInstructions;
   uint64_t forks =
     *theStatisticManager->getStatisticByName("Forks");
+  uint64_t queryIntervalHits =
+    *theStatisticManager->getStatisticByName("QueryIntervalHits");
+  uint64_t queryCacheHits =
+    *theStatisticManager->getStatisticByName("QueryCacheHits");
+  uint64_t queryCexCacheHits =
+    *theStatisticManager->getStatisticByName("QueryCexCacheHits");
+  uint64_t resolveCacheHits =
+    *theStatisticManager->getStatisticByName("ResolveCacheHits");
+  uint64_t resolveCacheMisses =
+    *theStatisticManager->getStatisticByName("ResolveCacheMisses");
+  uint64_t swapOuts =
+    *theStatisticManager->getStatisticByName("SwapOuts");
+  uint64_t swapIns =
+    *theStatisticManager->getStatisticByName("SwapIns");
 
   handler->getInfoStream()
     << "KLEE: done: explored paths = " << 1 + forks << "\n";
@@ -1675,6 +2337,24 @@ int main(int argc, char **argv, char **envp) {
     handler->getInfoStream()
       << "KLEE: done: avg. constructs per query = "
                              << queryConstructs / queries << "\n";
+  handler->getInfoStream()
+    << "KLEE: done: interval solver hits = " << queryIntervalHits << "\n"
+    << "KLEE: done: query cache hits = " << queryCacheHits << "\n"
+    << "KLEE: done: query cex cache hits = " << queryCexCacheHits << "\n"
+    << "KLEE: done: resolve cache hits = " << resolveCacheHits << " of "
+    << resolveCacheHits + resolveCacheMisses << "\n";
+  if (swapOuts)
+    handler->getInfoStream()
+      << "KLEE: done: states swapped out = " << swapOuts << " ("
+      << *theStatisticManager->getStatisticByName("SwapOutBytes")
+      << " bytes, "
+      << *theStatisticManager->getStatisticByName("SwapOutTime") / 1000000.
+      << "s)\n"
+      << "KLEE: done: states swapped in = " << swapIns << " ("
+      << *theStatisticManager->getStatisticByName("SwapInBytes")
+      << " bytes, "
+      << *theStatisticManager->getStatisticByName("SwapInTime") / 1000000.
+      << "s)\n";
   handler->getInfoStream()
     << "KLEE: done: total queries = " << queries << "\n"
     << "KLEE: done: valid queries = " << queriesValid << "\n"
@@ -1779,6 +2459,17 @@ int main(int argc, char **argv, char **envp) {
 
   handler->getInfoStream() << stats.str();
 
+  if (SwarmReportFD >= 0) {
+    std::stringstream report;
+    report << "tests=" << handler->getNumTestCases()
+           << " paths=" << handler->getNumPathsExplored()
+           << " instructions=" << instructions << "\n";
+    std::string line = report.str();
+    if (write(SwarmReportFD, line.c_str(), line.size()) != (ssize_t)line.size())
+      klee_warning("unable to write swarm report: %s", strerror(errno));
+    close(SwarmReportFD);
+  }
+
 #if LLVM_VERSION_CODE < LLVM_VERSION(3, 5)
   // FIXME: This really doesn't look right
   // This is preventing the module from being
@@ -0,0 +1,101 @@
+//===-- SetTrieTest.cpp -----------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Internal/ADT/SetTrie.h"
+#include "gtest/gtest.h"
+
+#include <set>
+
+using namespace klee;
+
+namespace {
+
+typedef SetTrie<int, int> Trie;
+typedef std::set<int> Set;
+
+struct Any {
+  bool operator()(int) const { return true; }
+};
+
+struct Equals {
+  int v;
+  Equals(int _v) : v(_v) {}
+  bool operator()(int x) const { return x == v; }
+};
+
+Set makeSet(int a, int b = -1, int c = -1) {
+  Set s;
+  s.insert(a);
+  if (b >= 0) s.insert(b);
+  if (c >= 0) s.insert(c);
+  return s;
+}
+
+int valueOf(Trie::Node *n) { return n ? n->value : 0; }
+
+TEST(SetTrieTest, SubsetsAndSupersets) {
+  Trie t;
+  Set s12 = makeSet(1, 2), s13 = makeSet(1, 3), s234 = makeSet(2, 3, 4);
+  EXPECT_TRUE(t.insert(s12.begin(), s12.end(), 12).second);
+  EXPECT_TRUE(t.insert(s13.begin(), s13.end(), 13).second);
+  EXPECT_TRUE(t.insert(s234.begin(), s234.end(), 234).second);
+  EXPECT_FALSE(t.insert(s12.begin(), s12.end(), 0).second);
+  EXPECT_EQ(3U, t.size());
+
+  EXPECT_EQ(12, valueOf(t.lookup(s12.begin(), s12.end())));
+  Set s1 = makeSet(1);
+  EXPECT_EQ(0, valueOf(t.lookup(s1.begin(), s1.end())));
+
+  Set s123 = makeSet(1, 2, 3);
+  EXPECT_EQ(12, valueOf(t.findSubset(s123.begin(), s123.end(), Equals(12))));
+  EXPECT_EQ(13, valueOf(t.findSubset(s123.begin(), s123.end(), Equals(13))));
+  EXPECT_EQ(0, valueOf(t.findSubset(s123.begin(), s123.end(), Equals(234))));
+
+  Set s3 = makeSet(3);
+  EXPECT_EQ(13, valueOf(t.findSuperset(s3.begin(), s3.end(), Equals(13))));
+  EXPECT_EQ(234, valueOf(t.findSuperset(s3.begin(), s3.end(), Equals(234))));
+  EXPECT_EQ(0, valueOf(t.findSuperset(s3.begin(), s3.end(), Equals(12))));
+  Set s24 = makeSet(2, 4);
+  EXPECT_EQ(234, valueOf(t.findSuperset(s24.begin(), s24.end(), Any())));
+}
+
+TEST(SetTrieTest, Erase) {
+  Trie t;
+  Set s12 = makeSet(1, 2), s123 = makeSet(1, 2, 3);
+  t.insert(s12.begin(), s12.end(), 12);
+  Trie::Node *n = t.insert(s123.begin(), s123.end(), 123).first;
+  EXPECT_EQ(4U, t.nodeCount());
+
+  // Erasing a leaf prunes it, but not the nodes leading to other sets.
+  t.erase(n);
+  EXPECT_EQ(1U, t.size());
+  EXPECT_EQ(3U, t.nodeCount());
+  EXPECT_EQ(0, valueOf(t.lookup(s123.begin(), s123.end())));
+  EXPECT_EQ(12, valueOf(t.findSubset(s123.begin(), s123.end(), Any())));
+
+  t.erase(t.lookup(s12.begin(), s12.end()));
+  EXPECT_EQ(0U, t.size());
+  EXPECT_EQ(1U, t.nodeCount());
+}
+
+TEST(SetTrieTest, BoundedSearch) {
+  Trie t;
+  for (int i = 0; i < 100; ++i) {
+    Set s = makeSet(i, 100 + i);
+    t.insert(s.begin(), s.end(), i + 1);
+  }
+
+  // The only superset of {199} is the last set stored; reaching it means
+  // visiting the nodes of all the others first.
+  Set s = makeSet(199);
+  EXPECT_EQ(100, valueOf(t.findSuperset(s.begin(), s.end(), Any())));
+  EXPECT_EQ(0, valueOf(t.findSuperset(s.begin(), s.end(), Any(), 10)));
+}
+
+}
@@ -1,5 +1,6 @@
 #include "klee/util/ArrayCache.h"
 #include "klee/util/Assignment.h"
+#include "klee/util/BatchEvaluator.h"
 #include "gtest/gtest.h"
 #include <iostream>
 #include <vector>
@@ -33,3 +34,145 @@ TEST(AssignmentTest, FoldNotOptimized)
   ASSERT_TRUE(asConstant != NULL);
   ASSERT_EQ(asConstant->getZExtValue(), (unsigned) 128);
 }
+
+TEST(AssignmentTest, BatchEvaluatorAgreesWithEvaluate)
+{
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("a", /*size=*/ 4);
+  const Array *b = ac.CreateArray("b", /*size=*/ 2);
+  ref<ConstantExpr> constants[3] = { ConstantExpr::create(7, Expr::Int8),
+                                     ConstantExpr::create(200, Expr::Int8),
+                                     ConstantExpr::create(0, Expr::Int8) };
+  const Array *c = ac.CreateArray("c", /*size=*/ 3, constants, constants + 3);
+
+  ref<Expr> a0 = ReadExpr::create(UpdateList(a, 0),
+                                  ConstantExpr::create(0, Expr::Int32));
+  ref<Expr> b0 = ReadExpr::create(UpdateList(b, 0),
+                                  ConstantExpr::create(0, Expr::Int32));
+  ref<Expr> b1 = ReadExpr::create(UpdateList(b, 0),
+                                  ConstantExpr::create(1, Expr::Int32));
+  ref<Expr> word = Expr::createTempRead(a, Expr::Int32);
+  ref<Expr> index = ZExtExpr::create(ExtractExpr::create(b0, 0, 2),
+                                     Expr::Int32);
+
+  // A read through a symbolic update, and one of a constant array.
+  UpdateList ul(a, 0);
+  ul.extend(ZExtExpr::create(ExtractExpr::create(b1, 0, 2), Expr::Int32), b0);
+  ref<Expr> updated = ReadExpr::create(ul, index);
+  ref<Expr> constRead = ReadExpr::create(UpdateList(c, 0), index);
+
+  std::vector< ref<Expr> > exprs;
+  exprs.push_back(EqExpr::create(updated, a0));
+  exprs.push_back(UltExpr::create(constRead, b1));
+  exprs.push_back(SltExpr::create(word, SExtExpr::create(b0, Expr::Int32)));
+  exprs.push_back(EqExpr::create(UDivExpr::create(a0, b0),
+                                 ConstantExpr::create(1, Expr::Int8)));
+  exprs.push_back(SleExpr::create(SRemExpr::create(word,
+                                                   SExtExpr::create(b1,
+                                                                    Expr::Int32)),
+                                  ConstantExpr::create(3, Expr::Int32)));
+  exprs.push_back(EqExpr::create(ShlExpr::create(a0, b0),
+                                 AShrExpr::create(b1, a0)));
+  exprs.push_back(UleExpr::create(LShrExpr::create(word,
+                                                   ZExtExpr::create(b0,
+                                                                    Expr::Int32)),
+                                  SubExpr::create(word,
+                                                  MulExpr::create(word,
+                                                                  word))));
+  exprs.push_back(SelectExpr::create(EqExpr::create(b0, b1),
+                                     UltExpr::create(a0, b0),
+                                     NotExpr::create(EqExpr::create(
+                                         XorExpr::create(a0, b1),
+                                         OrExpr::create(b0, AndExpr::create(
+                                                                a0, b1))))));
+
+  std::vector<Assignment*> assignments;
+  std::vector<const Array*> objects;
+  objects.push_back(a);
+  objects.push_back(b);
+  unsigned seed = 1;
+  for (unsigned i = 0; i != 150; ++i) {
+    std::vector< std::vector<unsigned char> > values(2);
+    for (unsigned j = 0; j != 6; ++j) {
+      seed = seed * 1103515245 + 12345;
+      // Favour small values so that equalities and zero divisors occur.
+      unsigned char v = (seed >> 16) & (i % 2 ? 0xff : 0x3);
+      values[j < 4 ? 0 : 1].push_back(v);
+    }
+    assignments.push_back(new Assignment(objects, values));
+  }
+
+  for (unsigned i = 0; i != exprs.size(); ++i) {
+    BatchEvaluator evaluator(&exprs[i], &exprs[i] + 1);
+    ASSERT_TRUE(evaluator.isSupported());
+    for (unsigned j = 0; j != assignments.size(); ++j) {
+      std::vector<Assignment*> one(1, assignments[j]);
+      bool expected = assignments[j]->satisfies(&exprs[i], &exprs[i] + 1);
+      EXPECT_EQ(expected ? 0U : 1U, evaluator.findFirstSatisfying(one))
+          << "expression " << i << ", assignment " << j;
+    }
+
+    unsigned first = 0;
+    while (first != assignments.size() &&
+           !assignments[first]->satisfies(&exprs[i], &exprs[i] + 1))
+      ++first;
+    EXPECT_EQ(first, evaluator.findFirstSatisfying(assignments));
+  }
+
+  for (unsigned i = 0; i != assignments.size(); ++i)
+    delete assignments[i];
+}
+
+TEST(AssignmentTest, BatchEvaluatorValues)
+{
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("a", /*size=*/ 2);
+  const Array *b = ac.CreateArray("b", /*size=*/ 1);
+
+  ref<Expr> a0 = ReadExpr::create(UpdateList(a, 0),
+                                  ConstantExpr::create(0, Expr::Int32));
+  ref<Expr> a1 = ReadExpr::create(UpdateList(a, 0),
+                                  ConstantExpr::create(1, Expr::Int32));
+  ref<Expr> e = AddExpr::create(ZExtExpr::create(a0, Expr::Int16),
+                                MulExpr::create(ZExtExpr::create(a1,
+                                                                 Expr::Int16),
+                                                ConstantExpr::create(
+                                                    300, Expr::Int16)));
+
+  // Assignments which allow free values, as seeds do: some bind all of a,
+  // some only part of it, and some only b.
+  std::vector<Assignment*> assignments;
+  for (unsigned i = 0; i != 100; ++i) {
+    Assignment *assignment = new Assignment(/*_allowFreeValues=*/true);
+    if (i % 5 == 4) {
+      assignment->bindings[b] = std::vector<unsigned char>(1, i);
+    } else {
+      std::vector<unsigned char> bytes;
+      bytes.push_back(i);
+      if (i % 5 != 3)
+        bytes.push_back(3 * i);
+      assignment->bindings[a] = bytes;
+    }
+    assignments.push_back(assignment);
+  }
+
+  BatchEvaluator evaluator(&e, &e + 1);
+  ASSERT_TRUE(evaluator.isSupported());
+  std::vector<uint64_t> results;
+  std::vector<bool> known;
+  evaluator.evaluate(0, assignments, results, known);
+  ASSERT_EQ(assignments.size(), results.size());
+  ASSERT_EQ(assignments.size(), known.size());
+
+  for (unsigned i = 0; i != assignments.size(); ++i) {
+    ref<Expr> expected = assignments[i]->evaluate(e);
+    const ConstantExpr *CE = dyn_cast<ConstantExpr>(expected);
+    EXPECT_EQ(CE != NULL, (bool) known[i]) << "assignment " << i;
+    if (CE && known[i]) {
+      EXPECT_EQ(CE->getZExtValue(), results[i]) << "assignment " << i;
+    }
+  }
+
+  for (unsigned i = 0; i != assignments.size(); ++i)
+    delete assignments[i];
+}
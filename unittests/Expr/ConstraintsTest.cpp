@@ -0,0 +1,105 @@
+//===-- ConstraintsTest.cpp -----------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Constraints.h"
+#include "klee/Expr.h"
+#include "klee/util/ArrayCache.h"
+
+using namespace klee;
+
+namespace {
+
+ref<Expr> readByte(const Array *array, unsigned index) {
+  return ReadExpr::create(UpdateList(array, 0),
+                          ConstantExpr::alloc(index, Expr::Int32));
+}
+
+TEST(ConstraintsTest, ArrayPartition) {
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("a", 4);
+  const Array *b = ac.CreateArray("b", 4);
+  const Array *c = ac.CreateArray("c", 4);
+
+  ref<Expr> ab = UltExpr::create(readByte(a, 0), readByte(b, 0));
+  ref<Expr> cc = UltExpr::create(readByte(c, 0), readByte(c, 1));
+  ref<Expr> bb = UltExpr::create(readByte(b, 1), readByte(b, 2));
+
+  ConstraintManager cm;
+  cm.addConstraint(ab);
+  cm.addConstraint(cc);
+  cm.addConstraint(bb);
+  ASSERT_TRUE(cm.hasArrayPartition());
+
+  std::vector<const Array*> arrays(1, a);
+  std::vector< ref<Expr> > deps;
+  cm.getDependentConstraints(arrays, deps);
+  ASSERT_EQ(2U, deps.size());
+  EXPECT_EQ(ab, deps[0]);
+  EXPECT_EQ(bb, deps[1]);
+
+  std::vector< std::vector< ref<Expr> > > classes;
+  cm.getPartitionClasses(classes);
+  EXPECT_EQ(2U, classes.size());
+
+  // Joining the classes in a copy must not affect the original.
+  ConstraintManager forked(cm);
+  forked.addConstraint(UltExpr::create(readByte(a, 1), readByte(c, 2)));
+
+  deps.clear();
+  forked.getDependentConstraints(arrays, deps);
+  EXPECT_EQ(4U, deps.size());
+
+  deps.clear();
+  cm.getDependentConstraints(arrays, deps);
+  EXPECT_EQ(2U, deps.size());
+
+  ConstraintManager unoptimized(cm.getConstraints());
+  EXPECT_FALSE(unoptimized.hasArrayPartition());
+}
+
+TEST(ConstraintsTest, EqualityIndex) {
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("a", 4);
+  const Array *b = ac.CreateArray("b", 4);
+
+  ref<Expr> a0 = readByte(a, 0), a1 = readByte(a, 1), b0 = readByte(b, 0);
+  ref<Expr> five = ConstantExpr::alloc(5, Expr::Int8);
+
+  ConstraintManager cm;
+  cm.addConstraint(UltExpr::create(a0, a1));
+  cm.addConstraint(UltExpr::create(b0, readByte(b, 1)));
+  ConstraintManager forked(cm);
+
+  // Fixing a[0] rewrites the constraint reading it, and only that one.
+  cm.addConstraint(EqExpr::create(five, a0));
+  std::vector< ref<Expr> > constraints = cm.getConstraints();
+  ASSERT_EQ(3U, constraints.size());
+  EXPECT_EQ(UltExpr::create(five, a1), constraints[0]);
+  EXPECT_EQ(UltExpr::create(b0, readByte(b, 1)), constraints[1]);
+  EXPECT_EQ(EqExpr::create(five, a0), constraints[2]);
+
+  // The index agrees with simplifying against the plain constraint list.
+  ConstraintManager unoptimized(constraints);
+  ref<Expr> queries[3] = { AddExpr::create(a0, b0),
+                           UltExpr::create(five, a1),
+                           UltExpr::create(a1, b0) };
+  for (unsigned i = 0; i != 3; ++i)
+    EXPECT_EQ(unoptimized.simplifyExpr(queries[i]),
+              cm.simplifyExpr(queries[i]));
+  EXPECT_EQ(AddExpr::create(five, b0), cm.simplifyExpr(queries[0]));
+  EXPECT_TRUE(cm.simplifyExpr(queries[1])->isTrue());
+
+  // The copy made before is not affected.
+  EXPECT_EQ(queries[0], forked.simplifyExpr(queries[0]));
+  EXPECT_EQ(2U, forked.size());
+}
+
+}
@@ -8,10 +8,14 @@
 //===----------------------------------------------------------------------===//
 
 #include <iostream>
+#include <map>
 #include "gtest/gtest.h"
 
 #include "klee/Expr.h"
+#include "klee/ExprBuilder.h"
 #include "klee/util/ArrayCache.h"
+#include "klee/util/Assignment.h"
+#include "klee/util/ExprCloner.h"
 
 using namespace klee;
 
@@ -113,4 +117,106 @@ TEST(ExprTest, ExtractConcat) {
   EXPECT_EQ(Expr::Extract, concat2->getKid(1)->getKind());
 }
 
+TEST(ExprTest, HashConsing) {
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 256);
+  ExprBuilder *builder =
+    createHashConsingExprBuilder(createDefaultExprBuilder());
+
+  {
+    ref<Expr> a = builder->Read(UpdateList(array, 0), builder->Constant(0, 32));
+    ref<Expr> b = builder->Read(UpdateList(array, 0), builder->Constant(0, 32));
+    EXPECT_EQ(a.get(), b.get());
+
+    ref<Expr> sum1 = builder->Add(a, builder->Constant(1, 8));
+    ref<Expr> sum2 = builder->Add(b, builder->Constant(1, 8));
+    EXPECT_EQ(sum1.get(), sum2.get());
+    EXPECT_NE(sum1.get(), builder->Add(a, builder->Constant(2, 8)).get());
+
+    // Expressions built without the builder are left alone.
+    EXPECT_NE(sum1.get(), AddExpr::alloc(a, builder->Constant(1, 8)).get());
+    EXPECT_LT(0U, Expr::getInternedCount());
+  }
+
+  // The table holds on to nothing once the expressions are released.
+  EXPECT_EQ(0U, Expr::getInternedCount());
+  delete builder;
+}
+
+TEST(ExprTest, UpdateSnapshots) {
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 64);
+  const Array *sym = ac.CreateArray("sym", 4);
+  UpdateList ul(array, 0);
+
+  // The array after every write, with the symbolic index taken to be 1, and
+  // the writes made since the symbolic one.
+  std::map<unsigned, unsigned> contents, recent;
+  for (unsigned i = 0; i < 1000; ++i) {
+    if (i == 500) {
+      ul.extend(Expr::createTempRead(sym, Expr::Int32),
+                ConstantExpr::create(0xAA, Expr::Int8));
+      contents[1] = 0xAA;
+      continue;
+    }
+    unsigned index = (i * 7) % 60, value = i & 0xFF;
+    ul.extend(ConstantExpr::create(index, Expr::Int32),
+              ConstantExpr::create(value, Expr::Int8));
+    contents[index] = value;
+    if (i > 500)
+      recent[index] = value;
+  }
+
+  unsigned snapshots = 0;
+  for (const UpdateNode *un = ul.head; un; un = un->next)
+    if (un->getSnapshot())
+      ++snapshots;
+  EXPECT_LT(0U, snapshots);
+
+  std::vector<const Array*> objects(1, sym);
+  std::vector< std::vector<unsigned char> > values(
+      1, std::vector<unsigned char>(4, 0));
+  values[0][0] = 1;
+  Assignment assignment(objects, values);
+
+  for (unsigned index = 0; index < 64; ++index) {
+    ref<Expr> read = ReadExpr::create(ul, ConstantExpr::create(index,
+                                                               Expr::Int32));
+    if (recent.count(index))
+      EXPECT_EQ(ref<Expr>(ConstantExpr::create(recent[index], Expr::Int8)),
+                read);
+    else
+      EXPECT_TRUE(isa<ReadExpr>(read));
+
+    ref<Expr> expected = ConstantExpr::create(
+        contents.count(index) ? contents[index] : 0, Expr::Int8);
+    EXPECT_EQ(expected, assignment.evaluate(read));
+  }
+}
+
+
+TEST(ExprTest, CloneConstantArrays) {
+  ArrayCache ac, copies;
+  ArrayCopySet cloned;
+  ref<ConstantExpr> values[2] = { ConstantExpr::create(1, Expr::Int8),
+                                  ConstantExpr::create(2, Expr::Int8) };
+  const Array *a = ac.CreateArray("const", 2, values, values + 2);
+  const Array *b = ac.CreateArray("const", 2, values, values + 2);
+  values[1] = ConstantExpr::create(3, Expr::Int8);
+  const Array *c = ac.CreateArray("const", 2, values, values + 2);
+
+  const Array *copy;
+  {
+    ExprCloner cloner(copies, cloned);
+    copy = cloner.clone(a);
+    EXPECT_NE(a, copy);
+    EXPECT_EQ(2U, copy->constantValues.size());
+  }
+
+  // Copies are found by content, whichever array they were made from.
+  ExprCloner cloner(copies, cloned);
+  EXPECT_EQ(copy, cloner.clone(b));
+  EXPECT_NE(copy, cloner.clone(c));
+  EXPECT_EQ(2U, cloned.size());
+}
 }
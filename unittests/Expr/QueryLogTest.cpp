@@ -0,0 +1,177 @@
+//===-- QueryLogTest.cpp --------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Constraints.h"
+#include "klee/Expr.h"
+#include "klee/ExprBuilder.h"
+#include "klee/Solver.h"
+#include "klee/Internal/Support/QueryLog.h"
+#include "klee/util/ArrayCache.h"
+
+#include "llvm/Support/raw_ostream.h"
+
+using namespace klee;
+
+namespace {
+
+// The read arrays are distinct objects, so compare the printed forms.
+std::string print(const ref<Expr> &e) {
+  std::string s;
+  llvm::raw_string_ostream os(s);
+  os << e;
+  return os.str();
+}
+
+void expectSameEntry(const QueryLogEntry &a, const QueryLogEntry &b) {
+  EXPECT_EQ(a.type, b.type);
+  EXPECT_EQ(a.instruction, b.instruction);
+  ASSERT_EQ(a.exprs.size(), b.exprs.size());
+  for (unsigned i = 0; i != a.exprs.size(); ++i)
+    EXPECT_EQ(print(a.exprs[i]), print(b.exprs[i])) << "constraint " << i;
+  EXPECT_EQ(print(a.query), print(b.query));
+  ASSERT_EQ(a.objects.size(), b.objects.size());
+  for (unsigned i = 0; i != a.objects.size(); ++i) {
+    EXPECT_EQ(a.objects[i]->name, b.objects[i]->name);
+    EXPECT_EQ(a.objects[i]->size, b.objects[i]->size);
+  }
+}
+
+TEST(QueryLogTest, RoundTrip) {
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("a", 8);
+  ref<ConstantExpr> constants[2] = { ConstantExpr::create(3, Expr::Int8),
+                                     ConstantExpr::create(250, Expr::Int8) };
+  const Array *c = ac.CreateArray("c", 2, constants, constants + 2);
+
+  ref<Expr> word = Expr::createTempRead(a, Expr::Int32);
+  UpdateList ul(a, 0);
+  for (unsigned i = 0; i != 100; ++i)
+    ul.extend(ConstantExpr::create(i % 8, Expr::Int32),
+              ExtractExpr::create(AddExpr::create(
+                                      word, ConstantExpr::create(i, Expr::Int32)),
+                                  0, Expr::Int8));
+  ref<Expr> updated = ReadExpr::create(
+      ul, ZExtExpr::create(ReadExpr::create(UpdateList(c, 0), word), 32));
+  ref<Expr> wide = ConcatExpr::create(word, ConcatExpr::create(word, word));
+  ref<Expr> big = ConstantExpr::alloc(llvm::APInt::getAllOnesValue(96));
+
+  std::vector< ref<Expr> > constraints;
+  constraints.push_back(UltExpr::create(word, ConstantExpr::create(1000,
+                                                                   Expr::Int32)));
+  constraints.push_back(NeExpr::create(wide, big));
+  constraints.push_back(SleExpr::create(
+      SExtExpr::create(updated, Expr::Int32),
+      SelectExpr::create(EqExpr::create(updated, ConstantExpr::create(
+                                                     7, Expr::Int8)),
+                         word, NotExpr::create(word))));
+  ConstraintManager cm(constraints);
+
+  std::vector<const Array*> objects(1, a);
+  std::vector<QueryLogEntry> entries;
+  entries.push_back(QueryLogEntry(
+      Query(cm, EqExpr::create(updated, ConstantExpr::create(5, Expr::Int8))),
+      QueryLogEntry::Truth));
+  entries.push_back(QueryLogEntry(Query(cm, word), QueryLogEntry::Value));
+  entries.push_back(QueryLogEntry(Query(cm, ConstantExpr::alloc(0, Expr::Bool)),
+                                  QueryLogEntry::Cex, &objects));
+  for (unsigned i = 0; i != entries.size(); ++i)
+    entries[i].instruction = 10 * i;
+
+  QueryLogWriter writer;
+  std::string log;
+  QueryLogWriter::writeHeader(log);
+  writer.write(log, entries[0], QueryLogResult(true, 1, 0.5));
+  size_t firstSize = log.size();
+  writer.write(log, entries[1], QueryLogResult(true, 42, 0.25));
+  writer.write(log, entries[2], QueryLogResult(false, 1, 2));
+  // The later queries only refer to the shared constraints.
+  EXPECT_LT(log.size() - firstSize, firstSize / 4);
+
+  ASSERT_TRUE(QueryLogReader::isQueryLog(log.data(), log.data() + log.size()));
+  ExprBuilder *builder = createDefaultExprBuilder();
+  ArrayCache readCache;
+  QueryLogReader reader(log.data(), log.data() + log.size(), builder,
+                        readCache);
+  QueryLogEntry entry;
+  QueryLogResult result;
+  for (unsigned i = 0; i != entries.size(); ++i) {
+    ASSERT_TRUE(reader.read(entry, result)) << reader.getError();
+    expectSameEntry(entries[i], entry);
+    if (i == 1) {
+      EXPECT_EQ(42U, result.result);
+      EXPECT_NEAR(0.25, result.time, 1e-6);
+    }
+  }
+  // The last query failed.
+  EXPECT_LT(result.time, 0);
+  EXPECT_FALSE(reader.read(entry, result));
+  EXPECT_EQ("", reader.getError());
+  delete builder;
+}
+
+TEST(QueryLogTest, Reset) {
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("a", 4);
+  ref<Expr> x = Expr::createTempRead(a, Expr::Int32);
+
+  // Forget the definitions after every query.
+  QueryLogWriter writer(1);
+  std::string log;
+  QueryLogWriter::writeHeader(log);
+  std::vector<QueryLogEntry> entries;
+  for (unsigned i = 0; i != 4; ++i) {
+    ConstraintManager cm;
+    cm.addConstraint(UgtExpr::create(x, ConstantExpr::create(i, Expr::Int32)));
+    entries.push_back(QueryLogEntry(Query(cm, EqExpr::create(
+                                                  x, ConstantExpr::create(
+                                                         i + 1, Expr::Int32))),
+                                    QueryLogEntry::Validity));
+    writer.write(log, entries.back(), QueryLogResult(true, i % 3, 0.001));
+  }
+
+  ExprBuilder *builder = createDefaultExprBuilder();
+  ArrayCache readCache;
+  QueryLogReader reader(log.data(), log.data() + log.size(), builder,
+                        readCache);
+  QueryLogEntry entry;
+  QueryLogResult result;
+  for (unsigned i = 0; i != entries.size(); ++i) {
+    ASSERT_TRUE(reader.read(entry, result)) << reader.getError();
+    expectSameEntry(entries[i], entry);
+    EXPECT_EQ(i % 3, result.result);
+    EXPECT_NEAR(0.001, result.time, 1e-6);
+  }
+  EXPECT_FALSE(reader.read(entry, result));
+  delete builder;
+}
+
+TEST(QueryLogTest, Malformed) {
+  std::string log;
+  QueryLogWriter::writeHeader(log);
+  // A query referring to an undefined expression.
+  log += (char) 4;
+  log += std::string(4, '\0');
+
+  ExprBuilder *builder = createDefaultExprBuilder();
+  ArrayCache ac;
+  QueryLogEntry entry;
+  QueryLogResult result;
+  QueryLogReader reader(log.data(), log.data() + log.size(), builder, ac);
+  EXPECT_FALSE(reader.read(entry, result));
+  EXPECT_NE("", reader.getError());
+
+  QueryLogReader truncated(log.data(), log.data() + 2, builder, ac);
+  EXPECT_FALSE(truncated.read(entry, result));
+  EXPECT_NE("", truncated.getError());
+  delete builder;
+}
+
+}
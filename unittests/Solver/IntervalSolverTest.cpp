@@ -0,0 +1,128 @@
+//===-- IntervalSolverTest.cpp --------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Constraints.h"
+#include "klee/Expr.h"
+#include "klee/Solver.h"
+#include "klee/util/ArrayCache.h"
+
+using namespace klee;
+
+namespace {
+
+// The interval tier sits in front of a solver which always fails, so every
+// decided query below was decided by the interval tier itself.
+class IntervalSolverTest : public ::testing::Test {
+protected:
+  ArrayCache ac;
+  Solver *solver;
+  ref<Expr> x, y;
+
+  void SetUp() {
+    solver = createIntervalSolver(createDummySolver());
+    x = Expr::createTempRead(ac.CreateArray("x", 4), Expr::Int32);
+    y = Expr::createTempRead(ac.CreateArray("y", 4), Expr::Int32);
+  }
+
+  void TearDown() { delete solver; }
+
+  ref<Expr> c(uint64_t value, Expr::Width width = Expr::Int32) {
+    return ConstantExpr::create(value, width);
+  }
+};
+
+TEST_F(IntervalSolverTest, UnsignedBounds) {
+  ConstraintManager cm;
+  cm.addConstraint(UltExpr::create(x, c(10)));
+  cm.addConstraint(UgeExpr::create(y, c(100)));
+
+  bool result;
+  ASSERT_TRUE(solver->mustBeTrue(Query(cm, UltExpr::create(x, c(20))),
+                                 result));
+  EXPECT_TRUE(result);
+
+  // Only the constraint on x is needed.
+  std::vector< ref<Expr> > &core = solver->getUnsatCore();
+  ASSERT_EQ(1U, core.size());
+  EXPECT_EQ(UltExpr::create(x, c(10)), core[0]);
+
+  ASSERT_TRUE(solver->mustBeTrue(
+      Query(cm, UltExpr::create(AddExpr::create(x, c(5)), c(15))), result));
+  EXPECT_TRUE(result);
+  ASSERT_TRUE(solver->mustBeTrue(Query(cm, UltExpr::create(x, y)), result));
+  EXPECT_TRUE(result);
+  EXPECT_EQ(2U, solver->getUnsatCore().size());
+}
+
+TEST_F(IntervalSolverTest, Validity) {
+  ConstraintManager cm;
+  cm.addConstraint(UltExpr::create(x, c(10)));
+
+  Solver::Validity result;
+  ASSERT_TRUE(solver->evaluate(Query(cm, EqExpr::create(x, c(50))), result));
+  EXPECT_EQ(Solver::False, result);
+  ASSERT_TRUE(solver->evaluate(Query(cm, UleExpr::create(x, c(9))), result));
+  EXPECT_EQ(Solver::True, result);
+
+  // Both outcomes are possible, which the interval tier cannot decide.
+  EXPECT_FALSE(solver->evaluate(Query(cm, EqExpr::create(x, c(5))), result));
+}
+
+TEST_F(IntervalSolverTest, KnownBits) {
+  ConstraintManager cm;
+  // The low two bits of x are zero.
+  cm.addConstraint(EqExpr::create(AndExpr::create(x, c(3)), c(0)));
+
+  bool result;
+  ASSERT_TRUE(solver->mustBeTrue(
+      Query(cm, NeExpr::create(x, c(6))), result));
+  EXPECT_TRUE(result);
+  ASSERT_TRUE(solver->mustBeTrue(
+      Query(cm, EqExpr::create(ExtractExpr::create(x, 0, Expr::Bool),
+                               c(0, Expr::Bool))),
+      result));
+  EXPECT_TRUE(result);
+  ASSERT_TRUE(solver->mustBeTrue(
+      Query(cm, EqExpr::create(URemExpr::create(x, c(4)), c(0))), result));
+  EXPECT_TRUE(result);
+}
+
+TEST_F(IntervalSolverTest, SignedBounds) {
+  ConstraintManager cm;
+  cm.addConstraint(SltExpr::create(x, c(0)));
+  cm.addConstraint(SgtExpr::create(x, c(0xFFFFFFF8)));
+
+  bool result;
+  ASSERT_TRUE(solver->mustBeTrue(Query(cm, UgeExpr::create(x, c(0xFFFFFFF8))),
+                                 result));
+  EXPECT_TRUE(result);
+  ASSERT_TRUE(solver->mustBeTrue(
+      Query(cm, SltExpr::create(SExtExpr::create(
+                                    ExtractExpr::create(x, 0, Expr::Int8),
+                                    Expr::Int64),
+                                c(0, Expr::Int64))),
+      result));
+  EXPECT_TRUE(result);
+}
+
+TEST_F(IntervalSolverTest, Undecided) {
+  ConstraintManager cm;
+  cm.addConstraint(UltExpr::create(x, c(10)));
+
+  // Nothing is known about y, and the truth tier never claims invalidity.
+  bool result;
+  EXPECT_FALSE(solver->mustBeTrue(Query(cm, UltExpr::create(y, c(10))),
+                                  result));
+  EXPECT_FALSE(solver->mustBeTrue(Query(cm, UltExpr::create(x, c(5))),
+                                  result));
+}
+
+}
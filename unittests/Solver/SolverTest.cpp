@@ -14,6 +14,8 @@
 #include "klee/Constraints.h"
 #include "klee/Expr.h"
 #include "klee/Solver.h"
+#include "klee/Statistics.h"
+#include "klee/Internal/System/Thread.h"
 #include "klee/util/ArrayCache.h"
 #include "llvm/ADT/StringExtras.h"
 
@@ -166,4 +168,85 @@ TEST(SolverTest, Evaluation) {
   delete solver;
 }
 
+#ifdef ENABLE_Z3
+TEST(SolverTest, ParallelIndependentInitialValues) {
+  Solver *solver = klee::createCoreSolver(Z3_SOLVER);
+  std::vector<Solver*> workerSolvers;
+  for (unsigned i = 0; i < 3; i++)
+    workerSolvers.push_back(
+        createCachingSolver(klee::createCoreSolver(Z3_SOLVER)));
+  solver = createIndependentSolver(solver, workerSolvers);
+
+  // Eight independent factors, each fixing one byte of its own array.
+  std::vector<const Array*> objects;
+  ConstraintManager constraints;
+  for (unsigned i = 0; i < 8; i++) {
+    const Array *array = ac.CreateArray("par" + llvm::utostr(i), 1);
+    objects.push_back(array);
+    ref<Expr> read = Expr::createTempRead(array, Expr::Int8);
+    constraints.addConstraint(
+        EqExpr::create(AddExpr::create(read, getConstant(1, Expr::Int8)),
+                       getConstant(10 + i, Expr::Int8)));
+  }
+
+  // A factor looking up a constant table, which the workers copy.
+  ref<ConstantExpr> table[4];
+  for (unsigned i = 0; i < 4; i++)
+    table[i] = ConstantExpr::create(5 + i, Expr::Int8);
+  const Array *tableArray = ac.CreateArray("partable", 4, table, table + 4);
+  const Array *index = ac.CreateArray("parindex", 1);
+  objects.push_back(index);
+  ref<Expr> indexRead = ZExtExpr::create(
+      Expr::createTempRead(index, Expr::Int8), Expr::Int32);
+  constraints.addConstraint(
+      UltExpr::create(indexRead, getConstant(4, Expr::Int32)));
+  constraints.addConstraint(
+      EqExpr::create(ReadExpr::create(UpdateList(tableArray, 0), indexRead),
+                     getConstant(7, Expr::Int8)));
+
+  // Twice, so that the worker chains answer from their caches, which refer
+  // to expressions and arrays copied for the first query.
+  for (unsigned round = 0; round < 2; round++) {
+    std::vector< std::vector<unsigned char> > values;
+    bool success = solver->getInitialValues(
+        Query(constraints, ConstantExpr::alloc(0, Expr::Bool)), objects,
+        values);
+    EXPECT_TRUE(success);
+    ASSERT_EQ(objects.size(), values.size());
+    for (unsigned i = 0; i < 8; i++) {
+      ASSERT_EQ(1U, values[i].size());
+      EXPECT_EQ(9 + i, values[i][0]);
+    }
+    EXPECT_EQ(2, values[8][0]);
+  }
+
+  delete solver;
+}
+#endif
+
+// Registered before any thread starts counting, like the solver statistics.
+Statistic workerCount("SolverTestWorkerCount", "STwc");
+
+class CountingTask : public WorkerPool::Task {
+public:
+  void run(unsigned worker) {
+    for (unsigned i = 0; i < 1000; i++)
+      ++workerCount;
+  }
+};
+
+TEST(SolverTest, WorkerThreadStatistics) {
+  uint64_t before = workerCount.getValue();
+  {
+    WorkerPool pool(4);
+    std::vector<CountingTask> tasks(8);
+    for (unsigned i = 0; i < tasks.size(); i++)
+      pool.enqueue(&tasks[i]);
+    pool.wait();
+    EXPECT_EQ(before + 8000, workerCount.getValue());
+  }
+  // The counts remain once the threads have left.
+  EXPECT_EQ(before + 8000, workerCount.getValue());
+}
+
 }